@@ -33,6 +33,7 @@
 #include <Urho3D/Graphics/Zone.h>
 #include <Urho3D/Input/Input.h>
 #include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/LogicComponent.h>
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/UI/Font.h>
 #include <Urho3D/UI/Text.h>
@@ -40,9 +41,11 @@
 #include <Urho3D/Input/FreeFlyController.h>
 
 #include "HugeObjectCount.h"
+#include "Rotator.h"
 
 #include <Urho3D/DebugNew.h>
 
+static const float ROTATE_SPEED = 15.0f;
 
 HugeObjectCount::HugeObjectCount(Context* context)
     : Sample(context)
@@ -86,6 +89,10 @@ void HugeObjectCount::CreateScene()
     // (-1000, -1000, -1000) to (1000, 1000, 1000)
     scene_->CreateComponent<Octree>();
 
+    // Logic components of the scene are updated in batches if the scene has LogicComponentManager
+    if (animationMode_ == AnimationMode::BatchedLogicComponents)
+        scene_->CreateComponent<LogicComponentManager>();
+
     // Create a Zone for ambient light & fog control
     Node* zoneNode = scene_->CreateChild("Zone");
     auto* zone = zoneNode->CreateComponent<Zone>();
@@ -149,6 +156,17 @@ void HugeObjectCount::CreateScene()
         }
     }
 
+    // Create rotators if the objects are animated by logic components
+    if (animationMode_ != AnimationMode::MainLoop)
+    {
+        for (Node* boxNode : boxNodes_)
+        {
+            auto* rotator = boxNode->CreateComponent<Rotator>();
+            rotator->SetRotationSpeed(Vector3(0.0f, 0.0f, ROTATE_SPEED));
+        }
+        UpdateLogicComponents();
+    }
+
     // Create the camera. Create it outside the scene so that we can clear the whole scene without affecting it
     if (!cameraNode_)
     {
@@ -170,7 +188,8 @@ void HugeObjectCount::CreateInstructions()
     instructionText->SetText(
         "Use WASD keys and mouse/touch to move\n"
         "Space to toggle animation\n"
-        "G to toggle object group optimization"
+        "G to toggle object group optimization\n"
+        "L to switch animation between main loop, logic components and batched logic components"
     );
     instructionText->SetFont(cache->GetResource<Font>("Fonts/Anonymous Pro.ttf"), 15);
     // The text has multiple rows. Center them in relation to each other
@@ -196,7 +215,6 @@ void HugeObjectCount::AnimateObjects(float timeStep)
 {
     URHO3D_PROFILE("AnimateObjects");
 
-    const float ROTATE_SPEED = 15.0f;
     // Rotate about the Z axis (roll)
     Quaternion rotateQuat(ROTATE_SPEED * timeStep, Vector3::FORWARD);
 
@@ -209,7 +227,10 @@ void HugeObjectCount::Update(float timeStep)
     // Toggle animation with space
     auto* input = GetSubsystem<Input>();
     if (input->GetKeyPress(KEY_SPACE))
+    {
         animate_ = !animate_;
+        UpdateLogicComponents();
+    }
 
     // Toggle grouped / ungrouped mode
     if (input->GetKeyPress(KEY_G))
@@ -218,7 +239,28 @@ void HugeObjectCount::Update(float timeStep)
         CreateScene();
     }
 
+    // Switch animation method. Compare "UpdateScene" profiler block between the modes
+    if (input->GetKeyPress(KEY_L))
+    {
+        switch (animationMode_)
+        {
+        case AnimationMode::MainLoop: animationMode_ = AnimationMode::LogicComponents; break;
+        case AnimationMode::LogicComponents: animationMode_ = AnimationMode::BatchedLogicComponents; break;
+        case AnimationMode::BatchedLogicComponents: animationMode_ = AnimationMode::MainLoop; break;
+        }
+        CreateScene();
+    }
+
     // Animate scene if enabled
-    if (animate_)
+    if (animate_ && animationMode_ == AnimationMode::MainLoop)
         AnimateObjects(timeStep);
 }
+
+void HugeObjectCount::UpdateLogicComponents()
+{
+    for (Node* boxNode : boxNodes_)
+    {
+        if (auto* rotator = boxNode->GetComponent<Rotator>())
+            rotator->SetEnabled(animate_);
+    }
+}
@@ -39,6 +39,8 @@ class Scene;
 ///     - Allowing examination of performance hotspots in the rendering code
 ///     - Using the profiler to measure the time taken to animate the scene
 ///     - Optionally speeding up rendering by grouping objects with the StaticModelGroup component
+///     - Comparing animation by the main loop, by logic components with individual event subscriptions
+///       and by logic components updated in batches with the LogicComponentManager component
 class HugeObjectCount : public Sample
 {
     URHO3D_OBJECT(HugeObjectCount, Sample);
@@ -74,6 +76,17 @@ protected:
     }
 
 private:
+    /// Method used to animate the objects.
+    enum class AnimationMode
+    {
+        /// Rotate the nodes in the sample update.
+        MainLoop,
+        /// Rotate the nodes by logic components with individual event subscriptions.
+        LogicComponents,
+        /// Rotate the nodes by logic components updated in batches.
+        BatchedLogicComponents,
+    };
+
     /// Construct the scene content.
     void CreateScene();
     /// Construct an instruction text to the UI.
@@ -82,6 +95,8 @@ private:
     void SetupViewport();
     /// Animate the scene.
     void AnimateObjects(float timeStep);
+    /// Enable or disable logic components of the objects.
+    void UpdateLogicComponents();
     /// Handle the logic update event.
     void Update(float timeStep) override;
 
@@ -91,4 +106,6 @@ private:
     bool animate_;
     /// Group optimization flag.
     bool useGroups_;
+    /// Animation method.
+    AnimationMode animationMode_{AnimationMode::MainLoop};
 };
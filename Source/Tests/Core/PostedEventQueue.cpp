@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/TypedEvent.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Scene/Node.h>
+
+#include <thread>
+
+namespace
+{
+
+URHO3D_EVENT(E_POSTEDEVENTTEST, PostedEventTest)
+{
+    URHO3D_PARAM(P_PRODUCER, Producer);            // unsigned
+    URHO3D_PARAM(P_INDEX, Index);                  // unsigned
+}
+
+URHO3D_EVENT(E_TYPEDPOSTEDEVENTTEST, TypedPostedEventTest)
+{
+    URHO3D_PARAM(P_VALUE, Value);                  // int
+}
+
+namespace Ev
+{
+
+struct TypedPostedEventTest
+{
+    URHO3D_TYPED_EVENT(E_TYPEDPOSTEDEVENTTEST);
+
+    int value_{};
+
+    void ToVariantMap(VariantMap& eventData) const { eventData[::TypedPostedEventTest::P_VALUE] = value_; }
+    void FromVariantMap(const VariantMap& eventData)
+    {
+        value_ = GetEventParameter(eventData, ::TypedPostedEventTest::P_VALUE).GetInt();
+    }
+};
+
+}
+
+}
+
+TEST_CASE("Events posted from other threads are delivered from main thread")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto queue = context->GetPostedEventQueue();
+
+    auto sender = MakeShared<Node>(context);
+    auto receiver = MakeShared<Node>(context);
+
+    ea::vector<ea::pair<unsigned, unsigned>> receivedEvents;
+    receiver->SubscribeToEvent(sender, E_POSTEDEVENTTEST, [&](StringHash, VariantMap& eventData)
+    {
+        using namespace PostedEventTest;
+        REQUIRE(WorkQueue::GetThreadIndex() == 0);
+        receivedEvents.emplace_back(eventData[P_PRODUCER].GetUInt(), eventData[P_INDEX].GetUInt());
+    });
+
+    ea::vector<int> typedValues;
+    receiver->SubscribeToEvent<Ev::TypedPostedEventTest>(sender, [&](const Ev::TypedPostedEventTest& event)
+    {
+        typedValues.push_back(event.value_);
+
+        // Events posted during delivery are delayed until next flush
+        if (event.value_ == 1)
+            sender->PostEvent<Ev::TypedPostedEventTest>({2});
+    });
+
+    SECTION("Events are delivered in order of source ID and posting order")
+    {
+        const unsigned numThreads = 4;
+        const unsigned numEventsPerThread = 1000;
+
+        ea::vector<std::thread> threads;
+        for (unsigned producer = 0; producer < numThreads; ++producer)
+        {
+            threads.emplace_back([&, producer]()
+            {
+                using namespace PostedEventTest;
+                for (unsigned i = 0; i < numEventsPerThread; ++i)
+                {
+                    VariantMap eventData;
+                    eventData[P_PRODUCER] = producer;
+                    eventData[P_INDEX] = i;
+                    sender->PostEvent(E_POSTEDEVENTTEST, eventData, producer);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+
+        CHECK(receivedEvents.empty());
+        CHECK(queue->GetNumPendingEvents() == numThreads * numEventsPerThread);
+
+        context->ProcessPostedEvents();
+
+        REQUIRE(receivedEvents.size() == numThreads * numEventsPerThread);
+        CHECK(queue->GetNumPendingEvents() == 0);
+        CHECK(queue->GetLastStats().numEvents_ == numThreads * numEventsPerThread);
+        CHECK(queue->GetLastStats().numEventTypes_ == 1);
+
+        // Order doesn't depend on scheduling of producer threads
+        unsigned numMismatches = 0;
+        for (unsigned i = 0; i < receivedEvents.size(); ++i)
+        {
+            if (receivedEvents[i].first != i / numEventsPerThread || receivedEvents[i].second != i % numEventsPerThread)
+                ++numMismatches;
+        }
+        CHECK(numMismatches == 0);
+    }
+
+    SECTION("Typed events are posted from WorkQueue threads")
+    {
+        auto workQueue = context->GetSubsystem<WorkQueue>();
+        ea::vector<int> values(100, 0);
+        ForEachParallel(workQueue, 8u, values, [&](unsigned index, int& value)
+        {
+            value = static_cast<int>(index) + 10;
+            sender->PostEvent<Ev::TypedPostedEventTest>({value}, index + 1);
+        });
+        sender->PostEvent<Ev::TypedPostedEventTest>({1});
+
+        context->ProcessPostedEvents();
+        REQUIRE(typedValues.size() == 101);
+        CHECK(ea::count(typedValues.begin(), typedValues.end(), 2) == 0);
+
+        // Events are ordered by job index regardless of the thread that executed the job
+        CHECK(typedValues[0] == 1);
+        for (unsigned i = 1; i < typedValues.size(); ++i)
+            CHECK(typedValues[i] == values[i - 1]);
+
+        // Event posted during delivery is pending
+        CHECK(queue->GetNumPendingEvents() == 1);
+        context->ProcessPostedEvents();
+        REQUIRE(typedValues.size() == 102);
+        CHECK(typedValues.back() == 2);
+    }
+
+    SECTION("Pending events are discarded on clear")
+    {
+        sender->PostEvent(E_POSTEDEVENTTEST);
+        queue->Clear();
+        context->ProcessPostedEvents();
+        CHECK(receivedEvents.empty());
+        CHECK(queue->GetLastStats().numEvents_ == 0);
+    }
+}
@@ -0,0 +1,222 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/TypedEvent.h>
+#include <Urho3D/Scene/Node.h>
+
+namespace
+{
+
+URHO3D_EVENT(E_TYPEDEVENTTEST, TypedEventTest)
+{
+    URHO3D_PARAM(P_NODE, Node);                    // Node pointer
+    URHO3D_PARAM(P_VALUE, Value);                  // float
+}
+
+namespace Ev
+{
+
+struct TypedEventTest
+{
+    URHO3D_TYPED_EVENT(E_TYPEDEVENTTEST);
+
+    Node* node_{};
+    float value_{};
+
+    void ToVariantMap(VariantMap& eventData) const
+    {
+        eventData[::TypedEventTest::P_NODE] = node_;
+        eventData[::TypedEventTest::P_VALUE] = value_;
+    }
+
+    void FromVariantMap(const VariantMap& eventData)
+    {
+        node_ = static_cast<Node*>(GetEventParameter(eventData, ::TypedEventTest::P_NODE).GetPtr());
+        value_ = GetEventParameter(eventData, ::TypedEventTest::P_VALUE).GetFloat();
+    }
+};
+
+}
+
+}
+
+TEST_CASE("Typed events interoperate with VariantMap events")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+
+    auto sender = MakeShared<Node>(context);
+    auto otherSender = MakeShared<Node>(context);
+    auto typedReceiver = MakeShared<Node>(context);
+    auto legacyReceiver = MakeShared<Node>(context);
+
+    ea::vector<ea::pair<Node*, float>> typedEvents;
+    ea::vector<ea::pair<Node*, float>> legacyEvents;
+
+    typedReceiver->SubscribeToEvent<Ev::TypedEventTest>(sender, [&](const Ev::TypedEventTest& event)
+    {
+        typedEvents.emplace_back(event.node_, event.value_);
+    });
+    legacyReceiver->SubscribeToEvent(sender, E_TYPEDEVENTTEST, [&](StringHash, VariantMap& eventData)
+    {
+        using namespace TypedEventTest;
+        legacyEvents.emplace_back(static_cast<Node*>(eventData[P_NODE].GetPtr()), eventData[P_VALUE].GetFloat());
+    });
+
+    SECTION("Typed event is received by typed and VariantMap subscribers")
+    {
+        sender->SendEvent<Ev::TypedEventTest>({sender, 0.5f});
+        otherSender->SendEvent<Ev::TypedEventTest>({otherSender, 1.0f});
+
+        REQUIRE(typedEvents.size() == 1);
+        CHECK(typedEvents[0].first == sender);
+        CHECK(typedEvents[0].second == 0.5f);
+        REQUIRE(legacyEvents.size() == 1);
+        CHECK(legacyEvents[0].first == sender);
+        CHECK(legacyEvents[0].second == 0.5f);
+    }
+
+    SECTION("VariantMap event is received by typed and VariantMap subscribers")
+    {
+        using namespace TypedEventTest;
+        VariantMap eventData;
+        eventData[P_NODE] = sender.Get();
+        eventData[P_VALUE] = 0.25f;
+        sender->SendEvent(E_TYPEDEVENTTEST, eventData);
+
+        REQUIRE(typedEvents.size() == 1);
+        CHECK(typedEvents[0].first == sender);
+        CHECK(typedEvents[0].second == 0.25f);
+        REQUIRE(legacyEvents.size() == 1);
+        CHECK(legacyEvents[0].second == 0.25f);
+    }
+
+    SECTION("Typed subscriptions are removed on unsubscribe and receiver destruction")
+    {
+        auto anySenderReceiver = MakeShared<Node>(context);
+        unsigned numAnySenderEvents = 0;
+        anySenderReceiver->SubscribeToEvent<Ev::TypedEventTest>([&](const Ev::TypedEventTest&) { ++numAnySenderEvents; });
+
+        sender->SendEvent<Ev::TypedEventTest>({sender, 0.5f});
+        otherSender->SendEvent<Ev::TypedEventTest>({otherSender, 0.5f});
+        CHECK(numAnySenderEvents == 2);
+
+        typedReceiver->UnsubscribeFromEvent<Ev::TypedEventTest>(sender);
+        anySenderReceiver = nullptr;
+
+        sender->SendEvent<Ev::TypedEventTest>({sender, 0.5f});
+        CHECK(numAnySenderEvents == 2);
+        CHECK(typedEvents.size() == 1);
+        CHECK(legacyEvents.size() == 2);
+    }
+
+    SECTION("Typed subscriptions are skipped for blocked receivers and removed on sender destruction")
+    {
+        typedReceiver->SetBlockEvents(true);
+        sender->SendEvent<Ev::TypedEventTest>({sender, 0.5f});
+        CHECK(typedEvents.size() == 0);
+
+        typedReceiver->SetBlockEvents(false);
+        sender->SendEvent<Ev::TypedEventTest>({sender, 0.5f});
+        CHECK(typedEvents.size() == 1);
+
+        auto deadSender = MakeShared<Node>(context);
+        unsigned numDeadSenderEvents = 0;
+        typedReceiver->UnsubscribeFromAllEvents();
+        legacyReceiver->SubscribeToEvent<Ev::TypedEventTest>(deadSender, [&](const Ev::TypedEventTest&) { ++numDeadSenderEvents; });
+        deadSender = nullptr;
+
+        sender->SendEvent<Ev::TypedEventTest>({sender, 0.5f});
+        CHECK(numDeadSenderEvents == 0);
+
+        auto receivers = static_cast<TypedEventReceivers<Ev::TypedEventTest>*>(context->GetTypedEventReceivers(E_TYPEDEVENTTEST));
+        CHECK((!receivers || receivers->IsEmpty()));
+    }
+
+    SECTION("Receivers may subscribe and unsubscribe during typed event")
+    {
+        auto lateReceiver = MakeShared<Node>(context);
+        unsigned numLateEvents = 0;
+        typedReceiver->SubscribeToEvent<Ev::TypedEventTest>(sender, [&](const Ev::TypedEventTest& event)
+        {
+            typedEvents.emplace_back(event.node_, event.value_);
+            typedReceiver->UnsubscribeFromAllEvents();
+            lateReceiver->SubscribeToEvent<Ev::TypedEventTest>(sender, [&](const Ev::TypedEventTest&) { ++numLateEvents; });
+        });
+
+        sender->SendEvent<Ev::TypedEventTest>({sender, 0.5f});
+        CHECK(typedEvents.size() == 1);
+        CHECK(numLateEvents == 0);
+
+        sender->SendEvent<Ev::TypedEventTest>({sender, 0.5f});
+        CHECK(typedEvents.size() == 1);
+        CHECK(numLateEvents == 1);
+    }
+}
+
+TEST_CASE("Typed events are faster than VariantMap events", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+
+    const unsigned numReceivers = 1000;
+    const unsigned numEvents = 1000;
+
+    // Typed events are also delivered to VariantMap subscribers, so each kind of event has its own sender
+    auto typedSender = MakeShared<Node>(context);
+    auto legacySender = MakeShared<Node>(context);
+    ea::vector<SharedPtr<Object>> receivers;
+    float sum = 0.0f;
+    for (unsigned i = 0; i < numReceivers; ++i)
+    {
+        auto typedReceiver = MakeShared<Node>(context);
+        typedReceiver->SubscribeToEvent<Ev::TypedEventTest>(typedSender, [&](const Ev::TypedEventTest& event) { sum += event.value_; });
+        receivers.push_back(typedReceiver);
+
+        auto legacyReceiver = MakeShared<Node>(context);
+        legacyReceiver->SubscribeToEvent(legacySender, E_TYPEDEVENTTEST, [&](StringHash, VariantMap& eventData)
+        {
+            using namespace TypedEventTest;
+            sum += eventData[P_VALUE].GetFloat();
+        });
+        receivers.push_back(legacyReceiver);
+    }
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < numEvents; ++i)
+        typedSender->SendEvent<Ev::TypedEventTest>({typedSender, 1.0f});
+    const long long typedUSec = timer.GetUSec(true);
+
+    for (unsigned i = 0; i < numEvents; ++i)
+    {
+        using namespace TypedEventTest;
+        VariantMap& eventData = legacySender->GetEventDataMap();
+        eventData[P_VALUE] = 1.0f;
+        legacySender->SendEvent(E_TYPEDEVENTTEST, eventData);
+    }
+    const long long legacyUSec = timer.GetUSec(true);
+
+    WARN("Typed events: " << typedUSec << " us, VariantMap events: " << legacyUSec << " us, "
+        << numEvents << " events to " << numReceivers << " receivers");
+    CHECK(sum == 2.0f * numReceivers * numEvents);
+}
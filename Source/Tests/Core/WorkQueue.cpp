@@ -0,0 +1,212 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+
+namespace
+{
+
+SharedPtr<Context> CreateContext()
+{
+    // Only one context may exist at a time, and WorkQueue thread indices are global
+    Tests::ResetContext();
+    return MakeShared<Context>();
+}
+
+SharedPtr<WorkQueue> CreateWorkQueue(Context* context, unsigned numThreads)
+{
+    auto workQueue = MakeShared<WorkQueue>(context);
+    if (numThreads > 0)
+        workQueue->CreateThreads(numThreads);
+    return workQueue;
+}
+
+}
+
+TEST_CASE("WorkQueue tasks are executed after their dependencies")
+{
+    auto context = CreateContext();
+    const unsigned numThreads = GENERATE(0u, 3u);
+    auto workQueue = CreateWorkQueue(context, numThreads);
+
+    SECTION("Diamond graph")
+    {
+        std::atomic<unsigned> counter{};
+        unsigned orderA{}, orderB{}, orderC{}, orderD{};
+
+        const TaskHandle taskA = workQueue->CreateTask([&](unsigned) { orderA = counter++; });
+        const TaskHandle taskB = workQueue->ScheduleContinuation(taskA, [&](unsigned) { orderB = counter++; });
+        const TaskHandle taskC = workQueue->ScheduleContinuation(taskA, [&](unsigned) { orderC = counter++; });
+        const TaskHandle dependencies[] = {taskB, taskC};
+        const TaskHandle taskD = workQueue->ScheduleTask([&](unsigned) { orderD = counter++; }, dependencies);
+
+        CHECK_FALSE(workQueue->IsTaskCompleted(taskA));
+        CHECK_FALSE(workQueue->IsTaskCompleted(taskD));
+
+        workQueue->SubmitTask(taskA);
+        workQueue->WaitTask(taskD);
+
+        CHECK(workQueue->IsTaskCompleted(taskA));
+        CHECK(workQueue->IsTaskCompleted(taskB));
+        CHECK(workQueue->IsTaskCompleted(taskC));
+        CHECK(workQueue->IsTaskCompleted(taskD));
+
+        CHECK(counter == 4);
+        CHECK(orderA == 0);
+        CHECK(orderB > orderA);
+        CHECK(orderC > orderA);
+        CHECK(orderD == 3);
+    }
+
+    SECTION("Dependency on completed task")
+    {
+        bool firstExecuted = false;
+        bool secondExecuted = false;
+
+        const TaskHandle firstTask = workQueue->ScheduleTask([&](unsigned) { firstExecuted = true; });
+        workQueue->WaitTask(firstTask);
+        REQUIRE(firstExecuted);
+
+        const TaskHandle secondTask = workQueue->ScheduleContinuation(firstTask, [&](unsigned) { secondExecuted = true; });
+        workQueue->WaitTask(secondTask);
+        CHECK(secondExecuted);
+    }
+
+    SECTION("Wide fan-in and long chain")
+    {
+        const unsigned numTasks = 10000;
+        std::atomic<unsigned> counter{};
+
+        ea::vector<TaskHandle> tasks;
+        for (unsigned i = 0; i < numTasks; ++i)
+            tasks.push_back(workQueue->ScheduleTask([&](unsigned) { ++counter; }));
+
+        unsigned counterAtJoin{};
+        TaskHandle lastTask = workQueue->ScheduleTask([&](unsigned) { counterAtJoin = counter; }, tasks);
+
+        unsigned chainLength = 0;
+        for (unsigned i = 0; i < 100; ++i)
+        {
+            lastTask = workQueue->ScheduleContinuation(lastTask, [&, i](unsigned)
+            {
+                if (chainLength == i)
+                    ++chainLength;
+            });
+        }
+
+        workQueue->WaitTask(lastTask);
+        CHECK(counterAtJoin == numTasks);
+        CHECK(chainLength == 100);
+        CHECK(workQueue->GetNumPendingTasks() == 0);
+    }
+
+    SECTION("ForEachParallel")
+    {
+        ea::vector<unsigned> elements(10000);
+        ForEachParallel(workQueue, 16u, elements, [](unsigned index, unsigned& element) { element += index + 1; });
+
+        unsigned numMismatches = 0;
+        for (unsigned i = 0; i < elements.size(); ++i)
+        {
+            if (elements[i] != i + 1)
+                ++numMismatches;
+        }
+        CHECK(numMismatches == 0);
+    }
+
+    SECTION("Task pool overflow")
+    {
+        workQueue->SetMaxPendingTasks(1024);
+
+        const unsigned numTasks = 3000;
+        std::atomic<unsigned> counter{};
+        ea::vector<TaskHandle> tasks;
+        for (unsigned i = 0; i < numTasks; ++i)
+            tasks.push_back(workQueue->CreateTask([&](unsigned) { ++counter; }));
+
+        const unsigned numInlineTasks = ea::count_if(tasks.begin(), tasks.end(), [](const TaskHandle& task) { return !task.IsValid(); });
+        CHECK(numInlineTasks >= numTasks - 1024);
+        CHECK(counter == numInlineTasks);
+
+        for (const TaskHandle& task : tasks)
+            workQueue->SubmitTask(task);
+
+        const TaskHandle lastTask = workQueue->ScheduleTask([&](unsigned) { ++counter; }, tasks);
+        workQueue->WaitTask(lastTask);
+        CHECK(counter == numTasks + 1);
+        CHECK(workQueue->GetNumPendingTasks() == 0);
+    }
+}
+
+TEST_CASE("WorkQueue task throughput scales with number of threads", "[.benchmark]")
+{
+    const unsigned numTasks = 200000;
+    const unsigned batchSize = 1000;
+    const unsigned maxThreads = ea::max(GetNumLogicalCPUs(), 1u);
+
+    for (unsigned numThreads = 1; numThreads <= maxThreads; ++numThreads)
+    {
+        auto context = CreateContext();
+        // Time initializes HiresTimer frequency
+        context->RegisterSubsystem<Time>();
+        auto workQueue = CreateWorkQueue(context, numThreads - 1);
+
+        std::atomic<unsigned> counter{};
+        const auto taskFunction = [&counter](unsigned)
+        {
+            // Some trivial work so the benchmark isn't dominated by counter contention
+            unsigned value = counter.load(std::memory_order_relaxed);
+            for (unsigned i = 0; i < 64; ++i)
+                value = value * 1664525u + 1013904223u;
+            counter.fetch_add(value & 1, std::memory_order_relaxed);
+        };
+
+        ea::vector<TaskHandle> tasks;
+        tasks.reserve(batchSize);
+
+        HiresTimer timer;
+        for (unsigned batchIndex = 0; batchIndex < numTasks / batchSize; ++batchIndex)
+        {
+            tasks.clear();
+            for (unsigned i = 0; i < batchSize; ++i)
+                tasks.push_back(workQueue->ScheduleTask(taskFunction));
+            workQueue->WaitTasks(tasks);
+        }
+        const long long taskGraphUSec = ea::max(timer.GetUSec(true), 1ll);
+
+        for (unsigned batchIndex = 0; batchIndex < numTasks / batchSize; ++batchIndex)
+        {
+            for (unsigned i = 0; i < batchSize; ++i)
+                workQueue->AddWorkItem(taskFunction, M_MAX_UNSIGNED);
+            workQueue->Complete(M_MAX_UNSIGNED);
+        }
+        const long long workItemUSec = ea::max(timer.GetUSec(true), 1ll);
+
+        WARN("Threads: " << numThreads
+            << ", tasks/sec: " << static_cast<long long>(numTasks * 1000000.0 / taskGraphUSec)
+            << ", work items/sec: " << static_cast<long long>(numTasks * 1000000.0 / workItemUSec));
+    }
+}
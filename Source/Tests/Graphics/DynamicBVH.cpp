@@ -0,0 +1,289 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/DynamicBVH.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Math/RandomEngine.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <EASTL/sort.h>
+
+namespace
+{
+
+class SpatialIndexTestDrawable : public Drawable
+{
+    URHO3D_OBJECT(SpatialIndexTestDrawable, Drawable);
+
+public:
+    explicit SpatialIndexTestDrawable(Context* context)
+        : Drawable(context, DRAWABLE_GEOMETRY)
+    {
+    }
+
+    void SetBoundingBox(const BoundingBox& box)
+    {
+        boundingBox_ = box;
+        OnMarkedDirty(node_);
+    }
+
+protected:
+    void OnWorldBoundingBoxUpdate() override
+    {
+        worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+    }
+};
+
+SharedPtr<Scene> CreateTestScene(Context* context, bool useDynamicBVH, unsigned numDrawables)
+{
+    auto scene = MakeShared<Scene>(context);
+    auto octree = scene->CreateComponent<Octree>();
+    octree->SetSize(BoundingBox(-500.0f, 500.0f), 6);
+    if (useDynamicBVH)
+        octree->SetSpatialIndex(ea::make_unique<DynamicBVH>(context->GetSubsystem<WorkQueue>()));
+
+    // Some drawables are outside of octree bounds
+    RandomEngine random(0);
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        Node* node = scene->CreateChild();
+        node->SetPosition(random.GetVector3(Vector3::ONE * -1000.0f, Vector3::ONE * 1000.0f));
+        auto drawable = node->CreateComponent<SpatialIndexTestDrawable>();
+        const Vector3 halfSize = random.GetVector3(Vector3::ONE * 0.5f, Vector3::ONE * 10.0f);
+        drawable->SetBoundingBox(BoundingBox(-halfSize, halfSize));
+    }
+    octree->Update(FrameInfo{});
+    return scene;
+}
+
+void MoveNodes(Scene* scene, unsigned step, float distance, unsigned seed)
+{
+    RandomEngine random(seed);
+    const ea::vector<SharedPtr<Node>>& children = scene->GetChildren();
+    for (unsigned i = 0; i < children.size(); i += step)
+        children[i]->Translate(random.GetVector3(Vector3::ONE * -distance, Vector3::ONE * distance));
+}
+
+ea::vector<unsigned> GetNodeIds(const ea::vector<Drawable*>& drawables)
+{
+    ea::vector<unsigned> result;
+    for (Drawable* drawable : drawables)
+        result.push_back(drawable->GetNode()->GetID());
+    ea::sort(result.begin(), result.end());
+    return result;
+}
+
+ea::vector<unsigned> GetNodeIds(const ea::vector<RayQueryResult>& results)
+{
+    ea::vector<unsigned> result;
+    for (const RayQueryResult& queryResult : results)
+        result.push_back(queryResult.node_->GetID());
+    ea::sort(result.begin(), result.end());
+    return result;
+}
+
+ea::vector<unsigned> QueryFrustum(Octree* octree, const Frustum& frustum)
+{
+    ea::vector<Drawable*> result;
+    FrustumOctreeQuery query(result, frustum);
+    octree->GetDrawables(query);
+    return GetNodeIds(result);
+}
+
+ea::vector<unsigned> QuerySphere(Octree* octree, const Sphere& sphere)
+{
+    ea::vector<Drawable*> result;
+    octree->GetDrawablesInSphere(result, sphere);
+    return GetNodeIds(result);
+}
+
+ea::vector<unsigned> QueryRay(Octree* octree, const Ray& ray)
+{
+    ea::vector<RayQueryResult> result;
+    RayOctreeQuery query(result, ray, RAY_AABB, 5000.0f);
+    octree->Raycast(query);
+    return GetNodeIds(result);
+}
+
+unsigned QueryRaySingle(Octree* octree, const Ray& ray)
+{
+    ea::vector<RayQueryResult> result;
+    RayOctreeQuery query(result, ray, RAY_AABB, 5000.0f);
+    octree->RaycastSingle(query);
+    return result.empty() ? 0 : result[0].node_->GetID();
+}
+
+void CheckSameQueryResults(Octree* expectedOctree, Octree* actualOctree)
+{
+    Frustum frustum;
+    frustum.Define(BoundingBox(Vector3(-300.0f, -200.0f, -100.0f), Vector3(400.0f, 300.0f, 600.0f)));
+    const Sphere sphere(Vector3(700.0f, 0.0f, -700.0f), 250.0f);
+    // Aim the ray at some drawable so it hits at least one
+    const Vector3 rayOrigin(-1100.0f, 3.0f, -5.0f);
+    const Vector3 rayTarget = expectedOctree->GetScene()->GetChildren().back()->GetWorldPosition();
+    const Ray ray(rayOrigin, rayTarget - rayOrigin);
+
+    const auto expectedFrustum = QueryFrustum(expectedOctree, frustum);
+    const auto expectedSphere = QuerySphere(expectedOctree, sphere);
+    const auto expectedRay = QueryRay(expectedOctree, ray);
+    REQUIRE_FALSE(expectedFrustum.empty());
+    REQUIRE_FALSE(expectedSphere.empty());
+    REQUIRE_FALSE(expectedRay.empty());
+
+    CHECK(QueryFrustum(actualOctree, frustum) == expectedFrustum);
+    CHECK(QuerySphere(actualOctree, sphere) == expectedSphere);
+    CHECK(QueryRay(actualOctree, ray) == expectedRay);
+    CHECK(QueryRaySingle(actualOctree, ray) == QueryRaySingle(expectedOctree, ray));
+}
+
+}
+
+TEST_CASE("Octree with DynamicBVH returns the same drawables as with octants")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<SpatialIndexTestDrawable>(context);
+
+    const unsigned numDrawables = 5000;
+    auto octreeScene = CreateTestScene(context, false, numDrawables);
+    auto bvhScene = CreateTestScene(context, true, numDrawables);
+    auto octree = octreeScene->GetComponent<Octree>();
+    auto bvhOctree = bvhScene->GetComponent<Octree>();
+    auto bvh = static_cast<DynamicBVH*>(bvhOctree->GetSpatialIndex());
+
+    // Initial insertion triggers rebuild
+    REQUIRE(bvh->GetNumDrawables() == numDrawables);
+    CHECK(bvh->GetNumRebuilds() == 1);
+    CHECK(bvh->GetNumChangesSinceRebuild() == 0);
+    CHECK(bvh->GetHeight() <= 14);
+    CheckSameQueryResults(octree, bvhOctree);
+
+    SECTION("Few drawables are refitted")
+    {
+        for (Scene* scene : {octreeScene.Get(), bvhScene.Get()})
+        {
+            MoveNodes(scene, 50, 100.0f, 1);
+            scene->GetComponent<Octree>()->Update(FrameInfo{});
+        }
+
+        CHECK(bvh->GetNumRebuilds() == 1);
+        CHECK(bvh->GetNumChangesSinceRebuild() > 0);
+        CheckSameQueryResults(octree, bvhOctree);
+    }
+
+    SECTION("Many drawables are rebuilt")
+    {
+        for (Scene* scene : {octreeScene.Get(), bvhScene.Get()})
+        {
+            MoveNodes(scene, 1, 100.0f, 1);
+            scene->GetComponent<Octree>()->Update(FrameInfo{});
+        }
+
+        CHECK(bvh->GetNumRebuilds() == 2);
+        CheckSameQueryResults(octree, bvhOctree);
+    }
+
+    SECTION("Drawables are added and removed")
+    {
+        for (Scene* scene : {octreeScene.Get(), bvhScene.Get()})
+        {
+            const ea::vector<SharedPtr<Node>> children = scene->GetChildren();
+            for (unsigned i = 0; i < children.size(); i += 3)
+                children[i]->Remove();
+            for (unsigned i = 0; i < children.size(); i += 7)
+            {
+                Node* node = scene->CreateChild();
+                node->SetPosition(children[i]->GetPosition());
+                node->CreateComponent<SpatialIndexTestDrawable>()->SetBoundingBox(BoundingBox(-5.0f, 5.0f));
+            }
+            scene->GetComponent<Octree>()->Update(FrameInfo{});
+        }
+
+        CHECK(bvh->GetNumDrawables() == octree->GetAllDrawables().size());
+        CheckSameQueryResults(octree, bvhOctree);
+    }
+
+    SECTION("Spatial index is changed for non-empty octree")
+    {
+        octree->SetSpatialIndex(ea::make_unique<DynamicBVH>());
+        octree->Update(FrameInfo{});
+        CheckSameQueryResults(bvhOctree, octree);
+
+        bvhOctree->SetSpatialIndex(nullptr);
+        CHECK(bvhOctree->GetSpatialIndex() == nullptr);
+        CheckSameQueryResults(octree, bvhOctree);
+    }
+}
+
+TEST_CASE("DynamicBVH and octants are compared in static and dynamic scenes", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<SpatialIndexTestDrawable>(context);
+
+    const unsigned numDrawables = 100000;
+    const unsigned numFrames = 20;
+    const unsigned numQueriesPerFrame = 10;
+
+    Frustum frustum;
+    frustum.Define(BoundingBox(Vector3(-300.0f, -200.0f, -100.0f), Vector3(400.0f, 300.0f, 600.0f)));
+
+    for (const unsigned movingStep : {100u, 2u})
+    {
+        for (const bool useDynamicBVH : {false, true})
+        {
+            auto scene = CreateTestScene(context, useDynamicBVH, numDrawables);
+            auto octree = scene->GetComponent<Octree>();
+
+            long long updateUSec = 0;
+            long long queryUSec = 0;
+            unsigned numResults = 0;
+            HiresTimer timer;
+            for (unsigned frame = 0; frame < numFrames; ++frame)
+            {
+                timer.Reset();
+                MoveNodes(scene, movingStep, 20.0f, frame);
+                octree->Update(FrameInfo{});
+                updateUSec += timer.GetUSec(true);
+
+                ea::vector<Drawable*> result;
+                for (unsigned i = 0; i < numQueriesPerFrame; ++i)
+                {
+                    FrustumOctreeQuery query(result, frustum);
+                    octree->GetDrawables(query);
+                }
+                queryUSec += timer.GetUSec(true);
+                numResults += result.size();
+            }
+
+            WARN((movingStep > 2 ? "Static-heavy" : "Dynamic-heavy") << " scene, "
+                << (useDynamicBVH ? "DynamicBVH" : "Octants") << ": update " << updateUSec / numFrames << " us"
+                << ", query " << queryUSec / (numFrames * numQueriesPerFrame) << " us"
+                << ", visible " << numResults / numFrames);
+        }
+    }
+}
@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Math/RandomEngine.h>
+#include <Urho3D/Scene/Scene.h>
+
+namespace
+{
+
+class CullingTestDrawable : public Drawable
+{
+    URHO3D_OBJECT(CullingTestDrawable, Drawable);
+
+public:
+    explicit CullingTestDrawable(Context* context)
+        : Drawable(context, DRAWABLE_GEOMETRY)
+    {
+    }
+
+    void SetBoundingBox(const BoundingBox& box)
+    {
+        boundingBox_ = box;
+        OnMarkedDirty(node_);
+    }
+
+protected:
+    void OnWorldBoundingBoxUpdate() override
+    {
+        worldBoundingBox_ = node_ ? boundingBox_.Transformed(node_->GetWorldTransform()) : boundingBox_;
+    }
+};
+
+Frustum CreateTestFrustum(Scene* scene, const Vector3& position, const Quaternion& rotation)
+{
+    Node* cameraNode = scene->CreateChild("Camera");
+    cameraNode->SetPosition(position);
+    cameraNode->SetRotation(rotation);
+    auto camera = cameraNode->CreateComponent<Camera>();
+    camera->SetFarClip(400.0f);
+    const Frustum frustum = camera->GetFrustum();
+    cameraNode->Remove();
+    return frustum;
+}
+
+void CheckCullingResults(Octree* octree, const Frustum& frustum, const Sphere& sphere, const BoundingBox& box,
+    unsigned viewMask)
+{
+    ea::vector<Drawable*> expected;
+    ea::vector<Drawable*> actual;
+
+    FrustumOctreeQuery frustumQuery(expected, frustum, DRAWABLE_ANY, viewMask);
+    octree->GetDrawables(frustumQuery);
+    octree->GetDrawablesInFrustum(actual, frustum, DRAWABLE_ANY, viewMask);
+    CHECK_FALSE(expected.empty());
+    CHECK(actual == expected);
+
+    SphereOctreeQuery sphereQuery(expected, sphere, DRAWABLE_ANY, viewMask);
+    octree->GetDrawables(sphereQuery);
+    octree->GetDrawablesInSphere(actual, sphere, DRAWABLE_ANY, viewMask);
+    CHECK_FALSE(expected.empty());
+    CHECK(actual == expected);
+
+    BoxOctreeQuery boxQuery(expected, box, DRAWABLE_ANY, viewMask);
+    octree->GetDrawables(boxQuery);
+    octree->GetDrawablesInBox(actual, box, DRAWABLE_ANY, viewMask);
+    CHECK_FALSE(expected.empty());
+    CHECK(actual == expected);
+
+    octree->GetDrawablesInFrustum(actual, frustum, DRAWABLE_LIGHT, viewMask);
+    CHECK(actual.empty());
+}
+
+}
+
+TEST_CASE("Octree culling with SoA data matches octree queries")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<CullingTestDrawable>(context);
+
+    auto scene = MakeShared<Scene>(context);
+    auto octree = scene->CreateComponent<Octree>();
+    octree->SetSize(BoundingBox(-500.0f, 500.0f), 6);
+
+    // Enough drawables to use worker threads, if any
+    RandomEngine random(0);
+    const unsigned numDrawables = 20000;
+    ea::vector<CullingTestDrawable*> drawables;
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        Node* node = scene->CreateChild();
+        node->SetPosition(random.GetVector3(Vector3::ONE * -600.0f, Vector3::ONE * 600.0f));
+        auto drawable = node->CreateComponent<CullingTestDrawable>();
+        const Vector3 halfSize = random.GetVector3(Vector3::ONE * 0.1f, Vector3::ONE * (i % 100 == 0 ? 100.0f : 5.0f));
+        drawable->SetBoundingBox(BoundingBox(-halfSize, halfSize));
+        drawable->SetViewMask(i % 3 == 0 ? 0x1 : 0x3);
+        drawables.push_back(drawable);
+    }
+    octree->Update(FrameInfo{});
+
+    const Frustum frustum = CreateTestFrustum(scene, Vector3(0.0f, 10.0f, -300.0f), Quaternion(10.0f, Vector3::UP));
+    const Sphere sphere(Vector3(50.0f, 0.0f, 50.0f), 150.0f);
+    const BoundingBox box(Vector3(-200.0f, -50.0f, -100.0f), Vector3(100.0f, 100.0f, 200.0f));
+
+    SECTION("Static drawables")
+    {
+        CheckCullingResults(octree, frustum, sphere, box, 0x1);
+        CheckCullingResults(octree, frustum, sphere, box, 0x2);
+    }
+
+    SECTION("Drawables moved before octree update")
+    {
+        for (unsigned i = 0; i < numDrawables; i += 7)
+            drawables[i]->GetNode()->Translate(random.GetVector3(Vector3::ONE * -50.0f, Vector3::ONE * 50.0f));
+        CheckCullingResults(octree, frustum, sphere, box, 0x1);
+
+        octree->Update(FrameInfo{});
+        CheckCullingResults(octree, frustum, sphere, box, 0x1);
+    }
+
+    SECTION("Drawables changed or removed")
+    {
+        for (unsigned i = 0; i < numDrawables; i += 5)
+            drawables[i]->SetViewMask(0x2);
+        for (unsigned i = 1; i < numDrawables; i += 11)
+            drawables[i]->GetNode()->Remove();
+        CheckCullingResults(octree, frustum, sphere, box, 0x1);
+        CheckCullingResults(octree, frustum, sphere, box, 0x2);
+    }
+}
+
+TEST_CASE("Octree culling with SoA data is faster than octree queries", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<CullingTestDrawable>(context);
+
+    auto scene = MakeShared<Scene>(context);
+    auto octree = scene->CreateComponent<Octree>();
+    octree->SetSize(BoundingBox(-1000.0f, 1000.0f), 8);
+
+    // Manual drawables without nodes to keep memory usage reasonable
+    RandomEngine random(0);
+    const unsigned numDrawables = 1000000;
+    ea::vector<SharedPtr<CullingTestDrawable>> drawables;
+    drawables.reserve(numDrawables);
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        auto drawable = MakeShared<CullingTestDrawable>(context);
+        const Vector3 position = random.GetVector3(Vector3::ONE * -1000.0f, Vector3::ONE * 1000.0f);
+        const Vector3 halfSize = random.GetVector3(Vector3::ONE * 0.5f, Vector3::ONE * 2.0f);
+        drawable->SetBoundingBox(BoundingBox(position - halfSize, position + halfSize));
+        octree->AddManualDrawable(drawable);
+        drawables.push_back(drawable);
+    }
+    octree->Update(FrameInfo{});
+
+    const Frustum frustum = CreateTestFrustum(scene, Vector3(0.0f, 0.0f, -500.0f), Quaternion::IDENTITY);
+    const unsigned numQueries = 20;
+
+    ea::vector<Drawable*> expected;
+    ea::vector<Drawable*> actual;
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < numQueries; ++i)
+    {
+        FrustumOctreeQuery query(expected, frustum, DRAWABLE_GEOMETRY);
+        octree->GetDrawables(query);
+    }
+    const long long queryUSec = timer.GetUSec(true);
+
+    for (unsigned i = 0; i < numQueries; ++i)
+        octree->GetDrawablesInFrustum(actual, frustum, DRAWABLE_GEOMETRY);
+    const long long cullingUSec = timer.GetUSec(true);
+
+    CHECK(actual == expected);
+    WARN("Drawables: " << numDrawables << ", visible: " << actual.size()
+        << ", FrustumOctreeQuery: " << queryUSec / numQueries << " us"
+        << ", GetDrawablesInFrustum: " << cullingUSec / numQueries << " us");
+}
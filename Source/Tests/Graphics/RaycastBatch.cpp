@@ -0,0 +1,256 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/DynamicBVH.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/OctreeCulling.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Math/RandomEngine.h>
+#include <Urho3D/Scene/Scene.h>
+
+namespace
+{
+
+class RaycastTestDrawable : public Drawable
+{
+    URHO3D_OBJECT(RaycastTestDrawable, Drawable);
+
+public:
+    explicit RaycastTestDrawable(Context* context)
+        : Drawable(context, DRAWABLE_GEOMETRY)
+    {
+    }
+
+    void SetBoundingBox(const BoundingBox& box)
+    {
+        boundingBox_ = box;
+        OnMarkedDirty(node_);
+    }
+
+protected:
+    void OnWorldBoundingBoxUpdate() override
+    {
+        worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+    }
+};
+
+SharedPtr<Scene> CreateTestScene(Context* context, unsigned numDrawables)
+{
+    auto scene = MakeShared<Scene>(context);
+    auto octree = scene->CreateComponent<Octree>();
+    octree->SetSize(BoundingBox(-500.0f, 500.0f), 6);
+
+    // Some drawables are outside of octree bounds
+    RandomEngine random(0);
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        Node* node = scene->CreateChild();
+        node->SetPosition(random.GetVector3(Vector3::ONE * -700.0f, Vector3::ONE * 700.0f));
+        auto drawable = node->CreateComponent<RaycastTestDrawable>();
+        const Vector3 halfSize = random.GetVector3(Vector3::ONE * 0.5f, Vector3::ONE * 10.0f);
+        drawable->SetBoundingBox(BoundingBox(-halfSize, halfSize));
+        if (i % 10 == 0)
+            drawable->SetViewMask(0x2);
+    }
+    octree->Update(FrameInfo{});
+    return scene;
+}
+
+ea::vector<Ray> CreateTestRays(unsigned numRays, unsigned seed)
+{
+    // Rays start outside of the scene so there are no hits at zero distance
+    RandomEngine random(seed);
+    ea::vector<Ray> rays;
+    for (unsigned i = 0; i < numRays; ++i)
+    {
+        const Vector3 side = i % 2 ? Vector3::ONE : -Vector3::ONE;
+        const Vector3 origin = random.GetVector3(Vector3::ONE * -800.0f, Vector3::ONE * 800.0f) + side * 1800.0f;
+        const Vector3 target = random.GetVector3(Vector3::ONE * -700.0f, Vector3::ONE * 700.0f);
+        rays.emplace_back(origin, target - origin);
+    }
+    return rays;
+}
+
+void CheckBatchedRaycast(Octree* octree, const ea::vector<Ray>& rays, const ea::vector<float>& maxDistances,
+    unsigned viewMask)
+{
+    ea::vector<RayQueryResult> batchResults(rays.size());
+    BatchedRayOctreeQuery batchQuery(rays, batchResults, RAY_AABB, 5000.0f, DRAWABLE_ANY, viewMask);
+    batchQuery.maxDistances_ = maxDistances;
+    octree->RaycastSingleBatch(batchQuery);
+
+    unsigned numHits = 0;
+    unsigned numMismatches = 0;
+    for (unsigned i = 0; i < rays.size(); ++i)
+    {
+        ea::vector<RayQueryResult> result;
+        RayOctreeQuery query(result, rays[i], RAY_AABB, batchQuery.GetMaxDistance(i), DRAWABLE_ANY, viewMask);
+        octree->RaycastSingle(query);
+
+        const RayQueryResult& batchResult = batchResults[i];
+        if (result.empty())
+        {
+            if (batchResult.drawable_ != nullptr)
+                ++numMismatches;
+        }
+        else
+        {
+            ++numHits;
+            if (batchResult.drawable_ != result[0].drawable_ || batchResult.distance_ != result[0].distance_)
+                ++numMismatches;
+        }
+    }
+
+    CHECK(numHits > 0);
+    CHECK(numHits < rays.size());
+    CHECK(numMismatches == 0);
+}
+
+}
+
+TEST_CASE("RayPacket hit distances are the same as for single rays")
+{
+    RandomEngine random(0);
+    const BoundingBox box(Vector3(-1.0f, -2.0f, -3.0f), Vector3(3.0f, 2.0f, 1.0f));
+    const float maxDistances[RayPacket::MAX_RAYS] = {M_INFINITY, M_INFINITY, 4.0f, M_INFINITY};
+
+    unsigned numHits = 0;
+    unsigned numMismatches = 0;
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        Ray rays[RayPacket::MAX_RAYS];
+        for (Ray& ray : rays)
+        {
+            Vector3 direction = random.GetVector3(-Vector3::ONE, Vector3::ONE);
+            // Axis-aligned rays are common and need special care
+            if (i % 4 == 0)
+                direction.y_ = 0.0f;
+            ray = Ray(random.GetVector3(Vector3::ONE * -6.0f, Vector3::ONE * 6.0f), direction);
+        }
+
+        const unsigned numRays = i % RayPacket::MAX_RAYS + 1;
+        const RayPacket packet(rays, maxDistances, numRays);
+        float distances[RayPacket::MAX_RAYS];
+        const unsigned hitMask = packet.HitDistance(box, distances);
+        for (unsigned j = 0; j < numRays; ++j)
+        {
+            const float expectedDistance = rays[j].HitDistance(box);
+            const bool expectedHit = expectedDistance < maxDistances[j];
+            numHits += expectedHit;
+            if (distances[j] != expectedDistance || !!(hitMask & (1u << j)) != expectedHit)
+                ++numMismatches;
+        }
+        if (hitMask >> numRays)
+            ++numMismatches;
+    }
+
+    CHECK(numHits > 0);
+    CHECK(numMismatches == 0);
+}
+
+TEST_CASE("Batched raycast returns the same results as single raycasts")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<RaycastTestDrawable>(context);
+
+    auto scene = CreateTestScene(context, 5000);
+    auto octree = scene->GetComponent<Octree>();
+
+    const unsigned numRays = 1001;
+    const ea::vector<Ray> rays = CreateTestRays(numRays, 1);
+
+    SECTION("Rays")
+    {
+        CheckBatchedRaycast(octree, rays, {}, DEFAULT_VIEWMASK);
+        CheckBatchedRaycast(octree, rays, {}, 0x2);
+    }
+
+    SECTION("Segments")
+    {
+        RandomEngine random(2);
+        ea::vector<float> maxDistances;
+        for (unsigned i = 0; i < numRays; ++i)
+            maxDistances.push_back(random.GetFloat(0.0f, 2000.0f));
+        CheckBatchedRaycast(octree, rays, maxDistances, DEFAULT_VIEWMASK);
+    }
+
+    SECTION("Moved drawables")
+    {
+        const ea::vector<SharedPtr<Node>>& children = scene->GetChildren();
+        for (unsigned i = 0; i < children.size(); i += 3)
+            children[i]->Translate(Vector3(10.0f, -20.0f, 30.0f));
+        CheckBatchedRaycast(octree, rays, {}, DEFAULT_VIEWMASK);
+    }
+
+    SECTION("DynamicBVH")
+    {
+        octree->SetSpatialIndex(ea::make_unique<DynamicBVH>());
+        octree->Update(FrameInfo{});
+        CheckBatchedRaycast(octree, rays, {}, DEFAULT_VIEWMASK);
+
+        // Bounding boxes of moved drawables are outdated until the next update
+        const ea::vector<SharedPtr<Node>>& children = scene->GetChildren();
+        for (unsigned i = 0; i < children.size(); i += 3)
+            children[i]->Translate(Vector3(1.0f, -2.0f, 3.0f));
+        CheckBatchedRaycast(octree, rays, {}, DEFAULT_VIEWMASK);
+    }
+}
+
+TEST_CASE("Batched raycast is compared with single raycasts", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<RaycastTestDrawable>(context);
+
+    auto scene = CreateTestScene(context, 100000);
+    auto octree = scene->GetComponent<Octree>();
+
+    const unsigned numRays = 10000;
+    const ea::vector<Ray> rays = CreateTestRays(numRays, 1);
+
+    HiresTimer timer;
+    unsigned numSingleHits = 0;
+    ea::vector<RayQueryResult> result;
+    for (const Ray& ray : rays)
+    {
+        RayOctreeQuery query(result, ray, RAY_AABB);
+        octree->RaycastSingle(query);
+        numSingleHits += !result.empty();
+    }
+    const long long singleUSec = timer.GetUSec(true);
+
+    ea::vector<RayQueryResult> batchResults(numRays);
+    BatchedRayOctreeQuery batchQuery(rays, batchResults, RAY_AABB);
+    octree->RaycastSingleBatch(batchQuery);
+    const long long batchUSec = timer.GetUSec(true);
+
+    unsigned numBatchHits = 0;
+    for (const RayQueryResult& batchResult : batchResults)
+        numBatchHits += batchResult.drawable_ != nullptr;
+
+    WARN("Single raycasts: " << singleUSec << " us, " << numSingleHits << " hits");
+    WARN("Batched raycast: " << batchUSec << " us, " << numBatchHits << " hits");
+}
@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/IO/AsyncFileReader.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+
+namespace
+{
+
+ea::string ReadAll(AbstractFile* file)
+{
+    ea::string result(file->GetSize(), '\0');
+    result.resize(file->Read(result.data(), result.length()));
+    return result;
+}
+
+}
+
+TEST_CASE("AsyncFileReader reads file regions")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "AsyncFileReaderTest");
+    const ea::string fileName = tempDir.GetPath() + "Data.txt";
+    {
+        File file(context, fileName, FILE_WRITE);
+        file.Write("Hello, world!", 13);
+    }
+
+    auto reader = MakeShared<AsyncFileReader>(context, 2);
+
+    ea::string wholeFile;
+    ea::string part;
+    bool missingFileRead = true;
+
+    AsyncReadRequest requests[3];
+    requests[0].region_.fileName_ = fileName;
+    requests[0].name_ = "Whole";
+    requests[0].callback_ = [&](AbstractFilePtr file) { wholeFile = ReadAll(file); };
+    requests[1].region_ = NativeFileRegion{fileName, 7, 5};
+    requests[1].callback_ = [&](AbstractFilePtr file) { part = ReadAll(file); };
+    requests[2].region_.fileName_ = tempDir.GetPath() + "Missing.txt";
+    requests[2].callback_ = [&](AbstractFilePtr file) { missingFileRead = file != nullptr; };
+
+    reader->Read(requests);
+    reader->WaitForCompletion();
+
+    CHECK(reader->GetNumPendingReads() == 0);
+    CHECK(wholeFile == "Hello, world!");
+    CHECK(part == "world");
+    CHECK_FALSE(missingFileRead);
+}
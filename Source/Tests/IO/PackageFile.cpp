@@ -0,0 +1,344 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/IO/Compression.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/PackageFile.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+namespace
+{
+
+bool WritePackage(Context* context, const ea::string& fileName, const ea::vector<ea::pair<ea::string, ea::string>>& files,
+    unsigned checksum = 0)
+{
+    File file(context, fileName, FILE_WRITE);
+    if (!file.IsOpen())
+        return false;
+
+    unsigned offset = 3 * sizeof(unsigned);
+    for (const auto& [name, content] : files)
+        offset += name.length() + 1 + 3 * sizeof(unsigned);
+
+    file.WriteFileID("UPAK");
+    file.WriteUInt(files.size());
+    file.WriteUInt(checksum);
+    for (const auto& [name, content] : files)
+    {
+        file.WriteString(name);
+        file.WriteUInt(offset);
+        file.WriteUInt(content.length());
+        file.WriteUInt(content.length());
+        offset += content.length();
+    }
+    for (const auto& [name, content] : files)
+        file.Write(content.data(), content.length());
+    return true;
+}
+
+bool WritePatchPackage(Context* context, const ea::string& fileName, unsigned baseChecksum,
+    const ea::vector<ea::pair<ea::string, ByteVector>>& deltas)
+{
+    File file(context, fileName, FILE_WRITE);
+    if (!file.IsOpen())
+        return false;
+
+    file.WriteFileID("RPAK");
+    file.WriteUInt(deltas.size());
+    file.WriteUInt(baseChecksum + 1);
+    file.WriteUInt(PACKAGE_VERSION_PATCH);
+    file.WriteInt64(0);
+
+    ea::vector<unsigned> offsets;
+    for (const auto& [name, delta] : deltas)
+    {
+        offsets.push_back(file.GetPosition());
+        file.Write(delta.data(), delta.size());
+    }
+
+    const unsigned fileListOffset = file.GetPosition();
+    file.WriteUInt(baseChecksum);
+    for (unsigned i = 0; i < deltas.size(); ++i)
+    {
+        file.WriteString(deltas[i].first);
+        file.WriteUInt(offsets[i]);
+        file.WriteUInt(deltas[i].second.size());
+        file.WriteUInt(0);
+        file.WriteUInt(PACKAGE_ENTRY_DELTA);
+    }
+
+    file.Seek(16);
+    file.WriteInt64(fileListOffset);
+    return true;
+}
+
+ByteVector ToBytes(const ea::string& str)
+{
+    return ByteVector(str.begin(), str.end());
+}
+
+bool WriteCompressedPackage(Context* context, const ea::string& fileName, const ea::string& name, const ea::string& content,
+    unsigned blockSize, bool blockIndexed)
+{
+    File file(context, fileName, FILE_WRITE);
+    if (!file.IsOpen())
+        return false;
+
+    file.WriteFileID(blockIndexed ? "RLZ4" : "ULZ4");
+    file.WriteUInt(1);
+    file.WriteUInt(0);
+    if (blockIndexed)
+    {
+        file.WriteUInt(PACKAGE_VERSION_BLOCK_INDEX);
+        file.WriteInt64(0);
+    }
+    else
+    {
+        file.WriteString(name);
+        file.WriteUInt(file.GetPosition() + 3 * sizeof(unsigned));
+        file.WriteUInt(content.length());
+        file.WriteUInt(content.length());
+    }
+
+    const unsigned offset = file.GetPosition();
+    ea::vector<unsigned> packedSizes;
+    ByteVector buffer(EstimateCompressBound(blockSize));
+    for (unsigned pos = 0; pos < content.length(); pos += blockSize)
+    {
+        // Store the first block uncompressed to test both kinds of blocks
+        const unsigned unpackedSize = ea::min(blockSize, content.length() - pos);
+        const bool isStored = blockIndexed && pos == 0;
+        const unsigned packedSize = isStored ? unpackedSize : CompressData(buffer.data(), &content[pos], unpackedSize);
+        if (!blockIndexed)
+        {
+            file.WriteUShort(unpackedSize);
+            file.WriteUShort(packedSize);
+        }
+        file.Write(isStored ? static_cast<const void*>(&content[pos]) : buffer.data(), packedSize);
+        packedSizes.push_back(packedSize);
+    }
+
+    if (blockIndexed)
+    {
+        const unsigned fileListOffset = file.GetPosition();
+        file.WriteUInt(blockSize);
+        file.WriteUInt(0);
+        file.WriteString(name);
+        file.WriteUInt(offset);
+        file.WriteUInt(content.length());
+        file.WriteUInt(content.length());
+        file.WriteUInt(0);
+        for (unsigned packedSize : packedSizes)
+            file.WriteUInt(packedSize);
+
+        file.Seek(16);
+        file.WriteInt64(fileListOffset);
+    }
+    return true;
+}
+
+}
+
+TEST_CASE("PackageFile reads uncompressed files from mapped memory")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "PackageFileTest");
+    const ea::string packageName = tempDir.GetPath() + "Test.pak";
+    REQUIRE(WritePackage(context, packageName, {{"A.txt", "Hello"}, {"Dir/B.txt", "World!"}}));
+
+    auto package = MakeShared<PackageFile>(context);
+    REQUIRE(package->Open(packageName));
+    CHECK(package->GetNumFiles() == 2);
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    CHECK(package->IsMemoryMapped());
+#endif
+
+    AbstractFilePtr fileA = package->OpenFile(FileIdentifier("", "A.txt"), FILE_READ);
+    AbstractFilePtr fileB = package->OpenFile(FileIdentifier("", "Dir/B.txt"), FILE_READ);
+    REQUIRE(fileA);
+    REQUIRE(fileB);
+
+    CHECK(fileB->GetName() == "Dir/B.txt");
+    CHECK(fileB->GetChecksum() == 6);
+    CHECK(fileB->GetSize() == 6);
+
+    ea::string contentA(fileA->GetSize(), '\0');
+    CHECK(fileA->Read(contentA.data(), contentA.length()) == 5);
+    CHECK(contentA == "Hello");
+
+    if (package->IsMemoryMapped())
+    {
+        const PackageEntry* entry = package->GetEntry("Dir/B.txt");
+        REQUIRE(entry);
+        const auto data = static_cast<const unsigned char*>(fileB->ReadInPlace(fileB->GetSize()));
+        CHECK(data == package->GetEntryData(*entry).data());
+        CHECK(ea::string(reinterpret_cast<const char*>(data), 6) == "World!");
+    }
+
+    // Mapped memory is kept alive by opened files
+    package = nullptr;
+    fileB->Seek(0);
+    CHECK(fileB->ReadString() == "World!");
+}
+
+TEST_CASE("PackageFile reads compressed files with random access")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "PackageFileCompressedTest");
+    const bool blockIndexed = GENERATE(false, true);
+    const ea::string packageName = tempDir.GetPath() + "Test.pak";
+
+    ea::string content;
+    for (unsigned i = 0; i < 1000; ++i)
+        content += static_cast<char>('a' + i % 7 + (i / 100) % 3);
+    REQUIRE(WriteCompressedPackage(context, packageName, "Data.bin", content, 256, blockIndexed));
+
+    auto package = MakeShared<PackageFile>(context);
+    REQUIRE(package->Open(packageName));
+    CHECK(package->IsCompressed());
+    CHECK(package->IsBlockIndexed() == blockIndexed);
+
+    AbstractFilePtr file = package->OpenFile(FileIdentifier("", "Data.bin"), FILE_READ);
+    REQUIRE(file);
+    REQUIRE(file->GetSize() == content.length());
+
+    ea::string data(content.length(), '\0');
+    CHECK(file->Read(data.data(), data.length()) == content.length());
+    CHECK(data == content);
+
+    if (blockIndexed)
+    {
+        CHECK(package->GetNumBlocks(*package->GetEntry("Data.bin")) == 4);
+        CHECK(package->GetPackedSize(*package->GetEntry("Data.bin")) < content.length());
+    }
+
+    // Read across block boundaries. Only block-indexed files support seeking backwards
+    const ea::vector<unsigned> positions = blockIndexed
+        ? ea::vector<unsigned>{700u, 250u, 0u, 990u} : ea::vector<unsigned>{0u, 250u, 700u, 990u};
+    for (unsigned position : positions)
+    {
+        ea::string chunk(20, '\0');
+        file->Seek(position);
+        chunk.resize(file->Read(chunk.data(), chunk.length()));
+        CHECK(chunk == content.substr(position, 20));
+    }
+}
+
+TEST_CASE("PackageFile rejects block index with invalid dictionary size")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "PackageFileInvalidTest");
+    const ea::string packageName = tempDir.GetPath() + "Test.pak";
+    REQUIRE(WriteCompressedPackage(context, packageName, "Data.bin", ea::string(1000, 'a'), 256, true));
+
+    {
+        File file(context, packageName, FILE_READWRITE);
+        REQUIRE(file.IsOpen());
+        file.Seek(16);
+        const auto fileListOffset = static_cast<unsigned>(file.ReadInt64());
+        file.Seek(fileListOffset + sizeof(unsigned));
+        file.WriteUInt(0xfffffff0);
+    }
+
+    auto package = MakeShared<PackageFile>(context);
+    CHECK_FALSE(package->Open(packageName));
+}
+
+TEST_CASE("Binary delta reconstructs target from base")
+{
+    ea::string base;
+    for (unsigned i = 0; i < 4000; ++i)
+        base += static_cast<char>('a' + (i * 7 + i / 13) % 26);
+
+    ea::string target = base;
+    target.insert(1000, "Inserted text");
+    target.erase(2500, 300);
+    target.replace(3000, 5, "XXXXX");
+    target += "Appended tail";
+
+    const ByteVector delta = CreateBinaryDelta(ToBytes(base), ToBytes(target));
+    CHECK(delta.size() < target.length() / 4);
+
+    ByteVector result;
+    REQUIRE(ApplyBinaryDelta(ToBytes(base), delta, result));
+    CHECK(result == ToBytes(target));
+
+    // Unrelated data is stored as literals
+    REQUIRE(ApplyBinaryDelta({}, CreateBinaryDelta({}, ToBytes(target)), result));
+    CHECK(result == ToBytes(target));
+
+    // Delta that produces more data than declared target size is rejected
+    VectorBuffer corruptedDelta;
+    corruptedDelta.WriteVLE(4);
+    corruptedDelta.WriteVLE((100 << 1) | 1);
+    corruptedDelta.WriteVLE(0);
+    CHECK_FALSE(ApplyBinaryDelta(ToBytes(base), corruptedDelta.GetBuffer(), result));
+}
+
+TEST_CASE("Patch package applies deltas on top of base package")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "PackageFilePatchTest");
+    const ea::string baseName = tempDir.GetPath() + "Base.pak";
+    const ea::string patchName = tempDir.GetPath() + "Patch.pak";
+
+    const ea::string oldContent = "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog.";
+    const ea::string newContent = "The quick brown fox jumps over the lazy cat. The quick brown fox jumps over the lazy dog!";
+    REQUIRE(WritePackage(context, baseName, {{"Changed.txt", oldContent}, {"Unchanged.txt", "Same"}}, 12345));
+    REQUIRE(WritePatchPackage(context, patchName, 12345,
+        {{"Changed.txt", CreateBinaryDelta(ToBytes(oldContent), ToBytes(newContent))}}));
+
+    auto basePackage = MakeShared<PackageFile>(context);
+    auto patchPackage = MakeShared<PackageFile>(context);
+    REQUIRE(basePackage->Open(baseName));
+    REQUIRE(patchPackage->Open(patchName));
+    CHECK(patchPackage->IsPatch());
+    CHECK(patchPackage->GetBaseChecksum() == 12345);
+    CHECK_FALSE(patchPackage->OpenFile(FileIdentifier("", "Changed.txt"), FILE_READ));
+
+    // Packages may be linked in any order
+    basePackage->LinkPatchPackage(patchPackage);
+    CHECK(patchPackage->GetBasePackage() == basePackage);
+
+    AbstractFilePtr file = patchPackage->OpenFile(FileIdentifier("", "Changed.txt"), FILE_READ);
+    REQUIRE(file);
+    REQUIRE(file->GetSize() == newContent.length());
+    ea::string data(newContent.length(), '\0');
+    CHECK(file->Read(data.data(), data.length()) == newContent.length());
+    CHECK(data == newContent);
+
+    // Unchanged files are read from the base package
+    CHECK_FALSE(patchPackage->Exists("Unchanged.txt"));
+    CHECK(basePackage->Exists("Unchanged.txt"));
+}
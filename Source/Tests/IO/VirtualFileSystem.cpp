@@ -21,8 +21,13 @@
 //
 #include "../CommonUtils.h"
 
+#include <Urho3D/IO/AsyncFileReader.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/VirtualFileSystem.h>
 
+#include <atomic>
+
 TEST_CASE("VirtualFileSystem has mount points")
 {
     auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
@@ -36,3 +41,46 @@ TEST_CASE("VirtualFileSystem has mount points")
         CHECK(mountPoint);
     }
 }
+
+TEST_CASE("VirtualFileSystem reads batch of files asynchronously")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "AsyncVirtualFileSystemTest");
+    const unsigned numFiles = 300;
+
+    ea::vector<FileIdentifier> fileNames;
+    for (unsigned i = 0; i < numFiles; ++i)
+    {
+        const ea::string name = Format("Dir{}/File{}.txt", i % 4, i);
+        REQUIRE(fileSystem->CreateDirsRecursive(GetPath(tempDir.GetPath() + name)));
+        File file(context, tempDir.GetPath() + name, FILE_WRITE);
+        file.WriteString(name);
+        fileNames.push_back(FileIdentifier{"", name});
+    }
+    fileNames.push_back(FileIdentifier{"", "Missing.txt"});
+
+    auto vfs = MakeShared<VirtualFileSystem>(context);
+    vfs->MountDir(tempDir.GetPath());
+
+    ea::vector<ea::string> contents(fileNames.size());
+    std::atomic<unsigned> numCallbacks{};
+    vfs->ReadFilesAsync(fileNames, [&](unsigned index, AbstractFilePtr file)
+    {
+        if (file)
+            contents[index] = file->ReadString();
+        ++numCallbacks;
+    });
+    vfs->GetAsyncFileReader()->WaitForCompletion();
+
+    REQUIRE(numCallbacks == fileNames.size());
+    unsigned numMismatches = 0;
+    for (unsigned i = 0; i < numFiles; ++i)
+    {
+        if (contents[i] != fileNames[i].fileName_)
+            ++numMismatches;
+    }
+    CHECK(numMismatches == 0);
+    CHECK(contents.back().empty());
+}
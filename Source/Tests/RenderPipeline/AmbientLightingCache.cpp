@@ -0,0 +1,217 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/GlobalIllumination.h>
+#include <Urho3D/Graphics/LightProbeGroup.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/Zone.h>
+#include <Urho3D/Math/RandomEngine.h>
+#include <Urho3D/RenderPipeline/AmbientLightingCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+namespace
+{
+
+class AmbientTestDrawable : public Drawable
+{
+    URHO3D_OBJECT(AmbientTestDrawable, Drawable);
+
+public:
+    explicit AmbientTestDrawable(Context* context)
+        : Drawable(context, DRAWABLE_GEOMETRY)
+    {
+        boundingBox_ = BoundingBox(-1.0f, 1.0f);
+    }
+
+protected:
+    void OnWorldBoundingBoxUpdate() override
+    {
+        worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+    }
+};
+
+SharedPtr<Scene> CreateTestScene(Context* context, unsigned numDrawables)
+{
+    auto scene = MakeShared<Scene>(context);
+    auto octree = scene->CreateComponent<Octree>();
+    scene->CreateComponent<GlobalIllumination>();
+
+    auto zone = scene->CreateComponent<Zone>();
+    zone->SetBoundingBox(BoundingBox(-1000.0f, 1000.0f));
+    zone->SetAmbientColor(Color(0.2f, 0.3f, 0.4f));
+
+    RandomEngine random(0);
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        Node* node = scene->CreateChild();
+        node->SetPosition(random.GetVector3(Vector3::ONE * -100.0f, Vector3::ONE * 100.0f));
+        auto drawable = node->CreateComponent<AmbientTestDrawable>();
+        if (i % 2 == 0)
+            drawable->SetGlobalIlluminationType(GlobalIlluminationType::BlendLightProbes);
+    }
+    octree->Update(FrameInfo{});
+    return scene;
+}
+
+ea::vector<Drawable*> GetTestDrawables(Scene* scene)
+{
+    ea::vector<Drawable*> drawables;
+    for (Drawable* drawable : scene->GetComponent<Octree>()->GetAllDrawables())
+    {
+        if (drawable->IsInstanceOf<AmbientTestDrawable>())
+            drawables.push_back(drawable);
+    }
+    return drawables;
+}
+
+/// Update zones and return ambient lighting of all drawables, same as DrawableProcessor does.
+ea::vector<Vector4> EvaluateFrame(Scene* scene, AmbientLightingCache& cache)
+{
+    auto octree = scene->GetComponent<Octree>();
+    octree->Update(FrameInfo{});
+    cache.BeginFrame(octree->GetAllDrawables().size(), scene->GetComponent<GlobalIllumination>());
+
+    ea::vector<Vector4> result;
+    for (Drawable* drawable : GetTestDrawables(scene))
+    {
+        const Vector3 samplePosition = drawable->GetWorldBoundingBox().Center();
+        drawable->GetMutableCachedZone() = octree->QueryZone(samplePosition, drawable->GetZoneMask());
+        const SphericalHarmonicsDot9 sh = cache.GetAmbientLighting(drawable, samplePosition);
+        result.push_back(sh.Ar_);
+        result.push_back(sh.Ag_);
+        result.push_back(sh.Ab_);
+    }
+    return result;
+}
+
+}
+
+TEST_CASE("AmbientLightingCache reevaluates only changed drawables")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<AmbientTestDrawable>(context);
+
+    const unsigned numDrawables = 100;
+    auto scene = CreateTestScene(context, numDrawables);
+
+    AmbientLightingCache cache;
+    AmbientLightingCache referenceCache;
+    referenceCache.SetEnabled(false);
+
+    CHECK(EvaluateFrame(scene, cache) == EvaluateFrame(scene, referenceCache));
+    CHECK(cache.GetNumEvaluations() == numDrawables);
+    CHECK(referenceCache.GetNumEvaluations() == numDrawables);
+
+    CHECK(EvaluateFrame(scene, cache) == EvaluateFrame(scene, referenceCache));
+    CHECK(cache.GetNumEvaluations() == 0);
+
+    SECTION("Drawables are moved")
+    {
+        const ea::vector<Drawable*> drawables = GetTestDrawables(scene);
+        for (unsigned i = 0; i < numDrawables; i += 10)
+            drawables[i]->GetNode()->Translate(Vector3::ONE);
+
+        CHECK(EvaluateFrame(scene, cache) == EvaluateFrame(scene, referenceCache));
+        CHECK(cache.GetNumEvaluations() == numDrawables / 10);
+    }
+
+    SECTION("Zone is changed")
+    {
+        const auto oldLighting = EvaluateFrame(scene, cache);
+        scene->GetComponent<Zone>()->SetAmbientColor(Color(0.5f, 0.1f, 0.1f));
+
+        const auto newLighting = EvaluateFrame(scene, cache);
+        CHECK(newLighting != oldLighting);
+        CHECK(newLighting == EvaluateFrame(scene, referenceCache));
+        CHECK(cache.GetNumEvaluations() == numDrawables);
+    }
+
+    SECTION("Global illumination is changed")
+    {
+        scene->GetComponent<GlobalIllumination>()->ResetLightProbes();
+
+        CHECK(EvaluateFrame(scene, cache) == EvaluateFrame(scene, referenceCache));
+        CHECK(cache.GetNumEvaluations() == numDrawables);
+    }
+
+    SECTION("Drawable is removed")
+    {
+        GetTestDrawables(scene)[0]->Remove();
+
+        CHECK(EvaluateFrame(scene, cache) == EvaluateFrame(scene, referenceCache));
+        CHECK(cache.GetNumEvaluations() <= 1);
+    }
+}
+
+TEST_CASE("AmbientLightingCache is compared with evaluation in static scene", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<AmbientTestDrawable>(context);
+
+    const unsigned numDrawables = 50000;
+    const unsigned numFrames = 20;
+    auto scene = CreateTestScene(context, numDrawables);
+
+    // Light probes are placed on a grid so sampling walks the tetrahedral mesh
+    auto lightProbeGroup = scene->CreateComponent<LightProbeGroup>();
+    LightProbeVector lightProbes;
+    for (int x = -100; x <= 100; x += 20)
+    {
+        for (int y = -100; y <= 100; y += 20)
+        {
+            for (int z = -100; z <= 100; z += 20)
+                lightProbes.push_back(LightProbe{Vector3(x, y, z)});
+        }
+    }
+    lightProbeGroup->SetLightProbes(lightProbes);
+    scene->GetComponent<GlobalIllumination>()->CompileLightProbes();
+
+    auto octree = scene->GetComponent<Octree>();
+    octree->Update(FrameInfo{});
+    auto gi = scene->GetComponent<GlobalIllumination>();
+    const ea::vector<Drawable*> drawables = GetTestDrawables(scene);
+    for (Drawable* drawable : drawables)
+        drawable->GetMutableCachedZone() = octree->QueryZone(drawable);
+
+    for (const bool enabled : {false, true})
+    {
+        AmbientLightingCache cache;
+        cache.SetEnabled(enabled);
+
+        HiresTimer timer;
+        Vector4 checksum;
+        for (unsigned frame = 0; frame < numFrames; ++frame)
+        {
+            cache.BeginFrame(octree->GetAllDrawables().size(), gi);
+            for (Drawable* drawable : drawables)
+                checksum += cache.GetAmbientLighting(drawable, drawable->GetWorldBoundingBox().Center()).Ar_;
+        }
+        const long long frameUSec = timer.GetUSec(false) / numFrames;
+
+        WARN((enabled ? "Cached" : "Uncached") << " ambient lighting: " << frameUSec << " us per frame, "
+            << cache.GetNumEvaluations() << " evaluations in last frame, checksum " << checksum.w_);
+    }
+}
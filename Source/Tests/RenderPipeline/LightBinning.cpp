@@ -0,0 +1,221 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Math/RandomEngine.h>
+#include <Urho3D/RenderPipeline/LightBinning.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <EASTL/sort.h>
+
+namespace
+{
+
+class LightBinningTestDrawable : public Drawable
+{
+    URHO3D_OBJECT(LightBinningTestDrawable, Drawable);
+
+public:
+    explicit LightBinningTestDrawable(Context* context)
+        : Drawable(context, DRAWABLE_GEOMETRY)
+    {
+    }
+
+    void SetBoundingBox(const BoundingBox& box)
+    {
+        boundingBox_ = box;
+        OnMarkedDirty(node_);
+    }
+
+protected:
+    void OnWorldBoundingBoxUpdate() override
+    {
+        worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+    }
+};
+
+SharedPtr<Scene> CreateTestScene(Context* context, unsigned numDrawables, ea::vector<Drawable*>& geometries)
+{
+    auto scene = MakeShared<Scene>(context);
+    auto octree = scene->CreateComponent<Octree>();
+    octree->SetSize(BoundingBox(-500.0f, 500.0f), 6);
+
+    // Some geometries are much larger than cells
+    RandomEngine random(0);
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        Node* node = scene->CreateChild();
+        node->SetPosition(random.GetVector3(Vector3::ONE * -500.0f, Vector3::ONE * 500.0f));
+        auto drawable = node->CreateComponent<LightBinningTestDrawable>();
+        const float maxHalfSize = i % 50 == 0 ? 200.0f : 10.0f;
+        const Vector3 halfSize = random.GetVector3(Vector3::ONE * 0.5f, Vector3::ONE * maxHalfSize);
+        drawable->SetBoundingBox(BoundingBox(-halfSize, halfSize));
+        if (i % 7 == 0)
+            drawable->SetLightMask(0x2);
+        geometries.push_back(drawable);
+    }
+    octree->Update(FrameInfo{});
+    return scene;
+}
+
+ea::vector<Drawable*> GetGeometriesBruteForce(const ea::vector<Drawable*>& geometries,
+    const OctreeCullingShape& shape, unsigned lightMask)
+{
+    ea::vector<Drawable*> result;
+    for (Drawable* geometry : geometries)
+    {
+        if ((geometry->GetLightMaskInZone() & lightMask) && shape.TestDrawable(geometry->GetWorldBoundingBox()))
+            result.push_back(geometry);
+    }
+    return result;
+}
+
+}
+
+TEST_CASE("LightBinning returns the same geometries as brute force culling")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<LightBinningTestDrawable>(context);
+
+    ea::vector<Drawable*> geometries;
+    auto scene = CreateTestScene(context, 5000, geometries);
+
+    LightBinning lightBinning;
+    lightBinning.Build(geometries);
+    REQUIRE(lightBinning.GetNumGeometries() == geometries.size());
+    REQUIRE(lightBinning.GetNumCellsPerAxis() > 1);
+
+    RandomEngine random(1);
+    const unsigned lightMasks[] = {DEFAULT_LIGHTMASK, 0x2, 0x4};
+
+    SECTION("Point lights")
+    {
+        unsigned numGeometries = 0;
+        unsigned numMismatches = 0;
+        for (unsigned i = 0; i < 300; ++i)
+        {
+            const Sphere sphere(random.GetVector3(Vector3::ONE * -600.0f, Vector3::ONE * 600.0f), random.GetFloat(1.0f, 150.0f));
+            const auto shape = OctreeCullingShape::FromSphere(sphere);
+            const unsigned lightMask = lightMasks[i % 3];
+
+            ea::vector<Drawable*> expected = GetGeometriesBruteForce(geometries, shape, lightMask);
+            ea::vector<Drawable*> actual;
+            lightBinning.GetGeometries(shape, lightMask, actual);
+
+            ea::sort(expected.begin(), expected.end());
+            ea::sort(actual.begin(), actual.end());
+            numGeometries += expected.size();
+            if (expected != actual)
+                ++numMismatches;
+        }
+
+        CHECK(numGeometries > 0);
+        CHECK(numMismatches == 0);
+    }
+
+    SECTION("Spot lights")
+    {
+        // Binning may drop false positives of plane test that are outside of frustum bounding box
+        unsigned numGeometries = 0;
+        unsigned numMismatches = 0;
+        for (unsigned i = 0; i < 300; ++i)
+        {
+            const Vector3 position = random.GetVector3(Vector3::ONE * -600.0f, Vector3::ONE * 600.0f);
+            const Quaternion rotation(random.GetFloat(0.0f, 360.0f), random.GetFloat(0.0f, 360.0f), random.GetFloat(0.0f, 360.0f));
+            Frustum frustum;
+            frustum.Define(random.GetFloat(10.0f, 120.0f), 1.0f, 1.0f, 0.0f, random.GetFloat(1.0f, 300.0f),
+                Matrix3x4(position, rotation, 1.0f));
+            const auto shape = OctreeCullingShape::FromFrustum(frustum);
+            const BoundingBox frustumBox(frustum);
+            const unsigned lightMask = lightMasks[i % 3];
+
+            ea::vector<Drawable*> candidates = GetGeometriesBruteForce(geometries, shape, lightMask);
+            ea::vector<Drawable*> actual;
+            lightBinning.GetGeometries(shape, lightMask, actual);
+
+            ea::sort(candidates.begin(), candidates.end());
+            ea::sort(actual.begin(), actual.end());
+            numGeometries += actual.size();
+            for (Drawable* geometry : candidates)
+            {
+                const bool isInsideBox = frustumBox.IsInsideFast(geometry->GetWorldBoundingBox()) != OUTSIDE;
+                if (isInsideBox && !ea::binary_search(actual.begin(), actual.end(), geometry))
+                    ++numMismatches;
+            }
+            for (Drawable* geometry : actual)
+            {
+                if (!ea::binary_search(candidates.begin(), candidates.end(), geometry))
+                    ++numMismatches;
+            }
+        }
+
+        CHECK(numGeometries > 0);
+        CHECK(numMismatches == 0);
+    }
+}
+
+TEST_CASE("LightBinning is compared with octree queries", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<LightBinningTestDrawable>(context);
+
+    ea::vector<Drawable*> geometries;
+    auto scene = CreateTestScene(context, 10000, geometries);
+    auto octree = scene->GetComponent<Octree>();
+
+    RandomEngine random(1);
+    ea::vector<Sphere> lights;
+    for (unsigned i = 0; i < 300; ++i)
+        lights.emplace_back(random.GetVector3(Vector3::ONE * -500.0f, Vector3::ONE * 500.0f), random.GetFloat(10.0f, 50.0f));
+
+    HiresTimer timer;
+    unsigned numOctreeGeometries = 0;
+    ea::vector<Drawable*> result;
+    for (const Sphere& light : lights)
+    {
+        result.clear();
+        SphereOctreeQuery query(result, light, DRAWABLE_GEOMETRY);
+        octree->GetDrawables(query);
+        numOctreeGeometries += result.size();
+    }
+    const long long octreeUSec = timer.GetUSec(true);
+
+    LightBinning lightBinning;
+    lightBinning.Build(geometries);
+    unsigned numBinnedGeometries = 0;
+    for (const Sphere& light : lights)
+    {
+        result.clear();
+        lightBinning.GetGeometries(OctreeCullingShape::FromSphere(light), DEFAULT_LIGHTMASK, result);
+        numBinnedGeometries += result.size();
+    }
+    const long long binningUSec = timer.GetUSec(true);
+
+    WARN("Octree queries: " << octreeUSec << " us, " << numOctreeGeometries << " geometries");
+    WARN("Light binning: " << binningUSec << " us, " << numBinnedGeometries << " geometries");
+}
@@ -23,6 +23,8 @@
 #include "../CommonUtils.h"
 #include "Urho3D/IO/MemoryBuffer.h"
 #include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Resource/CookedResourceCache.h>
 #include <Urho3D/Resource/Image.h>
 
 namespace Tests
@@ -98,4 +100,44 @@ TEST_CASE("DXT, ETC and PVRTC images are decompressed")
     REQUIRE(CompareImages(*imageReference, *imagePVRTC4, false) < 0.15f);
 }
 
+TEST_CASE("Decoded images are restored from cooked resource cache")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+    auto cookedCache = context->GetSubsystem<CookedResourceCache>();
+    REQUIRE(cookedCache);
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "CookedResourceCacheTest");
+    cookedCache->SetCacheDir(tempDir.GetPath());
+    cookedCache->ResetStats();
+    REQUIRE(cookedCache->IsEnabled());
+
+    const auto encodedBytes = DecodeBase64(PNG);
+    const auto loadImage = [&]()
+    {
+        auto image = MakeShared<Image>(context);
+        image->SetName("Textures/UT_Image.png");
+        MemoryBuffer buffer(encodedBytes);
+        REQUIRE(image->Load(buffer));
+        return image;
+    };
+
+    const auto sourceImage = loadImage();
+    CHECK(cookedCache->GetNumMisses() == 1);
+    CHECK(cookedCache->GetNumStores() == 1);
+    CHECK(cookedCache->GetNumHits() == 0);
+
+    const auto cookedImage = loadImage();
+    CHECK(cookedCache->GetNumMisses() == 1);
+    CHECK(cookedCache->GetNumHits() == 1);
+
+    REQUIRE(cookedImage->GetSize() == sourceImage->GetSize());
+    REQUIRE(cookedImage->GetComponents() == sourceImage->GetComponents());
+    CHECK(CompareImages(*sourceImage, *cookedImage, true) == 0.0f);
+
+    cookedCache->Clear();
+    cookedCache->SetCacheDir(EMPTY_STRING);
+    cookedCache->ResetStats();
+}
+
 } // namespace Tests
@@ -0,0 +1,326 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Format.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Resource/BinaryFile.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/XMLFile.h>
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+
+SharedPtr<Resource> AddManualResource(ResourceCache* cache, SharedPtr<Resource> resource, const ea::string& name)
+{
+    resource->SetName(name);
+    cache->AddManualResource(resource);
+    return resource;
+}
+
+/// Resource with fake memory use that releases half of it on soft-unload.
+class LruTestResource : public Resource
+{
+    URHO3D_OBJECT(LruTestResource, Resource);
+
+public:
+    LruTestResource(Context* context, unsigned memoryUse)
+        : Resource(context)
+    {
+        SetMemoryUse(memoryUse);
+    }
+
+protected:
+    bool OnSoftUnload() override
+    {
+        SetMemoryUse(GetMemoryUse() / 2);
+        return true;
+    }
+};
+
+SharedPtr<Resource> AddLruTestResource(ResourceCache* cache, const ea::string& name)
+{
+    return AddManualResource(cache, MakeShared<LruTestResource>(cache->GetContext(), 100), name);
+}
+
+}
+
+TEST_CASE("ResourceCache finds resources by name and type")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto cache = context->GetSubsystem<ResourceCache>();
+
+    const ea::string name = "Tests/ResourceCache/Shared.res";
+    auto xmlFile = AddManualResource(cache, MakeShared<XMLFile>(context), name);
+    auto binaryFile = AddManualResource(cache, MakeShared<BinaryFile>(context), name);
+
+    CHECK(cache->GetExistingResource<XMLFile>(name) == xmlFile.Get());
+    CHECK(cache->GetExistingResource<BinaryFile>(name) == binaryFile.Get());
+    CHECK(cache->GetResource<XMLFile>(name) == xmlFile.Get());
+
+    Resource* anyResource = cache->GetExistingResource(StringHash::Empty, name);
+    CHECK((anyResource == xmlFile.Get() || anyResource == binaryFile.Get()));
+
+    // Resources are not released while referenced
+    cache->ReleaseResource(name);
+    CHECK(cache->GetExistingResource<XMLFile>(name) == xmlFile.Get());
+
+    xmlFile = nullptr;
+    cache->ReleaseResource(name);
+    CHECK(cache->GetExistingResource<XMLFile>(name) == nullptr);
+    CHECK(cache->GetExistingResource<BinaryFile>(name) == binaryFile.Get());
+
+    cache->ReleaseResource(name, true);
+    CHECK(cache->GetExistingResource(StringHash::Empty, name) == nullptr);
+}
+
+TEST_CASE("ResourceCache returns loaded resources to worker threads")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto cache = context->GetSubsystem<ResourceCache>();
+
+    const ea::string name = "Tests/ResourceCache/Worker.xml";
+    auto xmlFile = AddManualResource(cache, MakeShared<XMLFile>(context), name);
+
+    Resource* existingResource = xmlFile.Get();
+    Resource* missingResource = xmlFile.Get();
+    SharedPtr<XMLFile> workerReference;
+    std::thread thread([&]()
+    {
+        existingResource = cache->GetResource<XMLFile>(name);
+        missingResource = cache->GetExistingResource<XMLFile>("Tests/ResourceCache/Missing.xml");
+        workerReference = cache->GetExistingResource<XMLFile>(name);
+    });
+    thread.join();
+
+    // Raw pointers are not returned to worker threads
+    CHECK(existingResource == nullptr);
+    CHECK(missingResource == nullptr);
+    CHECK(workerReference == xmlFile);
+
+    // Reference returned to the worker keeps the resource alive after it is released from the cache
+    xmlFile = nullptr;
+    cache->ReleaseResource(name, true);
+    REQUIRE(workerReference);
+    CHECK(workerReference->Refs() == 1);
+}
+
+TEST_CASE("ResourceCache background loads resources with priorities")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto cache = context->GetSubsystem<ResourceCache>();
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "BackgroundLoaderTest");
+    for (const char* name : {"A", "B", "C"})
+    {
+        auto xmlFile = MakeShared<XMLFile>(context);
+        xmlFile->CreateRoot(name);
+        REQUIRE(xmlFile->SaveFile(Format("{}Tests/BackgroundLoader/{}.xml", tempDir.GetPath(), name)));
+    }
+    cache->AddResourceDir(tempDir.GetPath());
+    cache->SetMaxConcurrentBackgroundLoads(1);
+
+    CHECK(cache->BackgroundLoadResource<XMLFile>("Tests/BackgroundLoader/A.xml", true, nullptr, ResourceLoadPriority::Prefetch));
+    CHECK(cache->BackgroundLoadResource<XMLFile>("Tests/BackgroundLoader/B.xml"));
+    CHECK(cache->BackgroundLoadResource<XMLFile>("Tests/BackgroundLoader/C.xml"));
+    CHECK_FALSE(cache->BackgroundLoadResource<XMLFile>("Tests/BackgroundLoader/B.xml"));
+    CHECK(cache->CancelBackgroundLoadResource<XMLFile>("Tests/BackgroundLoader/C.xml"));
+    CHECK_FALSE(cache->CancelBackgroundLoadResource<XMLFile>("Tests/BackgroundLoader/Missing.xml"));
+
+    // Resource requested synchronously is finished immediately
+    auto resourceB = cache->GetResource<XMLFile>("Tests/BackgroundLoader/B.xml");
+    REQUIRE(resourceB);
+    CHECK(resourceB->GetRoot().GetName() == "B");
+
+    for (unsigned i = 0; i < 1000 && cache->GetNumBackgroundLoadResources() > 0; ++i)
+        Tests::RunFrame(context, 0.01f);
+    CHECK(cache->GetNumBackgroundLoadResources() == 0);
+
+    auto resourceA = cache->GetExistingResource<XMLFile>("Tests/BackgroundLoader/A.xml");
+    REQUIRE(resourceA);
+    CHECK(resourceA->GetRoot().GetName() == "A");
+    CHECK(cache->GetExistingResource<XMLFile>("Tests/BackgroundLoader/C.xml") == nullptr);
+
+    cache->SetMaxConcurrentBackgroundLoads(0);
+    cache->RemoveResourceDir(tempDir.GetPath());
+    cache->ReleaseResources(ea::string("Tests/BackgroundLoader/"), true);
+}
+
+TEST_CASE("ResourceCache background loads resources when work queue pool is exhausted")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto cache = context->GetSubsystem<ResourceCache>();
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+    auto workQueue = context->GetSubsystem<WorkQueue>();
+
+    TemporaryDir tempDir(context, fileSystem->GetTemporaryDir() + "BackgroundLoaderPoolTest");
+    auto xmlFile = MakeShared<XMLFile>(context);
+    xmlFile->CreateRoot("D");
+    REQUIRE(xmlFile->SaveFile(tempDir.GetPath() + "Tests/BackgroundLoader/D.xml"));
+    cache->AddResourceDir(tempDir.GetPath());
+
+    // Fill the pool with tasks that are not submitted yet, the last one is executed immediately
+    workQueue->SetMaxPendingTasks(1);
+    std::atomic<unsigned> numExecuted{};
+    ea::vector<TaskHandle> tasks;
+    while (true)
+    {
+        const TaskHandle task = workQueue->CreateTask([&](unsigned) { ++numExecuted; });
+        if (!task.IsValid())
+            break;
+        tasks.push_back(task);
+    }
+    CHECK(numExecuted == 1);
+
+    // Resource is loaded without the work queue
+    CHECK(cache->BackgroundLoadResource<XMLFile>("Tests/BackgroundLoader/D.xml"));
+
+    for (const TaskHandle& task : tasks)
+        workQueue->SubmitTask(task);
+    workQueue->WaitTasks(tasks);
+    workQueue->SetMaxPendingTasks(M_MAX_UNSIGNED);
+    CHECK(numExecuted == tasks.size() + 1);
+
+    for (unsigned i = 0; i < 1000 && cache->GetNumBackgroundLoadResources() > 0; ++i)
+        Tests::RunFrame(context, 0.01f);
+    CHECK(cache->GetNumBackgroundLoadResources() == 0);
+
+    auto resourceD = cache->GetExistingResource<XMLFile>("Tests/BackgroundLoader/D.xml");
+    REQUIRE(resourceD);
+    CHECK(resourceD->GetRoot().GetName() == "D");
+
+    cache->RemoveResourceDir(tempDir.GetPath());
+    cache->ReleaseResources(ea::string("Tests/BackgroundLoader/"), true);
+}
+
+TEST_CASE("ResourceCache evicts least recently used resources over memory budget")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto cache = context->GetSubsystem<ResourceCache>();
+    const StringHash type = LruTestResource::GetTypeStatic();
+
+    cache->SetMemoryBudget(type, 300);
+
+    AddLruTestResource(cache, "Tests/LRU/1");
+    auto resource2 = AddLruTestResource(cache, "Tests/LRU/2");
+    AddLruTestResource(cache, "Tests/LRU/3");
+    AddLruTestResource(cache, "Tests/LRU/4");
+
+    CHECK(cache->GetExistingResource<LruTestResource>("Tests/LRU/1") == nullptr);
+    CHECK(cache->GetMemoryUse(type) == 300);
+
+    // Resource in use is skipped, recently used resource is kept
+    REQUIRE(cache->GetExistingResource<LruTestResource>("Tests/LRU/3"));
+    AddLruTestResource(cache, "Tests/LRU/5");
+
+    CHECK(cache->GetExistingResource<LruTestResource>("Tests/LRU/2") == resource2);
+    CHECK(cache->GetExistingResource<LruTestResource>("Tests/LRU/3"));
+    CHECK(cache->GetExistingResource<LruTestResource>("Tests/LRU/4") == nullptr);
+    CHECK(cache->GetExistingResource<LruTestResource>("Tests/LRU/5"));
+
+    // Resources in use are soft-unloaded in LRU order
+    cache->SetSoftUnloadEnabled(true);
+    SharedPtr<Resource> resource3{cache->GetExistingResource<LruTestResource>("Tests/LRU/3")};
+    SharedPtr<Resource> resource5{cache->GetExistingResource<LruTestResource>("Tests/LRU/5")};
+    auto resource6 = AddLruTestResource(cache, "Tests/LRU/6");
+
+    CHECK(resource2->IsSoftUnloaded());
+    CHECK(resource3->IsSoftUnloaded());
+    CHECK_FALSE(resource5->IsSoftUnloaded());
+    CHECK_FALSE(resource6->IsSoftUnloaded());
+    CHECK(cache->GetMemoryUse(type) == 300);
+    CHECK(cache->PrintMemoryUsage().contains("SoftUnld"));
+
+    // Total memory budget is enforced across resource types
+    cache->SetMemoryBudget(type, 0);
+    cache->SetTotalMemoryBudget(cache->GetTotalMemoryUse() - 100);
+    resource2 = nullptr;
+    resource3 = nullptr;
+    resource5 = nullptr;
+    resource6 = nullptr;
+    auto resource7 = AddLruTestResource(cache, "Tests/LRU/7");
+
+    CHECK(cache->GetTotalMemoryUse() <= cache->GetTotalMemoryBudget());
+    CHECK(cache->GetExistingResource<LruTestResource>("Tests/LRU/7") == resource7);
+
+    cache->SetTotalMemoryBudget(0);
+    cache->SetSoftUnloadEnabled(false);
+    cache->ReleaseResources(type, true);
+}
+
+TEST_CASE("ResourceCache lookups scale with number of threads", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto cache = context->GetSubsystem<ResourceCache>();
+
+    const unsigned numResources = 1000;
+    const unsigned numLookupsPerThread = 1000000;
+    const unsigned maxThreads = ea::max(GetNumLogicalCPUs(), 1u);
+
+    ea::vector<SharedPtr<Resource>> resources;
+    ea::vector<ea::string> names;
+    for (unsigned i = 0; i < numResources; ++i)
+    {
+        names.push_back(Format("Tests/ResourceCache/Benchmark{}.xml", i));
+        resources.push_back(AddManualResource(cache, MakeShared<XMLFile>(context), names.back()));
+    }
+
+    for (unsigned numThreads = 1; numThreads <= maxThreads; ++numThreads)
+    {
+        std::atomic<unsigned> numHits{};
+        ea::vector<std::thread> threads;
+
+        HiresTimer timer;
+        for (unsigned threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+        {
+            threads.emplace_back([&, threadIndex]()
+            {
+                unsigned localHits = 0;
+                for (unsigned i = 0; i < numLookupsPerThread; ++i)
+                {
+                    const ea::string& name = names[(i * 7919 + threadIndex) % numResources];
+                    if (cache->GetExistingResource<XMLFile>(name))
+                        ++localHits;
+                }
+                numHits += localHits;
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        const long long elapsedUSec = ea::max(timer.GetUSec(false), 1ll);
+
+        CHECK(numHits == numThreads * numLookupsPerThread);
+        WARN("Threads: " << numThreads
+            << ", lookups/sec: " << static_cast<long long>(numHits * 1000000.0 / elapsedUSec));
+    }
+
+    for (const ea::string& name : names)
+        cache->ReleaseResource<XMLFile>(name, true);
+}
@@ -0,0 +1,242 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+#include "../SceneUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Scene/CompiledPrefab.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SplinePath.h>
+#include <Urho3D/Utility/PackedSceneData.h>
+
+namespace
+{
+
+class PrefabTestComponent : public Component
+{
+    URHO3D_OBJECT(PrefabTestComponent, Component);
+
+public:
+    using Component::Component;
+
+    static void RegisterObject(Context* context)
+    {
+        context->AddFactoryReflection<PrefabTestComponent>();
+
+        URHO3D_ATTRIBUTE("First", int, first_, 0, AM_DEFAULT);
+        URHO3D_ATTRIBUTE("Second", int, second_, 0, AM_DEFAULT);
+    }
+
+    /// Register attributes in different order, as if the type was changed after the prefab was compiled.
+    static void RegisterObjectReversed(Context* context)
+    {
+        context->AddFactoryReflection<PrefabTestComponent>();
+
+        URHO3D_ATTRIBUTE("Second", int, second_, 0, AM_DEFAULT);
+        URHO3D_ATTRIBUTE("First", int, first_, 0, AM_DEFAULT);
+    }
+
+    int first_{};
+    int second_{};
+};
+
+Node* CreatePrefabNode(Scene* scene)
+{
+    Node* node = scene->CreateChild("Prefab");
+    node->SetPosition({1.0f, 2.0f, 3.0f});
+    node->AddTag("Spawned");
+    node->SetVar("Health", 100);
+    node->CreateComponent<StaticModel>()->SetCastShadows(true);
+
+    Node* child = node->CreateChild("Child");
+    child->SetScale(2.0f);
+    child->CreateComponent<Light>()->SetColor(Color::RED);
+
+    Node* disabledChild = child->CreateChild("Disabled");
+    disabledChild->SetEnabled(false);
+    disabledChild->CreateComponent<Light>()->SetBrightness(3.0f);
+
+    node->CreateTemporaryChild("Temporary");
+
+    auto splinePath = node->CreateComponent<SplinePath>();
+    splinePath->AddControlPoint(child);
+    splinePath->AddControlPoint(disabledChild);
+    // SetControlledNode doesn't update the attribute, so set node ID directly
+    splinePath->SetControlledIdAttr(child->GetID());
+    splinePath->ApplyAttributes();
+    return node;
+}
+
+}
+
+TEST_CASE("Compiled prefab is instantiated as a copy of the original nodes")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+
+    Node* prefabNode = CreatePrefabNode(scene);
+    const CompiledPrefab prefab{prefabNode};
+    CHECK(prefab.GetNumNodes() == 3);
+    CHECK(prefab.GetNumComponents() == 4);
+
+    const PackedNodeData nodeData{prefabNode};
+    prefabNode->Remove();
+
+    Node* referenceNode = nodeData.SpawnCopy(scene);
+    Node* node = prefab.Instantiate(scene);
+    REQUIRE(node);
+    CHECK(node->GetParent() == scene);
+    CHECK(Tests::CompareNodes(*node, *referenceNode));
+
+    CHECK(node->GetPosition() == Vector3{1.0f, 2.0f, 3.0f});
+    CHECK(node->HasTag("Spawned"));
+    CHECK(node->GetVar("Health") == Variant{100});
+    CHECK(node->GetNumChildren() == 1);
+    REQUIRE(node->GetComponent<StaticModel>());
+    CHECK(node->GetComponent<StaticModel>()->GetCastShadows());
+
+    Node* child = node->GetChild("Child");
+    REQUIRE(child);
+    CHECK(child->GetScale() == Vector3::ONE * 2.0f);
+    REQUIRE(child->GetComponent<Light>());
+    CHECK(child->GetComponent<Light>()->GetColor() == Color::RED);
+
+    Node* disabledChild = child->GetChild("Disabled");
+    REQUIRE(disabledChild);
+    CHECK_FALSE(disabledChild->IsEnabled());
+    REQUIRE(disabledChild->GetComponent<Light>());
+    CHECK(disabledChild->GetComponent<Light>()->GetBrightness() == 3.0f);
+
+    // References are resolved within the instance
+    auto splinePath = node->GetComponent<SplinePath>();
+    REQUIRE(splinePath);
+    CHECK(splinePath->GetControlledNode() == child);
+    REQUIRE(splinePath->GetControlPointIdsAttr().size() == 3);
+    CHECK(splinePath->GetControlPointIdsAttr()[1].GetUInt() == child->GetID());
+    CHECK(splinePath->GetControlPointIdsAttr()[2].GetUInt() == disabledChild->GetID());
+}
+
+TEST_CASE("Compiled prefab is instantiated many times")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+
+    Node* prefabNode = CreatePrefabNode(scene);
+    const CompiledPrefab prefab{prefabNode};
+    prefabNode->Remove();
+
+    Node* parent = scene->CreateChild("Parent");
+    const ea::vector<Node*> nodes = prefab.Instantiate(parent, 100);
+
+    REQUIRE(nodes.size() == 100);
+    CHECK(parent->GetNumChildren() == 100);
+
+    ea::unordered_set<unsigned> ids;
+    for (Node* node : nodes)
+    {
+        REQUIRE(node->GetParent() == parent);
+        CHECK(Tests::CompareNodes(*node, *nodes[0]));
+        REQUIRE(node->GetComponent<SplinePath>());
+        CHECK(node->GetComponent<SplinePath>()->GetControlledNode() == node->GetChild("Child"));
+        ids.insert(node->GetID());
+    }
+    CHECK(ids.size() == 100);
+    CHECK(scene->GetChildrenWithTag("Spawned", true).size() == 100);
+
+    CHECK(prefab.Instantiate(parent, 0).empty());
+    CHECK(CompiledPrefab{}.Instantiate(parent) == nullptr);
+}
+
+TEST_CASE("Compiled prefab resolves component types on instantiation")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+
+    CompiledPrefab prefab;
+    {
+        auto guard = Tests::MakeScopedReflection<Tests::RegisterObject<PrefabTestComponent>>(context);
+        Node* prefabNode = scene->CreateChild("Prefab");
+        auto component = prefabNode->CreateComponent<PrefabTestComponent>();
+        component->first_ = 1;
+        component->second_ = 2;
+        REQUIRE(prefab.Compile(prefabNode));
+        prefabNode->Remove();
+    }
+
+    // Component of type that is no longer registered is skipped
+    Node* node = prefab.Instantiate(scene);
+    REQUIRE(node);
+    CHECK(node->GetNumComponents() == 0);
+
+    // Attributes are matched by name when the type is registered again
+    PrefabTestComponent::RegisterObjectReversed(context);
+    node = prefab.Instantiate(scene);
+    context->RemoveReflection(PrefabTestComponent::GetTypeStatic());
+
+    REQUIRE(node);
+    auto component = node->GetComponent<PrefabTestComponent>();
+    REQUIRE(component);
+    CHECK(component->first_ == 1);
+    CHECK(component->second_ == 2);
+}
+
+TEST_CASE("Compiled prefab is instantiated faster than packed node data", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+
+    // Large prefab of 512 nodes
+    Node* prefabNode = scene->CreateChild("Prefab");
+    for (unsigned i = 0; i < 511; ++i)
+    {
+        Node* child = prefabNode->CreateChild(Format("Child{}", i));
+        child->SetPosition({static_cast<float>(i), 0.0f, 0.0f});
+        child->CreateComponent<StaticModel>()->SetCastShadows(true);
+        if (i % 8 == 0)
+            child->CreateComponent<Light>()->SetColor(Color::RED);
+    }
+
+    const PackedNodeData nodeData{prefabNode};
+    const CompiledPrefab prefab{prefabNode};
+    prefabNode->Remove();
+
+    const unsigned numInstances = 20;
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < numInstances; ++i)
+        nodeData.SpawnCopy(scene);
+    const long long spawnCopyUSec = timer.GetUSec(true);
+    scene->RemoveAllChildren();
+
+    timer.Reset();
+    prefab.Instantiate(scene, numInstances);
+    const long long compiledPrefabUSec = timer.GetUSec(true);
+    scene->RemoveAllChildren();
+
+    WARN("Instances: " << numInstances << " x " << prefab.GetNumNodes() << " nodes"
+        << ", SpawnCopy: " << spawnCopyUSec / 1000 << " ms"
+        << ", CompiledPrefab: " << compiledPrefabUSec / 1000 << " ms");
+}
@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2017-2021 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR rhs
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR rhsWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR rhs DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../CommonUtils.h"
+#include "../SceneUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Scene/LogicComponent.h>
+
+namespace
+{
+
+/// Logic component that counts its updates.
+class CountingLogicComponent : public LogicComponent
+{
+    URHO3D_OBJECT(CountingLogicComponent, LogicComponent);
+
+public:
+    explicit CountingLogicComponent(Context* context)
+        : LogicComponent(context)
+    {
+        SetUpdateEventMask(USE_UPDATE | USE_POSTUPDATE);
+    }
+
+    void DelayedStart() override { ++numDelayedStarts_; }
+    void Update(float timeStep) override
+    {
+        ++numUpdates_;
+        time_ += timeStep;
+        if (removeOnUpdate_)
+            Remove();
+    }
+    void PostUpdate(float timeStep) override { ++numPostUpdates_; }
+
+    unsigned numDelayedStarts_{};
+    unsigned numUpdates_{};
+    unsigned numPostUpdates_{};
+    float time_{};
+    bool removeOnUpdate_{};
+};
+
+/// Logic component that may be updated from worker threads.
+class ThreadSafeLogicComponent : public CountingLogicComponent
+{
+    URHO3D_OBJECT(ThreadSafeLogicComponent, CountingLogicComponent);
+
+public:
+    using CountingLogicComponent::CountingLogicComponent;
+
+    bool IsThreadSafeUpdate() const override { return true; }
+};
+
+}
+
+TEST_CASE("LogicComponentManager updates logic components in batches")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<CountingLogicComponent, ThreadSafeLogicComponent>(context);
+
+    auto scene = MakeShared<Scene>(context);
+    auto manager = scene->CreateComponent<LogicComponentManager>();
+
+    ea::vector<CountingLogicComponent*> components;
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        Node* node = scene->CreateChild();
+        if (i % 2 == 0)
+            components.push_back(node->CreateComponent<CountingLogicComponent>());
+        else
+            components.push_back(node->CreateComponent<ThreadSafeLogicComponent>());
+    }
+
+    for (CountingLogicComponent* component : components)
+    {
+        REQUIRE(component->GetManager() == manager);
+        REQUIRE(component->IsBatchedUpdate());
+    }
+
+    scene->Update(0.5f);
+
+    REQUIRE(manager->GetNumBatches() == 2);
+    REQUIRE(manager->GetBatchComponents(0).size() == 100);
+    REQUIRE(manager->GetBatchComponents(1).size() == 100);
+    for (CountingLogicComponent* component : components)
+    {
+        CHECK(component->numDelayedStarts_ == 1);
+        CHECK(component->numUpdates_ == 1);
+        CHECK(component->numPostUpdates_ == 1);
+        CHECK(component->time_ == 0.5f);
+    }
+
+    // Disabled and removed components are not updated
+    components[0]->SetEnabled(false);
+    components[1]->GetNode()->SetEnabled(false);
+    components[2]->removeOnUpdate_ = true;
+    scene->Update(0.5f);
+
+    CHECK(components[0]->numUpdates_ == 1);
+    CHECK(components[1]->numUpdates_ == 1);
+    CHECK(components[3]->numUpdates_ == 2);
+    CHECK(manager->GetBatchComponents(0).size() + manager->GetBatchComponents(1).size() == 197);
+
+    scene->Update(0.5f);
+    CHECK(components[3]->numUpdates_ == 3);
+
+    // Components fall back to event subscriptions when manager is removed
+    components[0]->SetEnabled(true);
+    manager->Remove();
+    CHECK_FALSE(components[0]->IsBatchedUpdate());
+    CHECK_FALSE(components[3]->IsBatchedUpdate());
+
+    scene->Update(0.5f);
+    CHECK(components[0]->numUpdates_ == 2);
+    CHECK(components[1]->numUpdates_ == 1);
+    CHECK(components[3]->numUpdates_ == 4);
+}
+
+TEST_CASE("Batched update of logic components is faster than event subscriptions", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<CountingLogicComponent>(context);
+
+    const unsigned numComponents = 20000;
+    const unsigned numFrames = 100;
+
+    for (const bool batched : {false, true})
+    {
+        auto scene = MakeShared<Scene>(context);
+        if (batched)
+            scene->CreateComponent<LogicComponentManager>();
+
+        for (unsigned i = 0; i < numComponents; ++i)
+            scene->CreateChild()->CreateComponent<CountingLogicComponent>();
+
+        HiresTimer timer;
+        for (unsigned i = 0; i < numFrames; ++i)
+            scene->Update(1.0f / 60.0f);
+        const long long elapsedUSec = timer.GetUSec(false);
+
+        WARN((batched ? "Batched update" : "Event update") << " of " << numComponents
+            << " components: " << elapsedUSec / numFrames << " us/frame");
+    }
+}
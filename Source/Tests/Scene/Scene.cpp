@@ -23,7 +23,65 @@
 #include "../CommonUtils.h"
 #include "../SceneUtils.h"
 
+#include <Urho3D/Graphics/Light.h>
 #include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Particles/ParticleGraphEmitter.h>
+#include <Urho3D/Scene/SceneUpdateScheduler.h>
+#include <Urho3D/Scene/SplinePath.h>
+
+namespace
+{
+
+/// Component that stores animation data next to attributes like Animatable does.
+class AnimationDataTestComponent : public Component
+{
+    URHO3D_OBJECT(AnimationDataTestComponent, Component);
+
+public:
+    using Component::Component;
+
+    static void RegisterObject(Context* context)
+    {
+        context->AddFactoryReflection<AnimationDataTestComponent>();
+
+        URHO3D_ATTRIBUTE("Value", int, value_, 0, AM_DEFAULT);
+    }
+
+    bool LoadXML(const XMLElement& source) override
+    {
+        speed_ = source.GetChild("attributeanimation").GetFloat("speed");
+        return Component::LoadXML(source);
+    }
+
+    bool SaveXML(XMLElement& dest) const override
+    {
+        if (!Component::SaveXML(dest))
+            return false;
+        return dest.CreateChild("attributeanimation").SetFloat("speed", speed_);
+    }
+
+    bool LoadJSON(const JSONValue& source) override
+    {
+        speed_ = source.Get("attributeanimation").Get("speed").GetFloat();
+        return Component::LoadJSON(source);
+    }
+
+    bool SaveJSON(JSONValue& dest) const override
+    {
+        if (!Component::SaveJSON(dest))
+            return false;
+        JSONValue animationValue;
+        animationValue.Set("speed", speed_);
+        dest.Set("attributeanimation", animationValue);
+        return true;
+    }
+
+    int value_{};
+    float speed_{};
+};
+
+}
 
 TEST_CASE("Scene lookup")
 {
@@ -55,3 +113,194 @@ TEST_CASE("Scene lookup")
     CHECK(Tests::GetAttributeValue(child20->FindComponentAttribute("@/Name")) == Variant(child20->GetName()));
     CHECK(Tests::GetAttributeValue(child20->FindComponentAttribute("@StaticModel/LOD Bias")) == Variant(1.0f));
 }
+
+TEST_CASE("Scene update scheduler executes jobs according to data access")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+    SceneUpdateScheduler* scheduler = scene->GetUpdateScheduler();
+    scheduler->SetEnabled(true);
+
+    auto ownerA = scene->CreateComponent<StaticModel>();
+    auto ownerB1 = scene->CreateChild()->CreateComponent<StaticModel>();
+    auto ownerB2 = scene->CreateChild()->CreateComponent<StaticModel>();
+    auto ownerC = scene->CreateChild()->CreateComponent<StaticModel>();
+
+    ea::vector<ea::string> log;
+    std::atomic<unsigned> numParallelJobs{};
+    unsigned numParallelJobsBeforeC{};
+
+    SceneUpdateJobDesc jobA;
+    jobA.name_ = "A";
+    jobA.write_ = SceneDataAccess::Transforms;
+    jobA.callback_ = [&](float) { log.push_back("A"); };
+    scheduler->AddJob(ownerA, jobA);
+
+    SceneUpdateJobDesc jobB;
+    jobB.name_ = "B";
+    jobB.read_ = SceneDataAccess::Transforms;
+    jobB.write_ = SceneDataAccess::Particles;
+    jobB.threadSafe_ = true;
+    jobB.callback_ = [&](float) { ++numParallelJobs; };
+    scheduler->AddJob(ownerB1, jobB);
+    scheduler->AddJob(ownerB2, jobB);
+
+    SceneUpdateJobDesc jobC;
+    jobC.name_ = "C";
+    jobC.read_ = SceneDataAccess::Particles;
+    jobC.callback_ = [&](float)
+    {
+        log.push_back("C");
+        numParallelJobsBeforeC = numParallelJobs;
+    };
+    scheduler->AddJob(ownerC, jobC);
+
+    CHECK(SceneUpdateScheduler::IsConflicting(jobA, jobB));
+    CHECK(SceneUpdateScheduler::IsConflicting(jobB, jobC));
+    CHECK_FALSE(SceneUpdateScheduler::IsConflicting(jobA, jobC));
+
+    scene->Update(0.1f);
+    CHECK(log == ea::vector<ea::string>{"A", "C"});
+    CHECK(numParallelJobs == 2);
+    CHECK(numParallelJobsBeforeC == 2);
+
+    // Jobs of removed components are removed too
+    ownerB1->Remove();
+    ownerB2->Remove();
+    scene->Update(0.1f);
+    CHECK(scheduler->GetNumJobGroups() == 2);
+    CHECK(numParallelJobs == 2);
+    CHECK(log == ea::vector<ea::string>{"A", "C", "A", "C"});
+
+    // Jobs are dropped when the scheduler is disabled and are not added until it is enabled again
+    scheduler->SetEnabled(false);
+    CHECK(scheduler->GetNumJobGroups() == 0);
+    scheduler->AddJob(ownerA, jobA);
+    CHECK(scheduler->GetNumJobGroups() == 0);
+}
+
+TEST_CASE("Scene update scheduler keeps jobs of builtin components only while enabled")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+    SceneUpdateScheduler* scheduler = scene->GetUpdateScheduler();
+
+    ea::vector<SharedPtr<Node>> nodes;
+    for (unsigned i = 0; i < 10; ++i)
+    {
+        Node* node = scene->CreateChild();
+        node->CreateComponent<ParticleGraphEmitter>();
+        nodes.emplace_back(node);
+    }
+    CHECK(scheduler->GetNumJobInstances() == 0);
+
+    // Existing components add their jobs when the scheduler is enabled, new components add them immediately
+    scheduler->SetEnabled(true);
+    CHECK(scheduler->GetNumJobInstances() == 10);
+    scene->CreateChild()->CreateComponent<ParticleGraphEmitter>();
+    CHECK(scheduler->GetNumJobInstances() == 11);
+
+    // Jobs of removed components are removed, even if the component is added to the scene again
+    nodes[0]->Remove();
+    nodes[1]->GetComponent<ParticleGraphEmitter>()->Remove();
+    scene->AddChild(nodes[0]);
+    scene->Update(0.1f);
+    CHECK(scheduler->GetNumJobInstances() == 10);
+
+    scheduler->SetEnabled(false);
+    CHECK(scheduler->GetNumJobInstances() == 0);
+    scene->CreateChild()->CreateComponent<ParticleGraphEmitter>();
+    CHECK(scheduler->GetNumJobInstances() == 0);
+}
+
+TEST_CASE("Scene is loaded asynchronously with nodes decoded in worker threads")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+
+    auto sourceScene = MakeShared<Scene>(context);
+    for (unsigned i = 0; i < 50; ++i)
+    {
+        Node* node = sourceScene->CreateChild(Format("Node_{}", i));
+        node->SetPosition({static_cast<float>(i), 0.0f, 0.0f});
+        node->AddTag("Loaded");
+        node->CreateComponent<StaticModel>()->SetCastShadows(i % 2 == 0);
+
+        Node* child = node->CreateChild("Child");
+        child->CreateComponent<Light>()->SetLightType(LIGHT_SPOT);
+
+        auto splinePath = node->CreateComponent<SplinePath>();
+        splinePath->AddControlPoint(child);
+        splinePath->SetControlledIdAttr(child->GetID());
+    }
+
+    const auto format = GENERATE(0, 1, 2);
+    VectorBuffer buffer;
+    const AbstractFilePtr file(&buffer, sourceScene.Get());
+    bool loading = false;
+    auto scene = MakeShared<Scene>(context);
+    scene->SetAsyncLoadingThreaded(true);
+    scene->SetAsyncLoadingMs(1);
+    if (format == 0)
+    {
+        REQUIRE(sourceScene->Save(*file));
+        file->Seek(0);
+        loading = scene->LoadAsync(file);
+    }
+    else if (format == 1)
+    {
+        REQUIRE(sourceScene->SaveXML(*file));
+        file->Seek(0);
+        loading = scene->LoadAsyncXML(file);
+    }
+    else
+    {
+        REQUIRE(sourceScene->SaveJSON(*file));
+        file->Seek(0);
+        loading = scene->LoadAsyncJSON(file);
+    }
+    REQUIRE(loading);
+
+    for (unsigned i = 0; i < 1000 && scene->IsAsyncLoading(); ++i)
+        Tests::RunFrame(context, 0.01f);
+    REQUIRE_FALSE(scene->IsAsyncLoading());
+
+    // Node IDs are preserved, so references are resolved the same way
+    CHECK(Tests::CompareNodes(*scene, *sourceScene));
+    CHECK(scene->GetChildrenWithTag("Loaded").size() == 50);
+
+    Node* node = scene->GetChild("Node_10");
+    REQUIRE(node);
+    REQUIRE(node->GetComponent<SplinePath>());
+    CHECK(node->GetComponent<SplinePath>()->GetControlledNode() == node->GetChild("Child"));
+}
+
+TEST_CASE("Scene loaded asynchronously in worker threads keeps animation data of components")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<Tests::RegisterObject<AnimationDataTestComponent>>(context);
+
+    auto sourceScene = MakeShared<Scene>(context);
+    auto sourceComponent = sourceScene->CreateChild("Node")->CreateComponent<AnimationDataTestComponent>();
+    sourceComponent->value_ = 5;
+    sourceComponent->speed_ = 2.0f;
+
+    const bool isXML = GENERATE(true, false);
+    VectorBuffer buffer;
+    const AbstractFilePtr file(&buffer, sourceScene.Get());
+    REQUIRE((isXML ? sourceScene->SaveXML(*file) : sourceScene->SaveJSON(*file)));
+    file->Seek(0);
+
+    auto scene = MakeShared<Scene>(context);
+    scene->SetAsyncLoadingThreaded(true);
+    REQUIRE((isXML ? scene->LoadAsyncXML(file) : scene->LoadAsyncJSON(file)));
+    for (unsigned i = 0; i < 1000 && scene->IsAsyncLoading(); ++i)
+        Tests::RunFrame(context, 0.01f);
+    REQUIRE_FALSE(scene->IsAsyncLoading());
+
+    Node* node = scene->GetChild("Node");
+    REQUIRE(node);
+    auto component = node->GetComponent<AnimationDataTestComponent>();
+    REQUIRE(component);
+    CHECK(component->value_ == 5);
+    CHECK(component->speed_ == 2.0f);
+}
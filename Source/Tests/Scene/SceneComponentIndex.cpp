@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Scene/Scene.h>
+
+TEST_CASE("Scene component index is dense and deterministic")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+
+    auto lightA = scene->CreateChild("A")->CreateComponent<Light>();
+    SharedPtr<Light> lightB{scene->CreateChild("B")->CreateComponent<Light>()};
+    scene->CreateChild("C")->CreateComponent<StaticModel>();
+
+    // Index may be created for non-empty scene
+    scene->CreateComponentIndex<Light>();
+    const SceneComponentIndex& index = scene->GetComponentIndex<Light>();
+    REQUIRE(index.GetSize() == 2);
+    CHECK(index.Contains(lightA));
+    CHECK(index.Contains(lightB));
+
+    auto lightD = scene->CreateChild("D")->CreateComponent<Light>();
+    SharedPtr<Light> lightE{scene->CreateChild("E")->CreateComponent<Light>()};
+    REQUIRE(index.GetSize() == 4);
+    CHECK(index.GetComponent<Light>(2) == lightD);
+    CHECK(index.GetComponent<Light>(3) == lightE);
+
+    // Order of remaining components is preserved
+    const unsigned version = index.GetVersion();
+    lightB->Remove();
+    CHECK(index.GetVersion() != version);
+    CHECK_FALSE(index.Contains(lightB));
+    REQUIRE(index.GetSize() == 3);
+    CHECK(index.GetComponent(1) == lightD);
+
+    unsigned numLights = 0;
+    for (Component* component : index)
+    {
+        CHECK(component->GetType() == Light::GetTypeStatic());
+        ++numLights;
+    }
+    CHECK(numLights == 3);
+
+    scene->GetChild("A")->Remove();
+    CHECK(index.GetComponents() == ea::vector<Component*>{lightD, lightE});
+
+    // Components removed during iteration are skipped as null, remaining ones are compacted afterwards
+    auto lightF = scene->CreateChild("F")->CreateComponent<Light>();
+    ea::vector<Component*> visitedComponents;
+    for (Component* component : index)
+    {
+        visitedComponents.push_back(component);
+        if (component == lightD)
+            lightE->Remove();
+    }
+    CHECK(visitedComponents == ea::vector<Component*>{lightD, nullptr, lightF});
+    REQUIRE(index.GetSize() == 2);
+    CHECK(index.GetComponent(1) == lightF);
+    CHECK(index.Contains(lightF));
+    CHECK_FALSE(index.Contains(lightE));
+}
+
+TEST_CASE("Scene component queries are cached until components are added or removed")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+
+    Node* nodeA = scene->CreateChild("A");
+    nodeA->CreateComponent<Light>();
+    nodeA->CreateComponent<Light>();
+    nodeA->CreateComponent<StaticModel>();
+
+    Node* nodeB = scene->CreateChild("B");
+    nodeB->CreateComponent<Light>();
+
+    Node* nodeC = scene->CreateChild("C");
+    nodeC->CreateComponent<StaticModel>();
+
+    const auto& result = scene->QueryNodesWithComponents<Light, StaticModel>();
+    CHECK(result == ea::vector<Node*>{nodeA});
+    CHECK(&scene->QueryNodesWithComponents<StaticModel, Light>() == &result);
+    CHECK(scene->QueryNodesWithComponents<Light>().size() == 2);
+
+    nodeB->CreateComponent<StaticModel>();
+    auto lightC = nodeC->CreateComponent<Light>();
+    CHECK(scene->QueryNodesWithComponents<Light, StaticModel>().size() == 3);
+
+    lightC->Remove();
+    nodeA->Remove();
+    CHECK(scene->QueryNodesWithComponents<Light, StaticModel>() == ea::vector<Node*>{nodeB});
+}
+
+TEST_CASE("Scene component index iteration is faster than tree traversal", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+    scene->CreateComponentIndex<Light>();
+
+    const unsigned numNodes = 100000;
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        Node* node = scene->CreateChild();
+        node->CreateComponent<StaticModel>();
+        if (i % 2 == 0)
+            node->CreateComponent<Light>();
+    }
+
+    HiresTimer timer;
+    float sum = 0.0f;
+    for (Component* component : scene->GetComponentIndex<Light>())
+        sum += static_cast<Light*>(component)->GetBrightness();
+    const long long indexUSec = timer.GetUSec(true);
+
+    ea::vector<Component*> components;
+    scene->GetComponents(components, Light::GetTypeStatic(), true);
+    for (Component* component : components)
+        sum += static_cast<Light*>(component)->GetBrightness();
+    const long long traversalUSec = timer.GetUSec(true);
+
+    scene->QueryNodesWithComponents<Light, StaticModel>();
+    const long long queryUSec = timer.GetUSec(true);
+    scene->QueryNodesWithComponents<Light, StaticModel>();
+    const long long cachedQueryUSec = timer.GetUSec(true);
+
+    CHECK(sum == numNodes);
+    WARN("Index iteration: " << indexUSec << " us, tree traversal: " << traversalUSec
+        << " us, query: " << queryUSec << " us, cached query: " << cachedQueryUSec << " us");
+}
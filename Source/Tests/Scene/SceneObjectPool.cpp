@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+#include "../SceneUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneObjectPool.h>
+#include <Urho3D/Utility/PackedSceneData.h>
+
+namespace
+{
+
+Node* CreatePrototypeNode(Scene* scene)
+{
+    Node* node = scene->CreateChild("Prototype");
+    node->SetPosition({1.0f, 2.0f, 3.0f});
+    node->AddTag("Spawned");
+    node->CreateComponent<StaticModel>()->SetCastShadows(true);
+
+    Node* child = node->CreateChild("Child");
+    child->SetScale(2.0f);
+    child->CreateComponent<Light>()->SetColor(Color::RED);
+    return node;
+}
+
+}
+
+TEST_CASE("Scene nodes and components are allocated from object pool")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+
+    const unsigned numNodesBefore = SceneObjectPool::GetNumAllocated(sizeof(Node));
+    {
+        auto node = MakeShared<Node>(context);
+        CHECK(SceneObjectPool::GetNumAllocated(sizeof(Node)) == numNodesBefore + 1);
+    }
+    CHECK(SceneObjectPool::GetNumAllocated(sizeof(Node)) == numNodesBefore);
+
+    SceneObjectPool::Reserve(sizeof(Node), 1000);
+    CHECK(SceneObjectPool::GetNumFree(sizeof(Node)) >= 1000);
+
+    // Memory is reused
+    void* firstPtr = SceneObjectPool::Allocate(sizeof(Node));
+    SceneObjectPool::Free(firstPtr, sizeof(Node));
+    void* secondPtr = SceneObjectPool::Allocate(sizeof(Node));
+    CHECK(firstPtr == secondPtr);
+    SceneObjectPool::Free(secondPtr, sizeof(Node));
+
+    // Large objects are not pooled
+    CHECK_FALSE(SceneObjectPool::IsPooled(SceneObjectPool::MaxPooledSize + 1));
+    void* largePtr = SceneObjectPool::Allocate(SceneObjectPool::MaxPooledSize + 1);
+    CHECK(largePtr != nullptr);
+    SceneObjectPool::Free(largePtr, SceneObjectPool::MaxPooledSize + 1);
+}
+
+TEST_CASE("Scene instantiates many copies of packed node")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+
+    Node* prototype = CreatePrototypeNode(scene);
+    const PackedNodeData nodeData{prototype};
+    prototype->Remove();
+
+    Node* parent = scene->CreateChild("Parent");
+    const ea::vector<Node*> nodes = scene->InstantiateMany(nodeData, 100, parent);
+
+    REQUIRE(nodes.size() == 100);
+    CHECK(parent->GetNumChildren() == 100);
+
+    ea::unordered_set<unsigned> ids;
+    for (Node* node : nodes)
+    {
+        REQUIRE(node->GetParent() == parent);
+        CHECK(Tests::CompareNodes(*node, *nodes[0]));
+        CHECK(node->GetPosition() == Vector3{1.0f, 2.0f, 3.0f});
+        CHECK(node->HasTag("Spawned"));
+        REQUIRE(node->GetComponent<StaticModel>());
+        CHECK(node->GetComponent<StaticModel>()->GetCastShadows());
+        REQUIRE(node->GetChild("Child"));
+        REQUIRE(node->GetChild("Child")->GetComponent<Light>());
+        CHECK(node->GetChild("Child")->GetComponent<Light>()->GetColor() == Color::RED);
+        ids.insert(node->GetID());
+    }
+    CHECK(ids.size() == 100);
+    CHECK(scene->GetChildrenWithTag("Spawned", true).size() == 100);
+
+    CHECK(scene->InstantiateMany(nodeData, 0).empty());
+}
+
+TEST_CASE("Scene instantiates many nodes faster than individual spawning", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto scene = MakeShared<Scene>(context);
+
+    Node* prototype = CreatePrototypeNode(scene);
+    const PackedNodeData nodeData{prototype};
+    prototype->Remove();
+
+    const unsigned numNodes = 10000;
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < numNodes; ++i)
+        nodeData.SpawnCopy(scene);
+    const long long spawnCopyUSec = timer.GetUSec(true);
+    scene->RemoveAllChildren();
+
+    timer.Reset();
+    scene->InstantiateMany(nodeData, numNodes);
+    const long long instantiateManyUSec = timer.GetUSec(true);
+    scene->RemoveAllChildren();
+
+    WARN("Nodes: " << numNodes << ", SpawnCopy: " << spawnCopyUSec / 1000
+        << " ms, InstantiateMany: " << instantiateManyUSec / 1000 << " ms");
+}
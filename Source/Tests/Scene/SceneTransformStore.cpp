@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+#include "../SceneUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Scene/Scene.h>
+
+namespace
+{
+
+/// Component that counts transform notifications of its node.
+class TransformListenerComponent : public Component
+{
+    URHO3D_OBJECT(TransformListenerComponent, Component);
+
+public:
+    using Component::Component;
+
+    unsigned numNotifications_{};
+
+protected:
+    void OnNodeSet(Node* previousNode, Node* currentNode) override
+    {
+        if (currentNode)
+            currentNode->AddListener(this);
+    }
+
+    void OnMarkedDirty(Node* node) override { ++numNotifications_; }
+};
+
+/// Create a tree of nodes with the same layout in the scene.
+void CreateNodeTree(Scene* scene, unsigned numRoots, unsigned numChildren, unsigned depth)
+{
+    ea::vector<Node*> level;
+    for (unsigned i = 0; i < numRoots; ++i)
+        level.push_back(scene->CreateChild());
+
+    for (unsigned levelIndex = 1; levelIndex < depth; ++levelIndex)
+    {
+        ea::vector<Node*> nextLevel;
+        for (Node* parent : level)
+        {
+            for (unsigned i = 0; i < numChildren; ++i)
+            {
+                Node* child = parent->CreateChild();
+                child->SetPosition({1.0f, static_cast<float>(i), 0.5f});
+                child->SetRotation(Quaternion(10.0f * i, Vector3::UP));
+                nextLevel.push_back(child);
+            }
+        }
+        level = ea::move(nextLevel);
+    }
+}
+
+/// Move every n-th node in the scene.
+void MoveNodes(Scene* scene, unsigned step, float offset)
+{
+    ea::vector<Node*> nodes;
+    scene->GetChildren(nodes, true);
+    for (unsigned i = 0; i < nodes.size(); i += step)
+        nodes[i]->Translate({offset, 0.0f, 0.0f});
+}
+
+}
+
+TEST_CASE("Scene transform store calculates world transforms in batch")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<TransformListenerComponent>(context);
+
+    auto referenceScene = MakeShared<Scene>(context);
+    auto scene = MakeShared<Scene>(context);
+    SceneTransformStore* store = scene->GetTransformStore();
+    store->SetEnabled(true);
+
+    CreateNodeTree(referenceScene, 3, 4, 4);
+    CreateNodeTree(scene, 3, 4, 4);
+
+    ea::vector<Node*> referenceNodes;
+    ea::vector<Node*> nodes;
+    referenceScene->GetChildren(referenceNodes, true);
+    scene->GetChildren(nodes, true);
+    REQUIRE(nodes.size() == referenceNodes.size());
+
+    // Nodes are enumerated depth-first, so this is a leaf node under the first root
+    Node* listenerNode = nodes[3];
+    auto listener = listenerNode->CreateComponent<TransformListenerComponent>();
+
+    store->Update();
+    CHECK(store->GetNumNodes() == nodes.size() + 1);
+    CHECK(store->GetNumLevels() == 5);
+    CHECK(store->GetNumUpdatedNodes() == nodes.size() + 1);
+
+    const auto compareTransforms = [&]()
+    {
+        unsigned numMismatches = 0;
+        for (unsigned i = 0; i < nodes.size(); ++i)
+        {
+            // Disabled store doesn't update transforms, they are calculated lazily
+            if (store->IsEnabled())
+                CHECK_FALSE(nodes[i]->IsDirty());
+            if (!nodes[i]->GetWorldTransform().Equals(referenceNodes[i]->GetWorldTransform()))
+                ++numMismatches;
+        }
+        return numMismatches;
+    };
+    CHECK(compareTransforms() == 0);
+
+    SECTION("Listeners are notified on update")
+    {
+        listener->numNotifications_ = 0;
+        nodes[0]->Translate(Vector3::UP);
+        referenceNodes[0]->Translate(Vector3::UP);
+
+        CHECK(listener->numNotifications_ == 0);
+        store->Update();
+        CHECK(listener->numNotifications_ == 1);
+        CHECK(store->GetNumUpdatedNodes() == 1 + 4 + 16 + 64);
+        CHECK(compareTransforms() == 0);
+    }
+
+    SECTION("Dirty nodes survive hierarchy changes")
+    {
+        MoveNodes(scene, 7, 2.0f);
+        MoveNodes(referenceScene, 7, 2.0f);
+
+        // Reparent the node between two updates
+        nodes[5]->SetParent(nodes[1]);
+        referenceNodes[5]->SetParent(referenceNodes[1]);
+
+        store->Update();
+        CHECK(compareTransforms() == 0);
+    }
+
+    SECTION("Transforms calculated lazily are kept in sync")
+    {
+        nodes[1]->Rotate(Quaternion(30.0f, Vector3::FORWARD));
+        referenceNodes[1]->Rotate(Quaternion(30.0f, Vector3::FORWARD));
+        CHECK(nodes[1]->GetWorldPosition().Equals(referenceNodes[1]->GetWorldPosition()));
+
+        store->Update();
+        CHECK(compareTransforms() == 0);
+    }
+
+    SECTION("Pending notifications are delivered when store is disabled")
+    {
+        listener->numNotifications_ = 0;
+        listenerNode->Translate(Vector3::UP);
+        referenceNodes[3]->Translate(Vector3::UP);
+
+        store->SetEnabled(false);
+        CHECK(listener->numNotifications_ == 1);
+
+        listenerNode->Translate(Vector3::UP);
+        referenceNodes[3]->Translate(Vector3::UP);
+        CHECK(listener->numNotifications_ == 2);
+        CHECK(compareTransforms() == 0);
+    }
+}
+
+TEST_CASE("Scene transform store is faster than lazy transform updates", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+
+    const unsigned numIterations = 20;
+    for (const bool enabled : {false, true})
+    {
+        auto scene = MakeShared<Scene>(context);
+        scene->GetTransformStore()->SetEnabled(enabled);
+        CreateNodeTree(scene, 800, 4, 5);
+
+        ea::vector<Node*> nodes;
+        scene->GetChildren(nodes, true);
+        scene->GetTransformStore()->Update();
+
+        HiresTimer timer;
+        for (unsigned iteration = 0; iteration < numIterations; ++iteration)
+        {
+            for (unsigned i = 0; i < 800; ++i)
+                nodes[i]->Translate(Vector3::UP);
+
+            scene->GetTransformStore()->Update();
+            for (Node* node : nodes)
+                node->GetWorldTransform();
+        }
+        const long long elapsedUSec = timer.GetUSec(false);
+
+        WARN("Nodes: " << nodes.size() << ", transform store: " << (enabled ? "enabled" : "disabled")
+            << ", time per frame: " << elapsedUSec / numIterations << " us");
+    }
+}
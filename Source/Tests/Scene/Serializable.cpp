@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/BinaryArchive.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Scene/Component.h>
+#include <Urho3D/Scene/Scene.h>
+
+namespace
+{
+
+class DirectAttributeComponent : public Component
+{
+    URHO3D_OBJECT(DirectAttributeComponent, Component);
+
+public:
+    using Component::Component;
+
+    static void RegisterObject(Context* context)
+    {
+        context->AddFactoryReflection<DirectAttributeComponent>();
+
+        URHO3D_ATTRIBUTE("Int", int, int_, 0, AM_DEFAULT);
+        URHO3D_ATTRIBUTE("Unsigned", unsigned, unsigned_, 0, AM_DEFAULT);
+        URHO3D_ATTRIBUTE("Float", float, float_, 0.0f, AM_DEFAULT);
+        URHO3D_ATTRIBUTE_EX("Vector3", Vector3, vector3_, OnVectorChanged, Vector3::ZERO, AM_DEFAULT);
+        URHO3D_ATTRIBUTE("Color", Color, color_, Color::WHITE, AM_DEFAULT);
+        URHO3D_ATTRIBUTE("Bool", bool, bool_, false, AM_DEFAULT);
+        URHO3D_ATTRIBUTE("String", ea::string, string_, EMPTY_STRING, AM_DEFAULT);
+        URHO3D_ATTRIBUTE("Narrow", int, narrow_, 0, AM_DEFAULT);
+        URHO3D_ACCESSOR_ATTRIBUTE("Accessor", GetAccessor, SetAccessor, float, 0.0f, AM_DEFAULT);
+    }
+
+    void OnVectorChanged() { ++numVectorChanges_; }
+    float GetAccessor() const { return accessor_; }
+    void SetAccessor(float value) { accessor_ = value; }
+
+    int int_{};
+    unsigned unsigned_{};
+    float float_{};
+    Vector3 vector3_;
+    Color color_;
+    bool bool_{};
+    ea::string string_;
+    unsigned char narrow_{};
+    float accessor_{};
+    unsigned numVectorChanges_{};
+};
+
+}
+
+TEST_CASE("Plain member attributes are serialized directly")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<Tests::RegisterObject<DirectAttributeComponent>>(context);
+
+    const auto& attributes = context->GetReflection<DirectAttributeComponent>()->GetAttributes();
+    const auto isDirect = [&](const ea::string& name)
+    {
+        const auto iter = ea::find_if(attributes.begin(), attributes.end(),
+            [&](const AttributeInfo& attr) { return attr.name_ == name; });
+        REQUIRE(iter != attributes.end());
+        return iter->accessor_->IsDirectMember();
+    };
+
+    CHECK(isDirect("Int"));
+    CHECK(isDirect("Unsigned"));
+    CHECK(isDirect("Float"));
+    CHECK(isDirect("Vector3"));
+    CHECK(isDirect("Color"));
+    CHECK(isDirect("Bool"));
+    CHECK_FALSE(isDirect("String"));
+    CHECK_FALSE(isDirect("Narrow"));
+    CHECK_FALSE(isDirect("Accessor"));
+
+    auto source = MakeShared<DirectAttributeComponent>(context);
+    source->int_ = -5;
+    source->unsigned_ = 0xfffffff0u;
+    source->float_ = 1.5f;
+    source->vector3_ = {1.0f, 2.0f, 3.0f};
+    source->color_ = Color::RED;
+    source->bool_ = true;
+    source->string_ = "Text";
+    source->narrow_ = 7;
+    source->accessor_ = 2.5f;
+
+    VectorBuffer buffer;
+    {
+        BinaryOutputArchive archive{context, buffer};
+        REQUIRE(ConsumeArchiveException([&] { SerializeValue(archive, "Component", *source); }));
+    }
+
+    auto loaded = MakeShared<DirectAttributeComponent>(context);
+    {
+        MemoryBuffer view{buffer.GetBuffer()};
+        BinaryInputArchive archive{context, view};
+        REQUIRE(ConsumeArchiveException([&] { SerializeValue(archive, "Component", *loaded); }));
+    }
+
+    CHECK(loaded->int_ == -5);
+    CHECK(loaded->unsigned_ == 0xfffffff0u);
+    CHECK(loaded->float_ == 1.5f);
+    CHECK(loaded->vector3_ == Vector3{1.0f, 2.0f, 3.0f});
+    CHECK(loaded->color_ == Color::RED);
+    CHECK(loaded->bool_);
+    CHECK(loaded->string_ == "Text");
+    CHECK(loaded->narrow_ == 7);
+    CHECK(loaded->accessor_ == 2.5f);
+    CHECK(loaded->numVectorChanges_ == 1);
+
+    // Direct and Variant paths produce the same data
+    for (unsigned i = 0; i < attributes.size(); ++i)
+        CHECK(loaded->GetAttribute(i) == source->GetAttribute(i));
+}
+
+TEST_CASE("Binary serialization of large scene", "[.benchmark]")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+    auto guard = Tests::MakeScopedReflection<Tests::RegisterObject<DirectAttributeComponent>>(context);
+
+    auto scene = MakeShared<Scene>(context);
+    const unsigned numNodes = 100000;
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        Node* node = scene->CreateChild("Node");
+        node->SetPosition({static_cast<float>(i), 0.0f, 0.0f});
+        node->CreateComponent<DirectAttributeComponent>()->int_ = i;
+    }
+
+    VectorBuffer buffer;
+    HiresTimer timer;
+    {
+        BinaryOutputArchive archive{context, buffer};
+        REQUIRE(ConsumeArchiveException([&] { SerializeValue(archive, "Scene", *scene); }));
+    }
+    const long long saveUSec = timer.GetUSec(true);
+
+    auto loadedScene = MakeShared<Scene>(context);
+    timer.Reset();
+    {
+        MemoryBuffer view{buffer.GetBuffer()};
+        BinaryInputArchive archive{context, view};
+        REQUIRE(ConsumeArchiveException([&] { SerializeValue(archive, "Scene", *loadedScene); }));
+    }
+    const long long loadUSec = timer.GetUSec(true);
+
+    CHECK(loadedScene->GetNumChildren() == numNodes);
+    WARN("Nodes: " << numNodes << ", size: " << buffer.GetSize() << " bytes, save: " << saveUSec
+        << " us, load: " << loadUSec << " us");
+}
@@ -0,0 +1,200 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../CommonUtils.h"
+#include "../SceneUtils.h"
+
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/IO/BinaryArchive.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Utility/PackedSceneData.h>
+#include <Urho3D/Utility/SceneDiff.h>
+
+TEST_CASE("Scene diff contains only changed objects and restores scene state")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+
+    auto scene = MakeShared<Scene>(context);
+    Node* nodeA = scene->CreateChild("A");
+    nodeA->CreateComponent<StaticModel>();
+    Node* nodeB = nodeA->CreateChild("B");
+    auto lightB = nodeB->CreateComponent<Light>();
+    Node* nodeC = scene->CreateChild("C");
+    nodeC->CreateComponent<Light>();
+    Node* nodeD = scene->CreateChild("D");
+
+    auto copyScene = MakeShared<Scene>(context);
+    PackedSceneData::FromScene(scene).ToScene(copyScene);
+    REQUIRE(Tests::CompareNodes(*scene, *copyScene));
+
+    // Temporary nodes are not included in snapshots
+    nodeD->CreateTemporaryChild("Temporary");
+
+    const SceneSnapshot oldSnapshot = SceneSnapshot::FromScene(scene);
+    CHECK(oldSnapshot.GetNodes().size() == 4);
+    CHECK(oldSnapshot.GetComponents().size() == 3);
+    CHECK(SceneDiff::Compute(oldSnapshot, SceneSnapshot::FromScene(scene)).IsEmpty());
+    CHECK(oldSnapshot.GetChecksum() == SceneSnapshot::FromScene(copyScene).GetChecksum());
+
+    nodeD->CreateTemporaryChild("AnotherTemporary");
+    CHECK(SceneDiff::Compute(oldSnapshot, SceneSnapshot::FromScene(scene)).IsEmpty());
+
+    nodeA->SetPosition({1.0f, 2.0f, 3.0f});
+    lightB->SetColor(Color::RED);
+    nodeC->GetComponent<Light>()->Remove();
+    nodeC->CreateComponent<StaticModel>()->SetCastShadows(true);
+    nodeD->AddChild(nodeB);
+    nodeA->CreateChild("E")->CreateComponent<Light>()->SetBrightness(2.0f);
+    scene->CreateChild("F");
+    scene->RemoveChild(scene->GetChild("F"));
+    scene->SetTimeScale(0.5f);
+
+    const SceneSnapshot newSnapshot = SceneSnapshot::FromScene(scene);
+    CHECK(newSnapshot.GetChecksum() != oldSnapshot.GetChecksum());
+
+    SceneDiff diff = SceneDiff::Compute(oldSnapshot, newSnapshot);
+    CHECK(diff.GetNumChangedNodes() == 3);
+    CHECK(diff.GetNumChangedComponents() == 3);
+    CHECK(diff.GetNumRemovedNodes() == 0);
+    CHECK(diff.GetNumRemovedComponents() == 1);
+
+    VectorBuffer buffer;
+    {
+        BinaryOutputArchive archive{context, buffer};
+        REQUIRE(ConsumeArchiveException([&] { SerializeValue(archive, "diff", diff); }));
+    }
+
+    SceneDiff loadedDiff;
+    {
+        MemoryBuffer view{buffer.GetBuffer()};
+        BinaryInputArchive archive{context, view};
+        REQUIRE(ConsumeArchiveException([&] { SerializeValue(archive, "diff", loadedDiff); }));
+    }
+
+    loadedDiff.Apply(copyScene);
+    nodeD->GetChild("Temporary")->Remove();
+    nodeD->GetChild("AnotherTemporary")->Remove();
+    CHECK(Tests::CompareNodes(*scene, *copyScene));
+    CHECK(SceneSnapshot::FromScene(copyScene).GetChecksum() == newSnapshot.GetChecksum());
+
+    const SceneDiff reverseDiff = SceneDiff::Compute(newSnapshot, oldSnapshot);
+    CHECK(reverseDiff.GetNumRemovedNodes() == 1);
+    reverseDiff.Apply(copyScene);
+    CHECK(SceneSnapshot::FromScene(copyScene).GetChecksum() == oldSnapshot.GetChecksum());
+}
+
+TEST_CASE("Scene diff keeps nodes moved out of removed nodes and temporary siblings")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+
+    auto scene = MakeShared<Scene>(context);
+    Node* nodeA = scene->CreateChild("A");
+    Node* nodeB = nodeA->CreateChild("B");
+    nodeB->CreateComponent<Light>()->SetBrightness(2.0f);
+    Node* nodeC = scene->CreateChild("C");
+
+    auto copyScene = MakeShared<Scene>(context);
+    PackedSceneData::FromScene(scene).ToScene(copyScene);
+    // Explicit ID so it doesn't collide with the node created in the source scene
+    Node* temporaryNode = copyScene->CreateTemporaryChild("Temporary", 1000);
+    copyScene->ReorderChild(temporaryNode, 0);
+
+    const SceneSnapshot oldSnapshot = SceneSnapshot::FromScene(scene);
+
+    nodeC->AddChild(nodeB);
+    nodeA->Remove();
+    Node* nodeD = scene->CreateChild("D");
+    scene->ReorderChild(nodeD, 0);
+
+    const SceneSnapshot newSnapshot = SceneSnapshot::FromScene(scene);
+    const SceneDiff diff = SceneDiff::Compute(oldSnapshot, newSnapshot);
+    CHECK(diff.GetNumRemovedNodes() == 1);
+    CHECK(diff.GetNumRemovedComponents() == 0);
+
+    diff.Apply(copyScene);
+    CHECK(SceneSnapshot::FromScene(copyScene).GetChecksum() == newSnapshot.GetChecksum());
+
+    REQUIRE(copyScene->GetNumChildren() == 3);
+    CHECK(copyScene->GetChild(0u) == temporaryNode);
+    CHECK(copyScene->GetChild(1u)->GetName() == "D");
+    CHECK(copyScene->GetChild(2u)->GetName() == "C");
+
+    Node* copyNodeB = copyScene->GetChild("B", true);
+    REQUIRE(copyNodeB);
+    CHECK(copyNodeB->GetParent()->GetName() == "C");
+    REQUIRE(copyNodeB->GetComponent<Light>());
+    CHECK(copyNodeB->GetComponent<Light>()->GetBrightness() == 2.0f);
+}
+
+TEST_CASE("Scene snapshot packs again only changed nodes")
+{
+    auto context = Tests::GetOrCreateContext(Tests::CreateCompleteContext);
+
+    auto scene = MakeShared<Scene>(context);
+    Node* nodeA = scene->CreateChild("A");
+    Node* nodeB = nodeA->CreateChild("B");
+    Node* nodeC = scene->CreateChild("C");
+
+    SceneSnapshot snapshot = SceneSnapshot::FromScene(scene);
+
+    // Moving parent node doesn't change attributes of child nodes
+    const unsigned revisionB = nodeB->GetAttributesRevision();
+    nodeA->SetPosition({1.0f, 2.0f, 3.0f});
+    CHECK(nodeB->GetAttributesRevision() == revisionB);
+
+    const auto checkSnapshot = [&]
+    {
+        const SceneSnapshot fullSnapshot = SceneSnapshot::FromScene(scene);
+        const SceneSnapshot incrementalSnapshot = SceneSnapshot::FromScene(scene, &snapshot);
+        CHECK(incrementalSnapshot.GetChecksum() == fullSnapshot.GetChecksum());
+        CHECK(incrementalSnapshot.GetChecksum() != snapshot.GetChecksum());
+        CHECK(SceneDiff::Compute(fullSnapshot, incrementalSnapshot).IsEmpty());
+        snapshot = incrementalSnapshot;
+    };
+
+    checkSnapshot();
+
+    nodeB->SetName("BB");
+    checkSnapshot();
+
+    nodeB->AddTag("Tag");
+    checkSnapshot();
+
+    nodeC->SetEnabled(false);
+    checkSnapshot();
+
+    nodeC->SetVar("Var", 1);
+    checkSnapshot();
+
+    nodeC->SetAttribute("Variables", StringVariantMap{{"Var", Variant{2}}});
+    checkSnapshot();
+
+    nodeB->SetPositionSilent({4.0f, 5.0f, 6.0f});
+    checkSnapshot();
+
+    nodeB->Rotate(Quaternion{90.0f, Vector3::UP});
+    checkSnapshot();
+}
@@ -23,7 +23,10 @@
 #include <EASTL/sort.h>
 
 #include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Format.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Compression.h>
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/PackageFile.h>
@@ -33,6 +36,7 @@
 #endif
 
 #include <EASTL/unique_ptr.h>
+#include <EASTL/unordered_map.h>
 #include <LZ4/lz4.h>
 #include <LZ4/lz4hc.h>
 
@@ -42,6 +46,8 @@
 using namespace Urho3D;
 
 static const unsigned COMPRESSED_BLOCK_SIZE = 32768;
+/// Maximum number of bytes taken from each small file when building dictionary.
+static const unsigned DICTIONARY_SAMPLE_SIZE = 1024;
 
 struct FileEntry
 {
@@ -49,6 +55,9 @@ struct FileEntry
     unsigned offset_{};
     unsigned size_{};
     unsigned checksum_{};
+    unsigned flags_{};
+    ea::vector<unsigned> packedBlockSizes_;
+    bool omitted_{};
 };
 
 Context* context_ = nullptr;
@@ -57,8 +66,16 @@ ea::string basePath_;
 ea::vector<FileEntry> entries_;
 unsigned checksum_ = 0;
 bool compress_ = false;
+bool legacyFormat_ = false;
+bool useDictionary_ = false;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
+ByteVector dictionary_;
+SharedPtr<PackageFile> basePackage_;
+/// Indices of entries with data written to the package, by checksum and size.
+ea::unordered_map<ea::pair<unsigned, unsigned>, ea::vector<unsigned>> writtenEntries_;
+/// Data of entries written to the package, used to find duplicates without reading the files again.
+ea::unordered_map<unsigned, ByteVector> writtenData_;
 
 ea::string ignoreExtensions_[] = {
     ".bak",
@@ -69,7 +86,13 @@ int main(int argc, char** argv);
 void Run(const ea::vector<ea::string>& arguments);
 void ProcessFile(const ea::string& fileName, const ea::string& rootDir);
 void WritePackageFile(const ea::string& fileName, const ea::string& rootDir);
-void WriteHeader(File& dest);
+void WriteHeader(File& dest, int64_t fileListOffset = 0);
+void BuildDictionary(const ea::string& rootDir);
+unsigned CompressBlock(const unsigned char* src, unsigned srcSize, unsigned char* dest, bool useDictionary);
+void WriteFileList(File& dest);
+unsigned GetNumWrittenEntries();
+bool ReadFileData(const ea::string& fileName, ByteVector& data);
+int FindDuplicateEntry(unsigned index, const ByteVector& data);
 
 int main(int argc, char** argv)
 {
@@ -96,7 +119,11 @@ void Run(const ea::vector<ea::string>& arguments)
             "Usage: PackageTool <directory to process> <package name> [basepath] [options]\n"
             "\n"
             "Options:\n"
-            "-c      Enable package file LZ4 compression\n"
+            "-c      Enable package file LZ4 compression with block index\n"
+            "-d      Compress small files with shared dictionary, implies -c\n"
+            "-u      Write legacy compressed package without block index, readable by older versions, implies -c\n"
+            "-p      Write patch package against base package specified by the next argument.\n"
+            "        Unchanged files are omitted, changed files are stored as binary deltas if it's smaller\n"
             "-q      Enable quiet mode\n"
             "\n"
             "Basepath is an optional prefix that will be added to the file entries.\n\n"
@@ -104,7 +131,7 @@ void Run(const ea::vector<ea::string>& arguments)
             "Output option:\n"
             "-i      Output package file information\n"
             "-l      Output file names (including their paths) contained in the package\n"
-            "-L      Similar to -l but also output compression ratio (compressed package file only)\n"
+            "-L      Similar to -l but also output compression ratio and decompression throughput (compressed package file only)\n"
         );
 
     const ea::string& dirName = arguments[0];
@@ -125,6 +152,21 @@ void Run(const ea::vector<ea::string>& arguments)
                     case 'c':
                         compress_ = true;
                         break;
+                    case 'd':
+                        compress_ = true;
+                        useDictionary_ = true;
+                        break;
+                    case 'u':
+                        compress_ = true;
+                        legacyFormat_ = true;
+                        break;
+                    case 'p':
+                        if (i + 1 >= arguments.size())
+                            ErrorExit("Base package is not specified");
+                        basePackage_ = MakeShared<PackageFile>(context_);
+                        if (!basePackage_->Open(arguments[++i]))
+                            ErrorExit("Could not open base package " + arguments[i]);
+                        break;
                     case 'q':
                         quiet_ = true;
                         break;
@@ -189,9 +231,17 @@ void Run(const ea::vector<ea::string>& arguments)
             }
         }
 
+        if (legacyFormat_ && useDictionary_)
+            ErrorExit("Dictionary compression is not supported by legacy package format");
+        if (legacyFormat_ && basePackage_)
+            ErrorExit("Patch packages are not supported by legacy package format");
+
         for (unsigned i = 0; i < fileNames.size(); ++i)
             ProcessFile(fileNames[i], dirName);
 
+        if (useDictionary_)
+            BuildDictionary(dirName);
+
         WritePackageFile(packageName, dirName);
     }
     else
@@ -206,6 +256,11 @@ void Run(const ea::vector<ea::string>& arguments)
             PrintLine("Package size: " + ea::to_string(packageFile->GetTotalSize()));
             PrintLine("Checksum: " + ea::to_string(packageFile->GetChecksum()));
             PrintLine("Compressed: " + ea::string(packageFile->IsCompressed() ? "yes" : "no"));
+            if (packageFile->IsBlockIndexed())
+            {
+                PrintLine("Block size: " + ea::to_string(packageFile->GetBlockSize()));
+                PrintLine("Dictionary size: " + ea::to_string(packageFile->GetDictionary().size()));
+            }
             break;
         case 'L':
             if (!packageFile->IsCompressed())
@@ -219,7 +274,23 @@ void Run(const ea::vector<ea::string>& arguments)
                 {
                     auto current = i++;
                     ea::string fileEntry(current->first);
-                    if (outputCompressionRatio)
+                    if (outputCompressionRatio && packageFile->IsBlockIndexed())
+                    {
+                        // Block index knows exact compressed size, measure decompression by reading the whole file
+                        const unsigned compressedSize = packageFile->GetPackedSize(current->second);
+                        AbstractFilePtr file = packageFile->OpenFile(FileIdentifier("", current->first), FILE_READ);
+                        ByteVector data(current->second.size_);
+
+                        HiresTimer timer;
+                        if (!file || file->Read(data.data(), data.size()) != data.size())
+                            ErrorExit("Could not decompress file " + current->first);
+                        const double seconds = ea::max(timer.GetUSec(false), 1ll) / 1000000.0;
+
+                        fileEntry.append_sprintf("\tin: %u\tout: %u\tratio: %f\tdecompression: %.1f MB/s%s", current->second.size_,
+                            compressedSize, compressedSize ? 1.f * current->second.size_ / compressedSize : 0.f,
+                            current->second.size_ / seconds / (1024.0 * 1024.0), current->second.useDictionary_ ? "\tdictionary" : "");
+                    }
+                    else if (outputCompressionRatio)
                     {
                         unsigned compressedSize =
                             (i == entries.end() ? packageFile->GetTotalSize() - sizeof(unsigned) : i->second.offset_) -
@@ -264,17 +335,31 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
     // Write ID, number of files & placeholder for checksum
     WriteHeader(dest);
 
-    for (unsigned i = 0; i < entries_.size(); ++i)
+    // Block-indexed and patch packages write file list in the end, when block sizes and omitted files are known
+    const bool blockIndexed = compress_ && !legacyFormat_;
+    const bool fileListAtEnd = blockIndexed || basePackage_;
+    if (!fileListAtEnd)
     {
-        // Write entry (correct offset is still unknown, will be filled in later)
-        dest.WriteString(basePath_ + entries_[i].name_);
-        dest.WriteUInt(entries_[i].offset_);
-        dest.WriteUInt(entries_[i].size_);
-        dest.WriteUInt(entries_[i].checksum_);
+        for (unsigned i = 0; i < entries_.size(); ++i)
+        {
+            // Write entry (correct offset is still unknown, will be filled in later)
+            dest.WriteString(basePath_ + entries_[i].name_);
+            dest.WriteUInt(entries_[i].offset_);
+            dest.WriteUInt(entries_[i].size_);
+            dest.WriteUInt(entries_[i].checksum_);
+        }
     }
 
     unsigned totalDataSize = 0;
     unsigned lastOffset;
+    long long totalCompressionUSec = 0;
+    unsigned numDuplicates = 0;
+    unsigned numOmitted = 0;
+    unsigned numDeltas = 0;
+    unsigned duplicateDataSize = 0;
+    ByteVector fileData;
+    ByteVector baseData;
+    ByteVector delta;
 
     // Write file data, calculate checksums & correct offsets
     for (unsigned i = 0; i < entries_.size(); ++i)
@@ -282,29 +367,121 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
         lastOffset = entries_[i].offset_ = dest.GetSize();
         ea::string fileFullPath = rootDir + "/" + entries_[i].name_;
 
-        File srcFile(context_, fileFullPath);
-        if (!srcFile.IsOpen())
-            ErrorExit("Could not open file " + fileFullPath);
+        if (!ReadFileData(fileFullPath, fileData))
+            ErrorExit("Could not read file " + fileFullPath);
 
-        unsigned dataSize = entries_[i].size_;
-        totalDataSize += dataSize;
-        ea::unique_ptr<unsigned char[]> buffer(new unsigned char[dataSize]);
+        totalDataSize += fileData.size();
+        for (unsigned char value : fileData)
+        {
+            checksum_ = SDBMHash(checksum_, value);
+            entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, value);
+        }
 
-        if (srcFile.Read(&buffer[0], dataSize) != dataSize)
-            ErrorExit("Could not read file " + fileFullPath);
-        srcFile.Close();
+        const unsigned char* buffer = fileData.data();
+        unsigned dataSize = fileData.size();
+
+        // Patch package omits files that are unchanged and stores changed files as deltas if it's smaller
+        const ea::string entryName = basePath_ + entries_[i].name_;
+        const PackageEntry* baseEntry = basePackage_ ? basePackage_->GetEntry(entryName) : nullptr;
+        if (baseEntry && baseEntry->checksum_ == entries_[i].checksum_)
+        {
+            AbstractFilePtr baseFile = basePackage_->OpenFile(FileIdentifier(EMPTY_STRING, entryName), FILE_READ);
+            baseData.resize(baseFile ? baseFile->GetSize() : 0);
+            if (baseFile && baseFile->Read(baseData.data(), baseData.size()) == baseData.size() && baseData == fileData)
+            {
+                entries_[i].omitted_ = true;
+                ++numOmitted;
+                if (!quiet_)
+                    PrintLine(entries_[i].name_ + " unchanged");
+                continue;
+            }
+        }
+        else if (baseEntry)
+        {
+            AbstractFilePtr baseFile = basePackage_->OpenFile(FileIdentifier(EMPTY_STRING, entryName), FILE_READ);
+            baseData.resize(baseFile ? baseFile->GetSize() : 0);
+            if (baseFile && baseFile->Read(baseData.data(), baseData.size()) == baseData.size())
+            {
+                delta = CreateBinaryDelta(baseData, fileData);
+                if (delta.size() < fileData.size())
+                {
+                    buffer = delta.data();
+                    dataSize = delta.size();
+                    entries_[i].flags_ |= PACKAGE_ENTRY_DELTA;
+                    ++numDeltas;
+                }
+            }
+        }
+        entries_[i].size_ = dataSize;
 
-        for (unsigned j = 0; j < dataSize; ++j)
+        // Identical files share data in the package
+        const int duplicateIndex = FindDuplicateEntry(i, fileData);
+        if (duplicateIndex >= 0)
         {
-            checksum_ = SDBMHash(checksum_, buffer[j]);
-            entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
+            const FileEntry& duplicateEntry = entries_[duplicateIndex];
+            entries_[i].offset_ = duplicateEntry.offset_;
+            entries_[i].flags_ = duplicateEntry.flags_;
+            entries_[i].packedBlockSizes_ = duplicateEntry.packedBlockSizes_;
+            ++numDuplicates;
+            duplicateDataSize += dataSize;
+            if (!quiet_)
+                PrintLine(entries_[i].name_ + " duplicate of " + duplicateEntry.name_);
+            continue;
         }
 
         if (!compress_)
         {
             if (!quiet_)
                 PrintLine(entries_[i].name_ + " size " + ea::to_string(dataSize));
-            dest.Write(&buffer[0], entries_[i].size_);
+            dest.Write(buffer, dataSize);
+        }
+        else if (blockIndexed)
+        {
+            ea::unique_ptr<unsigned char[]> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
+            ea::unique_ptr<unsigned char[]> dictionaryBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
+
+            HiresTimer timer;
+            for (unsigned pos = 0; pos < dataSize; pos += blockSize_)
+            {
+                const unsigned unpackedSize = ea::min(blockSize_, dataSize - pos);
+                unsigned packedSize = CompressBlock(&buffer[pos], unpackedSize, compressBuffer.get(), false);
+                const unsigned char* packedData = compressBuffer.get();
+
+                // Single-block files are the ones that benefit from dictionary
+                if (!dictionary_.empty() && dataSize <= blockSize_)
+                {
+                    const unsigned dictionaryPackedSize = CompressBlock(&buffer[pos], unpackedSize, dictionaryBuffer.get(), true);
+                    if (dictionaryPackedSize && (!packedSize || dictionaryPackedSize < packedSize))
+                    {
+                        packedSize = dictionaryPackedSize;
+                        packedData = dictionaryBuffer.get();
+                        entries_[i].flags_ |= PACKAGE_ENTRY_DICTIONARY;
+                    }
+                }
+
+                // Store incompressible blocks as is
+                if (!packedSize || packedSize >= unpackedSize)
+                {
+                    packedSize = unpackedSize;
+                    packedData = &buffer[pos];
+                }
+
+                dest.Write(packedData, packedSize);
+                entries_[i].packedBlockSizes_.push_back(packedSize);
+            }
+            const long long compressionUSec = ea::max(timer.GetUSec(false), 1ll);
+            totalCompressionUSec += compressionUSec;
+
+            if (!quiet_)
+            {
+                unsigned totalPackedBytes = dest.GetSize() - lastOffset;
+                ea::string fileEntry(entries_[i].name_);
+                fileEntry.append_sprintf("\tin: %u\tout: %u\tratio: %f\tblocks: %u\tcompression: %.1f MB/s%s", dataSize,
+                    totalPackedBytes, totalPackedBytes ? 1.f * dataSize / totalPackedBytes : 0.f,
+                    entries_[i].packedBlockSizes_.size(), dataSize * 1000000.0 / compressionUSec / (1024.0 * 1024.0),
+                    (entries_[i].flags_ & PACKAGE_ENTRY_DICTIONARY) ? "\tdictionary" : "");
+                PrintLine(fileEntry);
+            }
         }
         else
         {
@@ -340,38 +517,173 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
         }
     }
 
+    int64_t fileListOffset = 0;
+    if (fileListAtEnd)
+    {
+        fileListOffset = dest.GetSize();
+        WriteFileList(dest);
+    }
+
     // Write package size to the end of file to allow finding it linked to an executable file
     unsigned currentSize = dest.GetSize();
     dest.WriteUInt(currentSize + sizeof(unsigned));
 
     // Write header again with correct offsets & checksums
     dest.Seek(0);
-    WriteHeader(dest);
+    WriteHeader(dest, fileListOffset);
 
-    for (unsigned i = 0; i < entries_.size(); ++i)
+    if (fileListAtEnd)
+    {
+        dest.Seek(fileListOffset);
+        WriteFileList(dest);
+    }
+    else
     {
-        dest.WriteString(basePath_ + entries_[i].name_);
-        dest.WriteUInt(entries_[i].offset_);
-        dest.WriteUInt(entries_[i].size_);
-        dest.WriteUInt(entries_[i].checksum_);
+        for (unsigned i = 0; i < entries_.size(); ++i)
+        {
+            dest.WriteString(basePath_ + entries_[i].name_);
+            dest.WriteUInt(entries_[i].offset_);
+            dest.WriteUInt(entries_[i].size_);
+            dest.WriteUInt(entries_[i].checksum_);
+        }
     }
 
     if (!quiet_)
     {
-        PrintLine("Number of files: " + ea::to_string(entries_.size()));
+        PrintLine("Number of files: " + ea::to_string(GetNumWrittenEntries()));
         PrintLine("File data size: " + ea::to_string(totalDataSize));
+        PrintLine(Format("Duplicate files: {} ({} bytes)", numDuplicates, duplicateDataSize));
+        if (basePackage_)
+        {
+            PrintLine("Base package checksum: " + ea::to_string(basePackage_->GetChecksum()));
+            PrintLine(Format("Unchanged files: {}, delta files: {}", numOmitted, numDeltas));
+        }
         PrintLine("Package size: " + ea::to_string(dest.GetSize()));
         PrintLine("Checksum: " + ea::to_string(checksum_));
         PrintLine("Compressed: " + ea::string(compress_ ? "yes" : "no"));
+        if (blockIndexed)
+        {
+            PrintLine("Dictionary size: " + ea::to_string(dictionary_.size()));
+            PrintLine(Format("Compression throughput: {:.1f} MB/s",
+                totalDataSize * 1000000.0 / ea::max(totalCompressionUSec, 1ll) / (1024.0 * 1024.0)));
+        }
     }
 }
 
-void WriteHeader(File& dest)
+void WriteHeader(File& dest, int64_t fileListOffset)
 {
+    const bool hasVersion = basePackage_ || (compress_ && !legacyFormat_);
     if (!compress_)
-        dest.WriteFileID("UPAK");
-    else
+        dest.WriteFileID(hasVersion ? "RPAK" : "UPAK");
+    else if (legacyFormat_)
         dest.WriteFileID("ULZ4");
-    dest.WriteUInt(entries_.size());
+    else
+        dest.WriteFileID("RLZ4");
+    dest.WriteUInt(GetNumWrittenEntries());
     dest.WriteUInt(checksum_);
+
+    if (hasVersion)
+    {
+        dest.WriteUInt(basePackage_ ? PACKAGE_VERSION_PATCH : PACKAGE_VERSION_BLOCK_INDEX);
+        dest.WriteInt64(fileListOffset);
+    }
+}
+
+void BuildDictionary(const ea::string& rootDir)
+{
+    // Sample beginnings of small files: they usually share headers and markup, e.g. XML and JSON resources
+    for (const FileEntry& entry : entries_)
+    {
+        if (entry.size_ > blockSize_ || dictionary_.size() >= PACKAGE_MAX_DICTIONARY_SIZE)
+            continue;
+
+        File srcFile(context_, rootDir + "/" + entry.name_);
+        if (!srcFile.IsOpen())
+            ErrorExit("Could not open file " + entry.name_);
+
+        const unsigned sampleSize = ea::min(ea::min(DICTIONARY_SAMPLE_SIZE, entry.size_), PACKAGE_MAX_DICTIONARY_SIZE - dictionary_.size());
+        const unsigned oldSize = dictionary_.size();
+        dictionary_.resize(oldSize + sampleSize);
+        if (srcFile.Read(&dictionary_[oldSize], sampleSize) != sampleSize)
+            ErrorExit("Could not read file " + entry.name_);
+    }
+
+    if (!quiet_)
+        PrintLine("Dictionary size " + ea::to_string(dictionary_.size()));
+}
+
+unsigned CompressBlock(const unsigned char* src, unsigned srcSize, unsigned char* dest, bool useDictionary)
+{
+    const auto srcPtr = reinterpret_cast<const char*>(src);
+    const auto destPtr = reinterpret_cast<char*>(dest);
+    const int maxDestSize = LZ4_compressBound(srcSize);
+    if (!useDictionary)
+        return static_cast<unsigned>(LZ4_compress_HC(srcPtr, destPtr, srcSize, maxDestSize, 0));
+
+    static LZ4_streamHC_t* stream = LZ4_createStreamHC();
+    LZ4_resetStreamHC(stream, LZ4HC_CLEVEL_DEFAULT);
+    LZ4_loadDictHC(stream, reinterpret_cast<const char*>(dictionary_.data()), dictionary_.size());
+    return static_cast<unsigned>(LZ4_compress_HC_continue(stream, srcPtr, destPtr, srcSize, maxDestSize));
+}
+
+void WriteFileList(File& dest)
+{
+    if (compress_)
+    {
+        dest.WriteUInt(blockSize_);
+        dest.WriteUInt(dictionary_.size());
+        dest.Write(dictionary_.data(), dictionary_.size());
+    }
+
+    if (basePackage_)
+        dest.WriteUInt(basePackage_->GetChecksum());
+
+    for (const FileEntry& entry : entries_)
+    {
+        if (entry.omitted_)
+            continue;
+
+        dest.WriteString(basePath_ + entry.name_);
+        dest.WriteUInt(entry.offset_);
+        dest.WriteUInt(entry.size_);
+        dest.WriteUInt(entry.checksum_);
+        dest.WriteUInt(entry.flags_);
+        for (unsigned packedSize : entry.packedBlockSizes_)
+            dest.WriteUInt(packedSize);
+    }
+}
+
+unsigned GetNumWrittenEntries()
+{
+    return ea::count_if(entries_.begin(), entries_.end(), [](const FileEntry& entry) { return !entry.omitted_; });
+}
+
+bool ReadFileData(const ea::string& fileName, ByteVector& data)
+{
+    File srcFile(context_, fileName);
+    if (!srcFile.IsOpen())
+        return false;
+
+    data.resize(srcFile.GetSize());
+    return srcFile.Read(data.data(), data.size()) == data.size();
+}
+
+int FindDuplicateEntry(unsigned index, const ByteVector& data)
+{
+    const FileEntry& entry = entries_[index];
+    if (entry.flags_ & PACKAGE_ENTRY_DELTA)
+        return -1;
+
+    // Checksum collision is possible, compare actual contents
+    ea::vector<unsigned>& candidates = writtenEntries_[ea::make_pair(entry.checksum_, entry.size_)];
+    for (unsigned otherIndex : candidates)
+    {
+        if (writtenData_[otherIndex] == data)
+            return static_cast<int>(otherIndex);
+    }
+
+    // Entry is going to be written, remember it for the following entries
+    candidates.push_back(index);
+    writtenData_[index] = data;
+    return -1;
 }
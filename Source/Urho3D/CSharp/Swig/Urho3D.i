@@ -121,6 +121,7 @@ using namespace Urho3D;
 #endif
 
 #define URHO3D_TYPE_TRAIT(...)
+#define URHO3D_SCENE_OBJECT_POOL()
 
 %apply void* VOID_INT_PTR {
 	SDL_Cursor*,
@@ -405,6 +406,27 @@ namespace SDL
 %ignore Urho3D::GetWideNativePath;
 %ignore Urho3D::logLevelNames;
 %ignore Urho3D::LOG_LEVEL_COLORS;
+%ignore Urho3D::Deserializer::ReadInPlace;
+%ignore Urho3D::MemoryBuffer::ReadInPlace;
+%ignore Urho3D::PackageFile::GetEntryData;
+%ignore Urho3D::PackageFile::GetMappedData;
+%ignore Urho3D::PackageFile::DecompressBlocks;
+%ignore Urho3D::CreateBinaryDelta;
+%ignore Urho3D::ApplyBinaryDelta;
+%ignore Urho3D::AsyncFileReader;
+%ignore Urho3D::AsyncReadRequest;
+%ignore Urho3D::NativeFileRegion;
+%ignore Urho3D::MountPoint::GetNativeFileRegion;
+%ignore Urho3D::MountedDirectory::GetNativeFileRegion;
+%ignore Urho3D::PackageFile::GetNativeFileRegion;
+%ignore Urho3D::VirtualFileSystem::ReadFileAsync;
+%ignore Urho3D::VirtualFileSystem::ReadFilesAsync;
+%ignore Urho3D::VirtualFileSystem::GetAsyncFileReader;
+%ignore Urho3D::ResourceCache::ReadFileAsync;
+%ignore Urho3D::LogicComponentManager::UpdateParallel;
+%ignore Urho3D::LogicComponentManager::GetBatchComponents;
+%ignore Urho3D::Context::GetPostedEventQueue;
+%ignore Urho3D::Scene::InstantiateMany;
 
 %extend Urho3D::Log {
 public:
@@ -472,7 +494,6 @@ public:
 
 // These expose iterators of underlying collection. Iterate object through GetObject() instead.
 %ignore Urho3D::BackgroundLoadItem;
-%ignore Urho3D::BackgroundLoader::ThreadFunction;
 %ignore Urho3D::ImageCube::CalculateSphericalHarmonics;
 %rename(GetValueType) Urho3D::PListValue::GetType;
 
@@ -511,6 +532,7 @@ public:
 %ignore Urho3D::Node::SetEntity;
 %ignore Urho3D::Scene::GetRegistry;
 %ignore Urho3D::Scene::GetComponentIndex;
+%ignore Urho3D::Scene::QueryNodesWithComponents;
 %ignore Urho3D::Animatable::animationEnabled_;
 %ignore Urho3D::Animatable::objectAnimation_;
 %ignore Urho3D::Component::node_;
@@ -527,11 +549,11 @@ public:
 %include "Urho3D/Scene/Scene.h"
 %include "Urho3D/Scene/SplinePath.h"
 %include "Urho3D/Scene/ValueAnimation.h"
+%include "Urho3D/Scene/TrackedComponent.h"
 %include "Urho3D/Scene/LogicComponent.h"
 %include "Urho3D/Scene/ObjectAnimation.h"
 %include "Urho3D/Scene/SceneResolver.h"
 %include "Urho3D/Scene/UnknownComponent.h"
-%include "Urho3D/Scene/TrackedComponent.h"
 %include "Urho3D/Scene/PrefabReference.h"
 
 // --------------------------------------- Extra components ---------------------------------------
@@ -77,7 +77,7 @@ AllocatorBlock* AllocatorReserveBlock(AllocatorBlock* allocator, unsigned nodeSi
     // i == capacity - 1
     {
         auto* newNode = reinterpret_cast<AllocatorNode*>(nodePtr);
-        newNode->next_ = nullptr;
+        newNode->next_ = allocator->free_;
     }
 
     allocator->free_ = firstNewNode;
@@ -62,6 +62,8 @@ struct AllocatorNode
 URHO3D_API AllocatorBlock* AllocatorInitialize(unsigned nodeSize, unsigned initialCapacity = 1);
 /// Uninitialize a fixed-size allocator. Frees all blocks in the chain.
 URHO3D_API void AllocatorUninitialize(AllocatorBlock* allocator);
+/// Reserve a new block with given capacity and prepend its nodes to the free list. Return the new block.
+URHO3D_API AllocatorBlock* AllocatorReserveBlock(AllocatorBlock* allocator, unsigned nodeSize, unsigned capacity);
 /// Reserve a node. Creates a new block if necessary.
 URHO3D_API void* AllocatorReserve(AllocatorBlock* allocator);
 /// Free a node. Does not free any blocks.
@@ -81,6 +81,15 @@ public:
     virtual void Get(const Serializable* ptr, Variant& dest) const = 0;
     /// Set the attribute.
     virtual void Set(Serializable* ptr, const Variant& src) = 0;
+    /// Return pointer to the member variable if the attribute is a plain member of the same type as attribute.
+    virtual const void* GetMemberPointer(const Serializable* ptr) const { return nullptr; }
+
+    /// Return whether the attribute is a plain member that can be read from memory without Variant.
+    bool IsDirectMember() const { return directMember_; }
+
+protected:
+    /// Whether the attribute is a plain member that can be read from memory without Variant.
+    bool directMember_{};
 };
 
 /// Description of an automatically serializable variable.
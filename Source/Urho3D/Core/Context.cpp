@@ -129,6 +129,7 @@ void RemoveNamedAttribute(ea::unordered_map<StringHash, ea::vector<AttributeInfo
 
 Context::Context()
     : ObjectReflectionRegistry(this)
+    , postedEvents_(ea::make_unique<PostedEventQueue>())
     , eventHandler_(nullptr)
 {
     assert(contextInstance == nullptr);
@@ -145,6 +146,9 @@ Context::Context()
 
 Context::~Context()
 {
+    // Posted events keep their senders alive
+    postedEvents_->Clear();
+
 #ifndef MINI_URHO
     // Destroying resource cache does clear it, however some resources depend on resource cache being available when
     // destructor executes.
@@ -353,6 +357,12 @@ void Context::RemoveEventReceiver(Object* receiver, Object* sender, StringHash e
         group->Remove(receiver);
 }
 
+void Context::RemoveTypedEventReceiver(Object* receiver)
+{
+    for (const auto& [eventType, receivers] : typedEventReceivers_)
+        receivers->RemoveReceiver(receiver);
+}
+
 void Context::BeginSendEvent(Object* sender, StringHash eventType)
 {
     eventSenders_.push_back(sender);
@@ -28,11 +28,14 @@
 #include "../Core/Attribute.h"
 #include "../Core/Object.h"
 #include "../Core/ObjectReflection.h"
+#include "../Core/PostedEventQueue.h"
 #include "../Core/SubsystemCache.h"
 
 namespace Urho3D
 {
 
+template <class T> class TypedEventReceivers;
+
 /// Tracking structure for event receivers.
 class URHO3D_API EventReceiverGroup : public RefCounted
 {
@@ -66,6 +69,19 @@ private:
     bool dirty_;
 };
 
+/// Base class for receivers of typed event of one type.
+class URHO3D_API TypedEventReceiversBase
+{
+public:
+    /// Destruct.
+    virtual ~TypedEventReceiversBase() = default;
+
+    /// Invoke receivers with event payload converted from VariantMap event data.
+    virtual void InvokeFromVariantMap(Object* sender, const VariantMap& eventData) = 0;
+    /// Remove all subscriptions of the receiver.
+    virtual void RemoveReceiver(Object* receiver) = 0;
+};
+
 /// Urho3D execution context. Provides access to subsystems, object factories and attributes, and event receivers.
 class URHO3D_API Context : public RefCounted, public ObjectReflectionRegistry
 {
@@ -115,6 +131,11 @@ public:
     /// Return all subsystems.
     const SubsystemCache& GetSubsystems() const { return subsystems_; }
 
+    /// Return queue of events posted from any thread.
+    PostedEventQueue* GetPostedEventQueue() const { return postedEvents_.get(); }
+    /// Deliver events posted from any thread. Should be called from main thread.
+    void ProcessPostedEvents() { postedEvents_->Process(); }
+
     /// Return active event sender. Null outside event handling.
     Object* GetEventSender() const;
 
@@ -159,6 +180,17 @@ public:
         return i != eventReceivers_.end() ? i->second : nullptr;
     }
 
+    /// Return typed event receivers for an event type, or null if they do not exist.
+    TypedEventReceiversBase* GetTypedEventReceivers(StringHash eventType) const
+    {
+        if (typedEventReceivers_.empty())
+            return nullptr;
+        auto i = typedEventReceivers_.find(eventType);
+        return i != typedEventReceivers_.end() ? i->second.get() : nullptr;
+    }
+    /// Return typed event receivers for an event type, create if they do not exist.
+    template <class T> TypedEventReceivers<T>* GetOrCreateTypedEventReceivers();
+
 private:
     /// Add event receiver.
     void AddEventReceiver(Object* receiver, StringHash eventType);
@@ -170,6 +202,8 @@ private:
     void RemoveEventReceiver(Object* receiver, Object* sender, StringHash eventType);
     /// Remove event receiver from non-specific events.
     void RemoveEventReceiver(Object* receiver, StringHash eventType);
+    /// Remove receiver from all typed events.
+    void RemoveTypedEventReceiver(Object* receiver);
     /// Begin event send.
     void BeginSendEvent(Object* sender, StringHash eventType);
     /// End event send. Clean up event receivers removed in the meanwhile.
@@ -184,6 +218,10 @@ private:
     ea::unordered_map<StringHash, SharedPtr<EventReceiverGroup> > eventReceivers_;
     /// Event receivers for specific senders' events.
     ea::unordered_map<Object*, ea::unordered_map<StringHash, SharedPtr<EventReceiverGroup> > > specificEventReceivers_;
+    /// Receivers of typed events.
+    ea::unordered_map<StringHash, ea::unique_ptr<TypedEventReceiversBase>> typedEventReceivers_;
+    /// Events posted from any thread.
+    ea::unique_ptr<PostedEventQueue> postedEvents_;
     /// Event sender stack.
     ea::vector<Object*> eventSenders_;
     /// Event data stack.
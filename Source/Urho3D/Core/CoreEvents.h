@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Core/Object.h"
+#include "../Core/TypedEvent.h"
 
 namespace Urho3D
 {
@@ -74,4 +75,54 @@ URHO3D_EVENT(E_ENDFRAMEPRIVATE, EndFramePrivate)
 {
 }
 
+/// Typed events with statically typed payload. Use with Object::SendEvent<T> and Object::SubscribeToEvent<T>.
+namespace Ev
+{
+
+/// Typed payload of E_UPDATE.
+struct Update
+{
+    URHO3D_TYPED_EVENT(E_UPDATE);
+
+    float timeStep_{};
+
+    void ToVariantMap(VariantMap& eventData) const { eventData[Urho3D::Update::P_TIMESTEP] = timeStep_; }
+    void FromVariantMap(const VariantMap& eventData) { timeStep_ = GetEventParameter(eventData, Urho3D::Update::P_TIMESTEP).GetFloat(); }
+};
+
+/// Typed payload of E_POSTUPDATE.
+struct PostUpdate
+{
+    URHO3D_TYPED_EVENT(E_POSTUPDATE);
+
+    float timeStep_{};
+
+    void ToVariantMap(VariantMap& eventData) const { eventData[Urho3D::PostUpdate::P_TIMESTEP] = timeStep_; }
+    void FromVariantMap(const VariantMap& eventData) { timeStep_ = GetEventParameter(eventData, Urho3D::PostUpdate::P_TIMESTEP).GetFloat(); }
+};
+
+/// Typed payload of E_RENDERUPDATE.
+struct RenderUpdate
+{
+    URHO3D_TYPED_EVENT(E_RENDERUPDATE);
+
+    float timeStep_{};
+
+    void ToVariantMap(VariantMap& eventData) const { eventData[Urho3D::RenderUpdate::P_TIMESTEP] = timeStep_; }
+    void FromVariantMap(const VariantMap& eventData) { timeStep_ = GetEventParameter(eventData, Urho3D::RenderUpdate::P_TIMESTEP).GetFloat(); }
+};
+
+/// Typed payload of E_POSTRENDERUPDATE.
+struct PostRenderUpdate
+{
+    URHO3D_TYPED_EVENT(E_POSTRENDERUPDATE);
+
+    float timeStep_{};
+
+    void ToVariantMap(VariantMap& eventData) const { eventData[Urho3D::PostRenderUpdate::P_TIMESTEP] = timeStep_; }
+    void FromVariantMap(const VariantMap& eventData) { timeStep_ = GetEventParameter(eventData, Urho3D::PostRenderUpdate::P_TIMESTEP).GetFloat(); }
+};
+
+}
+
 }
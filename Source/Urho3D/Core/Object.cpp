@@ -213,6 +213,12 @@ void Object::UnsubscribeFromEvents(Object* sender)
 
 void Object::UnsubscribeFromAllEvents()
 {
+    if (hasTypedEventHandlers_)
+    {
+        context_->RemoveTypedEventReceiver(this);
+        hasTypedEventHandlers_ = false;
+    }
+
     for (;;)
     {
         auto handler = eventHandlers_.begin();
@@ -274,13 +280,7 @@ void Object::SendEvent(StringHash eventType)
 
 void Object::SendEvent(StringHash eventType, VariantMap& eventData)
 {
-    if (!Thread::IsMainThread())
-    {
-        URHO3D_LOGERROR("Sending events is only supported from the main thread");
-        return;
-    }
-
-    if (blockEvents_)
+    if (!CanSendEvent())
         return;
 
 #if URHO3D_PROFILING
@@ -289,6 +289,52 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     URHO3D_PROFILE_ZONENAME(eventName.c_str(), eventName.length());
 #endif
 
+    // Typed subscribers receive payload converted from event data
+    if (TypedEventReceiversBase* typedReceivers = context_->GetTypedEventReceivers(eventType))
+    {
+        WeakPtr<Object> self(this);
+        Context* context = context_;
+
+        context->BeginSendEvent(this, eventType);
+        typedReceivers->InvokeFromVariantMap(this, eventData);
+        context->EndSendEvent();
+
+        if (self.Expired())
+            return;
+    }
+
+    SendEventToReceivers(eventType, eventData);
+}
+
+void Object::PostEvent(StringHash eventType)
+{
+    const VariantMap noEventData;
+    context_->GetPostedEventQueue()->Post(this, eventType, noEventData);
+}
+
+void Object::PostEvent(StringHash eventType, const VariantMap& eventData, unsigned long long sourceId)
+{
+    context_->GetPostedEventQueue()->Post(this, eventType, eventData, sourceId);
+}
+
+bool Object::CanSendEvent() const
+{
+    if (!Thread::IsMainThread())
+    {
+        URHO3D_LOGERROR("Sending events is only supported from the main thread");
+        return false;
+    }
+
+    return !blockEvents_;
+}
+
+bool Object::HasEventReceivers(StringHash eventType)
+{
+    return context_->GetEventReceivers(this, eventType) || context_->GetEventReceivers(eventType);
+}
+
+void Object::SendEventToReceivers(StringHash eventType, VariantMap& eventData)
+{
     // Make a weak pointer to self to check for destruction during event handling
     WeakPtr<Object> self(this);
     Context* context = context_;
@@ -122,6 +122,11 @@ public:
     void SendEvent(StringHash eventType);
     /// Send event with parameters to all subscribers.
     void SendEvent(StringHash eventType, VariantMap& eventData);
+    /// Post event to be sent from main thread on next Context::ProcessPostedEvents. Thread-safe.
+    void PostEvent(StringHash eventType);
+    /// Post event with parameters to be sent from main thread on next Context::ProcessPostedEvents. Thread-safe.
+    /// Events of the same type are delivered in order of source ID and then in posting order.
+    void PostEvent(StringHash eventType, const VariantMap& eventData, unsigned long long sourceId = 0);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap() const;
     /// Send event with variadic parameter pairs to all subscribers. The parameters are (paramID, paramValue) pairs.
@@ -132,6 +137,19 @@ public:
         SendEvent(eventType, eventData);
     }
 
+    /// Send typed event to typed and VariantMap subscribers. Event data map is filled only if there are VariantMap subscribers.
+    /// Defined in TypedEvent.h.
+    template <class T, ea::enable_if_t<T::IsTypedEvent, int> = 0> void SendEvent(const T& event);
+    /// Post typed event to be sent from main thread on next Context::ProcessPostedEvents. Thread-safe.
+    /// Events of the same type are delivered in order of source ID and then in posting order. Defined in TypedEvent.h.
+    template <class T, ea::enable_if_t<T::IsTypedEvent, int> = 0> void PostEvent(const T& event, unsigned long long sourceId = 0);
+    /// Subscribe to typed event that can be sent by any sender. Handler signature is void(const T& event).
+    template <class T, class Handler, ea::enable_if_t<T::IsTypedEvent, int> = 0> void SubscribeToEvent(Handler handler);
+    /// Subscribe to a specific sender's typed event. Handler signature is void(const T& event).
+    template <class T, class Handler, ea::enable_if_t<T::IsTypedEvent, int> = 0> void SubscribeToEvent(Object* sender, Handler handler);
+    /// Unsubscribe from typed event.
+    template <class T, ea::enable_if_t<T::IsTypedEvent, int> = 0> void UnsubscribeFromEvent(Object* sender = nullptr);
+
     /// Return execution context.
     Context* GetContext() const { return context_; }
     /// Return global variable based on key.
@@ -193,12 +211,20 @@ private:
     ea::intrusive_list<EventHandler>::iterator EraseEventHandler(ea::intrusive_list<EventHandler>::iterator handlerIter);
     /// Remove event handlers related to a specific sender.
     void RemoveEventSender(Object* sender);
+    /// Return whether the event can be sent now.
+    bool CanSendEvent() const;
+    /// Return whether there are VariantMap subscribers of the event.
+    bool HasEventReceivers(StringHash eventType);
+    /// Send event with parameters to VariantMap subscribers only.
+    void SendEventToReceivers(StringHash eventType, VariantMap& eventData);
 
     /// Event handlers. Sender is null for non-specific handlers.
     ea::intrusive_list<EventHandler> eventHandlers_;
 
     /// Block object from sending and receiving any events.
     bool blockEvents_;
+    /// Whether the object has ever subscribed to typed events.
+    bool hasTypedEventHandlers_{};
 };
 
 template <class T> T* Object::GetSubsystem() const { return GetSubsystems().Get<T>(); }
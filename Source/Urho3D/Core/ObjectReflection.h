@@ -50,10 +50,12 @@ public:
 
     /// @name Factory management
     /// @{
-    void SetObjectFactory(ObjectFactoryCallback callback) { createObject_ = callback; }
+    void SetObjectFactory(ObjectFactoryCallback callback) { createObject_ = callback; objectSize_ = 0; }
     template <class T> void SetObjectFactory();
     SharedPtr<Object> CreateObject();
     bool HasObjectFactory() const { return createObject_ != nullptr; }
+    /// Return size of object created by the factory. Zero if unknown.
+    unsigned GetObjectSize() const { return objectSize_; }
     /// @}
 
     /// @name Category management
@@ -110,6 +112,8 @@ private:
     const TypeInfo* typeInfo_{};
     ea::unique_ptr<TypeInfo> ownedTypeInfo_;
     ObjectFactoryCallback createObject_{};
+    /// Size of object created by the factory, if known.
+    unsigned objectSize_{};
     /// Category of the object.
     ea::string category_;
 
@@ -191,6 +195,7 @@ template <class T>
 void ObjectReflection::SetObjectFactory()
 {
     createObject_ = +[](const TypeInfo* typeInfo, Context* context) { return StaticCast<Object>(MakeShared<T>(context)); };
+    objectSize_ = sizeof(T);
 }
 
 template <class T>
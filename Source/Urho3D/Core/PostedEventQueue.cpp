@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/PostedEventQueue.h"
+
+#include "../Core/Object.h"
+#include "../Core/Profiler.h"
+
+#include <EASTL/sort.h>
+
+#include <chrono>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+long long GetCurrentTimeUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+PostedEventQueue::PostedEventQueue() = default;
+
+PostedEventQueue::~PostedEventQueue()
+{
+    Clear();
+}
+
+void PostedEventQueue::Post(Object* sender, StringHash eventType, const VariantMap& eventData, unsigned long long sourceId)
+{
+    auto event = new PostedEvent();
+    event->sender_ = sender;
+    event->eventType_ = eventType;
+    event->eventData_ = eventData;
+    event->sourceId_ = sourceId;
+    Push(event);
+}
+
+void PostedEventQueue::Post(Object* sender, StringHash eventType, SendCallback callback, unsigned long long sourceId)
+{
+    auto event = new PostedEvent();
+    event->sender_ = sender;
+    event->eventType_ = eventType;
+    event->callback_ = ea::move(callback);
+    event->sourceId_ = sourceId;
+    Push(event);
+}
+
+void PostedEventQueue::Push(PostedEvent* event)
+{
+    event->sequence_ = nextSequence_.fetch_add(1, std::memory_order_relaxed);
+    event->postTimeUs_ = GetCurrentTimeUs();
+
+    event->next_ = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(event->next_, event, std::memory_order_release, std::memory_order_relaxed))
+        ;
+    numPendingEvents_.fetch_add(1, std::memory_order_relaxed);
+}
+
+PostedEventQueue::PostedEvent* PostedEventQueue::PopAll()
+{
+    return head_.exchange(nullptr, std::memory_order_acquire);
+}
+
+void PostedEventQueue::Process()
+{
+    PostedEvent* head = PopAll();
+    lastStats_ = {};
+    if (!head)
+        return;
+
+    URHO3D_PROFILE("ProcessPostedEvents");
+
+    const long long startTimeUs = GetCurrentTimeUs();
+    long long earliestPostTimeUs = startTimeUs;
+
+    events_.clear();
+    for (PostedEvent* event = head; event; event = event->next_)
+    {
+        events_.push_back(event);
+        earliestPostTimeUs = ea::min(earliestPostTimeUs, event->postTimeUs_);
+    }
+    numPendingEvents_.fetch_sub(events_.size(), std::memory_order_relaxed);
+
+    // Order depends only on keys supplied by producers, not on the threads they were scheduled on.
+    // Posting order is compared only between events of the same source, which are posted sequentially
+    const auto compare = [](const PostedEvent* lhs, const PostedEvent* rhs)
+    {
+        if (lhs->eventType_ != rhs->eventType_)
+            return lhs->eventType_.Value() < rhs->eventType_.Value();
+        if (lhs->sourceId_ != rhs->sourceId_)
+            return lhs->sourceId_ < rhs->sourceId_;
+        return lhs->sequence_ < rhs->sequence_;
+    };
+    ea::sort(events_.begin(), events_.end(), compare);
+
+    lastStats_.numEvents_ = events_.size();
+    lastStats_.maxLatencyUs_ = startTimeUs - earliestPostTimeUs;
+
+    StringHash lastEventType;
+    for (PostedEvent* event : events_)
+    {
+        if (lastStats_.numEventTypes_ == 0 || event->eventType_ != lastEventType)
+        {
+            ++lastStats_.numEventTypes_;
+            lastEventType = event->eventType_;
+        }
+
+        if (event->callback_)
+            event->callback_(event->sender_);
+        else
+            event->sender_->SendEvent(event->eventType_, event->eventData_);
+
+        delete event;
+    }
+    events_.clear();
+
+    lastStats_.flushTimeUs_ = GetCurrentTimeUs() - startTimeUs;
+
+    URHO3D_PROFILE_VALUE("PostedEventQueueDepth", static_cast<int64_t>(lastStats_.numEvents_));
+    URHO3D_PROFILE_VALUE("PostedEventLatencyUs", static_cast<int64_t>(lastStats_.maxLatencyUs_));
+}
+
+void PostedEventQueue::Clear()
+{
+    PostedEvent* event = PopAll();
+    while (event)
+    {
+        PostedEvent* next = event->next_;
+        delete event;
+        event = next;
+        numPendingEvents_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+}
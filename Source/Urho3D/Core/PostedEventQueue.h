@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/Ptr.h"
+#include "../Core/Variant.h"
+
+#include <EASTL/functional.h>
+#include <EASTL/vector.h>
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+class Object;
+
+/// Statistics of the last flush of posted events.
+struct PostedEventQueueStats
+{
+    /// Number of events delivered.
+    unsigned numEvents_{};
+    /// Number of distinct event types delivered.
+    unsigned numEventTypes_{};
+    /// Time between the earliest post and the flush, in microseconds.
+    long long maxLatencyUs_{};
+    /// Time spent delivering events, in microseconds.
+    long long flushTimeUs_{};
+};
+
+/// Lock-free multi-producer queue of events posted from any thread and delivered from the main thread.
+/// Events are batched per event type. Batches are delivered in order of event type hash,
+/// events within a batch are ordered by source ID supplied by the producer and then by posting order.
+/// Delivery order doesn't depend on thread scheduling as long as events with the same source ID
+/// are posted by one producer at a time, e.g. source ID is the index of parallel job or the ID of the node.
+class URHO3D_API PostedEventQueue
+{
+public:
+    /// Callback used to deliver typed event.
+    using SendCallback = ea::function<void(Object* sender)>;
+
+    /// Construct.
+    PostedEventQueue();
+    /// Destruct. Pending events are discarded.
+    ~PostedEventQueue();
+
+    /// Post event. Thread-safe. Sender is kept alive until the event is delivered.
+    /// Event data should not contain pointers to RefCounted objects because they are not thread-safe.
+    void Post(Object* sender, StringHash eventType, const VariantMap& eventData, unsigned long long sourceId = 0);
+    /// Post typed event delivered via callback. Thread-safe.
+    void Post(Object* sender, StringHash eventType, SendCallback callback, unsigned long long sourceId = 0);
+    /// Deliver all posted events. Should be called from main thread.
+    /// Events posted during delivery are delivered on the next call.
+    void Process();
+    /// Discard all posted events.
+    void Clear();
+
+    /// Return approximate number of pending events. Thread-safe.
+    unsigned GetNumPendingEvents() const { return numPendingEvents_.load(std::memory_order_relaxed); }
+    /// Return statistics of the last call of Process.
+    const PostedEventQueueStats& GetLastStats() const { return lastStats_; }
+
+private:
+    /// Posted event stored in the intrusive list.
+    struct PostedEvent
+    {
+        /// Next event in the list.
+        PostedEvent* next_{};
+        /// Sender.
+        SharedPtr<Object> sender_;
+        /// Event type.
+        StringHash eventType_;
+        /// Event data for VariantMap events.
+        VariantMap eventData_;
+        /// Callback for typed events.
+        SendCallback callback_;
+        /// Stable ID of the logical source supplied by the producer.
+        unsigned long long sourceId_{};
+        /// Posting order.
+        unsigned long long sequence_{};
+        /// Time of posting in microseconds.
+        long long postTimeUs_{};
+    };
+
+    /// Link event into the list.
+    void Push(PostedEvent* event);
+    /// Detach all events from the list.
+    PostedEvent* PopAll();
+
+    /// Head of the list of posted events, newest first.
+    std::atomic<PostedEvent*> head_{};
+    /// Approximate number of pending events.
+    std::atomic<unsigned> numPendingEvents_{};
+    /// Posting order of the next event.
+    std::atomic<unsigned long long> nextSequence_{};
+    /// Events being delivered. Reused between calls.
+    ea::vector<PostedEvent*> events_;
+    /// Statistics of the last call of Process.
+    PostedEventQueueStats lastStats_;
+};
+
+}
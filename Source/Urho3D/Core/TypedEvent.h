@@ -0,0 +1,264 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Core/Context.h"
+
+#include <EASTL/functional.h>
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+/// Declare typed event payload. Should be used inside the payload struct.
+/// Payload is bound to the existing event ID declared with URHO3D_EVENT and should implement
+/// ToVariantMap() and FromVariantMap() so VariantMap subscribers and senders (e.g. scripts) keep working.
+#define URHO3D_TYPED_EVENT(eventID) \
+    static constexpr bool IsTypedEvent = true; \
+    static Urho3D::StringHash GetEventTypeStatic() { return eventID; }
+
+/// Return event parameter or empty variant if not found.
+inline const Variant& GetEventParameter(const VariantMap& eventData, StringHash param)
+{
+    const auto iter = eventData.find(param);
+    return iter != eventData.end() ? iter->second : Variant::EMPTY;
+}
+
+/// Flat array of typed event subscriptions. Subscriptions are removed lazily when receivers or senders expire.
+template <class T> class TypedEventReceivers : public TypedEventReceiversBase
+{
+public:
+    /// Handler type.
+    using Handler = ea::function<void(const T&)>;
+
+    /// Add subscription or replace existing subscription of the receiver.
+    void Add(Object* receiver, Object* sender, Handler handler)
+    {
+        if (Subscription* subscription = FindSubscription(subscriptions_, receiver, sender))
+        {
+            subscription->handler_ = ea::move(handler);
+            return;
+        }
+        if (Subscription* subscription = FindSubscription(addedSubscriptions_, receiver, sender))
+        {
+            subscription->handler_ = ea::move(handler);
+            return;
+        }
+
+        // Subscriptions cannot be reallocated while handlers are invoked
+        auto& subscriptions = inSend_ ? addedSubscriptions_ : subscriptions_;
+        subscriptions.push_back(Subscription{WeakPtr<Object>(receiver), WeakPtr<Object>(sender), sender != nullptr, ea::move(handler)});
+    }
+
+    /// Remove subscription of the receiver.
+    void Remove(Object* receiver, Object* sender)
+    {
+        if (Subscription* subscription = FindSubscription(subscriptions_, receiver, sender))
+        {
+            subscription->receiver_ = nullptr;
+            dirty_ = true;
+        }
+        if (Subscription* subscription = FindSubscription(addedSubscriptions_, receiver, sender))
+            subscription->receiver_ = nullptr;
+        RemoveExpired();
+    }
+
+    /// Invoke handlers subscribed to the sender or to any sender.
+    void Invoke(Object* sender, const T& event)
+    {
+        ++inSend_;
+        const unsigned numSubscriptions = subscriptions_.size();
+        for (unsigned i = 0; i < numSubscriptions; ++i)
+        {
+            const Subscription& subscription = subscriptions_[i];
+            if (subscription.IsExpired())
+            {
+                dirty_ = true;
+                continue;
+            }
+
+            if (subscription.hasSender_ && subscription.sender_ != sender)
+                continue;
+
+            if (subscription.receiver_->GetBlockEvents())
+                continue;
+
+            subscription.handler_(event);
+        }
+        --inSend_;
+
+        RemoveExpired();
+    }
+
+    /// Return whether there are no subscriptions.
+    bool IsEmpty() const { return subscriptions_.empty() && addedSubscriptions_.empty(); }
+
+    /// Implement TypedEventReceiversBase.
+    /// @{
+    void InvokeFromVariantMap(Object* sender, const VariantMap& eventData) override
+    {
+        T event;
+        event.FromVariantMap(eventData);
+        Invoke(sender, event);
+    }
+
+    void RemoveReceiver(Object* receiver) override
+    {
+        for (Subscription& subscription : subscriptions_)
+        {
+            if (subscription.receiver_ == receiver)
+            {
+                subscription.receiver_ = nullptr;
+                dirty_ = true;
+            }
+        }
+        ea::erase_if(addedSubscriptions_, [receiver](const Subscription& subscription) { return subscription.receiver_ == receiver; });
+        RemoveExpired();
+    }
+    /// @}
+
+private:
+    /// Subscription of receiver.
+    struct Subscription
+    {
+        WeakPtr<Object> receiver_;
+        WeakPtr<Object> sender_;
+        bool hasSender_{};
+        Handler handler_;
+
+        /// Return whether the receiver or the specific sender is destroyed.
+        bool IsExpired() const { return !receiver_ || (hasSender_ && !sender_); }
+    };
+
+    /// Find subscription of the receiver.
+    static Subscription* FindSubscription(ea::vector<Subscription>& subscriptions, Object* receiver, Object* sender)
+    {
+        for (Subscription& subscription : subscriptions)
+        {
+            if (subscription.receiver_ == receiver && subscription.hasSender_ == (sender != nullptr) && subscription.sender_ == sender)
+                return &subscription;
+        }
+        return nullptr;
+    }
+
+    /// Remove expired subscriptions and merge added ones, unless handlers are being invoked.
+    void RemoveExpired()
+    {
+        if (inSend_)
+            return;
+
+        if (dirty_)
+        {
+            ea::erase_if(subscriptions_, [](const Subscription& subscription) { return subscription.IsExpired(); });
+            dirty_ = false;
+        }
+
+        if (!addedSubscriptions_.empty())
+        {
+            for (Subscription& subscription : addedSubscriptions_)
+            {
+                if (!subscription.IsExpired())
+                    subscriptions_.push_back(ea::move(subscription));
+            }
+            addedSubscriptions_.clear();
+        }
+    }
+
+    /// Active subscriptions in order of subscription.
+    ea::vector<Subscription> subscriptions_;
+    /// Subscriptions added during invocation.
+    ea::vector<Subscription> addedSubscriptions_;
+    /// Invocation recursion counter.
+    unsigned inSend_{};
+    /// Whether there are expired subscriptions.
+    bool dirty_{};
+};
+
+template <class T> TypedEventReceivers<T>* Context::GetOrCreateTypedEventReceivers()
+{
+    ea::unique_ptr<TypedEventReceiversBase>& receivers = typedEventReceivers_[T::GetEventTypeStatic()];
+    if (!receivers)
+        receivers = ea::make_unique<TypedEventReceivers<T>>();
+    // There should be only one payload type per event type
+    return static_cast<TypedEventReceivers<T>*>(receivers.get());
+}
+
+template <class T, ea::enable_if_t<T::IsTypedEvent, int>> void Object::SendEvent(const T& event)
+{
+    if (!CanSendEvent())
+        return;
+
+    const StringHash eventType = T::GetEventTypeStatic();
+    if (TypedEventReceiversBase* typedReceivers = context_->GetTypedEventReceivers(eventType))
+    {
+        // Make a weak pointer to self to check for destruction during event handling
+        WeakPtr<Object> self(this);
+        Context* context = context_;
+
+        context->BeginSendEvent(this, eventType);
+        static_cast<TypedEventReceivers<T>*>(typedReceivers)->Invoke(this, event);
+        context->EndSendEvent();
+
+        if (self.Expired())
+            return;
+    }
+
+    // Event data is filled only if there are VariantMap subscribers
+    if (HasEventReceivers(eventType))
+    {
+        VariantMap& eventData = GetEventDataMap();
+        event.ToVariantMap(eventData);
+        SendEventToReceivers(eventType, eventData);
+    }
+}
+
+template <class T, ea::enable_if_t<T::IsTypedEvent, int>> void Object::PostEvent(const T& event, unsigned long long sourceId)
+{
+    context_->GetPostedEventQueue()->Post(this, T::GetEventTypeStatic(),
+        [event](Object* sender) { sender->SendEvent(event); }, sourceId);
+}
+
+template <class T, class Handler, ea::enable_if_t<T::IsTypedEvent, int>> void Object::SubscribeToEvent(Handler handler)
+{
+    context_->GetOrCreateTypedEventReceivers<T>()->Add(this, nullptr, ea::move(handler));
+    hasTypedEventHandlers_ = true;
+}
+
+template <class T, class Handler, ea::enable_if_t<T::IsTypedEvent, int>> void Object::SubscribeToEvent(Object* sender, Handler handler)
+{
+    if (!sender)
+        return;
+
+    context_->GetOrCreateTypedEventReceivers<T>()->Add(this, sender, ea::move(handler));
+    hasTypedEventHandlers_ = true;
+}
+
+template <class T, ea::enable_if_t<T::IsTypedEvent, int>> void Object::UnsubscribeFromEvent(Object* sender)
+{
+    if (TypedEventReceiversBase* receivers = context_->GetTypedEventReceivers(T::GetEventTypeStatic()))
+        static_cast<TypedEventReceivers<T>*>(receivers)->Remove(this, sender);
+}
+
+}
@@ -28,8 +28,13 @@
 #include "../Core/Thread.h"
 #include "../Core/Timer.h"
 #include "../Core/WorkQueue.h"
+#include "../Core/WorkStealingQueue.h"
 #include "../IO/Log.h"
 
+#include <EASTL/array.h>
+
+#include <thread>
+
 namespace Urho3D
 {
 
@@ -37,6 +42,158 @@ namespace Urho3D
 static thread_local unsigned currentThreadIndex = M_MAX_UNSIGNED;
 static unsigned maxThreadIndex = 1;
 
+namespace
+{
+
+/// Max number of ready tasks stored in the queue of each thread. Extra tasks are stored in shared queue.
+const unsigned TaskQueueCapacity = 4096;
+/// Number of tasks allocated at once.
+const unsigned TaskChunkSize = 1024;
+/// Max number of task chunks.
+const unsigned MaxTaskChunks = 1024;
+/// Invalid task index.
+const unsigned InvalidTaskIndex = M_MAX_UNSIGNED;
+/// Number of failed attempts to find work before worker thread goes to sleep.
+const unsigned MaxIdleSpins = 64;
+
+}
+
+/// Task stored in the pool.
+struct WorkQueueTask
+{
+    /// Task function.
+    WorkFunction function_;
+    /// Generation of the storage. Incremented when the task is completed.
+    std::atomic<unsigned> generation_{};
+    /// Number of dependencies that are not completed yet, plus one until the task is submitted.
+    std::atomic<unsigned> numPendingDependencies_{};
+    /// Next free task in the pool.
+    std::atomic<unsigned> nextFree_{InvalidTaskIndex};
+    /// Mutex that guards the list of dependent tasks.
+    SpinLockMutex dependentsMutex_;
+    /// Tasks that should be notified when this task is completed.
+    ea::fixed_vector<unsigned, 4> dependents_;
+};
+
+/// Pool of tasks. Task storage is never deallocated while the pool is alive.
+class WorkQueueTaskPool
+{
+public:
+    WorkQueueTaskPool() = default;
+
+    ~WorkQueueTaskPool()
+    {
+        for (std::atomic<WorkQueueTask*>& chunk : chunks_)
+            delete[] chunk.load(std::memory_order_relaxed);
+    }
+
+    /// Allocate task. Return InvalidTaskIndex if the pool is exhausted. Thread-safe.
+    unsigned Allocate()
+    {
+        numAllocated_.fetch_add(1, std::memory_order_relaxed);
+        while (true)
+        {
+            uint64_t head = freeListHead_.load(std::memory_order_acquire);
+            const unsigned index = static_cast<unsigned>(head);
+            if (index == InvalidTaskIndex)
+            {
+                if (!Grow(head))
+                {
+                    numAllocated_.fetch_sub(1, std::memory_order_relaxed);
+                    return InvalidTaskIndex;
+                }
+                continue;
+            }
+
+            // Tag in the upper half of the head prevents ABA problem
+            const unsigned next = Get(index).nextFree_.load(std::memory_order_relaxed);
+            const uint64_t newHead = MakeHead(next, GetTag(head) + 1);
+            if (freeListHead_.compare_exchange_weak(head, newHead, std::memory_order_acq_rel))
+                return index;
+        }
+    }
+
+    /// Return task to the pool. Thread-safe.
+    void Release(unsigned index)
+    {
+        PushFree(index);
+        numAllocated_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// Return task by index. Index should be previously allocated.
+    WorkQueueTask& Get(unsigned index) const
+    {
+        WorkQueueTask* chunk = chunks_[index / TaskChunkSize].load(std::memory_order_acquire);
+        return chunk[index % TaskChunkSize];
+    }
+
+    /// Return number of allocated tasks.
+    unsigned GetNumAllocated() const { return numAllocated_.load(std::memory_order_relaxed); }
+
+    /// Set max number of chunks. Already allocated chunks are kept.
+    void SetMaxChunks(unsigned maxChunks)
+    {
+        MutexLock<Mutex> lock(growMutex_);
+        maxChunks_ = Clamp(maxChunks, 1u, MaxTaskChunks);
+    }
+
+private:
+    static uint64_t MakeHead(unsigned index, unsigned tag) { return (static_cast<uint64_t>(tag) << 32) | index; }
+    static unsigned GetTag(uint64_t head) { return static_cast<unsigned>(head >> 32); }
+
+    /// Push task to the free list.
+    void PushFree(unsigned index)
+    {
+        WorkQueueTask& task = Get(index);
+        uint64_t head = freeListHead_.load(std::memory_order_relaxed);
+        do
+        {
+            task.nextFree_.store(static_cast<unsigned>(head), std::memory_order_relaxed);
+        } while (!freeListHead_.compare_exchange_weak(
+            head, MakeHead(index, GetTag(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /// Allocate new chunk of tasks if the free list is still empty. Return false if all chunks are allocated.
+    bool Grow(uint64_t expectedHead)
+    {
+        MutexLock<Mutex> lock(growMutex_);
+        if (freeListHead_.load(std::memory_order_acquire) != expectedHead)
+            return true;
+
+        const unsigned chunkIndex = numChunks_;
+        if (chunkIndex >= maxChunks_)
+            return false;
+
+        auto chunk = new WorkQueueTask[TaskChunkSize];
+        chunks_[chunkIndex].store(chunk, std::memory_order_release);
+        ++numChunks_;
+
+        const unsigned firstIndex = chunkIndex * TaskChunkSize;
+        for (unsigned i = 0; i < TaskChunkSize; ++i)
+            PushFree(firstIndex + TaskChunkSize - i - 1);
+        return true;
+    }
+
+    /// Head of free list: index of the first free task and tag.
+    std::atomic<uint64_t> freeListHead_{InvalidTaskIndex};
+    /// Chunks of tasks.
+    ea::array<std::atomic<WorkQueueTask*>, MaxTaskChunks> chunks_{};
+    /// Number of allocated chunks. Modified only under the mutex.
+    unsigned numChunks_{};
+    /// Max number of chunks. Modified only under the mutex.
+    unsigned maxChunks_{MaxTaskChunks};
+    /// Mutex for chunk allocation.
+    Mutex growMutex_;
+    /// Number of tasks allocated from the pool.
+    std::atomic<unsigned> numAllocated_{};
+};
+
+/// Queue of ready tasks owned by one thread.
+struct WorkQueueTaskQueue
+{
+    WorkStealingQueue<unsigned, TaskQueueCapacity> queue_;
+};
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -70,8 +227,8 @@ private:
 
 WorkQueue::WorkQueue(Context* context) :
     Object(context),
+    taskPool_(ea::make_unique<WorkQueueTaskPool>()),
     shutDown_(false),
-    pausing_(false),
     paused_(false),
     completing_(false),
     tolerance_(10),
@@ -81,6 +238,7 @@ WorkQueue::WorkQueue(Context* context) :
     currentThreadIndex = 0;
     maxThreadIndex = 1;
     mainThreadTasks_.Clear();
+    taskQueues_.push_back(ea::make_unique<WorkQueueTaskQueue>());
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -88,7 +246,7 @@ WorkQueue::~WorkQueue()
 {
     // Stop the worker threads. First make sure they are not waiting for work items
     shutDown_ = true;
-    Resume();
+    WakeWorkerThreads();
 
     for (unsigned i = 0; i < threads_.size(); ++i)
         threads_[i]->Stop();
@@ -106,6 +264,9 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     Pause();
 
     maxThreadIndex = numThreads + 1;
+    for (unsigned i = 0; i < numThreads; ++i)
+        taskQueues_.push_back(ea::make_unique<WorkQueueTaskQueue>());
+
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -164,8 +325,7 @@ void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item)
     item->completed_ = false;
 
     // Make sure worker threads' list is safe to modify
-    if (threads_.size() && !paused_)
-        queueMutex_.Acquire();
+    queueMutex_.Acquire();
 
     // Find position for new item
     if (queue_.empty())
@@ -188,10 +348,12 @@ void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item)
             queue_.push_back(item.Get());
     }
 
+    queueMutex_.Release();
+
     if (threads_.size())
     {
-        queueMutex_.Release();
         paused_ = false;
+        WakeWorkerThreads();
     }
 }
 
@@ -255,26 +417,258 @@ unsigned WorkQueue::RemoveWorkItems(const ea::vector<SharedPtr<WorkItem> >& item
 
 void WorkQueue::Pause()
 {
-    if (!paused_)
+    paused_ = true;
+}
+
+void WorkQueue::Resume()
+{
+    if (paused_)
+    {
+        paused_ = false;
+        WakeWorkerThreads();
+    }
+}
+
+TaskHandle WorkQueue::CreateTask(WorkFunction workFunction)
+{
+    const TaskHandle handle = AllocateTask(workFunction);
+    if (!handle.IsValid())
     {
-        pausing_ = true;
+        // Work is never dropped, the task is executed immediately if the pool is exhausted
+        workFunction(GetThreadIndex());
+    }
+    return handle;
+}
 
-        queueMutex_.Acquire();
-        paused_ = true;
+TaskHandle WorkQueue::AllocateTask(WorkFunction& workFunction)
+{
+    unsigned index = taskPool_->Allocate();
 
-        pausing_ = false;
+    // Threads not owned by WorkQueue have no thread index to execute the task with, so they wait for free space
+    const bool canExecuteTasks = GetThreadIndex() < taskQueues_.size();
+    while (index == InvalidTaskIndex && !canExecuteTasks)
+    {
+        std::this_thread::yield();
+        index = taskPool_->Allocate();
     }
+
+    if (index == InvalidTaskIndex)
+        return {};
+
+    WorkQueueTask& task = taskPool_->Get(index);
+    task.function_ = ea::move(workFunction);
+    task.numPendingDependencies_.store(1, std::memory_order_relaxed);
+
+    TaskHandle handle;
+    handle.index_ = index;
+    handle.generation_ = task.generation_.load(std::memory_order_relaxed);
+    return handle;
 }
 
-void WorkQueue::Resume()
+void WorkQueue::AddTaskDependency(TaskHandle task, TaskHandle dependency)
 {
-    if (paused_)
+    if (!task.IsValid() || !dependency.IsValid())
+        return;
+
+    WorkQueueTask& dependencyTask = taskPool_->Get(dependency.index_);
+    MutexLock<SpinLockMutex> lock(dependencyTask.dependentsMutex_);
+
+    // Dependency is already completed, nothing to wait for
+    if (dependencyTask.generation_.load(std::memory_order_acquire) != dependency.generation_)
+        return;
+
+    taskPool_->Get(task.index_).numPendingDependencies_.fetch_add(1, std::memory_order_relaxed);
+    dependencyTask.dependents_.push_back(task.index_);
+}
+
+void WorkQueue::SubmitTask(TaskHandle task)
+{
+    if (!task.IsValid())
+        return;
+
+    WorkQueueTask& submittedTask = taskPool_->Get(task.index_);
+    if (submittedTask.numPendingDependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        EnqueueTask(task.index_);
+}
+
+TaskHandle WorkQueue::ScheduleTask(WorkFunction workFunction, ea::span<const TaskHandle> dependencies)
+{
+    const TaskHandle task = AllocateTask(workFunction);
+    if (!task.IsValid())
+    {
+        // Pool is exhausted, execute the task immediately after its dependencies
+        WaitTasks(dependencies);
+        workFunction(GetThreadIndex());
+        return {};
+    }
+
+    for (const TaskHandle& dependency : dependencies)
+        AddTaskDependency(task, dependency);
+    SubmitTask(task);
+    return task;
+}
+
+TaskHandle WorkQueue::ScheduleContinuation(TaskHandle task, WorkFunction workFunction)
+{
+    return ScheduleTask(ea::move(workFunction), {&task, 1});
+}
+
+bool WorkQueue::IsTaskCompleted(TaskHandle task) const
+{
+    if (!task.IsValid())
+        return true;
+
+    return taskPool_->Get(task.index_).generation_.load(std::memory_order_acquire) != task.generation_;
+}
+
+void WorkQueue::WaitTask(TaskHandle task)
+{
+    WaitTasks({&task, 1});
+}
+
+void WorkQueue::WaitTasks(ea::span<const TaskHandle> tasks)
+{
+    const unsigned threadIndex = GetThreadIndex();
+    const bool canExecuteTasks = threadIndex < taskQueues_.size();
+
+    for (const TaskHandle& task : tasks)
+    {
+        while (!IsTaskCompleted(task))
+        {
+            // Help other threads instead of spinning
+            if (!canExecuteTasks || !ExecuteTask(threadIndex))
+                std::this_thread::yield();
+        }
+    }
+
+    // Same as Complete, invoke callbacks queued by the tasks
+    if (threadIndex == 0)
+        ProcessMainThreadTasks();
+}
+
+void WorkQueue::SetMaxPendingTasks(unsigned maxTasks)
+{
+    const unsigned maxChunks = maxTasks / TaskChunkSize + (maxTasks % TaskChunkSize != 0 ? 1 : 0);
+    taskPool_->SetMaxChunks(maxChunks);
+}
+
+unsigned WorkQueue::GetNumPendingTasks() const
+{
+    return taskPool_->GetNumAllocated();
+}
+
+void WorkQueue::EnqueueTask(unsigned taskIndex)
+{
+    const unsigned threadIndex = GetThreadIndex();
+    if (threadIndex >= taskQueues_.size() || !taskQueues_[threadIndex]->queue_.Push(taskIndex))
+    {
+        MutexLock<Mutex> lock(sharedTaskQueueMutex_);
+        sharedTaskQueue_.push_back(taskIndex);
+        sharedTaskQueueSize_.fetch_add(1, std::memory_order_release);
+    }
+
+    WakeWorkerThreads();
+}
+
+bool WorkQueue::ExecuteTask(unsigned threadIndex)
+{
+    unsigned taskIndex = InvalidTaskIndex;
+
+    // Take the most recent task from own queue first, it's likely to be hot in cache
+    const unsigned numQueues = taskQueues_.size();
+    bool found = taskQueues_[threadIndex]->queue_.Pop(taskIndex);
+
+    if (!found && sharedTaskQueueSize_.load(std::memory_order_acquire) != 0)
+    {
+        MutexLock<Mutex> lock(sharedTaskQueueMutex_);
+        if (!sharedTaskQueue_.empty())
+        {
+            taskIndex = sharedTaskQueue_.back();
+            sharedTaskQueue_.pop_back();
+            sharedTaskQueueSize_.fetch_sub(1, std::memory_order_relaxed);
+            found = true;
+        }
+    }
+
+    // Steal the oldest task from other threads
+    for (unsigned i = 1; !found && i < numQueues; ++i)
+    {
+        const unsigned victimIndex = (threadIndex + i) % numQueues;
+        found = taskQueues_[victimIndex]->queue_.Steal(taskIndex);
+    }
+
+    if (!found)
+        return false;
+
+    RunTask(taskIndex, threadIndex);
+    return true;
+}
+
+void WorkQueue::RunTask(unsigned taskIndex, unsigned threadIndex)
+{
+    WorkQueueTask& task = taskPool_->Get(taskIndex);
+    if (task.function_)
+        task.function_(threadIndex);
+    task.function_ = nullptr;
+
+    ea::fixed_vector<unsigned, 4> dependents;
+    {
+        MutexLock<SpinLockMutex> lock(task.dependentsMutex_);
+        dependents.swap(task.dependents_);
+        task.generation_.fetch_add(1, std::memory_order_release);
+    }
+
+    for (unsigned dependentIndex : dependents)
+    {
+        WorkQueueTask& dependentTask = taskPool_->Get(dependentIndex);
+        if (dependentTask.numPendingDependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            EnqueueTask(dependentIndex);
+    }
+
+    taskPool_->Release(taskIndex);
+}
+
+bool WorkQueue::ExecuteWorkItem(unsigned threadIndex)
+{
+    if (paused_.load(std::memory_order_relaxed))
+        return false;
+
+    queueMutex_.Acquire();
+    if (queue_.empty())
     {
         queueMutex_.Release();
-        paused_ = false;
+        return false;
+    }
+
+    WorkItem* item = queue_.front();
+    queue_.pop_front();
+    queueMutex_.Release();
+    item->workFunction_(item, threadIndex);
+    item->completed_ = true;
+    return true;
+}
+
+void WorkQueue::WakeWorkerThreads()
+{
+    wakeEpoch_.fetch_add(1);
+    if (numSleepingThreads_.load() != 0)
+    {
+        // Synchronize with the thread that is going to sleep so the notification is not lost
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+        }
+        sleepCondition_.notify_all();
     }
 }
 
+void WorkQueue::WaitForWork(unsigned wakeEpoch)
+{
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    numSleepingThreads_.fetch_add(1);
+    sleepCondition_.wait(lock, [&] { return shutDown_ || wakeEpoch_.load() != wakeEpoch; });
+    numSleepingThreads_.fetch_sub(1);
+}
+
 
 void WorkQueue::Complete(unsigned priority)
 {
@@ -305,10 +699,9 @@ void WorkQueue::Complete(unsigned priority)
 
         // Wait for threaded work to complete
         while (!IsCompleted(priority))
-        {
-        }
+            std::this_thread::yield();
 
-        // If no work at all remaining, pause worker threads by leaving the mutex locked
+        // If no work items remaining, pause processing of work items by worker threads until new ones are added
         if (queue_.empty())
             Pause();
     }
@@ -362,36 +755,28 @@ void WorkQueue::ProcessMainThreadTasks()
 
 void WorkQueue::ProcessItems(unsigned threadIndex)
 {
-    bool wasActive = false;
+    unsigned numIdleSpins = 0;
 
-    for (;;)
+    while (!shutDown_)
     {
-        if (shutDown_)
-            return;
+        // Remember epoch before looking for work so new work added in between is not missed
+        const unsigned wakeEpoch = wakeEpoch_.load();
 
-        if (pausing_ && !wasActive)
-            Time::Sleep(0);
-        else
+        if (ExecuteTask(threadIndex) || ExecuteWorkItem(threadIndex))
         {
-            queueMutex_.Acquire();
-            if (!queue_.empty())
-            {
-                wasActive = true;
-
-                WorkItem* item = queue_.front();
-                queue_.pop_front();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
-            }
-            else
-            {
-                wasActive = false;
+            numIdleSpins = 0;
+            continue;
+        }
 
-                queueMutex_.Release();
-                Time::Sleep(0);
-            }
+        if (numIdleSpins < MaxIdleSpins)
+        {
+            ++numIdleSpins;
+            std::this_thread::yield();
+            continue;
         }
+
+        numIdleSpins = 0;
+        WaitForWork(wakeEpoch);
     }
 }
 
@@ -458,6 +843,14 @@ void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     ProcessMainThreadTasks();
 
+    // If no worker threads, execute tasks that were not waited for
+    if (threads_.empty())
+    {
+        while (ExecuteTask(0))
+        {
+        }
+    }
+
     // If no worker threads, complete low-priority work here
     if (threads_.empty() && !queue_.empty())
     {
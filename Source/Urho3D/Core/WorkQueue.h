@@ -26,9 +26,13 @@
 #include "../Core/Object.h"
 #include "../Container/MultiVector.h"
 
+#include <EASTL/fixed_vector.h>
 #include <EASTL/list.h>
 #include <EASTL/span.h>
+#include <EASTL/unique_ptr.h>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 namespace Urho3D
 {
@@ -40,6 +44,8 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 }
 
 class WorkerThread;
+class WorkQueueTaskPool;
+struct WorkQueueTaskQueue;
 
 /// Vector-like collection that can be safely filled from different WorkQueue threads simultaneously.
 template <class T>
@@ -59,6 +65,21 @@ public:
 /// TODO: Get rid of parameter
 using WorkFunction = ea::function<void(unsigned threadIndex)>;
 
+/// Lightweight handle of the task scheduled in WorkQueue.
+/// Tasks are stored in the pool and are not reference counted.
+/// When the task is completed, its storage is reused and the handle is considered referring to completed task.
+/// @nobind
+struct TaskHandle
+{
+    /// Index of the task in the pool.
+    unsigned index_{M_MAX_UNSIGNED};
+    /// Generation of the task storage at the moment of task creation.
+    unsigned generation_{};
+
+    /// Return whether the handle was initialized.
+    bool IsValid() const { return index_ != M_MAX_UNSIGNED; }
+};
+
 /// Work queue item.
 /// @nobind
 struct WorkItem : public RefCounted
@@ -123,6 +144,34 @@ public:
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(unsigned priority);
 
+    /// Task graph. Tasks are executed by worker threads via lock-free work-stealing queues.
+    /// Task may depend on other tasks and is executed only after all its dependencies are completed.
+    /// @{
+    /// Create task. Task is not executed until it is submitted. Thread-safe.
+    /// If too many tasks are pending, the function is executed immediately and invalid handle is returned.
+    TaskHandle CreateTask(WorkFunction workFunction);
+    /// Make task wait for completion of another task. Should be called before the task is submitted. Thread-safe.
+    void AddTaskDependency(TaskHandle task, TaskHandle dependency);
+    /// Submit task for execution. Should be called exactly once per created task. Thread-safe.
+    void SubmitTask(TaskHandle task);
+    /// Create and submit task that is executed after all specified tasks are completed. Thread-safe.
+    /// If too many tasks are pending, waits for the dependencies and executes the function immediately.
+    TaskHandle ScheduleTask(WorkFunction workFunction, ea::span<const TaskHandle> dependencies = {});
+    /// Create and submit continuation that is executed after the task is completed. Thread-safe.
+    TaskHandle ScheduleContinuation(TaskHandle task, WorkFunction workFunction);
+    /// Return whether the task is completed. Thread-safe.
+    bool IsTaskCompleted(TaskHandle task) const;
+    /// Wait for task completion. Same as WaitTasks.
+    void WaitTask(TaskHandle task);
+    /// Wait for completion of all tasks. If called from WorkQueue thread, pending tasks are executed while waiting.
+    /// If called from main thread, callbacks queued via CallFromMainThread are invoked afterwards.
+    void WaitTasks(ea::span<const TaskHandle> tasks);
+    /// Set max number of created tasks that are not completed yet. Rounded up to the internal allocation granularity.
+    void SetMaxPendingTasks(unsigned maxTasks);
+    /// Return number of created tasks that are not completed yet.
+    unsigned GetNumPendingTasks() const;
+    /// @}
+
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
 
@@ -155,6 +204,20 @@ private:
     void ProcessMainThreadTasks();
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
+    /// Allocate task in the pool. Return invalid handle if the pool is exhausted and current thread can execute tasks.
+    TaskHandle AllocateTask(WorkFunction& workFunction);
+    /// Push task that is ready for execution to the queue of current thread.
+    void EnqueueTask(unsigned taskIndex);
+    /// Take one task from local queue, shared queue or other threads and execute it. Return false if there was no task.
+    bool ExecuteTask(unsigned threadIndex);
+    /// Execute task and schedule dependent tasks.
+    void RunTask(unsigned taskIndex, unsigned threadIndex);
+    /// Take one legacy work item from the priority queue and execute it. Return false if there was no item.
+    bool ExecuteWorkItem(unsigned threadIndex);
+    /// Wake up sleeping worker threads.
+    void WakeWorkerThreads();
+    /// Put worker thread to sleep until new work is added.
+    void WaitForWork(unsigned wakeEpoch);
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
     /// Purge the pool to reduce allocation where its unneeded.
@@ -166,6 +229,24 @@ private:
 
     /// Worker threads.
     ea::vector<SharedPtr<WorkerThread> > threads_;
+    /// Task storage.
+    ea::unique_ptr<WorkQueueTaskPool> taskPool_;
+    /// Lock-free task queues, one per thread. Main thread has index 0.
+    ea::vector<ea::unique_ptr<WorkQueueTaskQueue>> taskQueues_;
+    /// Tasks that didn't fit into thread queues or were submitted from non-WorkQueue threads.
+    ea::vector<unsigned> sharedTaskQueue_;
+    /// Number of tasks in shared queue.
+    std::atomic<unsigned> sharedTaskQueueSize_{};
+    /// Shared task queue mutex.
+    Mutex sharedTaskQueueMutex_;
+    /// Incremented whenever new work is added.
+    std::atomic<unsigned> wakeEpoch_{};
+    /// Number of worker threads waiting for work.
+    std::atomic<unsigned> numSleepingThreads_{};
+    /// Mutex for sleeping worker threads.
+    std::mutex sleepMutex_;
+    /// Condition for sleeping worker threads.
+    std::condition_variable sleepCondition_;
     /// Tasks to be invoked from main thread.
     WorkQueueVector<WorkFunction> mainThreadTasks_;
     /// Work item pool for reuse to cut down on allocation. The bool is a flag for item pooling and whether it is available or not.
@@ -178,10 +259,8 @@ private:
     Mutex queueMutex_;
     /// Shutting down flag.
     std::atomic<bool> shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
-    std::atomic<bool> pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
-    bool paused_;
+    /// Paused flag. Worker threads don't take work items while paused. Tasks are always processed.
+    std::atomic<bool> paused_;
     /// Completing work in the main thread flag.
     bool completing_;
     /// Tolerance for the shared pool before it begins to deallocate.
@@ -208,23 +287,33 @@ void ForEachParallel(WorkQueue* workQueue, unsigned bucket, unsigned size, Callb
     }
 
     std::atomic<unsigned> offset = 0;
-    const unsigned maxThreads = workQueue->GetNumThreads() + 1;
-    for (unsigned i = 0; i < maxThreads; ++i)
+    const auto processBuckets = [&offset, bucket, size](Callback& callbackCopy)
+    {
+        while (true)
+        {
+            const unsigned beginIndex = offset.fetch_add(bucket, std::memory_order_relaxed);
+            if (beginIndex >= size)
+                break;
+
+            const unsigned endIndex = ea::min(beginIndex + bucket, size);
+            callbackCopy(beginIndex, endIndex);
+        }
+    };
+
+    // Calling thread processes buckets too, so one task less is needed
+    const unsigned numBuckets = (size + bucket - 1) / bucket;
+    const unsigned numTasks = ea::min(workQueue->GetNumThreads() + 1, numBuckets) - 1;
+    ea::fixed_vector<TaskHandle, 16> tasks;
+    for (unsigned i = 0; i < numTasks; ++i)
     {
-        workQueue->AddWorkItem([=, &offset](unsigned /*threadIndex*/) mutable
+        tasks.push_back(workQueue->ScheduleTask([processBuckets, callback](unsigned /*threadIndex*/) mutable
         {
-            while (true)
-            {
-                const unsigned beginIndex = offset.fetch_add(bucket, std::memory_order_relaxed);
-                if (beginIndex >= size)
-                    break;
-
-                const unsigned endIndex = ea::min(beginIndex + bucket, size);
-                callback(beginIndex, endIndex);
-            }
-        }, M_MAX_UNSIGNED);
+            processBuckets(callback);
+        }));
     }
-    workQueue->Complete(M_MAX_UNSIGNED);
+
+    processBuckets(callback);
+    workQueue->WaitTasks(tasks);
 }
 
 /// Process collection in multiple threads.
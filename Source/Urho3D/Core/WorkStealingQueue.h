@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <EASTL/array.h>
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace Urho3D
+{
+
+/// Bounded lock-free work-stealing deque (Chase-Lev).
+/// Owner thread pushes and pops elements at the bottom, any other thread may steal elements from the top.
+/// Elements should be small and trivially copyable, e.g. indices or pointers.
+template <class T, unsigned Capacity>
+class WorkStealingQueue
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity should be power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "Element should be trivially copyable");
+
+public:
+    /// Push element to the bottom. Should be called only by the owner thread. Return false if queue is full.
+    bool Push(T value)
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        const int64_t top = top_.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(Capacity))
+            return false;
+
+        buffer_[bottom & Mask].store(value, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// Pop element from the bottom. Should be called only by the owner thread. Return false if queue is empty.
+    bool Pop(T& value)
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            // Queue was empty
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        value = buffer_[bottom & Mask].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // Last element, race against thieves
+            const bool won = top_.compare_exchange_strong(
+                top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /// Steal element from the top. May be called by any thread. Return false if queue is empty or steal failed.
+    bool Steal(T& value)
+    {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return false;
+
+        value = buffer_[top & Mask].load(std::memory_order_relaxed);
+        return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    /// Return approximate number of elements. Exact only if called by the owner thread while there are no thieves.
+    unsigned GetApproximateSize() const
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        const int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<unsigned>(bottom - top) : 0u;
+    }
+
+private:
+    static constexpr int64_t Mask = Capacity - 1;
+
+    /// Top index, modified by thieves. Kept on separate cache line.
+    alignas(64) std::atomic<int64_t> top_{};
+    /// Bottom index, modified by owner.
+    alignas(64) std::atomic<int64_t> bottom_{};
+    /// Ring buffer of elements.
+    alignas(64) ea::array<std::atomic<T>, Capacity> buffer_{};
+};
+
+}
@@ -68,6 +68,7 @@
 #include "../Physics2D/Physics2D.h"
 #endif
 #include "../Resource/ResourceCache.h"
+#include "../Resource/CookedResourceCache.h"
 #include "../Resource/Localization.h"
 #include "../RenderPipeline/RenderPipeline.h"
 #include "../Resource/JSONArchive.h"
@@ -158,6 +159,7 @@ Engine::Engine(Context* context) :
     context_->RegisterSubsystem(new Log(context_));
 #endif
     context_->RegisterSubsystem(new ResourceCache(context_));
+    context_->RegisterSubsystem(new CookedResourceCache(context_));
     context_->RegisterSubsystem(new Localization(context_));
 #ifdef URHO3D_NETWORK
     context_->RegisterSubsystem(new Network(context_));
@@ -300,6 +302,14 @@ bool Engine::Initialize(const StringVariantMap& parameters)
     if (!InitializeResourceCache(parameters, false))
         return false;
 
+    // Cooked resources are stored in app preferences directory unless absolute path is specified
+    const ea::string& cookedResourceCacheDir = GetParameter(EP_COOKED_RESOURCE_CACHE_DIR).GetString();
+    if (!cookedResourceCacheDir.empty())
+    {
+        GetSubsystem<CookedResourceCache>()->SetCacheDir(
+            IsAbsolutePath(cookedResourceCacheDir) ? cookedResourceCacheDir : appPreferencesDir_ + cookedResourceCacheDir);
+    }
+
     auto* cache = GetSubsystem<ResourceCache>();
 
     // Initialize graphics & audio output
@@ -830,17 +840,23 @@ void Engine::Update()
     // Pre-update event that indicates
     SendEvent(E_INPUTREADY, eventData);
 
+    // Deliver events posted from worker threads since last frame
+    context_->ProcessPostedEvents();
+
     // Logic update event
-    SendEvent(E_UPDATE, eventData);
+    SendEvent<Ev::Update>({timeStep_});
 
     // Logic post-update event
-    SendEvent(E_POSTUPDATE, eventData);
+    SendEvent<Ev::PostUpdate>({timeStep_});
+
+    // Deliver events posted during logic update, e.g. by threaded scene jobs
+    context_->ProcessPostedEvents();
 
     // Rendering update event
-    SendEvent(E_RENDERUPDATE, eventData);
+    SendEvent<Ev::RenderUpdate>({timeStep_});
 
     // Post-render update event
-    SendEvent(E_POSTRENDERUPDATE, eventData);
+    SendEvent<Ev::PostRenderUpdate>({timeStep_});
 }
 
 void Engine::Render()
@@ -1122,6 +1138,7 @@ void Engine::PopulateDefaultParameters()
     engineParameters_->DefineVariable(EP_AUTOLOAD_PATHS, "Autoload");
     engineParameters_->DefineVariable(EP_CONFIG_NAME, "EngineParameters.json");
     engineParameters_->DefineVariable(EP_BORDERLESS, false).Overridable();
+    engineParameters_->DefineVariable(EP_COOKED_RESOURCE_CACHE_DIR, EMPTY_STRING);
     engineParameters_->DefineVariable(EP_DUMP_SHADERS, EMPTY_STRING);
     engineParameters_->DefineVariable(EP_ENGINE_AUTO_LOAD_SCRIPTS, false);
     engineParameters_->DefineVariable(EP_ENGINE_CLI_PARAMETERS, true);
@@ -37,6 +37,7 @@ URHO3D_GLOBAL_CONSTANT(ConstString EP_APPLICATION_PREFERENCES_DIR{"ApplicationPr
 URHO3D_GLOBAL_CONSTANT(ConstString EP_AUTOLOAD_PATHS{"AutoloadPaths"});
 URHO3D_GLOBAL_CONSTANT(ConstString EP_BORDERLESS{"Borderless"});
 URHO3D_GLOBAL_CONSTANT(ConstString EP_CONFIG_NAME{"ConfigName"});
+URHO3D_GLOBAL_CONSTANT(ConstString EP_COOKED_RESOURCE_CACHE_DIR{"CookedResourceCacheDir"});
 URHO3D_GLOBAL_CONSTANT(ConstString EP_DUMP_SHADERS{"DumpShaders"});
 URHO3D_GLOBAL_CONSTANT(ConstString EP_ENGINE_AUTO_LOAD_SCRIPTS{"EngineAutoLoadScripts"});
 URHO3D_GLOBAL_CONSTANT(ConstString EP_ENGINE_CLI_PARAMETERS{"EngineCliParameters"});
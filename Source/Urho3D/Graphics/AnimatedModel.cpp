@@ -796,7 +796,7 @@ void AnimatedModel::CalculateLocalBoundingBox()
     }
 
     boneBoundingBoxDirty_ = false;
-    worldBoundingBoxDirty_ = true;
+    MarkWorldBoundingBoxDirty();
 }
 
 void AnimatedModel::UpdateBoneBoundingBox()
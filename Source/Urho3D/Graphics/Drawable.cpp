@@ -205,6 +205,8 @@ void Drawable::SetLodBias(float bias)
 void Drawable::SetViewMask(unsigned mask)
 {
     viewMask_ = mask;
+    if (octant_)
+        octant_->UpdateDrawableViewMask(this);
 }
 
 void Drawable::SetLightMask(unsigned mask)
@@ -270,6 +272,13 @@ void Drawable::MarkForUpdate()
         octant_->GetOctree()->QueueUpdate(this);
 }
 
+void Drawable::MarkWorldBoundingBoxDirty()
+{
+    worldBoundingBoxDirty_ = true;
+    if (octant_)
+        octant_->MarkCullingDataDirty(this);
+}
+
 const BoundingBox& Drawable::GetWorldBoundingBox()
 {
     if (worldBoundingBoxDirty_)
@@ -423,7 +432,7 @@ void Drawable::OnSceneSet(Scene* scene)
 
 void Drawable::OnMarkedDirty(Node* node)
 {
-    worldBoundingBoxDirty_ = true;
+    MarkWorldBoundingBoxDirty();
     if (!updateQueued_ && octant_)
         octant_->GetOctree()->QueueUpdate(this);
 
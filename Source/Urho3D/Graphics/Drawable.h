@@ -385,6 +385,11 @@ public:
     /// Return whether the drawable is added to Octree.
     bool IsInOctree() const { return drawableIndex_ != M_MAX_UNSIGNED; }
 
+    /// Set index of the drawable in spatial index of Octree. For internal use only.
+    void SetSpatialIndexProxy(unsigned proxy) { spatialIndexProxy_ = proxy; }
+    /// Return index of the drawable in spatial index of Octree. For internal use only.
+    unsigned GetSpatialIndexProxy() const { return spatialIndexProxy_; }
+
     /// Return current zone.
     /// @property
     Zone* GetZone() const { return cachedZone_.zone_; }
@@ -479,6 +484,8 @@ protected:
     void RemoveFromOctree();
     /// Request UpdateBatchesDelayed call from main thread.
     void RequestUpdateBatchesDelayed(const FrameInfo& frame);
+    /// Mark world-space bounding box as dirty, including octree culling data.
+    void MarkWorldBoundingBoxDirty();
 
     /// Move into another octree octant.
     void SetOctant(Octant* octant) { octant_ = octant; }
@@ -513,6 +520,10 @@ protected:
     Octant* octant_;
     /// Index of Drawable in Scene. May be updated.
     unsigned drawableIndex_{ M_MAX_UNSIGNED };
+    /// Index of Drawable in the octant. Managed by Octant.
+    unsigned octantIndex_{ M_MAX_UNSIGNED };
+    /// Index of Drawable in spatial index of Octree. Managed by spatial index.
+    unsigned spatialIndexProxy_{ M_MAX_UNSIGNED };
     /// Current zone.
     CachedDrawableZone cachedZone_;
     /// Current reflection.
@@ -0,0 +1,466 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/DynamicBVH.h"
+
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
+#include "../IO/Log.h"
+
+#include <EASTL/fixed_vector.h>
+#include <EASTL/sort.h>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Minimum number of drawables to rebuild the tree in worker threads.
+const unsigned MIN_DRAWABLES_FOR_THREADED_BUILD = 4096;
+/// Minimum number of drawables in subtree built by one task.
+const unsigned MIN_DRAWABLES_PER_BUILD_TASK = 512;
+/// Size of traversal stack that doesn't require allocation.
+const unsigned TRAVERSAL_STACK_SIZE = 128;
+
+BoundingBox MergeBoundingBoxes(const BoundingBox& lhs, const BoundingBox& rhs)
+{
+    BoundingBox result = lhs;
+    result.Merge(rhs);
+    return result;
+}
+
+float GetHalfSurfaceArea(const BoundingBox& box)
+{
+    const Vector3 size = box.Size();
+    return size.x_ * size.y_ + size.y_ * size.z_ + size.z_ * size.x_;
+}
+
+}
+
+DynamicBVH::DynamicBVH(WorkQueue* workQueue)
+    : workQueue_(workQueue)
+{
+}
+
+DynamicBVH::~DynamicBVH() = default;
+
+BoundingBox DynamicBVH::GetFatBoundingBox(const BoundingBox& box) const
+{
+    if (!box.Defined())
+        return box;
+
+    const Vector3 extent = box.Size() * margin_;
+    return BoundingBox(box.min_ - extent, box.max_ + extent);
+}
+
+unsigned DynamicBVH::AllocateNode()
+{
+    if (!freeNodes_.empty())
+    {
+        const unsigned nodeIndex = freeNodes_.back();
+        freeNodes_.pop_back();
+        return nodeIndex;
+    }
+
+    nodes_.emplace_back();
+    return nodes_.size() - 1;
+}
+
+void DynamicBVH::FreeNode(unsigned nodeIndex)
+{
+    nodes_[nodeIndex] = Node{};
+    freeNodes_.push_back(nodeIndex);
+}
+
+void DynamicBVH::InsertLeaf(unsigned leafIndex)
+{
+    if (root_ == NONE)
+    {
+        root_ = leafIndex;
+        nodes_[leafIndex].parent_ = NONE;
+        return;
+    }
+
+    // Find sibling that requires the least enlargement
+    const BoundingBox leafBox = nodes_[leafIndex].box_;
+    unsigned siblingIndex = root_;
+    while (!nodes_[siblingIndex].IsLeaf())
+    {
+        const Node& node = nodes_[siblingIndex];
+        const BoundingBox& leftBox = nodes_[node.left_].box_;
+        const BoundingBox& rightBox = nodes_[node.right_].box_;
+        const float leftCost = GetHalfSurfaceArea(MergeBoundingBoxes(leftBox, leafBox)) - GetHalfSurfaceArea(leftBox);
+        const float rightCost = GetHalfSurfaceArea(MergeBoundingBoxes(rightBox, leafBox)) - GetHalfSurfaceArea(rightBox);
+        siblingIndex = leftCost <= rightCost ? node.left_ : node.right_;
+    }
+
+    const unsigned oldParentIndex = nodes_[siblingIndex].parent_;
+    const unsigned newParentIndex = AllocateNode();
+
+    Node& newParent = nodes_[newParentIndex];
+    newParent.parent_ = oldParentIndex;
+    newParent.left_ = siblingIndex;
+    newParent.right_ = leafIndex;
+    newParent.box_ = MergeBoundingBoxes(nodes_[siblingIndex].box_, leafBox);
+    nodes_[siblingIndex].parent_ = newParentIndex;
+    nodes_[leafIndex].parent_ = newParentIndex;
+
+    if (oldParentIndex == NONE)
+        root_ = newParentIndex;
+    else
+    {
+        Node& oldParent = nodes_[oldParentIndex];
+        if (oldParent.left_ == siblingIndex)
+            oldParent.left_ = newParentIndex;
+        else
+            oldParent.right_ = newParentIndex;
+        RefitAncestors(oldParentIndex);
+    }
+}
+
+void DynamicBVH::RemoveLeaf(unsigned leafIndex)
+{
+    if (leafIndex == root_)
+    {
+        root_ = NONE;
+        return;
+    }
+
+    const unsigned parentIndex = nodes_[leafIndex].parent_;
+    const Node& parent = nodes_[parentIndex];
+    const unsigned grandParentIndex = parent.parent_;
+    const unsigned siblingIndex = parent.left_ == leafIndex ? parent.right_ : parent.left_;
+
+    // Replace parent with sibling
+    nodes_[siblingIndex].parent_ = grandParentIndex;
+    if (grandParentIndex == NONE)
+        root_ = siblingIndex;
+    else
+    {
+        Node& grandParent = nodes_[grandParentIndex];
+        if (grandParent.left_ == parentIndex)
+            grandParent.left_ = siblingIndex;
+        else
+            grandParent.right_ = siblingIndex;
+        RefitAncestors(grandParentIndex);
+    }
+
+    FreeNode(parentIndex);
+}
+
+void DynamicBVH::RefitAncestors(unsigned nodeIndex)
+{
+    while (nodeIndex != NONE)
+    {
+        Node& node = nodes_[nodeIndex];
+        const BoundingBox box = MergeBoundingBoxes(nodes_[node.left_].box_, nodes_[node.right_].box_);
+
+        // Ancestors don't change if this node doesn't change
+        if (box == node.box_)
+            break;
+
+        node.box_ = box;
+        nodeIndex = node.parent_;
+    }
+}
+
+void DynamicBVH::AddDrawable(Drawable* drawable)
+{
+    const unsigned leafIndex = AllocateNode();
+    Node& leaf = nodes_[leafIndex];
+    leaf.box_ = GetFatBoundingBox(drawable->GetWorldBoundingBox());
+    leaf.drawable_ = drawable;
+    drawable->SetSpatialIndexProxy(leafIndex);
+
+    InsertLeaf(leafIndex);
+    ++numLeaves_;
+    ++numChangesSinceRebuild_;
+}
+
+void DynamicBVH::RemoveDrawable(Drawable* drawable)
+{
+    const unsigned leafIndex = drawable->GetSpatialIndexProxy();
+    if (leafIndex >= nodes_.size() || nodes_[leafIndex].drawable_ != drawable)
+    {
+        URHO3D_LOGERROR("Cannot remove Drawable that doesn't belong to DynamicBVH");
+        assert(0);
+        return;
+    }
+
+    RemoveLeaf(leafIndex);
+    FreeNode(leafIndex);
+    drawable->SetSpatialIndexProxy(M_MAX_UNSIGNED);
+    --numLeaves_;
+    ++numChangesSinceRebuild_;
+}
+
+void DynamicBVH::UpdateDrawable(Drawable* drawable)
+{
+    const unsigned leafIndex = drawable->GetSpatialIndexProxy();
+    assert(leafIndex < nodes_.size() && nodes_[leafIndex].drawable_ == drawable);
+
+    // Skip if drawable still fits into the leaf
+    const BoundingBox& box = drawable->GetWorldBoundingBox();
+    Node& leaf = nodes_[leafIndex];
+    if (leaf.box_.IsInside(box) == INSIDE)
+        return;
+
+    leaf.box_ = GetFatBoundingBox(box);
+    RefitAncestors(leaf.parent_);
+    ++numChangesSinceRebuild_;
+}
+
+void DynamicBVH::Commit()
+{
+    if (numChangesSinceRebuild_ > 0 && numChangesSinceRebuild_ >= rebuildThreshold_ * numLeaves_)
+        Rebuild();
+}
+
+void DynamicBVH::Rebuild()
+{
+    URHO3D_PROFILE("RebuildDynamicBVH");
+
+    buildItems_.clear();
+    for (const Node& node : nodes_)
+    {
+        if (node.IsLeaf())
+        {
+            const BoundingBox box = GetFatBoundingBox(node.drawable_->GetWorldBoundingBox());
+            buildItems_.push_back(BuildItem{box, box.Defined() ? box.Center() : Vector3::ZERO, node.drawable_});
+        }
+    }
+
+    nodes_.clear();
+    freeNodes_.clear();
+    root_ = NONE;
+    numChangesSinceRebuild_ = 0;
+    ++numRebuilds_;
+
+    const unsigned numItems = buildItems_.size();
+    if (numItems == 0)
+        return;
+
+    // Subtree of N leaves always takes 2N-1 nodes, so subtrees can be built independently
+    nodes_.resize(2 * numItems - 1);
+    root_ = 0;
+
+    const unsigned numThreads = workQueue_ ? workQueue_->GetNumThreads() : 0;
+    if (numThreads == 0 || numItems < MIN_DRAWABLES_FOR_THREADED_BUILD)
+    {
+        BuildNode(root_, NONE, 0, numItems, 0);
+        return;
+    }
+
+    // Build top levels of the tree in main thread and the rest in worker threads
+    buildTasks_.clear();
+    buildTopNodes_.clear();
+    const unsigned deferredSize = ea::max(numItems / ((numThreads + 1) * 4), MIN_DRAWABLES_PER_BUILD_TASK);
+    BuildNode(root_, NONE, 0, numItems, deferredSize);
+
+    ForEachParallel(workQueue_, buildTasks_, [this](unsigned /*index*/, const BuildTask& task)
+    {
+        BuildNode(task.nodeIndex_, task.parentIndex_, task.begin_, task.end_, 0);
+    });
+
+    for (unsigned nodeIndex : buildTopNodes_)
+    {
+        Node& node = nodes_[nodeIndex];
+        node.box_ = MergeBoundingBoxes(nodes_[node.left_].box_, nodes_[node.right_].box_);
+    }
+}
+
+void DynamicBVH::BuildNode(unsigned nodeIndex, unsigned parentIndex, unsigned begin, unsigned end, unsigned deferredSize)
+{
+    Node& node = nodes_[nodeIndex];
+    node.parent_ = parentIndex;
+
+    if (end - begin == 1)
+    {
+        const BuildItem& item = buildItems_[begin];
+        node.box_ = item.box_;
+        node.drawable_ = item.drawable_;
+        item.drawable_->SetSpatialIndexProxy(nodeIndex);
+        return;
+    }
+
+    if (end - begin <= deferredSize)
+    {
+        buildTasks_.push_back(BuildTask{nodeIndex, parentIndex, begin, end});
+        return;
+    }
+
+    // Split at the median of centers along the longest axis
+    BoundingBox centerBox;
+    for (unsigned i = begin; i < end; ++i)
+        centerBox.Merge(buildItems_[i].center_);
+
+    const Vector3 size = centerBox.Size();
+    const unsigned axis = size.x_ >= size.y_ && size.x_ >= size.z_ ? 0 : size.y_ >= size.z_ ? 1 : 2;
+    const unsigned middle = begin + (end - begin) / 2;
+    const auto compareCenters = [axis](const BuildItem& lhs, const BuildItem& rhs)
+    {
+        return lhs.center_.Data()[axis] < rhs.center_.Data()[axis];
+    };
+    ea::nth_element(buildItems_.begin() + begin, buildItems_.begin() + middle, buildItems_.begin() + end, compareCenters);
+
+    node.left_ = nodeIndex + 1;
+    node.right_ = nodeIndex + 2 * (middle - begin);
+    BuildNode(node.left_, nodeIndex, begin, middle, deferredSize);
+    BuildNode(node.right_, nodeIndex, middle, end, deferredSize);
+
+    // Bounding box of top node is calculated after deferred subtrees are built
+    if (deferredSize != 0)
+        buildTopNodes_.push_back(nodeIndex);
+    else
+        node.box_ = MergeBoundingBoxes(nodes_[node.left_].box_, nodes_[node.right_].box_);
+}
+
+template <class Callback> void DynamicBVH::TraverseNodes(const Callback& callback) const
+{
+    if (root_ == NONE)
+        return;
+
+    ea::fixed_vector<ea::pair<unsigned, bool>, TRAVERSAL_STACK_SIZE> stack;
+    stack.emplace_back(root_, false);
+    while (!stack.empty())
+    {
+        auto [nodeIndex, inside] = stack.back();
+        stack.pop_back();
+
+        const Node& node = nodes_[nodeIndex];
+        if (!callback(node, inside) || node.IsLeaf())
+            continue;
+
+        stack.emplace_back(node.right_, inside);
+        stack.emplace_back(node.left_, inside);
+    }
+}
+
+void DynamicBVH::GetDrawables(OctreeQuery& query) const
+{
+    TraverseNodes([&](const Node& node, bool& inside)
+    {
+        if (node.IsLeaf())
+        {
+            Drawable* drawable = node.drawable_;
+            query.TestDrawables(&drawable, &drawable + 1, inside);
+            return false;
+        }
+
+        const Intersection result = query.TestOctant(node.box_, inside);
+        inside = result == INSIDE;
+        return result != OUTSIDE;
+    });
+}
+
+void DynamicBVH::GetDrawables(const OctreeCullingShape& shape, DrawableFlags drawableFlags, unsigned viewMask,
+    ea::vector<Drawable*>& result) const
+{
+    TraverseNodes([&](const Node& node, bool& inside)
+    {
+        if (node.IsLeaf())
+        {
+            Drawable* drawable = node.drawable_;
+            if ((drawable->GetDrawableFlags() & drawableFlags) && (drawable->GetViewMask() & viewMask))
+            {
+                if (inside || shape.TestDrawable(drawable->GetWorldBoundingBox()))
+                    result.push_back(drawable);
+            }
+            return false;
+        }
+
+        const Intersection intersection = shape.TestOctant(node.box_, inside);
+        inside = intersection == INSIDE;
+        return intersection != OUTSIDE;
+    });
+}
+
+void DynamicBVH::Raycast(RayOctreeQuery& query) const
+{
+    TraverseNodes([&](const Node& node, bool& /*inside*/)
+    {
+        if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+            return false;
+
+        if (node.IsLeaf())
+        {
+            Drawable* drawable = node.drawable_;
+            if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+                drawable->ProcessRayQuery(query, query.result_);
+        }
+        return true;
+    });
+}
+
+void DynamicBVH::GetDrawablesOnly(RayOctreeQuery& query, ea::vector<Drawable*>& result) const
+{
+    TraverseNodes([&](const Node& node, bool& /*inside*/)
+    {
+        if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+            return false;
+
+        if (node.IsLeaf())
+        {
+            Drawable* drawable = node.drawable_;
+            if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+                result.push_back(drawable);
+        }
+        return true;
+    });
+}
+
+BoundingBox DynamicBVH::GetBoundingBox() const
+{
+    return root_ != NONE ? nodes_[root_].box_ : BoundingBox{};
+}
+
+unsigned DynamicBVH::GetHeight() const
+{
+    if (root_ == NONE)
+        return 0;
+
+    unsigned height = 0;
+    ea::vector<ea::pair<unsigned, unsigned>> stack;
+    stack.emplace_back(root_, 1);
+    while (!stack.empty())
+    {
+        const auto [nodeIndex, depth] = stack.back();
+        stack.pop_back();
+
+        height = ea::max(height, depth);
+        const Node& node = nodes_[nodeIndex];
+        if (!node.IsLeaf())
+        {
+            stack.emplace_back(node.left_, depth + 1);
+            stack.emplace_back(node.right_, depth + 1);
+        }
+    }
+    return height;
+}
+
+}
@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Graphics/SpatialIndex.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class WorkQueue;
+
+/// Dynamic bounding volume hierarchy of drawables.
+/// Leaves store bounding boxes enlarged by margin, so small movements don't change the tree.
+/// Drawables that leave their boxes are refitted in place. The tree is rebuilt from scratch,
+/// in worker threads if possible, when too many leaves have changed since the last rebuild.
+class URHO3D_API DynamicBVH : public SpatialIndex
+{
+public:
+    /// Construct. Worker threads are used for rebuilding if work queue is provided.
+    explicit DynamicBVH(WorkQueue* workQueue = nullptr);
+    /// Destruct.
+    ~DynamicBVH() override;
+
+    /// Set margin of leaf bounding boxes relative to drawable size.
+    void SetMargin(float margin) { margin_ = ea::max(margin, 0.0f); }
+    /// Set number of changed leaves, relative to total number of leaves, that triggers rebuild.
+    void SetRebuildThreshold(float threshold) { rebuildThreshold_ = threshold; }
+    /// Rebuild the tree from scratch.
+    void Rebuild();
+
+    /// Implement SpatialIndex.
+    /// @{
+    void AddDrawable(Drawable* drawable) override;
+    void RemoveDrawable(Drawable* drawable) override;
+    void UpdateDrawable(Drawable* drawable) override;
+    void Commit() override;
+    void GetDrawables(OctreeQuery& query) const override;
+    void GetDrawables(const OctreeCullingShape& shape, DrawableFlags drawableFlags, unsigned viewMask,
+        ea::vector<Drawable*>& result) const override;
+    void Raycast(RayOctreeQuery& query) const override;
+    void GetDrawablesOnly(RayOctreeQuery& query, ea::vector<Drawable*>& result) const override;
+    /// @}
+
+    /// Return margin of leaf bounding boxes.
+    float GetMargin() const { return margin_; }
+    /// Return rebuild threshold.
+    float GetRebuildThreshold() const { return rebuildThreshold_; }
+    /// Return number of drawables.
+    unsigned GetNumDrawables() const { return numLeaves_; }
+    /// Return number of leaves changed since the last rebuild.
+    unsigned GetNumChangesSinceRebuild() const { return numChangesSinceRebuild_; }
+    /// Return number of rebuilds.
+    unsigned GetNumRebuilds() const { return numRebuilds_; }
+    /// Return bounding box of the whole tree.
+    BoundingBox GetBoundingBox() const;
+    /// Return height of the tree. Complexity is linear.
+    unsigned GetHeight() const;
+
+private:
+    /// Index of missing node.
+    static const unsigned NONE = M_MAX_UNSIGNED;
+
+    /// Node of the tree. Leaves have drawable and no children.
+    struct Node
+    {
+        /// Bounding box of drawable or children.
+        BoundingBox box_;
+        /// Parent node.
+        unsigned parent_{NONE};
+        /// First child node.
+        unsigned left_{NONE};
+        /// Second child node.
+        unsigned right_{NONE};
+        /// Drawable.
+        Drawable* drawable_{};
+
+        /// Return whether the node is leaf.
+        bool IsLeaf() const { return drawable_ != nullptr; }
+    };
+
+    /// Drawable with bounding box used for rebuild.
+    struct BuildItem
+    {
+        BoundingBox box_;
+        Vector3 center_;
+        Drawable* drawable_{};
+    };
+
+    /// Subtree deferred for building in worker thread.
+    struct BuildTask
+    {
+        unsigned nodeIndex_{};
+        unsigned parentIndex_{};
+        unsigned begin_{};
+        unsigned end_{};
+    };
+
+    /// Return bounding box enlarged by margin.
+    BoundingBox GetFatBoundingBox(const BoundingBox& box) const;
+    /// Allocate new node.
+    unsigned AllocateNode();
+    /// Free node.
+    void FreeNode(unsigned nodeIndex);
+    /// Insert leaf into the tree.
+    void InsertLeaf(unsigned leafIndex);
+    /// Remove leaf from the tree. Leaf node is not freed.
+    void RemoveLeaf(unsigned leafIndex);
+    /// Recalculate bounding boxes of the node and its ancestors.
+    void RefitAncestors(unsigned nodeIndex);
+    /// Build subtree from build items in range. Subtrees not larger than deferred size are added to build tasks.
+    void BuildNode(unsigned nodeIndex, unsigned parentIndex, unsigned begin, unsigned end, unsigned deferredSize);
+    /// Visit nodes while callback returns true for them.
+    template <class Callback> void TraverseNodes(const Callback& callback) const;
+
+    /// Work queue.
+    WorkQueue* workQueue_{};
+    /// Margin of leaf bounding boxes relative to drawable size.
+    float margin_{0.1f};
+    /// Number of changed leaves, relative to total number of leaves, that triggers rebuild.
+    float rebuildThreshold_{0.5f};
+
+    /// Nodes.
+    ea::vector<Node> nodes_;
+    /// Unused nodes.
+    ea::vector<unsigned> freeNodes_;
+    /// Root node.
+    unsigned root_{NONE};
+    /// Number of leaves.
+    unsigned numLeaves_{};
+    /// Number of leaves added, removed or refitted since the last rebuild.
+    unsigned numChangesSinceRebuild_{};
+    /// Number of rebuilds.
+    unsigned numRebuilds_{};
+
+    /// Temporary build items.
+    ea::vector<BuildItem> buildItems_;
+    /// Temporary build tasks.
+    ea::vector<BuildTask> buildTasks_;
+    /// Temporary nodes built before build tasks, in order of completion.
+    ea::vector<unsigned> buildTopNodes_;
+};
+
+}
@@ -81,6 +81,7 @@ void GlobalIllumination::ResetLightProbes()
 {
     lightProbesBakedData_.Clear();
     lightProbesMesh_ = {};
+    ++revision_;
 }
 
 void GlobalIllumination::CompileLightProbes()
@@ -153,6 +154,8 @@ void GlobalIllumination::SerializeData(Archive& archive)
     {
         SerializeValue(archive, "mesh", lightProbesMesh_);
         SerializeValue(archive, "data", lightProbesBakedData_);
+        if (archive.IsInput())
+            ++revision_;
     }
 }
 
@@ -165,6 +168,7 @@ void GlobalIllumination::ReloadData()
     {
         lightProbesMesh_ = {};
         lightProbesBakedData_.Clear();
+        ++revision_;
     }
 }
 
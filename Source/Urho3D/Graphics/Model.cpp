@@ -74,6 +74,8 @@ void Model::RegisterObject(Context* context)
 
 bool Model::BeginLoad(Deserializer& source)
 {
+    shadowDataReleased_ = false;
+
     // Check ID
     ea::string fileID = source.ReadFileID();
     if (fileID != "UMDL" && fileID != "UMD2" && fileID != "UMD3")
@@ -368,8 +370,94 @@ bool Model::EndLoad()
     return true;
 }
 
+bool Model::OnSoftUnload()
+{
+    // Software skinning and morphing read original vertices, so these buffers are kept.
+    // Index buffers are kept for raycasts.
+    const bool isSkinned = skeleton_.GetNumBones() > 0;
+    unsigned releasedMemory = 0;
+    unsigned allocatedMemory = 0;
+    for (unsigned i = 0; i < vertexBuffers_.size(); ++i)
+    {
+        VertexBuffer* buffer = vertexBuffers_[i];
+        if (!buffer || !buffer->IsShadowed() || isSkinned || morphRangeCounts_[i] > 0)
+            continue;
+
+        // Raycasts read the data of the first vertex buffer, so keep positions and texture coordinates
+        const ea::shared_array<unsigned char> shadowData = buffer->GetShadowDataShared();
+        const ea::vector<VertexElement>& elements = buffer->GetElements();
+        const unsigned uvOffset = VertexBuffer::GetElementOffset(elements, TYPE_VECTOR2, SEM_TEXCOORD);
+        ea::vector<VertexElement> rawElements{VertexElement(TYPE_VECTOR3, SEM_POSITION)};
+        if (uvOffset != M_MAX_UNSIGNED)
+            rawElements.push_back(VertexElement(TYPE_VECTOR2, SEM_TEXCOORD));
+
+        buffer->SetShadowed(false);
+        if (buffer->IsShadowed())
+            continue;
+        releasedMemory += buffer->GetVertexCount() * buffer->GetVertexSize();
+
+        if (VertexBuffer::GetElementOffset(elements, TYPE_VECTOR3, SEM_POSITION) != 0)
+            continue;
+
+        const unsigned vertexCount = buffer->GetVertexCount();
+        const unsigned vertexSize = buffer->GetVertexSize();
+        const unsigned rawVertexSize = VertexBuffer::GetVertexSize(rawElements);
+        ea::shared_array<unsigned char> rawData;
+        for (const auto& lodGeometries : geometries_)
+        {
+            for (Geometry* geometry : lodGeometries)
+            {
+                if (!geometry || geometry->GetVertexBuffer(0) != buffer)
+                    continue;
+
+                if (!rawData)
+                {
+                    rawData = ea::shared_array<unsigned char>(new unsigned char[vertexCount * rawVertexSize]);
+                    allocatedMemory += vertexCount * rawVertexSize;
+                    for (unsigned j = 0; j < vertexCount; ++j)
+                    {
+                        const unsigned char* src = shadowData.get() + j * vertexSize;
+                        unsigned char* dest = rawData.get() + j * rawVertexSize;
+                        memcpy(dest, src, sizeof(Vector3));
+                        if (uvOffset != M_MAX_UNSIGNED)
+                            memcpy(dest + sizeof(Vector3), src + uvOffset, sizeof(Vector2));
+                    }
+                }
+                geometry->SetRawVertexData(rawData, rawElements);
+            }
+        }
+    }
+
+    if (releasedMemory != 0)
+        shadowDataReleased_ = true;
+
+    const unsigned memoryUse = GetMemoryUse() - ea::min(releasedMemory, GetMemoryUse()) + allocatedMemory;
+    SetMemoryUse(memoryUse);
+    return releasedMemory > allocatedMemory;
+}
+
+SharedPtr<Model> Model::LoadOriginal() const
+{
+    auto cache = GetSubsystem<ResourceCache>();
+    const AbstractFilePtr file = cache->GetFile(GetName());
+    auto model = MakeShared<Model>(context_);
+    if (!file || !model->Load(*file))
+    {
+        URHO3D_LOGERROR("Failed to load data of soft-unloaded model " + GetName());
+        return nullptr;
+    }
+    return model;
+}
+
 bool Model::Save(Serializer& dest) const
 {
+    // Soft-unloaded model doesn't have CPU copy of all buffers, so the data is loaded from the file
+    if (shadowDataReleased_)
+    {
+        SharedPtr<Model> model = LoadOriginal();
+        return model && model->Save(dest);
+    }
+
     // Write ID
     if (!dest.WriteFileID("UMD3"))
         return false;
@@ -621,6 +709,15 @@ void Model::SetMorphs(const ea::vector<ModelMorph>& morphs)
 
 SharedPtr<Model> Model::Clone(const ea::string& cloneName) const
 {
+    // Soft-unloaded model doesn't have CPU copy of all buffers, so the clone is loaded from the file
+    if (shadowDataReleased_)
+    {
+        SharedPtr<Model> ret = LoadOriginal();
+        if (ret)
+            ret->SetName(cloneName);
+        return ret;
+    }
+
     SharedPtr<Model> ret(MakeShared<Model>(context_));
 
     ret->SetName(cloneName);
@@ -222,7 +222,16 @@ public:
     /// Return morph range vertex counts for each vertex buffer.
     const ea::vector<unsigned>& GetMorphRangeCounts() const { return morphRangeCounts_; }
 
+protected:
+    /// Release CPU shadow copies of vertex data that has GPU copy. Buffers used for software skinning and morphing
+    /// and index buffers are kept, positions and texture coordinates are kept for raycasts.
+    /// Cloning and saving load the data from the file afterwards.
+    bool OnSoftUnload() override;
+
 private:
+    /// Load copy of the model from the file.
+    SharedPtr<Model> LoadOriginal() const;
+
     /// Class versions (used for serialization)
     /// @{
     static const unsigned legacyVersion = 1; // Fake version for legacy unversioned UMDL/UMD2 file
@@ -251,6 +260,8 @@ private:
     ea::vector<unsigned> morphRangeStarts_;
     /// Vertex buffer morph range vertex count.
     ea::vector<unsigned> morphRangeCounts_;
+    /// Whether the shadow data of vertex buffers is released by soft-unload.
+    bool shadowDataReleased_{};
     /// Vertex buffer data for asynchronous loading.
     ea::vector<VertexBufferDesc> loadVBData_;
     /// Index buffer data for asynchronous loading.
@@ -53,10 +53,19 @@ namespace
 /// Unused vector of drawables.
 static ea::vector<Drawable*> unusedDrawablesVector;
 
+/// Evaluate bounding box and node transform of the drawable.
+void ResolveDrawableBoundingBox(Drawable* drawable)
+{
+    drawable->GetWorldBoundingBox();
+    if (Node* node = drawable->GetNode())
+        node->GetWorldTransform();
+}
+
 }
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+static const unsigned MIN_DRAWABLES_FOR_THREADED_CULLING = 16384;
 
 void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
 {
@@ -74,6 +83,8 @@ void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
     }
 }
 
+static const unsigned RAYCAST_BATCH_BUCKET_SIZE = 16;
+
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
     return lhs.distance_ < rhs.distance_;
@@ -97,11 +108,11 @@ Octant::~Octant()
         // Remove the drawables (if any) from this octant to the root octant
         for (auto i = drawables_.begin(); i != drawables_.end(); ++i)
         {
-            (*i)->SetOctant(rootOctant);
-            rootOctant->drawables_.push_back(*i);
+            rootOctant->PushDrawable(*i);
             octree_->QueueUpdate(*i);
         }
         drawables_.clear();
+        cullingData_.Clear();
         numDrawables_ = 0;
     }
 
@@ -162,9 +173,10 @@ void Octant::InsertDrawable(Drawable* drawable)
         if (oldOctant != this)
         {
             // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+            const unsigned oldIndex = drawable->octantIndex_;
             AddDrawable(drawable);
             if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
+                oldOctant->EraseDrawable(oldIndex, false);
         }
     }
     else
@@ -178,6 +190,46 @@ void Octant::InsertDrawable(Drawable* drawable)
     }
 }
 
+void Octant::RemoveDrawable(Drawable* drawable, bool resetOctant)
+{
+    unsigned index = drawable->octantIndex_;
+    if (index >= drawables_.size() || drawables_[index] != drawable)
+        index = drawables_.index_of(drawable);
+
+    if (index < drawables_.size())
+        EraseDrawable(index, resetOctant);
+}
+
+void Octant::UpdateDrawableCullingData(Drawable* drawable)
+{
+    assert(drawable->octant_ == this && drawables_[drawable->octantIndex_] == drawable);
+    cullingData_.Update(drawable->octantIndex_, drawable->GetWorldBoundingBox(), drawable->GetViewMask());
+}
+
+void Octant::UpdateDrawableViewMask(Drawable* drawable)
+{
+    // Drawables stored in spatial index are not added to octants
+    if (drawable->GetSpatialIndexProxy() != M_MAX_UNSIGNED)
+        return;
+
+    assert(drawable->octant_ == this && drawables_[drawable->octantIndex_] == drawable);
+    cullingData_.SetViewMask(drawable->octantIndex_, drawable->GetViewMask());
+}
+
+void Octant::MarkCullingDataDirty(Drawable* drawable)
+{
+    // Drawables stored in spatial index are not added to octants
+    if (drawable->GetSpatialIndexProxy() != M_MAX_UNSIGNED)
+    {
+        if (octree_)
+            octree_->MarkBoundingBoxesDirty();
+        return;
+    }
+
+    assert(drawable->octant_ == this && drawables_[drawable->octantIndex_] == drawable);
+    MarkBoundingBoxDirty(drawable->octantIndex_);
+}
+
 bool Octant::CheckDrawableFit(const BoundingBox& box) const
 {
     Vector3 boxSize = box.Size();
@@ -221,6 +273,7 @@ void Octant::ResetOctree()
     {
         drawable->SetOctant(nullptr);
         drawable->SetDrawableIndex(M_MAX_UNSIGNED);
+        drawable->octantIndex_ = M_MAX_UNSIGNED;
     }
 
     for (auto& child : children_)
@@ -252,6 +305,43 @@ void Octant::Initialize(const BoundingBox& box)
     cullingBox_ = BoundingBox(worldBoundingBox_.min_ - halfSize_, worldBoundingBox_.max_ + halfSize_);
 }
 
+void Octant::PushDrawable(Drawable* drawable)
+{
+    drawable->SetOctant(this);
+    drawable->octantIndex_ = drawables_.size();
+    drawables_.push_back(drawable);
+
+    // Bounding box is not evaluated here because drawable may be added from Octant destructor
+    cullingData_.Add(drawable->worldBoundingBox_, drawable->GetDrawableFlags(), drawable->GetViewMask());
+    if (drawable->worldBoundingBoxDirty_)
+        MarkBoundingBoxDirty(drawable->octantIndex_);
+}
+
+void Octant::MarkBoundingBoxDirty(unsigned index)
+{
+    cullingData_.MarkBoundingBoxDirty(index);
+    if (octree_)
+        octree_->MarkBoundingBoxesDirty();
+}
+
+void Octant::EraseDrawable(unsigned index, bool resetOctant)
+{
+    Drawable* drawable = drawables_[index];
+    drawables_.erase_at(index);
+    cullingData_.Remove(index);
+
+    // Keep order of drawables so query results are stable
+    for (unsigned i = index; i < drawables_.size(); ++i)
+        drawables_[i]->octantIndex_ = i;
+
+    if (resetOctant)
+    {
+        drawable->SetOctant(nullptr);
+        drawable->octantIndex_ = M_MAX_UNSIGNED;
+    }
+    DecDrawableCount();
+}
+
 void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
 {
     if (this != octree_->GetRootOctant())
@@ -280,6 +370,50 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     }
 }
 
+void Octant::CullDrawablesInternal(const OctreeCullingShape& shape, bool inside, DrawableFlags drawableFlags,
+    unsigned viewMask, ea::vector<Drawable*>& result, bool recursive) const
+{
+    if (this != octree_->GetRootOctant())
+    {
+        Intersection res = shape.TestOctant(cullingBox_, inside);
+        if (res == INSIDE)
+            inside = true;
+        else if (res == OUTSIDE)
+        {
+            // Fully outside, so cull this octant, its children & drawables
+            return;
+        }
+    }
+
+    if (drawables_.size())
+        cullingData_.Cull(shape, inside, drawableFlags, viewMask, drawables_.data(), result);
+
+    if (recursive)
+    {
+        for (auto child : children_)
+        {
+            if (child)
+                child->CullDrawablesInternal(shape, inside, drawableFlags, viewMask, result);
+        }
+    }
+}
+
+void Octant::ResolveDirtyBoundingBoxes() const
+{
+    const unsigned numDrawables = drawables_.size();
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        if (cullingData_.IsBoundingBoxDirty(i))
+            ResolveDrawableBoundingBox(drawables_[i]);
+    }
+
+    for (auto child : children_)
+    {
+        if (child)
+            child->ResolveDirtyBoundingBoxes();
+    }
+}
+
 void Octant::GetDrawablesInternal(RayOctreeQuery& query) const
 {
     float octantDist = query.ray_.HitDistance(cullingBox_);
@@ -334,6 +468,38 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, ea::vector<Drawable
     }
 }
 
+void Octant::GetDrawablesInternal(const RayPacket& packet, unsigned raysMask, DrawableFlags drawableFlags,
+    unsigned viewMask, ea::vector<RayHitCandidate>* candidates) const
+{
+    float distances[RayPacket::MAX_RAYS];
+    raysMask &= packet.HitDistance(cullingBox_, distances);
+    if (!raysMask)
+        return;
+
+    const unsigned numDrawables = drawables_.size();
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        Drawable* drawable = drawables_[i];
+        if (!(drawable->GetDrawableFlags() & drawableFlags) || !(drawable->GetViewMask() & viewMask))
+            continue;
+
+        const BoundingBox boundingBox = cullingData_.IsBoundingBoxDirty(i)
+            ? drawable->GetWorldBoundingBox() : cullingData_.GetBoundingBox(i);
+        const unsigned hitMask = raysMask & packet.HitDistance(boundingBox, distances);
+        for (unsigned rayIndex = 0; rayIndex < RayPacket::MAX_RAYS; ++rayIndex)
+        {
+            if (hitMask & (1u << rayIndex))
+                candidates[rayIndex].emplace_back(distances[rayIndex], drawable);
+        }
+    }
+
+    for (auto child : children_)
+    {
+        if (child)
+            child->GetDrawablesInternal(packet, raysMask, drawableFlags, viewMask, candidates);
+    }
+}
+
 ZoneLookupIndex::ZoneLookupIndex(Context* context)
 {
     if (auto renderer = context->GetSubsystem<Renderer>())
@@ -444,6 +610,17 @@ Octree::~Octree()
     // Reset root pointer from all child octants now so that they do not move their drawables to root
     drawableUpdates_.clear();
     rootOctant_.ResetOctree();
+
+    // Drawables stored in spatial index refer to root octant but are not added to it
+    if (spatialIndex_)
+    {
+        for (Drawable* drawable : drawables_)
+        {
+            drawable->SetOctant(nullptr);
+            drawable->SetDrawableIndex(M_MAX_UNSIGNED);
+            drawable->SetSpatialIndexProxy(M_MAX_UNSIGNED);
+        }
+    }
 }
 
 void Octree::RegisterObject(Context* context)
@@ -485,6 +662,10 @@ void Octree::Update(const FrameInfo& frame)
         return;
     }
 
+    // Deliver batched transform notifications so moved drawables are queued for update
+    if (Scene* scene = GetScene())
+        scene->GetTransformStore()->Update();
+
     // Let drawables update themselves before reinsertion. This can be used for animation
     if (!drawableUpdates_.empty())
     {
@@ -561,11 +742,27 @@ void Octree::Update(const FrameInfo& frame)
         eventData[P_SCENE] = scene;
         eventData[P_TIMESTEP] = frame.timeStep_;
         scene->SendEvent(E_SCENEDRAWABLEUPDATEFINISHED, eventData);
+
+        // Custom animation may move the nodes
+        scene->GetTransformStore()->Update();
     }
 
+    if (spatialIndex_)
+    {
+        URHO3D_PROFILE("UpdateSpatialIndex");
+
+        for (Drawable* drawable : drawableUpdates_)
+        {
+            drawable->updateQueued_ = false;
+            Octant* octant = drawable->GetOctant();
+            if (octant && octant->GetOctree() == this)
+                spatialIndex_->UpdateDrawable(drawable);
+        }
+        spatialIndex_->Commit();
+    }
     // Reinsert drawables that have been moved or resized, or that have been newly added to the octree and do not sit inside
     // the proper octant yet
-    if (!drawableUpdates_.empty())
+    else if (!drawableUpdates_.empty())
     {
         URHO3D_PROFILE("ReinsertToOctree");
 
@@ -595,6 +792,14 @@ void Octree::Update(const FrameInfo& frame)
             }
 #endif
         }
+
+        // Culling data is updated after reinsertion because reinsertion may move the drawable to another octant
+        for (Drawable* drawable : drawableUpdates_)
+        {
+            Octant* octant = drawable->GetOctant();
+            if (octant && octant->GetOctree() == this)
+                octant->UpdateDrawableCullingData(drawable);
+        }
     }
 
     drawableUpdates_.clear();
@@ -610,6 +815,40 @@ void Octree::Update(const FrameInfo& frame)
     }
 }
 
+void Octree::SetSpatialIndex(ea::unique_ptr<SpatialIndex> spatialIndex)
+{
+    for (Drawable* drawable : drawables_)
+        RemoveFromStorage(drawable);
+
+    spatialIndex_ = ea::move(spatialIndex);
+
+    for (Drawable* drawable : drawables_)
+        InsertToStorage(drawable);
+}
+
+void Octree::InsertToStorage(Drawable* drawable)
+{
+    if (spatialIndex_)
+    {
+        // Drawable refers to root octant so the ownership can be checked
+        drawable->SetOctant(&rootOctant_);
+        spatialIndex_->AddDrawable(drawable);
+    }
+    else
+        rootOctant_.InsertDrawable(drawable);
+}
+
+void Octree::RemoveFromStorage(Drawable* drawable)
+{
+    if (spatialIndex_)
+    {
+        spatialIndex_->RemoveDrawable(drawable);
+        drawable->SetOctant(nullptr);
+    }
+    else if (Octant* octant = drawable->GetOctant())
+        octant->RemoveDrawable(drawable);
+}
+
 void Octree::AddManualDrawable(Drawable* drawable)
 {
     if (!drawable || drawable->GetOctant())
@@ -646,7 +885,7 @@ void Octree::AddDrawable(Drawable* drawable)
     drawable->SetDrawableIndex(index);
 
     // Insert drawable to common Octree
-    rootOctant_.InsertDrawable(drawable);
+    InsertToStorage(drawable);
 
     // Insert drawable to zone index
     if (drawable->GetDrawableFlags().Test(DRAWABLE_ZONE))
@@ -673,7 +912,7 @@ void Octree::RemoveDrawable(Drawable* drawable, Octant* octant)
     }
 
     // Remove drawable from Octree
-    octant->RemoveDrawable(drawable);
+    RemoveFromStorage(drawable);
 
     // Remove drawable from Zone index
     if (drawable->GetDrawableFlags().Test(DRAWABLE_ZONE))
@@ -706,7 +945,88 @@ void Octree::MarkZoneDirty(Zone* zone)
 void Octree::GetDrawables(OctreeQuery& query) const
 {
     query.result_.clear();
-    rootOctant_.GetDrawablesInternal(query, false);
+    if (spatialIndex_)
+        spatialIndex_->GetDrawables(query);
+    else
+        rootOctant_.GetDrawablesInternal(query, false);
+}
+
+void Octree::GetDrawablesInFrustum(ea::vector<Drawable*>& result, const Frustum& frustum,
+    DrawableFlags drawableFlags, unsigned viewMask) const
+{
+    CullDrawables(result, OctreeCullingShape::FromFrustum(frustum), drawableFlags, viewMask);
+}
+
+void Octree::GetDrawablesInSphere(ea::vector<Drawable*>& result, const Sphere& sphere,
+    DrawableFlags drawableFlags, unsigned viewMask) const
+{
+    CullDrawables(result, OctreeCullingShape::FromSphere(sphere), drawableFlags, viewMask);
+}
+
+void Octree::GetDrawablesInBox(ea::vector<Drawable*>& result, const BoundingBox& box,
+    DrawableFlags drawableFlags, unsigned viewMask) const
+{
+    CullDrawables(result, OctreeCullingShape::FromBox(box), drawableFlags, viewMask);
+}
+
+void Octree::CullDrawables(ea::vector<Drawable*>& result, const OctreeCullingShape& shape,
+    DrawableFlags drawableFlags, unsigned viewMask) const
+{
+    URHO3D_PROFILE("CullDrawables");
+
+    result.clear();
+
+    if (spatialIndex_)
+    {
+        spatialIndex_->GetDrawables(shape, drawableFlags, viewMask, result);
+        return;
+    }
+
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    const bool threaded = workQueue && workQueue->GetNumThreads() > 0 && Thread::IsMainThread()
+        && rootOctant_.GetNumDrawables() >= MIN_DRAWABLES_FOR_THREADED_CULLING;
+    if (!threaded)
+    {
+        rootOctant_.CullDrawablesInternal(shape, false, drawableFlags, viewMask, result);
+        return;
+    }
+
+    // Bounding boxes and node transforms are evaluated lazily, which is not thread-safe
+    ResolveDirtyBoundingBoxes();
+
+    // Root octant is never culled, so process its children in parallel and merge results in the same order
+    rootOctant_.CullDrawablesInternal(shape, false, drawableFlags, viewMask, result, false);
+    ForEachParallel(workQueue, 1u, static_cast<unsigned>(NUM_OCTANTS), [&](unsigned beginIndex, unsigned endIndex)
+    {
+        for (unsigned i = beginIndex; i < endIndex; ++i)
+        {
+            cullingTaskResults_[i].clear();
+            if (const Octant* child = rootOctant_.GetChild(i))
+                child->CullDrawablesInternal(shape, false, drawableFlags, viewMask, cullingTaskResults_[i]);
+        }
+    });
+
+    for (const ea::vector<Drawable*>& childResult : cullingTaskResults_)
+        result.insert(result.end(), childResult.begin(), childResult.end());
+}
+
+void Octree::ResolveDirtyBoundingBoxes() const
+{
+    if (!boundingBoxesDirty_.exchange(false, std::memory_order_relaxed))
+        return;
+
+    URHO3D_PROFILE("ResolveDirtyBoundingBoxes");
+    if (spatialIndex_)
+    {
+        // Drawables stored in spatial index have no culling data
+        for (Drawable* drawable : drawables_)
+        {
+            if (drawable->worldBoundingBoxDirty_)
+                ResolveDrawableBoundingBox(drawable);
+        }
+    }
+    else
+        rootOctant_.ResolveDirtyBoundingBoxes();
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -714,7 +1034,10 @@ void Octree::Raycast(RayOctreeQuery& query) const
     URHO3D_PROFILE("Raycast");
 
     query.result_.clear();
-    rootOctant_.GetDrawablesInternal(query);
+    if (spatialIndex_)
+        spatialIndex_->Raycast(query);
+    else
+        rootOctant_.GetDrawablesInternal(query);
     ea::quick_sort(query.result_.begin(), query.result_.end(), CompareRayQueryResults);
 }
 
@@ -724,7 +1047,10 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 
     query.result_.clear();
     rayQueryDrawables_.clear();
-    rootOctant_.GetDrawablesOnlyInternal(query, rayQueryDrawables_);
+    if (spatialIndex_)
+        spatialIndex_->GetDrawablesOnly(query, rayQueryDrawables_);
+    else
+        rootOctant_.GetDrawablesOnlyInternal(query, rayQueryDrawables_);
 
     // Sort by increasing hit distance to AABB
     for (auto i = rayQueryDrawables_.begin(); i != rayQueryDrawables_.end(); ++i)
@@ -758,6 +1084,109 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
     }
 }
 
+void Octree::RaycastSingleBatch(BatchedRayOctreeQuery& query) const
+{
+    URHO3D_PROFILE("RaycastBatch");
+
+    const unsigned numRays = query.rays_.size();
+    if (query.results_.size() != numRays || (!query.maxDistances_.empty() && query.maxDistances_.size() != numRays))
+    {
+        URHO3D_LOGERROR("Batched ray query should have the same number of rays, results and distances");
+        return;
+    }
+
+    struct Scratch
+    {
+        ea::vector<RayHitCandidate> candidates_[RayPacket::MAX_RAYS];
+        ea::vector<Drawable*> drawables_;
+        ea::vector<RayQueryResult> results_;
+    };
+
+    // Same as RaycastSingle, except that sort values of drawables are not touched
+    const auto processRay = [&](unsigned rayIndex, float maxDistance, Scratch& scratch, ea::vector<RayHitCandidate>& candidates)
+    {
+        const auto compareCandidates = [](const RayHitCandidate& lhs, const RayHitCandidate& rhs) { return lhs.first < rhs.first; };
+        ea::quick_sort(candidates.begin(), candidates.end(), compareCandidates);
+
+        scratch.results_.clear();
+        RayOctreeQuery rayQuery(scratch.results_, query.rays_[rayIndex], query.level_, maxDistance,
+            query.drawableFlags_, query.viewMask_);
+
+        float closestHit = M_INFINITY;
+        for (const auto& [distance, drawable] : candidates)
+        {
+            if (distance >= Min(closestHit, maxDistance))
+                break;
+
+            const unsigned oldSize = scratch.results_.size();
+            drawable->ProcessRayQuery(rayQuery, scratch.results_);
+            if (scratch.results_.size() > oldSize)
+                closestHit = Min(closestHit, scratch.results_.back().distance_);
+        }
+
+        if (scratch.results_.size() > 1)
+            ea::quick_sort(scratch.results_.begin(), scratch.results_.end(), CompareRayQueryResults);
+        query.results_[rayIndex] = !scratch.results_.empty() ? scratch.results_[0] : RayQueryResult{};
+    };
+
+    const unsigned numPackets = (numRays + RayPacket::MAX_RAYS - 1) / RayPacket::MAX_RAYS;
+    const auto processPackets = [&, scratch = Scratch{}](unsigned beginIndex, unsigned endIndex) mutable
+    {
+        float maxDistances[RayPacket::MAX_RAYS];
+        for (unsigned packetIndex = beginIndex; packetIndex < endIndex; ++packetIndex)
+        {
+            const unsigned firstRay = packetIndex * RayPacket::MAX_RAYS;
+            const unsigned packetSize = ea::min(numRays - firstRay, RayPacket::MAX_RAYS);
+            for (unsigned i = 0; i < packetSize; ++i)
+            {
+                maxDistances[i] = query.GetMaxDistance(firstRay + i);
+                scratch.candidates_[i].clear();
+            }
+
+            if (spatialIndex_)
+            {
+                for (unsigned i = 0; i < packetSize; ++i)
+                {
+                    const Ray& ray = query.rays_[firstRay + i];
+                    RayOctreeQuery rayQuery(scratch.results_, ray, query.level_, maxDistances[i],
+                        query.drawableFlags_, query.viewMask_);
+
+                    scratch.drawables_.clear();
+                    spatialIndex_->GetDrawablesOnly(rayQuery, scratch.drawables_);
+                    for (Drawable* drawable : scratch.drawables_)
+                    {
+                        const float distance = ray.HitDistance(drawable->GetWorldBoundingBox());
+                        if (distance < maxDistances[i])
+                            scratch.candidates_[i].emplace_back(distance, drawable);
+                    }
+                }
+            }
+            else
+            {
+                const RayPacket packet(&query.rays_[firstRay], maxDistances, packetSize);
+                rootOctant_.GetDrawablesInternal(packet, M_MAX_UNSIGNED, query.drawableFlags_, query.viewMask_,
+                    scratch.candidates_);
+            }
+
+            for (unsigned i = 0; i < packetSize; ++i)
+                processRay(firstRay + i, maxDistances[i], scratch, scratch.candidates_[i]);
+        }
+    };
+
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    if (workQueue && workQueue->GetNumThreads() > 0 && Thread::IsMainThread())
+    {
+        // Bounding boxes and node transforms are evaluated lazily, which is not thread-safe
+        ResolveDirtyBoundingBoxes();
+        ForEachParallel(workQueue, RAYCAST_BATCH_BUCKET_SIZE, numPackets, processPackets);
+    }
+    else
+    {
+        auto callback = processPackets;
+        callback(0, numPackets);
+    }
+}
+
 CachedDrawableZone Octree::QueryZone(Drawable* drawable) const
 {
     return zones_.QueryZone(drawable->GetWorldBoundingBox().Center(), drawable->GetZoneMask());
@@ -26,9 +26,15 @@
 #include "../Core/Mutex.h"
 #include "../Core/WorkQueue.h"
 #include "../Graphics/Drawable.h"
+#include "../Graphics/OctreeCulling.h"
 #include "../Graphics/OctreeQuery.h"
+#include "../Graphics/SpatialIndex.h"
 #include "../Math/Transform.h"
 
+#include <EASTL/unique_ptr.h>
+
+#include <atomic>
+
 namespace Urho3D
 {
 
@@ -60,23 +66,19 @@ public:
     /// Add a drawable object to this octant.
     void AddDrawable(Drawable* drawable)
     {
-        drawable->SetOctant(this);
-        drawables_.push_back(drawable);
+        PushDrawable(drawable);
         IncDrawableCount();
     }
 
     /// Remove a drawable object from this octant.
-    void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
-    {
-        auto it = drawables_.find(drawable);
-        if (it != drawables_.end())
-        {
-            drawables_.erase(it);
-            if (resetOctant)
-                drawable->SetOctant(nullptr);
-            DecDrawableCount();
-        }
-    }
+    void RemoveDrawable(Drawable* drawable, bool resetOctant = true);
+
+    /// Update culling data of the drawable from its actual bounding box and view mask.
+    void UpdateDrawableCullingData(Drawable* drawable);
+    /// Update view mask of the drawable in culling data.
+    void UpdateDrawableViewMask(Drawable* drawable);
+    /// Mark bounding box of the drawable in culling data as outdated. May be called from any thread.
+    void MarkCullingDataDirty(Drawable* drawable);
 
     /// Return world-space bounding box.
     /// @property
@@ -94,6 +96,12 @@ public:
     /// Return octree.
     Octree* GetOctree() const { return octree_; }
 
+    /// Return child octant, if exists.
+    Octant* GetChild(unsigned index) const { return children_[index]; }
+
+    /// Return culling data of drawables in this octant.
+    const DrawableCullingData& GetCullingData() const { return cullingData_; }
+
     /// Return number of drawables.
     unsigned GetNumDrawables() const { return numDrawables_; }
 
@@ -114,10 +122,24 @@ public:
     void GetDrawablesInternal(RayOctreeQuery& query) const;
     /// Return drawable objects only for a threaded ray query, called internally.
     void GetDrawablesOnlyInternal(RayOctreeQuery& query, ea::vector<Drawable*>& drawables) const;
+    /// Return drawable objects which bounding boxes are hit by rays of the packet, called internally.
+    void GetDrawablesInternal(const RayPacket& packet, unsigned raysMask, DrawableFlags drawableFlags,
+        unsigned viewMask, ea::vector<RayHitCandidate>* candidates) const;
+    /// Return drawable objects by a shape using culling data, called internally.
+    void CullDrawablesInternal(const OctreeCullingShape& shape, bool inside, DrawableFlags drawableFlags,
+        unsigned viewMask, ea::vector<Drawable*>& result, bool recursive = true) const;
+    /// Evaluate outdated bounding boxes and node transforms of drawables recursively, called internally.
+    void ResolveDirtyBoundingBoxes() const;
 
 protected:
     /// Initialize bounding box.
     void Initialize(const BoundingBox& box);
+    /// Add drawable object to the list without changing drawable count.
+    void PushDrawable(Drawable* drawable);
+    /// Remove drawable object at index and decrease drawable count. May delete this octant.
+    void EraseDrawable(unsigned index, bool resetOctant);
+    /// Mark bounding box in culling data as outdated and notify the octree.
+    void MarkBoundingBoxDirty(unsigned index);
 
     /// Increase drawable object count recursively.
     void IncDrawableCount()
@@ -149,6 +171,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     ea::vector<Drawable*> drawables_;
+    /// Culling data of drawable objects, stored in the same order.
+    DrawableCullingData cullingData_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS]{};
     /// World bounding box center.
@@ -231,6 +255,10 @@ public:
     void SetSize(const BoundingBox& box, unsigned numLevels);
     /// Update and reinsert drawable objects.
     void Update(const FrameInfo& frame);
+    /// Set spatial index used instead of octants to store and query drawables. Null means octants are used.
+    /// Drawables already added to the octree are moved to the new storage.
+    /// @nobind
+    void SetSpatialIndex(ea::unique_ptr<SpatialIndex> spatialIndex);
     /// Add a drawable manually.
     void AddManualDrawable(Drawable* drawable);
     /// Remove a manually added drawable.
@@ -246,10 +274,27 @@ public:
     /// Return drawable objects by a query.
     /// @nobind
     void GetDrawables(OctreeQuery& query) const;
+    /// Return drawable objects inside or intersecting frustum. Same as FrustumOctreeQuery, but faster.
+    /// Large octrees are processed in worker threads if called from main thread.
+    /// @nobind
+    void GetDrawablesInFrustum(ea::vector<Drawable*>& result, const Frustum& frustum,
+        DrawableFlags drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) const;
+    /// Return drawable objects inside or intersecting sphere. Same as SphereOctreeQuery, but faster.
+    /// @nobind
+    void GetDrawablesInSphere(ea::vector<Drawable*>& result, const Sphere& sphere,
+        DrawableFlags drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) const;
+    /// Return drawable objects inside or intersecting box. Same as BoxOctreeQuery, but faster.
+    /// @nobind
+    void GetDrawablesInBox(ea::vector<Drawable*>& result, const BoundingBox& box,
+        DrawableFlags drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) const;
     /// Return drawable objects by a ray query.
     void Raycast(RayOctreeQuery& query) const;
     /// Return the closest drawable object by a ray query.
     void RaycastSingle(RayOctreeQuery& query) const;
+    /// Return the closest drawable object for each ray of the batched query. Rays are processed in parallel.
+    /// Scene should not be modified during the call.
+    /// @nobind
+    void RaycastSingleBatch(BatchedRayOctreeQuery& query) const;
     /// Return best zone for drawable.
     CachedDrawableZone QueryZone(Drawable* drawable) const;
     /// Return best zone for drawable with given center in world space and zone mask.
@@ -257,6 +302,10 @@ public:
     /// Return background zone (arbitrary zone with 0 priority or lower). Zones with positive priority are ignored.
     Zone* GetBackgroundZone() const;
 
+    /// Return spatial index, if used instead of octants.
+    /// @nobind
+    SpatialIndex* GetSpatialIndex() const { return spatialIndex_.get(); }
+
     /// Return root octant.
     const Octant* GetRootOctant() const { return &rootOctant_; }
 
@@ -277,6 +326,8 @@ public:
     /// Queue Node transform update to be applied after threaded update.
     /// Should be called only during Drawable::Update.
     void QueueNodeTransformUpdate(Node* node, const Transform& transform);
+    /// Mark that some drawables have outdated bounding boxes. May be called from any thread.
+    void MarkBoundingBoxesDirty() { boundingBoxesDirty_.store(true, std::memory_order_relaxed); }
     /// Visualize the component as debug geometry.
     void DrawDebugGeometry(bool depthTest);
 
@@ -285,9 +336,21 @@ private:
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
     /// Update octree size.
     void UpdateOctreeSize() { SetSize(worldBoundingBox_, numLevels_); }
+    /// Add drawable to octants or spatial index.
+    void InsertToStorage(Drawable* drawable);
+    /// Remove drawable from octants or spatial index.
+    void RemoveFromStorage(Drawable* drawable);
+    /// Return drawable objects by a shape using culling data.
+    void CullDrawables(ea::vector<Drawable*>& result, const OctreeCullingShape& shape,
+        DrawableFlags drawableFlags, unsigned viewMask) const;
+    /// Evaluate outdated bounding boxes and node transforms of drawables, so worker threads do not evaluate them lazily.
+    /// Should be called from main thread.
+    void ResolveDirtyBoundingBoxes() const;
 
     /// Root octant.
     Octant rootOctant_;
+    /// Spatial index used instead of octants.
+    ea::unique_ptr<SpatialIndex> spatialIndex_;
     /// Drawable objects that require update.
     ea::vector<Drawable*> drawableUpdates_;
     /// Drawable objects that were inserted during threaded update phase.
@@ -300,6 +363,10 @@ private:
     Mutex octreeMutex_;
     /// Ray query temporary list of drawables.
     mutable ea::vector<Drawable*> rayQueryDrawables_;
+    /// Temporary lists of drawables culled in worker threads, one per child of the root octant.
+    mutable ea::vector<Drawable*> cullingTaskResults_[NUM_OCTANTS];
+    /// Whether some drawables may have outdated bounding boxes.
+    mutable std::atomic_bool boundingBoxesDirty_{};
     /// Subdivision level.
     unsigned numLevels_;
     /// World bounding box.
@@ -0,0 +1,405 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/OctreeCulling.h"
+
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+#ifdef URHO3D_SSE
+/// Bounding boxes of 4 drawables.
+struct BoundingBoxBatch
+{
+    __m128 minX_;
+    __m128 minY_;
+    __m128 minZ_;
+    __m128 maxX_;
+    __m128 maxY_;
+    __m128 maxZ_;
+};
+
+/// Same as Frustum::IsInsideFast, for 4 bounding boxes.
+__m128 IsOutsideFrustum(const Frustum& frustum, const BoundingBoxBatch& boxes)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 centerX = _mm_mul_ps(_mm_add_ps(boxes.maxX_, boxes.minX_), half);
+    const __m128 centerY = _mm_mul_ps(_mm_add_ps(boxes.maxY_, boxes.minY_), half);
+    const __m128 centerZ = _mm_mul_ps(_mm_add_ps(boxes.maxZ_, boxes.minZ_), half);
+    const __m128 edgeX = _mm_sub_ps(centerX, boxes.minX_);
+    const __m128 edgeY = _mm_sub_ps(centerY, boxes.minY_);
+    const __m128 edgeZ = _mm_sub_ps(centerZ, boxes.minZ_);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    __m128 outside = _mm_setzero_ps();
+    for (const Plane& plane : frustum.planes_)
+    {
+        const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(_mm_set1_ps(plane.normal_.x_), centerX),
+            _mm_mul_ps(_mm_set1_ps(plane.normal_.y_), centerY)),
+            _mm_mul_ps(_mm_set1_ps(plane.normal_.z_), centerZ)),
+            _mm_set1_ps(plane.d_));
+        const __m128 absDist = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(_mm_set1_ps(plane.absNormal_.x_), edgeX),
+            _mm_mul_ps(_mm_set1_ps(plane.absNormal_.y_), edgeY)),
+            _mm_mul_ps(_mm_set1_ps(plane.absNormal_.z_), edgeZ));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_xor_ps(absDist, signMask)));
+    }
+    return outside;
+}
+
+/// Return squared distance from sphere center to the box along one axis. Same as in Sphere::IsInsideFast.
+__m128 GetAxisDistanceSquared(__m128 center, __m128 min, __m128 max)
+{
+    const __m128 belowMin = _mm_cmplt_ps(center, min);
+    const __m128 aboveMax = _mm_andnot_ps(belowMin, _mm_cmpgt_ps(center, max));
+    const __m128 temp = _mm_or_ps(
+        _mm_and_ps(belowMin, _mm_sub_ps(center, min)),
+        _mm_and_ps(aboveMax, _mm_sub_ps(center, max)));
+    return _mm_mul_ps(temp, temp);
+}
+
+/// Same as Sphere::IsInsideFast, for 4 bounding boxes.
+__m128 IsOutsideSphere(const Sphere& sphere, const BoundingBoxBatch& boxes)
+{
+    const __m128 distSquared = _mm_add_ps(_mm_add_ps(
+        GetAxisDistanceSquared(_mm_set1_ps(sphere.center_.x_), boxes.minX_, boxes.maxX_),
+        GetAxisDistanceSquared(_mm_set1_ps(sphere.center_.y_), boxes.minY_, boxes.maxY_)),
+        GetAxisDistanceSquared(_mm_set1_ps(sphere.center_.z_), boxes.minZ_, boxes.maxZ_));
+    return _mm_cmpge_ps(distSquared, _mm_set1_ps(sphere.radius_ * sphere.radius_));
+}
+
+/// Update hit distances with the hit of box face, same as in Ray::HitDistanceAndNormal.
+__m128 HitBoxFace(__m128 distance, __m128 condition, __m128 faceDistance,
+    __m128 origin1, __m128 direction1, __m128 min1, __m128 max1,
+    __m128 origin2, __m128 direction2, __m128 min2, __m128 max2)
+{
+    const __m128 point1 = _mm_add_ps(origin1, _mm_mul_ps(faceDistance, direction1));
+    const __m128 point2 = _mm_add_ps(origin2, _mm_mul_ps(faceDistance, direction2));
+    __m128 hit = _mm_and_ps(condition, _mm_cmplt_ps(faceDistance, distance));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(point1, min1), _mm_cmple_ps(point1, max1)));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(point2, min2), _mm_cmple_ps(point2, max2)));
+    return _mm_or_ps(_mm_and_ps(hit, faceDistance), _mm_andnot_ps(hit, distance));
+}
+
+/// Same as BoundingBox::IsInsideFast, for 4 bounding boxes.
+__m128 IsOutsideBox(const BoundingBox& box, const BoundingBoxBatch& boxes)
+{
+    const __m128 outsideX = _mm_or_ps(
+        _mm_cmplt_ps(boxes.maxX_, _mm_set1_ps(box.min_.x_)), _mm_cmpgt_ps(boxes.minX_, _mm_set1_ps(box.max_.x_)));
+    const __m128 outsideY = _mm_or_ps(
+        _mm_cmplt_ps(boxes.maxY_, _mm_set1_ps(box.min_.y_)), _mm_cmpgt_ps(boxes.minY_, _mm_set1_ps(box.max_.y_)));
+    const __m128 outsideZ = _mm_or_ps(
+        _mm_cmplt_ps(boxes.maxZ_, _mm_set1_ps(box.min_.z_)), _mm_cmpgt_ps(boxes.minZ_, _mm_set1_ps(box.max_.z_)));
+    return _mm_or_ps(_mm_or_ps(outsideX, outsideY), outsideZ);
+}
+#endif
+
+}
+
+OctreeCullingShape OctreeCullingShape::FromFrustum(const Frustum& frustum)
+{
+    OctreeCullingShape shape;
+    shape.type_ = Type::Frustum;
+    shape.frustum_ = frustum;
+    return shape;
+}
+
+OctreeCullingShape OctreeCullingShape::FromSphere(const Sphere& sphere)
+{
+    OctreeCullingShape shape;
+    shape.type_ = Type::Sphere;
+    shape.sphere_ = sphere;
+    return shape;
+}
+
+OctreeCullingShape OctreeCullingShape::FromBox(const BoundingBox& box)
+{
+    OctreeCullingShape shape;
+    shape.type_ = Type::Box;
+    shape.box_ = box;
+    return shape;
+}
+
+Intersection OctreeCullingShape::TestOctant(const BoundingBox& box, bool inside) const
+{
+    if (inside)
+        return INSIDE;
+
+    switch (type_)
+    {
+    case Type::Frustum:
+        return frustum_.IsInside(box);
+    case Type::Sphere:
+        return sphere_.IsInside(box);
+    case Type::Box:
+        return box_.IsInside(box);
+    default:
+        return INSIDE;
+    }
+}
+
+bool OctreeCullingShape::TestDrawable(const BoundingBox& box) const
+{
+    switch (type_)
+    {
+    case Type::Frustum:
+        return frustum_.IsInsideFast(box) != OUTSIDE;
+    case Type::Sphere:
+        return sphere_.IsInsideFast(box) != OUTSIDE;
+    case Type::Box:
+        return box_.IsInsideFast(box) != OUTSIDE;
+    default:
+        return true;
+    }
+}
+
+RayPacket::RayPacket(const Ray* rays, const float* maxDistances, unsigned numRays)
+    : numRays_(ea::min(numRays, MAX_RAYS))
+{
+    assert(numRays_ > 0);
+    for (unsigned i = 0; i < MAX_RAYS; ++i)
+    {
+        const unsigned index = ea::min(i, numRays_ - 1);
+        const Ray& ray = rays[index];
+        rays_[i] = ray;
+        maxDistances_[i] = maxDistances[index];
+        originX_[i] = ray.origin_.x_;
+        originY_[i] = ray.origin_.y_;
+        originZ_[i] = ray.origin_.z_;
+        directionX_[i] = ray.direction_.x_;
+        directionY_[i] = ray.direction_.y_;
+        directionZ_[i] = ray.direction_.z_;
+    }
+}
+
+unsigned RayPacket::HitDistance(const BoundingBox& box, float distances[MAX_RAYS]) const
+{
+    const unsigned raysMask = (1u << numRays_) - 1;
+    if (!box.Defined())
+    {
+        for (unsigned i = 0; i < MAX_RAYS; ++i)
+            distances[i] = M_INFINITY;
+        return 0;
+    }
+
+#ifdef URHO3D_SSE
+    const __m128 originX = _mm_loadu_ps(originX_);
+    const __m128 originY = _mm_loadu_ps(originY_);
+    const __m128 originZ = _mm_loadu_ps(originZ_);
+    const __m128 directionX = _mm_loadu_ps(directionX_);
+    const __m128 directionY = _mm_loadu_ps(directionY_);
+    const __m128 directionZ = _mm_loadu_ps(directionZ_);
+    const __m128 minX = _mm_set1_ps(box.min_.x_);
+    const __m128 minY = _mm_set1_ps(box.min_.y_);
+    const __m128 minZ = _mm_set1_ps(box.min_.z_);
+    const __m128 maxX = _mm_set1_ps(box.max_.x_);
+    const __m128 maxY = _mm_set1_ps(box.max_.y_);
+    const __m128 maxZ = _mm_set1_ps(box.max_.z_);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 distance = _mm_set1_ps(M_INFINITY);
+    distance = HitBoxFace(distance,
+        _mm_and_ps(_mm_cmplt_ps(originX, minX), _mm_cmpgt_ps(directionX, zero)),
+        _mm_div_ps(_mm_sub_ps(minX, originX), directionX),
+        originY, directionY, minY, maxY, originZ, directionZ, minZ, maxZ);
+    distance = HitBoxFace(distance,
+        _mm_and_ps(_mm_cmpgt_ps(originX, maxX), _mm_cmplt_ps(directionX, zero)),
+        _mm_div_ps(_mm_sub_ps(maxX, originX), directionX),
+        originY, directionY, minY, maxY, originZ, directionZ, minZ, maxZ);
+    distance = HitBoxFace(distance,
+        _mm_and_ps(_mm_cmplt_ps(originY, minY), _mm_cmpgt_ps(directionY, zero)),
+        _mm_div_ps(_mm_sub_ps(minY, originY), directionY),
+        originX, directionX, minX, maxX, originZ, directionZ, minZ, maxZ);
+    distance = HitBoxFace(distance,
+        _mm_and_ps(_mm_cmpgt_ps(originY, maxY), _mm_cmplt_ps(directionY, zero)),
+        _mm_div_ps(_mm_sub_ps(maxY, originY), directionY),
+        originX, directionX, minX, maxX, originZ, directionZ, minZ, maxZ);
+    distance = HitBoxFace(distance,
+        _mm_and_ps(_mm_cmplt_ps(originZ, minZ), _mm_cmpgt_ps(directionZ, zero)),
+        _mm_div_ps(_mm_sub_ps(minZ, originZ), directionZ),
+        originX, directionX, minX, maxX, originY, directionY, minY, maxY);
+    distance = HitBoxFace(distance,
+        _mm_and_ps(_mm_cmpgt_ps(originZ, maxZ), _mm_cmplt_ps(directionZ, zero)),
+        _mm_div_ps(_mm_sub_ps(maxZ, originZ), directionZ),
+        originX, directionX, minX, maxX, originY, directionY, minY, maxY);
+
+    // Ray origin inside the box
+    const __m128 outside = _mm_or_ps(
+        _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(originX, minX), _mm_cmpgt_ps(originX, maxX)),
+            _mm_or_ps(_mm_cmplt_ps(originY, minY), _mm_cmpgt_ps(originY, maxY))),
+        _mm_or_ps(_mm_cmplt_ps(originZ, minZ), _mm_cmpgt_ps(originZ, maxZ)));
+    distance = _mm_and_ps(outside, distance);
+
+    _mm_storeu_ps(distances, distance);
+    return raysMask & _mm_movemask_ps(_mm_cmplt_ps(distance, _mm_loadu_ps(maxDistances_)));
+#else
+    unsigned hitMask = 0;
+    for (unsigned i = 0; i < MAX_RAYS; ++i)
+    {
+        distances[i] = rays_[i].HitDistance(box);
+        if (distances[i] < maxDistances_[i])
+            hitMask |= 1u << i;
+    }
+    return raysMask & hitMask;
+#endif
+}
+
+void DrawableCullingData::Add(const BoundingBox& box, DrawableFlags drawableFlags, unsigned viewMask)
+{
+    minX_.push_back(box.min_.x_);
+    minY_.push_back(box.min_.y_);
+    minZ_.push_back(box.min_.z_);
+    maxX_.push_back(box.max_.x_);
+    maxY_.push_back(box.max_.y_);
+    maxZ_.push_back(box.max_.z_);
+    viewMasks_.push_back(viewMask);
+    flags_.push_back(drawableFlags.AsInteger());
+}
+
+void DrawableCullingData::Remove(unsigned index)
+{
+    minX_.erase_at(index);
+    minY_.erase_at(index);
+    minZ_.erase_at(index);
+    maxX_.erase_at(index);
+    maxY_.erase_at(index);
+    maxZ_.erase_at(index);
+    viewMasks_.erase_at(index);
+    flags_.erase_at(index);
+}
+
+void DrawableCullingData::Clear()
+{
+    minX_.clear();
+    minY_.clear();
+    minZ_.clear();
+    maxX_.clear();
+    maxY_.clear();
+    maxZ_.clear();
+    viewMasks_.clear();
+    flags_.clear();
+}
+
+void DrawableCullingData::Update(unsigned index, const BoundingBox& box, unsigned viewMask)
+{
+    minX_[index] = box.min_.x_;
+    minY_[index] = box.min_.y_;
+    minZ_[index] = box.min_.z_;
+    maxX_[index] = box.max_.x_;
+    maxY_[index] = box.max_.y_;
+    maxZ_[index] = box.max_.z_;
+    viewMasks_[index] = viewMask;
+    flags_[index] &= ~BOUNDING_BOX_DIRTY;
+}
+
+BoundingBox DrawableCullingData::GetBoundingBox(unsigned index) const
+{
+    return BoundingBox{Vector3{minX_[index], minY_[index], minZ_[index]}, Vector3{maxX_[index], maxY_[index], maxZ_[index]}};
+}
+
+unsigned DrawableCullingData::TestBatch(const OctreeCullingShape& shape, unsigned index) const
+{
+#ifdef URHO3D_SSE
+    BoundingBoxBatch boxes;
+    boxes.minX_ = _mm_loadu_ps(&minX_[index]);
+    boxes.minY_ = _mm_loadu_ps(&minY_[index]);
+    boxes.minZ_ = _mm_loadu_ps(&minZ_[index]);
+    boxes.maxX_ = _mm_loadu_ps(&maxX_[index]);
+    boxes.maxY_ = _mm_loadu_ps(&maxY_[index]);
+    boxes.maxZ_ = _mm_loadu_ps(&maxZ_[index]);
+
+    switch (shape.type_)
+    {
+    case OctreeCullingShape::Type::Frustum:
+        return _mm_movemask_ps(IsOutsideFrustum(shape.frustum_, boxes));
+    case OctreeCullingShape::Type::Sphere:
+        return _mm_movemask_ps(IsOutsideSphere(shape.sphere_, boxes));
+    case OctreeCullingShape::Type::Box:
+        return _mm_movemask_ps(IsOutsideBox(shape.box_, boxes));
+    default:
+        return 0;
+    }
+#else
+    unsigned outsideMask = 0;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (!shape.TestDrawable(GetBoundingBox(index + i)))
+            outsideMask |= 1u << i;
+    }
+    return outsideMask;
+#endif
+}
+
+void DrawableCullingData::Cull(const OctreeCullingShape& shape, bool inside, DrawableFlags drawableFlags,
+    unsigned viewMask, Drawable* const* drawables, ea::vector<Drawable*>& result) const
+{
+    CullRange(shape, inside, drawableFlags, viewMask, drawables, 0, GetSize(), result);
+}
+
+void DrawableCullingData::CullRange(const OctreeCullingShape& shape, bool inside, DrawableFlags drawableFlags,
+    unsigned viewMask, Drawable* const* drawables, unsigned beginIndex, unsigned endIndex,
+    ea::vector<Drawable*>& result) const
+{
+    const unsigned flagsMask = drawableFlags.AsInteger();
+    for (unsigned batchIndex = beginIndex; batchIndex < endIndex; batchIndex += 4)
+    {
+        const unsigned batchSize = ea::min(endIndex - batchIndex, 4u);
+
+        // Incomplete batch is tested per drawable
+        unsigned outsideMask = 0;
+        if (!inside && batchSize == 4)
+            outsideMask = TestBatch(shape, batchIndex);
+
+        for (unsigned i = 0; i < batchSize; ++i)
+        {
+            const unsigned index = batchIndex + i;
+            const unsigned flags = flags_[index];
+            if (!(flags & flagsMask) || !(viewMasks_[index] & viewMask))
+                continue;
+
+            if (!inside && (batchSize != 4 || (flags & BOUNDING_BOX_DIRTY)))
+            {
+                // Drawable may have been moved after the last octree update, use actual bounding box
+                Drawable* drawable = drawables[index];
+                const BoundingBox& box = (flags & BOUNDING_BOX_DIRTY) ? drawable->GetWorldBoundingBox() : GetBoundingBox(index);
+                if (shape.TestDrawable(box))
+                    result.push_back(drawable);
+            }
+            else if (!(outsideMask & (1u << i)))
+                result.push_back(drawables[index]);
+        }
+    }
+}
+
+}
@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Graphics/Drawable.h"
+#include "../Math/BoundingBox.h"
+#include "../Math/Frustum.h"
+#include "../Math/Ray.h"
+#include "../Math/Sphere.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+/// Shape tested by vectorized octree culling.
+struct URHO3D_API OctreeCullingShape
+{
+    /// Type of the shape.
+    enum class Type
+    {
+        Frustum,
+        Sphere,
+        Box
+    };
+
+    /// Construct frustum shape.
+    static OctreeCullingShape FromFrustum(const Frustum& frustum);
+    /// Construct sphere shape.
+    static OctreeCullingShape FromSphere(const Sphere& sphere);
+    /// Construct box shape.
+    static OctreeCullingShape FromBox(const BoundingBox& box);
+
+    /// Intersection test for an octant. Same as in corresponding OctreeQuery.
+    Intersection TestOctant(const BoundingBox& box, bool inside) const;
+    /// Intersection test for a drawable bounding box. Same as in corresponding OctreeQuery.
+    bool TestDrawable(const BoundingBox& box) const;
+
+    /// Type.
+    Type type_{};
+    /// Frustum.
+    Frustum frustum_;
+    /// Sphere.
+    Sphere sphere_;
+    /// Box.
+    BoundingBox box_;
+};
+
+/// Drawable which bounding box is hit by ray, with hit distance.
+using RayHitCandidate = ea::pair<float, Drawable*>;
+
+/// Packet of rays tested against bounding boxes at once.
+struct URHO3D_API RayPacket
+{
+    /// Max number of rays in packet.
+    static const unsigned MAX_RAYS = 4;
+
+    /// Construct empty.
+    RayPacket() = default;
+    /// Construct from rays and maximum distances of rays.
+    RayPacket(const Ray* rays, const float* maxDistances, unsigned numRays);
+
+    /// Calculate hit distances to the bounding box, same as Ray::HitDistance.
+    /// Return mask of rays that hit the box closer than their maximum distance.
+    unsigned HitDistance(const BoundingBox& box, float distances[MAX_RAYS]) const;
+
+    /// Number of rays.
+    unsigned numRays_{};
+    /// Rays.
+    Ray rays_[MAX_RAYS];
+    /// Maximum distances of rays.
+    float maxDistances_[MAX_RAYS]{};
+    /// Ray origin and direction components. Unused elements repeat the last ray.
+    /// @{
+    float originX_[MAX_RAYS]{};
+    float originY_[MAX_RAYS]{};
+    float originZ_[MAX_RAYS]{};
+    float directionX_[MAX_RAYS]{};
+    float directionY_[MAX_RAYS]{};
+    float directionZ_[MAX_RAYS]{};
+    /// @}
+};
+
+/// Culling data of drawables in the octant, stored as structure of arrays to test several bounding boxes at once.
+/// Elements are stored in the same order as drawables.
+class URHO3D_API DrawableCullingData
+{
+public:
+    /// Add drawable.
+    void Add(const BoundingBox& box, DrawableFlags drawableFlags, unsigned viewMask);
+    /// Remove drawable preserving order of other drawables.
+    void Remove(unsigned index);
+    /// Remove all drawables.
+    void Clear();
+    /// Update bounding box and view mask of the drawable.
+    void Update(unsigned index, const BoundingBox& box, unsigned viewMask);
+    /// Update view mask of the drawable.
+    void SetViewMask(unsigned index, unsigned viewMask) { viewMasks_[index] = viewMask; }
+    /// Mark bounding box as outdated. Culling will read actual bounding box from the drawable until it's updated.
+    /// May be called from any thread, doesn't change the layout.
+    void MarkBoundingBoxDirty(unsigned index) { flags_[index] |= BOUNDING_BOX_DIRTY; }
+
+    /// Test drawables against the shape and append visible ones to the result.
+    void Cull(const OctreeCullingShape& shape, bool inside, DrawableFlags drawableFlags, unsigned viewMask,
+        Drawable* const* drawables, ea::vector<Drawable*>& result) const;
+    /// Test range of drawables against the shape and append visible ones to the result.
+    /// Outdated bounding boxes are evaluated by drawables, so they should be resolved before culling from worker threads.
+    void CullRange(const OctreeCullingShape& shape, bool inside, DrawableFlags drawableFlags, unsigned viewMask,
+        Drawable* const* drawables, unsigned beginIndex, unsigned endIndex, ea::vector<Drawable*>& result) const;
+
+    /// Return number of drawables.
+    unsigned GetSize() const { return flags_.size(); }
+    /// Return bounding box of the drawable.
+    BoundingBox GetBoundingBox(unsigned index) const;
+    /// Return whether the bounding box of the drawable is outdated.
+    bool IsBoundingBoxDirty(unsigned index) const { return !!(flags_[index] & BOUNDING_BOX_DIRTY); }
+
+private:
+    /// Flag that indicates that the bounding box is outdated.
+    static const unsigned BOUNDING_BOX_DIRTY = 1u << 31u;
+
+    /// Test 4 drawables starting from the index against the shape. Return mask of drawables outside of the shape.
+    unsigned TestBatch(const OctreeCullingShape& shape, unsigned index) const;
+
+    /// Bounding box components.
+    /// @{
+    ea::vector<float> minX_;
+    ea::vector<float> minY_;
+    ea::vector<float> minZ_;
+    ea::vector<float> maxX_;
+    ea::vector<float> maxY_;
+    ea::vector<float> maxZ_;
+    /// @}
+    /// View masks.
+    ea::vector<unsigned> viewMasks_;
+    /// Drawable flags and dirty flag.
+    ea::vector<unsigned> flags_;
+};
+
+}
@@ -31,6 +31,8 @@
 #include "../Math/Ray.h"
 #include "../Math/Sphere.h"
 
+#include <EASTL/span.h>
+
 namespace Urho3D
 {
 
@@ -264,6 +266,45 @@ private:
     ea::vector<RayQueryResult> resultStorage_;
 };
 
+/// Raycast octree query for many rays at once. Only the closest hit is returned for each ray.
+/// @nobind
+class URHO3D_API BatchedRayOctreeQuery : private NonCopyable
+{
+public:
+    /// Construct with rays, result storage and query parameters. Results should have the same size as rays.
+    BatchedRayOctreeQuery(ea::span<const Ray> rays, ea::span<RayQueryResult> results, RayQueryLevel level = RAY_TRIANGLE,
+        float maxDistance = M_INFINITY, DrawableFlags drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) :
+        rays_(rays),
+        results_(results),
+        drawableFlags_(drawableFlags),
+        viewMask_(viewMask),
+        maxDistance_(maxDistance),
+        level_(level)
+    {
+    }
+
+    /// Return maximum distance for the ray.
+    float GetMaxDistance(unsigned index) const
+    {
+        return maxDistances_.empty() ? maxDistance_ : Min(maxDistances_[index], maxDistance_);
+    }
+
+    /// Rays.
+    ea::span<const Ray> rays_;
+    /// Closest hits for each ray. Drawable is null if the ray hit nothing.
+    ea::span<RayQueryResult> results_;
+    /// Optional maximum distances for each ray, used to query segments.
+    ea::span<const float> maxDistances_;
+    /// Drawable flags to include.
+    DrawableFlags drawableFlags_;
+    /// Drawable layers to include.
+    unsigned viewMask_;
+    /// Maximum ray distance.
+    float maxDistance_;
+    /// Raycast detail level.
+    RayQueryLevel level_;
+};
+
 /// @nobind
 class URHO3D_API AllContentOctreeQuery : public OctreeQuery
 {
@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Graphics/OctreeCulling.h"
+#include "../Graphics/OctreeQuery.h"
+
+namespace Urho3D
+{
+
+/// Spatial index used by Octree to store and query drawables instead of octants.
+/// Octree keeps ownership of drawables and forwards all changes and queries to the index.
+class URHO3D_API SpatialIndex
+{
+public:
+    /// Destruct.
+    virtual ~SpatialIndex() = default;
+
+    /// Add drawable.
+    virtual void AddDrawable(Drawable* drawable) = 0;
+    /// Remove drawable.
+    virtual void RemoveDrawable(Drawable* drawable) = 0;
+    /// Update drawable after its bounding box has changed.
+    virtual void UpdateDrawable(Drawable* drawable) = 0;
+    /// Commit all updates. Called from main thread on every Octree update.
+    virtual void Commit() = 0;
+
+    /// Return drawable objects by a query.
+    virtual void GetDrawables(OctreeQuery& query) const = 0;
+    /// Return drawable objects inside or intersecting the shape.
+    virtual void GetDrawables(const OctreeCullingShape& shape, DrawableFlags drawableFlags, unsigned viewMask,
+        ea::vector<Drawable*>& result) const = 0;
+    /// Return drawable objects by a ray query. Results are not sorted.
+    virtual void Raycast(RayOctreeQuery& query) const = 0;
+    /// Return drawable objects whose bounding boxes may be hit by a ray, without processing the ray query.
+    virtual void GetDrawablesOnly(RayOctreeQuery& query, ea::vector<Drawable*>& result) const = 0;
+};
+
+}
@@ -78,7 +78,7 @@ void Zone::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE_EX("Ambient Color", Color, ambientColor_, MarkCachedAmbientDirty, DEFAULT_AMBIENT_COLOR, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Ambient Brightness", float, ambientBrightness_, MarkCachedAmbientDirty, 1.0f, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Background Brightness", float, backgroundBrightness_, MarkCachedAmbientDirty, 0.0f, AM_DEFAULT);
-    URHO3D_ATTRIBUTE("Is Background Static", bool, backgroundStatic_, false, AM_DEFAULT);
+    URHO3D_ATTRIBUTE_EX("Is Background Static", bool, backgroundStatic_, MarkCachedAmbientDirty, false, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Fog Color", Color, fogColor_, MarkCachedAmbientDirty, DEFAULT_FOG_COLOR, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Fog Start", float, fogStart_, DEFAULT_FOG_START, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Fog End", float, fogEnd_, DEFAULT_FOG_END, AM_DEFAULT);
@@ -128,6 +128,7 @@ void Zone::SetBackgroundBrightness(float brightness)
 void Zone::SetBackgroundStatic(bool isStatic)
 {
     backgroundStatic_ = isStatic;
+    MarkCachedAmbientDirty();
 }
 
 void Zone::SetFogColor(const Color& color)
@@ -455,12 +456,14 @@ void Zone::MarkCachedAmbientDirty()
 {
     cachedAmbientLighting_.Invalidate();
     cachedAmbientAndBackgroundLighting_.Invalidate();
+    ++lightingRevision_;
 }
 
 void Zone::MarkCachedTextureDirty()
 {
     cachedTextureLighting_.Invalidate();
     reflectionProbeData_.Invalidate();
+    ++lightingRevision_;
 }
 
 }
@@ -117,6 +117,8 @@ public:
 
     /// Return zone's ambient and background light in linear space.
     const SphericalHarmonicsDot9 GetAmbientAndBackgroundLighting() const;
+    /// Return revision of ambient lighting. Changes whenever ambient or background lighting may change.
+    unsigned GetLightingRevision() const { return lightingRevision_; }
 
     /// Return ambient start color. Not safe to call from worker threads due to possible octree query.
     /// @property
@@ -244,6 +246,8 @@ protected:
     mutable ThreadSafeCache<SphericalHarmonicsDot9> cachedTextureLighting_;
     mutable ThreadSafeCache<SphericalHarmonicsDot9> cachedAmbientAndBackgroundLighting_;
     /// @}
+    /// Revision of ambient lighting.
+    unsigned lightingRevision_{};
 };
 
 }
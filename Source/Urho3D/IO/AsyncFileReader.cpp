@@ -0,0 +1,625 @@
+//
+// Copyright (c) 2022-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../IO/AsyncFileReader.h"
+
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+
+#if defined(__linux__) && !defined(__ANDROID__) && __has_include(<linux/io_uring.h>)
+    #define URHO3D_IO_URING
+#endif
+
+#ifdef URHO3D_IO_URING
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Storage of file data read asynchronously, initialized before MemoryBuffer that references it.
+struct AsyncReadData
+{
+    ByteVector data_;
+};
+
+/// File read asynchronously.
+class AsyncReadBuffer : public RefCounted, private AsyncReadData, public MemoryBuffer
+{
+public:
+    AsyncReadBuffer(ByteVector&& data, const ea::string& name, const ea::string& absoluteName)
+        : AsyncReadData{ea::move(data)}
+        , MemoryBuffer(data_)
+        , absoluteName_(absoluteName)
+    {
+        SetName(name);
+    }
+
+    /// Return absolute name of the file the data was read from.
+    const ea::string& GetAbsoluteName() const override { return absoluteName_; }
+
+    /// Return checksum of the data, same as File::GetChecksum would.
+    unsigned GetChecksum() override
+    {
+        if (!checksum_)
+        {
+            for (unsigned char value : data_)
+                checksum_ = SDBMHash(checksum_, value);
+        }
+        return checksum_;
+    }
+
+private:
+    ea::string absoluteName_;
+    unsigned checksum_{};
+};
+
+}
+
+struct AsyncFileReader::Request
+{
+    /// Request description.
+    AsyncReadRequest desc_;
+    /// File data.
+    ByteVector data_;
+    /// File with data already in memory.
+    AbstractFilePtr file_;
+    /// Absolute name of the file.
+    ea::string absoluteName_;
+    /// Number of bytes read by the ring.
+    unsigned bytesRead_{};
+    /// File descriptor for ring reads.
+    int fd_{-1};
+#ifdef URHO3D_IO_URING
+    /// Destination of ring read.
+    iovec iovec_{};
+#endif
+};
+
+#ifdef URHO3D_IO_URING
+/// Minimal io_uring wrapper. Submission queue should be accessed by one thread at a time,
+/// completion queue should be accessed only by one thread.
+class AsyncFileReader::Ring
+{
+public:
+    ~Ring()
+    {
+        if (sqes_)
+            munmap(sqes_, sqesSize_);
+        if (cqRing_ && cqRing_ != sqRing_)
+            munmap(cqRing_, cqRingSize_);
+        if (sqRing_)
+            munmap(sqRing_, sqRingSize_);
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    /// Create the ring. Return false if io_uring is not supported.
+    bool Initialize(unsigned numEntries)
+    {
+        io_uring_params params{};
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, numEntries, &params));
+        if (fd_ < 0)
+            return false;
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+
+        bool singleMap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+        singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap)
+            sqRingSize_ = cqRingSize_ = ea::max(sqRingSize_, cqRingSize_);
+#endif
+
+        sqRing_ = Map(sqRingSize_, IORING_OFF_SQ_RING);
+        cqRing_ = singleMap ? sqRing_ : Map(cqRingSize_, IORING_OFF_CQ_RING);
+        sqes_ = static_cast<io_uring_sqe*>(Map(sqesSize_, IORING_OFF_SQES));
+        if (!sqRing_ || !cqRing_ || !sqes_)
+            return false;
+
+        auto sqRing = static_cast<unsigned char*>(sqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sqRing + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sqRing + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sqRing + params.sq_off.array);
+        sqEntries_ = params.sq_entries;
+        localTail_ = *sqTail_;
+        submittedTail_ = localTail_;
+
+        auto cqRing = static_cast<unsigned char*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cqRing + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cqRing + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cqRing + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+        return true;
+    }
+
+    /// Return max number of simultaneous reads.
+    unsigned GetNumEntries() const { return sqEntries_; }
+
+    /// Queue vectored read. Return false if submission queue is full.
+    bool QueueRead(int fd, iovec* destination, uint64_t offset, void* userData)
+    {
+        io_uring_sqe* sqe = GetSqe();
+        if (!sqe)
+            return false;
+
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(destination);
+        sqe->len = 1;
+        sqe->off = offset;
+        sqe->user_data = reinterpret_cast<uint64_t>(userData);
+        return true;
+    }
+
+    /// Queue no-op that wakes up waiting thread.
+    bool QueueWakeUp()
+    {
+        io_uring_sqe* sqe = GetSqe();
+        if (!sqe)
+            return false;
+
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = 0;
+        return true;
+    }
+
+    /// Submit queued entries to the kernel. On failure, entries that were not submitted are discarded
+    /// and their number is returned in numDiscarded.
+    bool Submit(unsigned* numDiscarded = nullptr)
+    {
+        __atomic_store_n(sqTail_, localTail_, __ATOMIC_RELEASE);
+        while (submittedTail_ != localTail_)
+        {
+            const int result = Enter(localTail_ - submittedTail_, 0, 0);
+            if (result < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    continue;
+
+                // Kernel consumes submission queue only on enter, so remaining entries can be taken back
+                if (numDiscarded)
+                    *numDiscarded = localTail_ - submittedTail_;
+                localTail_ = submittedTail_;
+                __atomic_store_n(sqTail_, localTail_, __ATOMIC_RELEASE);
+                return false;
+            }
+            submittedTail_ += result;
+        }
+        return true;
+    }
+
+    /// Wait for at least one completion. Completions are returned as pairs of user data and result.
+    bool WaitCompletions(ea::vector<ea::pair<uint64_t, int>>& completions)
+    {
+        completions.clear();
+
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        while (head == tail)
+        {
+            if (Enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                return false;
+            tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        }
+
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe& cqe = cqes_[head & cqMask_];
+            completions.emplace_back(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    void* Map(size_t size, off_t offset) const
+    {
+        void* result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return result != MAP_FAILED ? result : nullptr;
+    }
+
+    int Enter(unsigned toSubmit, unsigned minComplete, unsigned flags) const
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd_, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    io_uring_sqe* GetSqe()
+    {
+        const unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (localTail_ - head >= sqEntries_)
+            return nullptr;
+
+        const unsigned index = localTail_ & sqMask_;
+        sqArray_[index] = index;
+        ++localTail_;
+
+        io_uring_sqe* sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(io_uring_sqe));
+        return sqe;
+    }
+
+    int fd_{-1};
+
+    void* sqRing_{};
+    void* cqRing_{};
+    io_uring_sqe* sqes_{};
+    size_t sqRingSize_{};
+    size_t cqRingSize_{};
+    size_t sqesSize_{};
+
+    unsigned* sqHead_{};
+    unsigned* sqTail_{};
+    unsigned* sqArray_{};
+    unsigned sqMask_{};
+    unsigned sqEntries_{};
+    unsigned localTail_{};
+    unsigned submittedTail_{};
+
+    unsigned* cqHead_{};
+    unsigned* cqTail_{};
+    unsigned cqMask_{};
+    io_uring_cqe* cqes_{};
+};
+#else
+class AsyncFileReader::Ring
+{
+};
+#endif
+
+AsyncFileReader::AsyncFileReader(Context* context, unsigned numThreads)
+    : Object(context)
+{
+#ifdef URHO3D_IO_URING
+    // io_uring may be unsupported by the kernel or disabled by the sandbox, silently fall back to threads
+    ring_ = ea::make_unique<Ring>();
+    if (ring_->Initialize(MAX_IO_QUEUE_DEPTH))
+        ringThread_ = std::thread([this] { RingCompletionLoop(); });
+    else
+        ring_ = nullptr;
+#endif
+
+    for (unsigned i = 0; i < ea::max(numThreads, 1u); ++i)
+        threads_.emplace_back([this] { ThreadLoop(); });
+
+    URHO3D_LOGDEBUG("Created asynchronous file reader with {} threads{}", threads_.size(), ring_ ? " and io_uring" : "");
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    WaitForCompletion();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        shutDown_ = true;
+    }
+    requestCondition_.notify_all();
+    for (std::thread& thread : threads_)
+        thread.join();
+
+#ifdef URHO3D_IO_URING
+    if (ring_)
+    {
+        {
+            std::unique_lock<std::mutex> lock(ringMutex_);
+            ring_->QueueWakeUp();
+            ring_->Submit();
+        }
+        ringThread_.join();
+    }
+#endif
+}
+
+void AsyncFileReader::Read(AsyncReadRequest request)
+{
+    auto requestPtr = ea::make_unique<Request>();
+    requestPtr->desc_ = ea::move(request);
+    QueueRequest(ea::move(requestPtr), true);
+}
+
+void AsyncFileReader::Read(ea::span<AsyncReadRequest> requests)
+{
+    for (AsyncReadRequest& request : requests)
+    {
+        auto requestPtr = ea::make_unique<Request>();
+        requestPtr->desc_ = ea::move(request);
+        QueueRequest(ea::move(requestPtr), false);
+    }
+    FlushRing();
+}
+
+void AsyncFileReader::WaitForCompletion()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    completionCondition_.wait(lock, [this] { return numPendingReads_ == 0; });
+}
+
+unsigned AsyncFileReader::GetNumPendingReads() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return numPendingReads_;
+}
+
+void AsyncFileReader::QueueRequest(ea::unique_ptr<Request> request, bool flush)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++numPendingReads_;
+    }
+
+#ifdef URHO3D_IO_URING
+    const NativeFileRegion& region = request->desc_.region_;
+    if (ring_ && !region.IsEmpty())
+    {
+        // Files that cannot be opened directly are read by threads, e.g. Android assets
+        const int fd = open(GetNativePath(region.fileName_).c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat fileStat{};
+        if (fd >= 0 && fstat(fd, &fileStat) == 0 && region.offset_ <= fileStat.st_size)
+        {
+            const auto maxSize = static_cast<unsigned>(ea::min<int64_t>(fileStat.st_size - region.offset_, M_MAX_UNSIGNED));
+            request->fd_ = fd;
+            request->absoluteName_ = region.fileName_;
+            request->data_.resize(ea::min(region.size_, maxSize));
+            if (request->data_.empty())
+            {
+                close(fd);
+                request->fd_ = -1;
+                CompleteRequest(ea::move(request), true);
+                return;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(ringMutex_);
+                ringRequests_.push_back(request.release());
+            }
+
+            if (flush)
+                FlushRing();
+            return;
+        }
+
+        if (fd >= 0)
+            close(fd);
+    }
+#endif
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        requests_.push_back(ea::move(request));
+    }
+    requestCondition_.notify_one();
+}
+
+void AsyncFileReader::FlushRing()
+{
+#ifdef URHO3D_IO_URING
+    if (!ring_)
+        return;
+
+    ea::vector<Request*> failedRequests;
+    {
+        std::unique_lock<std::mutex> lock(ringMutex_);
+        if (ringRequests_.empty())
+            return;
+
+        // Keep the number of reads in flight below ring size so completion queue never overflows
+        unsigned numQueued = 0;
+        while (numQueued < ringRequests_.size() && numRingReads_ + numQueued < ring_->GetNumEntries())
+        {
+            Request* request = ringRequests_[numQueued];
+            request->iovec_.iov_base = request->data_.data() + request->bytesRead_;
+            request->iovec_.iov_len = request->data_.size() - request->bytesRead_;
+            const uint64_t offset = request->desc_.region_.offset_ + static_cast<uint64_t>(request->bytesRead_);
+            if (!ring_->QueueRead(request->fd_, &request->iovec_, offset, request))
+                break;
+            ++numQueued;
+        }
+
+        unsigned numDiscarded = 0;
+        if (!ring_->Submit(&numDiscarded))
+            URHO3D_LOGERROR("Failed to submit asynchronous reads");
+
+        // Reads are submitted in order, so discarded reads are the last queued ones
+        const unsigned numSubmitted = numQueued - numDiscarded;
+        ringRequests_.erase(ringRequests_.begin(), ringRequests_.begin() + numSubmitted);
+        numRingReads_ += numSubmitted;
+        for (unsigned i = 0; i < numDiscarded; ++i)
+        {
+            failedRequests.push_back(ringRequests_.front());
+            ringRequests_.pop_front();
+        }
+    }
+
+    // Complete outside of the lock because callbacks may queue new reads
+    for (Request* request : failedRequests)
+    {
+        close(request->fd_);
+        request->fd_ = -1;
+        URHO3D_LOGERROR("Failed to read file {} asynchronously", request->absoluteName_);
+        CompleteRequest(ea::unique_ptr<Request>(request), false);
+    }
+#endif
+}
+
+void AsyncFileReader::ThreadLoop()
+{
+    while (true)
+    {
+        ea::unique_ptr<Request> request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            requestCondition_.wait(lock, [this] { return shutDown_ || !requests_.empty(); });
+            if (requests_.empty())
+                return;
+
+            request = ea::move(requests_.front());
+            requests_.pop_front();
+        }
+
+        const bool success = ExecuteRequest(*request);
+        CompleteRequest(ea::move(request), success);
+    }
+}
+
+void AsyncFileReader::RingCompletionLoop()
+{
+#ifdef URHO3D_IO_URING
+    ea::vector<ea::pair<uint64_t, int>> completions;
+    while (true)
+    {
+        if (!ring_->WaitCompletions(completions))
+        {
+            URHO3D_LOGERROR("Failed to wait for asynchronous reads");
+            return;
+        }
+
+        bool wokenUp = false;
+        for (const auto& [userData, result] : completions)
+        {
+            if (!userData)
+            {
+                wokenUp = true;
+                continue;
+            }
+
+            auto request = reinterpret_cast<Request*>(userData);
+            {
+                std::unique_lock<std::mutex> lock(ringMutex_);
+                --numRingReads_;
+
+                // Resubmit interrupted and partial reads
+                if (result == -EAGAIN || result == -EINTR || (result > 0 && request->bytesRead_ + result < request->data_.size()))
+                {
+                    request->bytesRead_ += ea::max(result, 0);
+                    ringRequests_.push_front(request);
+                    continue;
+                }
+            }
+
+            request->bytesRead_ += ea::max(result, 0);
+            close(request->fd_);
+            request->fd_ = -1;
+
+            const bool success = result >= 0 && request->bytesRead_ == request->data_.size();
+            if (!success)
+                URHO3D_LOGERROR("Failed to read file {} asynchronously", request->absoluteName_);
+            CompleteRequest(ea::unique_ptr<Request>(request), success);
+        }
+
+        FlushRing();
+
+        // Wake-up is sent only on destruction when there are no reads in progress
+        if (wokenUp)
+            return;
+    }
+#endif
+}
+
+bool AsyncFileReader::ExecuteRequest(Request& request)
+{
+    const NativeFileRegion& region = request.desc_.region_;
+    if (!region.IsEmpty())
+    {
+        File file(context_);
+        if (!file.Open(region.fileName_) || region.offset_ > file.GetSize())
+            return false;
+
+        const unsigned size = ea::min(region.size_, file.GetSize() - region.offset_);
+        request.data_.resize(size);
+        request.absoluteName_ = file.GetAbsoluteName();
+        file.Seek(region.offset_);
+        if (file.Read(request.data_.data(), size) != size)
+        {
+            URHO3D_LOGERROR("Failed to read file {} asynchronously", request.absoluteName_);
+            return false;
+        }
+        return true;
+    }
+    else if (request.desc_.openFile_)
+    {
+        AbstractFilePtr file = request.desc_.openFile_();
+        if (!file)
+            return false;
+
+        // Files in memory don't need to be copied
+        const unsigned size = file->GetSize();
+        if (file->ReadInPlace(size))
+        {
+            file->Seek(0);
+            request.file_ = file;
+            return true;
+        }
+
+        request.data_.resize(size);
+        request.absoluteName_ = file->GetAbsoluteName();
+        if (request.desc_.name_.empty())
+            request.desc_.name_ = file->GetName();
+        if (file->Read(request.data_.data(), size) != size)
+        {
+            URHO3D_LOGERROR("Failed to read file {} asynchronously", request.absoluteName_);
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+void AsyncFileReader::CompleteRequest(ea::unique_ptr<Request> request, bool success)
+{
+    AbstractFilePtr file = request->file_;
+    if (!file && success)
+    {
+        file = AbstractFilePtr(MakeShared<AsyncReadBuffer>(
+            ea::move(request->data_), request->desc_.name_, request->absoluteName_));
+    }
+
+    if (request->desc_.callback_)
+        request->desc_.callback_(file);
+    request = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        --numPendingReads_;
+    }
+    completionCondition_.notify_all();
+}
+
+}
@@ -0,0 +1,148 @@
+//
+// Copyright (c) 2022-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/ByteVector.h"
+#include "../Core/Object.h"
+#include "../IO/AbstractFile.h"
+
+#include <EASTL/deque.h>
+#include <EASTL/functional.h>
+#include <EASTL/span.h>
+#include <EASTL/unique_ptr.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Urho3D
+{
+
+/// Default number of threads used by AsyncFileReader to execute blocking reads.
+static const unsigned DEFAULT_NUM_IO_THREADS = 8;
+/// Max number of reads submitted to the kernel simultaneously.
+static const unsigned MAX_IO_QUEUE_DEPTH = 256;
+
+/// Callback of asynchronous read. Called from I/O thread. File is null if the file cannot be read.
+using AsyncReadCallback = ea::function<void(AbstractFilePtr file)>;
+
+/// Region of a file on disk that stores the contents of a file as is.
+struct URHO3D_API NativeFileRegion
+{
+    /// Return whether the region is empty.
+    bool IsEmpty() const { return fileName_.empty(); }
+
+    /// Name of the file on disk.
+    ea::string fileName_;
+    /// Offset of the contents in the file.
+    unsigned offset_{};
+    /// Size of the contents. M_MAX_UNSIGNED means the rest of the file.
+    unsigned size_{M_MAX_UNSIGNED};
+};
+
+/// Request of asynchronous read.
+struct URHO3D_API AsyncReadRequest
+{
+    /// Region of the file on disk to read. Used if not empty.
+    NativeFileRegion region_;
+    /// Function that opens the file. Called from I/O thread if region is empty, e.g. for compressed files.
+    ea::function<AbstractFilePtr()> openFile_;
+    /// Name of the resulting file.
+    ea::string name_;
+    /// Callback called when the read is completed.
+    AsyncReadCallback callback_;
+};
+
+/// Batched asynchronous file reader.
+/// File regions are read via io_uring on Linux if supported by the kernel, many reads may be in progress simultaneously.
+/// Other reads and all reads on other platforms are executed by the pool of I/O threads.
+/// @nobind
+class URHO3D_API AsyncFileReader : public Object
+{
+    URHO3D_OBJECT(AsyncFileReader, Object);
+
+public:
+    /// Construct.
+    explicit AsyncFileReader(Context* context, unsigned numThreads = DEFAULT_NUM_IO_THREADS);
+    /// Destruct. Wait for all pending reads to complete.
+    ~AsyncFileReader() override;
+
+    /// Submit read request.
+    void Read(AsyncReadRequest request);
+    /// Submit a batch of read requests. Requests are moved from.
+    void Read(ea::span<AsyncReadRequest> requests);
+    /// Wait until all pending reads are completed.
+    void WaitForCompletion();
+
+    /// Return number of reads in progress.
+    unsigned GetNumPendingReads() const;
+    /// Return whether io_uring is used.
+    bool IsUsingIoUring() const { return ring_ != nullptr; }
+
+private:
+    struct Request;
+    class Ring;
+
+    /// Queue request to be executed. Submit reads to the kernel if flush is requested.
+    void QueueRequest(ea::unique_ptr<Request> request, bool flush);
+    /// Submit queued ring reads to the kernel.
+    void FlushRing();
+    /// Execute blocking reads in the I/O thread.
+    void ThreadLoop();
+    /// Process ring completions in the I/O thread.
+    void RingCompletionLoop();
+    /// Execute blocking read. Return whether the file was read.
+    bool ExecuteRequest(Request& request);
+    /// Finish the request and invoke the callback.
+    void CompleteRequest(ea::unique_ptr<Request> request, bool success);
+
+    /// Mutex for request queues.
+    mutable std::mutex mutex_;
+    /// Condition of new blocking reads.
+    std::condition_variable requestCondition_;
+    /// Condition of completed reads.
+    std::condition_variable completionCondition_;
+    /// Blocking reads.
+    ea::deque<ea::unique_ptr<Request>> requests_;
+    /// Number of reads in progress.
+    unsigned numPendingReads_{};
+    /// Whether the reader is being destroyed.
+    bool shutDown_{};
+    /// I/O threads.
+    ea::vector<std::thread> threads_;
+
+    /// io_uring, if supported.
+    ea::unique_ptr<Ring> ring_;
+    /// Mutex for ring submission.
+    std::mutex ringMutex_;
+    /// Ring reads not submitted to the kernel yet.
+    ea::deque<Request*> ringRequests_;
+    /// Number of reads submitted to the kernel.
+    unsigned numRingReads_{};
+    /// Thread that processes ring completions.
+    std::thread ringThread_;
+};
+
+}
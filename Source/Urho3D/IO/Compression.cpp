@@ -23,9 +23,11 @@
 #include "../Precompiled.h"
 
 #include <EASTL/shared_array.h>
+#include <EASTL/unordered_map.h>
 
 #include "../IO/Compression.h"
 #include "../IO/Deserializer.h"
+#include "../IO/MemoryBuffer.h"
 #include "../IO/Serializer.h"
 #include "../IO/VectorBuffer.h"
 
@@ -35,6 +37,41 @@
 namespace Urho3D
 {
 
+namespace
+{
+
+/// Minimal length of byte sequence copied from base data in binary delta.
+const unsigned DELTA_WINDOW_SIZE = 32;
+/// Multiplier of rolling hash used to find matching sequences.
+const unsigned DELTA_HASH_MULTIPLIER = 16777619u;
+
+unsigned HashDeltaWindow(const unsigned char* data)
+{
+    unsigned hash = 0;
+    for (unsigned i = 0; i < DELTA_WINDOW_SIZE; ++i)
+        hash = hash * DELTA_HASH_MULTIPLIER + data[i];
+    return hash;
+}
+
+/// Binary delta consists of operations. Operation header is (size << 1 | isCopy) encoded as VLE.
+/// Copy operation is followed by offset in base data, literal operation is followed by literal bytes.
+void WriteDeltaLiteral(Serializer& dest, const unsigned char* data, unsigned size)
+{
+    if (size > 0)
+    {
+        dest.WriteVLE(size << 1);
+        dest.Write(data, size);
+    }
+}
+
+void WriteDeltaCopy(Serializer& dest, unsigned offset, unsigned size)
+{
+    dest.WriteVLE(size << 1 | 1);
+    dest.WriteVLE(offset);
+}
+
+}
+
 unsigned EstimateCompressBound(unsigned srcSize)
 {
     return (unsigned)LZ4_compressBound(srcSize);
@@ -123,4 +160,96 @@ VectorBuffer DecompressVectorBuffer(VectorBuffer& src)
     return ret;
 }
 
+ByteVector CreateBinaryDelta(ea::span<const unsigned char> base, ea::span<const unsigned char> target)
+{
+    VectorBuffer dest;
+    dest.WriteVLE(target.size());
+
+    // Index window-aligned sequences of base data
+    ea::unordered_map<unsigned, unsigned> baseIndex;
+    for (unsigned offset = 0; offset + DELTA_WINDOW_SIZE <= base.size(); offset += DELTA_WINDOW_SIZE)
+        baseIndex.emplace(HashDeltaWindow(&base[offset]), offset);
+
+    unsigned highestPower = 1;
+    for (unsigned i = 1; i < DELTA_WINDOW_SIZE; ++i)
+        highestPower *= DELTA_HASH_MULTIPLIER;
+
+    // Scan target with rolling hash and emit copies for matching sequences
+    const unsigned targetSize = target.size();
+    unsigned literalBegin = 0;
+    unsigned position = 0;
+    unsigned hash = targetSize >= DELTA_WINDOW_SIZE ? HashDeltaWindow(target.data()) : 0;
+    while (position + DELTA_WINDOW_SIZE <= targetSize)
+    {
+        const auto iter = baseIndex.find(hash);
+        if (iter != baseIndex.end() && memcmp(&base[iter->second], &target[position], DELTA_WINDOW_SIZE) == 0)
+        {
+            unsigned baseBegin = iter->second;
+            unsigned targetBegin = position;
+            while (baseBegin > 0 && targetBegin > literalBegin && base[baseBegin - 1] == target[targetBegin - 1])
+            {
+                --baseBegin;
+                --targetBegin;
+            }
+
+            unsigned baseEnd = iter->second + DELTA_WINDOW_SIZE;
+            unsigned targetEnd = position + DELTA_WINDOW_SIZE;
+            while (baseEnd < base.size() && targetEnd < targetSize && base[baseEnd] == target[targetEnd])
+            {
+                ++baseEnd;
+                ++targetEnd;
+            }
+
+            WriteDeltaLiteral(dest, &target[literalBegin], targetBegin - literalBegin);
+            WriteDeltaCopy(dest, baseBegin, targetEnd - targetBegin);
+
+            position = literalBegin = targetEnd;
+            if (position + DELTA_WINDOW_SIZE <= targetSize)
+                hash = HashDeltaWindow(&target[position]);
+            continue;
+        }
+
+        if (position + DELTA_WINDOW_SIZE < targetSize)
+            hash = (hash - target[position] * highestPower) * DELTA_HASH_MULTIPLIER + target[position + DELTA_WINDOW_SIZE];
+        ++position;
+    }
+
+    WriteDeltaLiteral(dest, target.data() + literalBegin, targetSize - literalBegin);
+    return dest.GetBuffer();
+}
+
+bool ApplyBinaryDelta(ea::span<const unsigned char> base, ea::span<const unsigned char> delta, ByteVector& target)
+{
+    MemoryBuffer source(delta.data(), delta.size());
+    const unsigned targetSize = source.ReadVLE();
+
+    // Target size is not trusted until the delta is applied, don't reserve more than literals and copies can plausibly produce
+    target.clear();
+    target.reserve(ea::min<unsigned long long>(targetSize, static_cast<unsigned long long>(base.size()) + delta.size()));
+    while (!source.IsEof())
+    {
+        const unsigned header = source.ReadVLE();
+        const unsigned size = header >> 1;
+        if (static_cast<unsigned long long>(target.size()) + size > targetSize)
+            return false;
+
+        if (header & 1)
+        {
+            const unsigned offset = source.ReadVLE();
+            if (static_cast<unsigned long long>(offset) + size > base.size())
+                return false;
+            target.insert(target.end(), base.data() + offset, base.data() + offset + size);
+        }
+        else
+        {
+            const auto data = static_cast<const unsigned char*>(source.ReadInPlace(size));
+            if (!data)
+                return false;
+            target.insert(target.end(), data, data + size);
+        }
+    }
+
+    return target.size() == targetSize;
+}
+
 }
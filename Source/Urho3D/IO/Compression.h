@@ -23,6 +23,9 @@
 #pragma once
 
 #include <Urho3D/Urho3D.h>
+#include <Urho3D/Container/ByteVector.h>
+
+#include <EASTL/span.h>
 
 namespace Urho3D
 {
@@ -45,5 +48,9 @@ URHO3D_API bool DecompressStream(Serializer& dest, Deserializer& src);
 URHO3D_API VectorBuffer CompressVectorBuffer(VectorBuffer& src);
 /// Decompress a VectorBuffer produced using CompressVectorBuffer().
 URHO3D_API VectorBuffer DecompressVectorBuffer(VectorBuffer& src);
+/// Encode target data as binary delta against base data. Delta is small if target shares long byte sequences with base.
+URHO3D_API ByteVector CreateBinaryDelta(ea::span<const unsigned char> base, ea::span<const unsigned char> target);
+/// Reconstruct target data from base data and binary delta produced by CreateBinaryDelta(). Return false if delta is malformed.
+URHO3D_API bool ApplyBinaryDelta(ea::span<const unsigned char> base, ea::span<const unsigned char> delta, ByteVector& target);
 
 }
@@ -57,6 +57,9 @@ public:
     /// Return whether the end of stream has been reached.
     /// @property
     virtual bool IsEof() const { return position_ >= size_; }
+    /// Return pointer to the next size bytes and advance position if the stream data is already in memory, e.g. memory-mapped.
+    /// Return null and don't change position otherwise. Returned data is valid while the stream is alive.
+    virtual const void* ReadInPlace(unsigned size) { return nullptr; }
 
     /// Set position relative to current position. Return actual new position.
     unsigned SeekRelative(int delta);
@@ -140,6 +140,12 @@ bool File::Open(PackageFile* package, const ea::string& fileName)
     if (!entry)
         return false;
 
+    if (package->IsBlockIndexed() || entry->isDelta_)
+    {
+        URHO3D_LOGERROR("Block-indexed or patch package file " + package->GetName() + " should be read via PackageFile::OpenFile");
+        return false;
+    }
+
     bool success = OpenInternal(package->GetName(), FILE_READ, true);
     if (!success)
     {
@@ -50,6 +50,8 @@ public:
     unsigned Seek(unsigned position) override;
     /// Write bytes to the memory area.
     unsigned Write(const void* data, unsigned size) override;
+    /// Return pointer to the next size bytes in the memory area and advance position.
+    const void* ReadInPlace(unsigned size) override;
 
     /// Return memory area.
     unsigned char* GetData() { return buffer_; }
@@ -24,6 +24,7 @@
 
 #include "../Core/Object.h"
 #include "../IO/AbstractFile.h"
+#include "../IO/AsyncFileReader.h"
 #include "../IO/FileIdentifier.h"
 
 namespace Urho3D
@@ -53,6 +54,10 @@ public:
 
     /// Get full path to a file if it exists in a mount point.
     virtual ea::string GetFileName(const FileIdentifier& fileName) const = 0;
+
+    /// Return region of a file on disk that stores the file as is, for direct asynchronous reads.
+    /// Return empty region if the file is not found or should be read via OpenFile, e.g. if it's compressed.
+    virtual NativeFileRegion GetNativeFileRegion(const FileIdentifier& fileName) const { return {}; }
 };
 
 } // namespace Urho3D
@@ -123,4 +123,11 @@ ea::string MountedDirectory::GetFileName(const FileIdentifier& fileName) const
     return EMPTY_STRING;
 }
 
+NativeFileRegion MountedDirectory::GetNativeFileRegion(const FileIdentifier& fileName) const
+{
+    NativeFileRegion region;
+    region.fileName_ = GetFileName(fileName);
+    return region;
+}
+
 } // namespace Urho3D
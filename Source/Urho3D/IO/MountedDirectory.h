@@ -54,6 +54,9 @@ public:
     /// Return full absolute file name of the file if possible, or empty if not found.
     ea::string GetFileName(const FileIdentifier& fileName) const override;
 
+    /// Return region of a file on disk that stores the file as is, for direct asynchronous reads.
+    NativeFileRegion GetNativeFileRegion(const FileIdentifier& fileName) const override;
+
 protected:
     ea::string SanitizeDirName(const ea::string& name) const;
 
@@ -22,14 +22,207 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/WorkQueue.h"
+#include "../IO/Compression.h"
 #include "../IO/File.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
 #include "../IO/PackageFile.h"
 #include "../IO/FileSystem.h"
 
+#include <LZ4/lz4.h>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    #define URHO3D_PACKAGE_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
+namespace
+{
+
+/// Read-only view of file entry in memory-mapped package file.
+class PackageEntryBuffer : public RefCounted, public MemoryBuffer
+{
+public:
+    PackageEntryBuffer(PackageFile* package, const ea::string& name, const PackageEntry& entry)
+        : MemoryBuffer(package->GetEntryData(entry).data(), entry.size_)
+        , package_(package)
+        , checksum_(entry.checksum_)
+    {
+        SetName(name);
+    }
+
+    /// Return name of the package file, same as File opened from package would.
+    const ea::string& GetAbsoluteName() const override { return package_->GetName(); }
+
+    /// Return checksum of the file entry.
+    unsigned GetChecksum() override { return checksum_; }
+
+private:
+    /// Package file that owns mapped memory.
+    SharedPtr<PackageFile> package_;
+    /// File entry checksum.
+    unsigned checksum_{};
+};
+
+/// Storage of patched file data, initialized before MemoryBuffer that references it.
+struct PatchedFileData
+{
+    ByteVector data_;
+};
+
+/// File entry of patch package reconstructed from binary delta.
+class PatchedFileBuffer : public RefCounted, private PatchedFileData, public MemoryBuffer
+{
+public:
+    PatchedFileBuffer(PackageFile* package, const ea::string& name, unsigned checksum, ByteVector&& data)
+        : PatchedFileData{ea::move(data)}
+        , MemoryBuffer(data_)
+        , packageName_(package->GetName())
+        , checksum_(checksum)
+    {
+        SetName(name);
+    }
+
+    /// Return name of the patch package file.
+    const ea::string& GetAbsoluteName() const override { return packageName_; }
+    /// Return checksum of the patched file.
+    unsigned GetChecksum() override { return checksum_; }
+
+private:
+    /// Patch package file name.
+    ea::string packageName_;
+    /// Patched file checksum.
+    unsigned checksum_{};
+};
+
+/// File entry in block-indexed compressed package file. Supports random access, decompresses consecutive blocks in parallel.
+class PackageBlockFile : public RefCounted, public AbstractFile
+{
+public:
+    PackageBlockFile(PackageFile* package, const ea::string& name, const PackageEntry& entry)
+        : AbstractFile(entry.size_)
+        , package_(package)
+        , entry_(entry)
+    {
+        SetName(name);
+        if (!package_->IsMemoryMapped())
+            file_ = MakeShared<File>(package_->GetContext(), package_->GetName());
+    }
+
+    /// Read bytes from the file entry. Return number of bytes actually read.
+    unsigned Read(void* dest, unsigned size) override
+    {
+        size = ea::min(size, size_ - position_);
+
+        const unsigned blockSize = package_->GetBlockSize();
+        auto destPtr = static_cast<unsigned char*>(dest);
+        unsigned sizeLeft = size;
+        while (sizeLeft)
+        {
+            const unsigned blockIndex = position_ / blockSize;
+            const unsigned blockOffset = position_ % blockSize;
+
+            // Decompress fully covered blocks directly to destination
+            unsigned numCoveredBlocks = blockOffset == 0 ? sizeLeft / blockSize : 0;
+            if (blockOffset == 0 && position_ + sizeLeft == size_ && sizeLeft % blockSize != 0)
+                ++numCoveredBlocks;
+
+            if (numCoveredBlocks > 0)
+            {
+                if (!DecompressBlocks(blockIndex, numCoveredBlocks, destPtr))
+                    break;
+
+                const unsigned copySize = ea::min(sizeLeft, numCoveredBlocks * blockSize);
+                destPtr += copySize;
+                position_ += copySize;
+                sizeLeft -= copySize;
+                continue;
+            }
+
+            if (blockIndex != cachedBlockIndex_)
+            {
+                blockData_.resize(blockSize);
+                if (!DecompressBlocks(blockIndex, 1, blockData_.data()))
+                    break;
+                cachedBlockIndex_ = blockIndex;
+            }
+
+            const unsigned blockDataSize = ea::min(blockSize, size_ - blockIndex * blockSize);
+            const unsigned copySize = ea::min(sizeLeft, blockDataSize - blockOffset);
+            memcpy(destPtr, blockData_.data() + blockOffset, copySize);
+            destPtr += copySize;
+            position_ += copySize;
+            sizeLeft -= copySize;
+        }
+
+        return size - sizeLeft;
+    }
+
+    /// Set position from the beginning of the file entry. Blocks are decompressed lazily, so seek is cheap.
+    unsigned Seek(unsigned position) override
+    {
+        position_ = ea::min(position, size_);
+        return position_;
+    }
+
+    /// Package files are read-only.
+    unsigned Write(const void* data, unsigned size) override { return 0; }
+
+    /// Return whether the file is open.
+    bool IsOpen() const override { return !file_ || file_->IsOpen(); }
+    /// Return name of the package file, same as File opened from package would.
+    const ea::string& GetAbsoluteName() const override { return package_->GetName(); }
+    /// Return checksum of the file entry.
+    unsigned GetChecksum() override { return entry_.checksum_; }
+
+private:
+    bool DecompressBlocks(unsigned firstBlock, unsigned numBlocks, unsigned char* dest)
+    {
+        const PackageBlock* blocks = &package_->GetBlocks()[entry_.firstBlock_ + firstBlock];
+        const unsigned packedOffset = blocks[0].offset_;
+        const unsigned packedSize = blocks[numBlocks - 1].offset_ + blocks[numBlocks - 1].packedSize_ - packedOffset;
+
+        const unsigned char* packedData = package_->GetMappedData(packedOffset, packedSize).data();
+        if (!packedData)
+        {
+            packedBuffer_.resize(packedSize);
+            file_->Seek(packedOffset);
+            if (file_->Read(packedBuffer_.data(), packedSize) != packedSize)
+                return false;
+            packedData = packedBuffer_.data();
+        }
+
+        if (!package_->DecompressBlocks(entry_, firstBlock, numBlocks, packedData, dest))
+        {
+            URHO3D_LOGERROR("Failed to decompress package file entry " + GetName());
+            return false;
+        }
+        return true;
+    }
+
+    /// Package file.
+    SharedPtr<PackageFile> package_;
+    /// File entry.
+    const PackageEntry entry_;
+    /// Package file used to read compressed data if the package file is not memory-mapped.
+    SharedPtr<File> file_;
+    /// Compressed data read from the package file.
+    ByteVector packedBuffer_;
+    /// Last decompressed block.
+    ByteVector blockData_;
+    /// Index of last decompressed block.
+    unsigned cachedBlockIndex_{M_MAX_UNSIGNED};
+};
+
+}
+
 PackageFile::PackageFile(Context* context) :
     MountPoint(context),
     totalSize_(0),
@@ -49,10 +242,21 @@ PackageFile::PackageFile(Context* context, const ea::string& fileName, unsigned
     Open(fileName, startOffset);
 }
 
-PackageFile::~PackageFile() = default;
+PackageFile::~PackageFile()
+{
+    UnmapFile();
+}
 
 bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
 {
+    UnmapFile();
+    blockSize_ = 0;
+    blocks_.clear();
+    dictionary_.clear();
+    isPatch_ = false;
+    baseChecksum_ = 0;
+    basePackage_ = nullptr;
+
     auto file = MakeShared<File>(context_, fileName);
     if (!file->IsOpen())
         return false;
@@ -91,18 +295,45 @@ bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
 
+    unsigned version = 0;
     if (id == "RPAK" || id == "RLZ4")
     {
         // New PAK file format includes two extra PAK header fields:
-        // * Version. At this time this field is unused and is always 0. It will be used in the future if PAK format needs to be extended.
+        // * Version. Version 0 is the original format, version 1 adds block index to compressed files,
+        //   version 2 is used by patch packages and adds base package checksum and flags of file entries.
         // * File list offset. New format writes file list in the end of the file. This allows PAK creation without knowing entire file list
         //   beforehand.
-        unsigned version = file->ReadUInt();                        // Reserved for future use.
-        assert(version == 0);
+        version = file->ReadUInt();
+        if (version > PACKAGE_VERSION_PATCH)
+        {
+            URHO3D_LOGERROR(fileName + " has unsupported package version " + ea::to_string(version));
+            return false;
+        }
         int64_t fileListOffset = file->ReadInt64();                 // New format has file list at the end of the file.
         file->Seek(fileListOffset);                                 // TODO: Serializer/Deserializer do not support files bigger than 4 GB
     }
 
+    // Block-indexed compressed package stores block size and optional dictionary before the file list
+    const bool hasBlockIndex = compressed_ && version >= PACKAGE_VERSION_BLOCK_INDEX;
+    if (hasBlockIndex)
+    {
+        blockSize_ = file->ReadUInt();
+        const unsigned dictionarySize = file->ReadUInt();
+        const bool isDictionarySizeValid =
+            dictionarySize <= PACKAGE_MAX_DICTIONARY_SIZE && dictionarySize <= file->GetSize() - file->GetPosition();
+        if (isDictionarySizeValid)
+            dictionary_.resize(dictionarySize);
+        if (!blockSize_ || !isDictionarySizeValid || file->Read(dictionary_.data(), dictionary_.size()) != dictionary_.size())
+        {
+            URHO3D_LOGERROR(fileName + " has invalid block index");
+            return false;
+        }
+    }
+
+    isPatch_ = version >= PACKAGE_VERSION_PATCH;
+    if (isPatch_)
+        baseChecksum_ = file->ReadUInt();
+
     for (unsigned i = 0; i < numFiles; ++i)
     {
         ea::string entryName = file->ReadString();
@@ -110,7 +341,31 @@ bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
         newEntry.offset_ = file->ReadUInt() + startOffset;
         totalDataSize_ += (newEntry.size_ = file->ReadUInt());
         newEntry.checksum_ = file->ReadUInt();
-        if (!compressed_ && newEntry.offset_ + newEntry.size_ > totalSize_)
+
+        if (hasBlockIndex || isPatch_)
+        {
+            const unsigned flags = file->ReadUInt();
+            newEntry.useDictionary_ = (flags & PACKAGE_ENTRY_DICTIONARY) != 0;
+            newEntry.isDelta_ = (flags & PACKAGE_ENTRY_DELTA) != 0;
+        }
+
+        unsigned entryEnd = newEntry.offset_ + newEntry.size_;
+        if (hasBlockIndex)
+        {
+            newEntry.firstBlock_ = blocks_.size();
+
+            unsigned blockOffset = newEntry.offset_;
+            const unsigned numBlocks = GetNumBlocks(newEntry);
+            for (unsigned j = 0; j < numBlocks; ++j)
+            {
+                const unsigned packedSize = file->ReadUInt();
+                blocks_.push_back(PackageBlock{blockOffset, packedSize});
+                blockOffset += packedSize;
+            }
+            entryEnd = blockOffset;
+        }
+
+        if ((!compressed_ || hasBlockIndex) && entryEnd > totalSize_)
         {
             URHO3D_LOGERROR("File entry " + entryName + " outside package file");
             return false;
@@ -119,9 +374,140 @@ bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
             entries_[entryName] = newEntry;
     }
 
+    // Legacy compressed packages are read sequentially by File, there's no benefit from mapping
+    if (!compressed_ || hasBlockIndex)
+        MapFile();
+
     return true;
 }
 
+bool PackageFile::SetBasePackage(PackageFile* basePackage)
+{
+    if (basePackage && (!isPatch_ || basePackage->GetChecksum() != baseChecksum_))
+    {
+        URHO3D_LOGERROR(fileName_ + " is not a patch of package " + basePackage->GetName());
+        return false;
+    }
+
+    basePackage_ = basePackage;
+    return true;
+}
+
+void PackageFile::LinkPatchPackage(PackageFile* package)
+{
+    if (!package || package == this)
+        return;
+
+    if (isPatch_ && !basePackage_ && package->GetChecksum() == baseChecksum_)
+        SetBasePackage(package);
+    else if (package->IsPatch() && !package->GetBasePackage() && package->GetBaseChecksum() == checksum_)
+        package->SetBasePackage(this);
+}
+
+unsigned PackageFile::GetNumBlocks(const PackageEntry& entry) const
+{
+    return blockSize_ ? (entry.size_ + blockSize_ - 1) / blockSize_ : 0;
+}
+
+unsigned PackageFile::GetPackedSize(const PackageEntry& entry) const
+{
+    unsigned packedSize = 0;
+    const unsigned numBlocks = GetNumBlocks(entry);
+    for (unsigned i = 0; i < numBlocks; ++i)
+        packedSize += blocks_[entry.firstBlock_ + i].packedSize_;
+    return packedSize;
+}
+
+bool PackageFile::DecompressBlocks(const PackageEntry& entry, unsigned firstBlock, unsigned numBlocks,
+    const unsigned char* packedData, unsigned char* dest) const
+{
+    const unsigned packedOffset = blocks_[entry.firstBlock_ + firstBlock].offset_;
+    std::atomic<bool> success{true};
+    const auto decompressRange = [&](unsigned beginIndex, unsigned endIndex)
+    {
+        for (unsigned i = beginIndex; i < endIndex; ++i)
+        {
+            const unsigned blockIndex = firstBlock + i;
+            const unsigned char* blockData = packedData + blocks_[entry.firstBlock_ + blockIndex].offset_ - packedOffset;
+            if (!DecompressBlock(entry, blockIndex, blockData, dest + i * blockSize_))
+                success = false;
+        }
+    };
+
+    auto workQueue = GetSubsystem<WorkQueue>();
+    if (workQueue && numBlocks > 1)
+        ForEachParallel(workQueue, 1u, numBlocks, decompressRange);
+    else
+        decompressRange(0, numBlocks);
+    return success;
+}
+
+bool PackageFile::DecompressBlock(const PackageEntry& entry, unsigned blockIndex, const unsigned char* packedData, unsigned char* dest) const
+{
+    const unsigned packedSize = blocks_[entry.firstBlock_ + blockIndex].packedSize_;
+    const unsigned unpackedSize = ea::min(blockSize_, entry.size_ - blockIndex * blockSize_);
+    if (packedSize == unpackedSize)
+    {
+        // Incompressible block is stored as is
+        memcpy(dest, packedData, unpackedSize);
+        return true;
+    }
+
+    const auto src = reinterpret_cast<const char*>(packedData);
+    const auto dst = reinterpret_cast<char*>(dest);
+    const int result = entry.useDictionary_
+        ? LZ4_decompress_safe_usingDict(src, dst, packedSize, unpackedSize,
+            reinterpret_cast<const char*>(dictionary_.data()), dictionary_.size())
+        : LZ4_decompress_safe(src, dst, packedSize, unpackedSize);
+    return result == static_cast<int>(unpackedSize);
+}
+
+ea::span<const unsigned char> PackageFile::GetEntryData(const PackageEntry& entry) const
+{
+    return compressed_ ? ea::span<const unsigned char>{} : GetMappedData(entry.offset_, entry.size_);
+}
+
+ea::span<const unsigned char> PackageFile::GetMappedData(unsigned offset, unsigned size) const
+{
+    if (!mappedData_ || offset + static_cast<size_t>(size) > mappedSize_)
+        return {};
+    return {mappedData_ + offset, size};
+}
+
+void PackageFile::MapFile()
+{
+#ifdef URHO3D_PACKAGE_MMAP
+    // Package may be not a regular file, e.g. Android asset. Fall back to File reads silently.
+    const int fd = open(GetNativePath(fileName_).c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            mappedData_ = static_cast<const unsigned char*>(data);
+            mappedSize_ = static_cast<size_t>(fileStat.st_size);
+        }
+    }
+
+    // Mapping stays valid after the descriptor is closed
+    close(fd);
+#endif
+}
+
+void PackageFile::UnmapFile()
+{
+#ifdef URHO3D_PACKAGE_MMAP
+    if (mappedData_)
+        munmap(const_cast<unsigned char*>(mappedData_), mappedSize_);
+#endif
+    mappedData_ = nullptr;
+    mappedSize_ = 0;
+}
+
 bool PackageFile::Exists(const ea::string& fileName) const
 {
     bool found = entries_.find(fileName) != entries_.end();
@@ -230,13 +616,71 @@ AbstractFilePtr PackageFile::OpenFile(const FileIdentifier& fileName, FileMode m
         return {};
 
     // Quit if file doesn't exists in the package.
-    if (!Exists(fileName.fileName_))
+    const PackageEntry* entry = GetEntry(fileName.fileName_);
+    if (!entry)
         return {};
 
-    auto file = MakeShared<File>(context_, this, fileName.fileName_);
+    if (entry->isDelta_)
+        return OpenPatchedFile(fileName.fileName_, *entry);
+    return OpenStoredFile(fileName.fileName_, *entry);
+}
+
+AbstractFilePtr PackageFile::OpenStoredFile(const ea::string& fileName, const PackageEntry& entry)
+{
+    // Block-indexed compressed files support random access and parallel decompression
+    if (blockSize_)
+        return AbstractFilePtr(MakeShared<PackageBlockFile>(this, fileName, entry));
+
+    // Memory-mapped files are read directly from mapped memory
+    if (!GetEntryData(entry).empty())
+        return AbstractFilePtr(MakeShared<PackageEntryBuffer>(this, fileName, entry));
+
+    auto file = MakeShared<File>(context_, this, fileName);
     return file;
 }
 
+AbstractFilePtr PackageFile::OpenPatchedFile(const ea::string& fileName, const PackageEntry& entry)
+{
+    if (!basePackage_)
+    {
+        URHO3D_LOGERROR("Could not open " + fileName + " from patch package " + fileName_ + " without base package");
+        return {};
+    }
+
+    AbstractFilePtr deltaFile = OpenStoredFile(fileName, entry);
+    AbstractFilePtr baseFile = basePackage_->OpenFile(FileIdentifier(EMPTY_STRING, fileName), FILE_READ);
+    if (!deltaFile || !baseFile)
+    {
+        URHO3D_LOGERROR("Could not open " + fileName + " from patch package " + fileName_);
+        return {};
+    }
+
+    ByteVector delta(deltaFile->GetSize());
+    if (deltaFile->Read(delta.data(), delta.size()) != delta.size())
+        return {};
+
+    // Base file is used in place if it's memory-mapped
+    const unsigned baseSize = baseFile->GetSize();
+    ByteVector baseBuffer;
+    auto baseData = static_cast<const unsigned char*>(baseFile->ReadInPlace(baseSize));
+    if (!baseData)
+    {
+        baseBuffer.resize(baseSize);
+        if (baseFile->Read(baseBuffer.data(), baseSize) != baseSize)
+            return {};
+        baseData = baseBuffer.data();
+    }
+
+    ByteVector data;
+    if (!ApplyBinaryDelta({baseData, baseSize}, delta, data))
+    {
+        URHO3D_LOGERROR("Could not apply patch to " + fileName + " from patch package " + fileName_);
+        return {};
+    }
+
+    return AbstractFilePtr(MakeShared<PatchedFileBuffer>(this, fileName, entry.checksum_, ea::move(data)));
+}
+
 /// Get full path to a file if it exists in a mount point.
 ea::string PackageFile::GetFileName(const FileIdentifier& fileName) const
 {
@@ -244,4 +688,20 @@ ea::string PackageFile::GetFileName(const FileIdentifier& fileName) const
     return ea::string();
 }
 
+NativeFileRegion PackageFile::GetNativeFileRegion(const FileIdentifier& fileName) const
+{
+    if (compressed_ || IsMemoryMapped() || !AcceptsScheme(fileName.scheme_))
+        return {};
+
+    const PackageEntry* entry = GetEntry(fileName.fileName_);
+    if (!entry || entry->isDelta_)
+        return {};
+
+    NativeFileRegion region;
+    region.fileName_ = fileName_;
+    region.offset_ = entry->offset_;
+    region.size_ = entry->size_;
+    return region;
+}
+
 }
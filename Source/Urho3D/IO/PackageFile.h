@@ -22,11 +22,25 @@
 
 #pragma once
 
+#include "../Container/ByteVector.h"
 #include "../IO/MountPoint.h"
 
+#include <EASTL/span.h>
+
 namespace Urho3D
 {
 
+/// Version of RPAK/RLZ4 package format with per-entry block index of compressed files.
+static const unsigned PACKAGE_VERSION_BLOCK_INDEX = 1;
+/// Version of RPAK/RLZ4 package format of patch packages, which store base package checksum and entry flags.
+static const unsigned PACKAGE_VERSION_PATCH = 2;
+/// Max size of compression dictionary of block-indexed package file.
+static const unsigned PACKAGE_MAX_DICTIONARY_SIZE = 65536;
+/// Flag of file entry in block-indexed package file: blocks are compressed with the package dictionary.
+static const unsigned PACKAGE_ENTRY_DICTIONARY = 1;
+/// Flag of file entry in patch package: entry data is binary delta against the file with the same name in the base package.
+static const unsigned PACKAGE_ENTRY_DELTA = 2;
+
 /// %File entry within the package file.
 struct PackageEntry
 {
@@ -36,6 +50,21 @@ struct PackageEntry
     unsigned size_;
     /// File checksum.
     unsigned checksum_;
+    /// Index of the first compressed block in block-indexed package file.
+    unsigned firstBlock_;
+    /// Whether the blocks are compressed with the package dictionary.
+    bool useDictionary_;
+    /// Whether the entry data is binary delta against the base package.
+    bool isDelta_;
+};
+
+/// Compressed block of the file entry within block-indexed package file.
+struct PackageBlock
+{
+    /// Offset from the beginning.
+    unsigned offset_;
+    /// Compressed size. Equal to uncompressed size if the block is stored uncompressed.
+    unsigned packedSize_;
 };
 
 /// Stores files of a directory tree sequentially for convenient access.
@@ -88,6 +117,43 @@ public:
     /// @property
     bool IsCompressed() const { return compressed_; }
 
+    /// Return whether the package file is memory-mapped. Files of memory-mapped package are read without copying to intermediate buffers.
+    bool IsMemoryMapped() const { return mappedData_ != nullptr; }
+
+    /// Return read-only data of the uncompressed file entry if the package file is memory-mapped, or empty span otherwise.
+    /// Data is valid while the package file is alive.
+    ea::span<const unsigned char> GetEntryData(const PackageEntry& entry) const;
+    /// Return read-only region of the package file if it is memory-mapped, or empty span otherwise.
+    ea::span<const unsigned char> GetMappedData(unsigned offset, unsigned size) const;
+
+    /// Return whether the compressed files have block index and can be accessed randomly.
+    bool IsBlockIndexed() const { return blockSize_ != 0; }
+    /// Return uncompressed size of blocks in block-indexed package file.
+    unsigned GetBlockSize() const { return blockSize_; }
+    /// Return compressed blocks of all file entries in block-indexed package file.
+    const ea::vector<PackageBlock>& GetBlocks() const { return blocks_; }
+    /// Return compression dictionary of block-indexed package file.
+    const ByteVector& GetDictionary() const { return dictionary_; }
+    /// Return number of blocks of the file entry in block-indexed package file.
+    unsigned GetNumBlocks(const PackageEntry& entry) const;
+    /// Return compressed size of the file entry in block-indexed package file.
+    unsigned GetPackedSize(const PackageEntry& entry) const;
+    /// Return whether the package is a patch that should be layered over the base package.
+    bool IsPatch() const { return isPatch_; }
+    /// Return checksum of the base package the patch package was created against.
+    unsigned GetBaseChecksum() const { return baseChecksum_; }
+    /// Set base package of the patch package. Return false if the package is not a patch of the base package.
+    bool SetBasePackage(PackageFile* basePackage);
+    /// Return base package of the patch package.
+    PackageFile* GetBasePackage() const { return basePackage_; }
+    /// If either of the packages is a patch of another one and has no base package yet, set base package of the patch.
+    void LinkPatchPackage(PackageFile* package);
+
+    /// Decompress consecutive blocks of the file entry in block-indexed package file. Blocks are decompressed in parallel if possible.
+    /// Packed data should contain compressed data of the blocks starting from the first one.
+    bool DecompressBlocks(const PackageEntry& entry, unsigned firstBlock, unsigned numBlocks,
+        const unsigned char* packedData, unsigned char* dest) const;
+
     /// Return list of file names in the package.
     const ea::vector<ea::string> GetEntryNames() const { return entries_.keys(); }
 
@@ -118,7 +184,22 @@ public:
     /// Get full path to a file if it exists in a mount point.
     ea::string GetFileName(const FileIdentifier& fileName) const override;
 
+    /// Return region of the package that stores the file as is. Only uncompressed files are stored as is.
+    /// Memory-mapped files are read in place instead.
+    NativeFileRegion GetNativeFileRegion(const FileIdentifier& fileName) const override;
+
 private:
+    /// Map the package file into memory if supported by the platform.
+    void MapFile();
+    /// Unmap the package file.
+    void UnmapFile();
+    /// Open stored data of the file entry.
+    AbstractFilePtr OpenStoredFile(const ea::string& fileName, const PackageEntry& entry);
+    /// Open file entry of the patch package by applying binary delta to the file from the base package.
+    AbstractFilePtr OpenPatchedFile(const ea::string& fileName, const PackageEntry& entry);
+    /// Decompress single block of the file entry.
+    bool DecompressBlock(const PackageEntry& entry, unsigned blockIndex, const unsigned char* packedData, unsigned char* dest) const;
+
     /// File entries.
     ea::unordered_map<ea::string, PackageEntry> entries_;
     /// File name.
@@ -133,6 +214,22 @@ private:
     unsigned checksum_;
     /// Compressed flag.
     bool compressed_;
+    /// Memory-mapped package file contents.
+    const unsigned char* mappedData_{};
+    /// Size of memory-mapped package file contents.
+    size_t mappedSize_{};
+    /// Uncompressed block size in block-indexed package file.
+    unsigned blockSize_{};
+    /// Compressed blocks in block-indexed package file.
+    ea::vector<PackageBlock> blocks_;
+    /// Compression dictionary.
+    ByteVector dictionary_;
+    /// Whether the package is a patch.
+    bool isPatch_{};
+    /// Checksum of the base package.
+    unsigned baseChecksum_{};
+    /// Base package of the patch package.
+    SharedPtr<PackageFile> basePackage_;
 };
 
 }
@@ -70,6 +70,13 @@ void VirtualFileSystem::Mount(MountPoint* mountPoint)
         return;
     }
     mountPoints_.push_back(pointPtr);
+
+    // Layer patch packages over their base packages
+    if (auto package = mountPoint->Cast<PackageFile>())
+    {
+        for (MountPoint* otherMountPoint : mountPoints_)
+            package->LinkPatchPackage(otherMountPoint->Cast<PackageFile>());
+    }
 }
 
 void VirtualFileSystem::MountExistingPackages(
@@ -169,6 +176,66 @@ ea::string VirtualFileSystem::GetFileName(const FileIdentifier& fileName)
     return ea::string();
 }
 
+void VirtualFileSystem::ReadFileAsync(const FileIdentifier& fileName, AsyncReadCallback callback)
+{
+    ReadFilesAsync({&fileName, 1}, [callback = ea::move(callback)](unsigned, AbstractFilePtr file) { callback(file); });
+}
+
+void VirtualFileSystem::ReadFilesAsync(
+    ea::span<const FileIdentifier> fileNames, const ea::function<void(unsigned index, AbstractFilePtr file)>& callback)
+{
+    AsyncFileReader* reader = GetAsyncFileReader();
+
+    ea::vector<AsyncReadRequest> requests;
+    ea::vector<unsigned> missingFiles;
+    {
+        MutexLock lock(mountMutex_);
+        for (unsigned i = 0; i < fileNames.size(); ++i)
+        {
+            AsyncReadRequest request;
+            if (!CreateReadRequest(fileNames[i], request))
+            {
+                missingFiles.push_back(i);
+                continue;
+            }
+
+            request.callback_ = [callback, i](AbstractFilePtr file) { callback(i, file); };
+            requests.push_back(ea::move(request));
+        }
+    }
+
+    reader->Read(requests);
+
+    for (unsigned index : missingFiles)
+        callback(index, nullptr);
+}
+
+AsyncFileReader* VirtualFileSystem::GetAsyncFileReader()
+{
+    MutexLock lock(mountMutex_);
+
+    if (!asyncFileReader_)
+        asyncFileReader_ = MakeShared<AsyncFileReader>(context_);
+    return asyncFileReader_;
+}
+
+bool VirtualFileSystem::CreateReadRequest(const FileIdentifier& fileName, AsyncReadRequest& request) const
+{
+    for (auto i = mountPoints_.rbegin(); i != mountPoints_.rend(); ++i)
+    {
+        SharedPtr<MountPoint> mountPoint = *i;
+        if (!mountPoint->Exists(fileName))
+            continue;
+
+        request.name_ = fileName.fileName_;
+        request.region_ = mountPoint->GetNativeFileRegion(fileName);
+        if (request.region_.IsEmpty())
+            request.openFile_ = [mountPoint, fileName] { return mountPoint->OpenFile(fileName, FILE_READ); };
+        return true;
+    }
+    return false;
+}
+
 /// Check if a file exists in the virtual file system.
 bool VirtualFileSystem::Exists(const FileIdentifier& fileName) const
 {
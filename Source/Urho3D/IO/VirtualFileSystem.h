@@ -69,11 +69,23 @@ public:
     /// Return full absolute file name of the file if possible, or empty if not found.
     ea::string GetFileName(const FileIdentifier& name);
 
+    /// Read file asynchronously. Callback is called from I/O thread, the file is null if not found.
+    void ReadFileAsync(const FileIdentifier& fileName, AsyncReadCallback callback);
+    /// Read files asynchronously as one batch. Callback is called from I/O thread for each file, the file is null if not found.
+    void ReadFilesAsync(ea::span<const FileIdentifier> fileNames, const ea::function<void(unsigned index, AbstractFilePtr file)>& callback);
+    /// Return asynchronous file reader. It's created on first use.
+    AsyncFileReader* GetAsyncFileReader();
+
 private:
+    /// Create read request for the file. Return false if file not found. Should be called with locked mutex.
+    bool CreateReadRequest(const FileIdentifier& fileName, AsyncReadRequest& request) const;
+
     /// Mutex for thread-safe access to the mount points.
     mutable Mutex mountMutex_;
     /// File system mount points. It is expected to have small number of mount points.
     ea::vector<SharedPtr<MountPoint>> mountPoints_;
+    /// Asynchronous file reader.
+    SharedPtr<AsyncFileReader> asyncFileReader_;
 };
 
 }
@@ -33,6 +33,7 @@
 #include "../Scene/Node.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
+#include "../Scene/SceneUpdateScheduler.h"
 
 #include <DetourCrowd/DetourCrowd.h>
 
@@ -642,6 +643,9 @@ void CrowdManager::OnSceneSet(Scene* scene)
         }
 
         SubscribeToEvent(scene, E_SCENESUBSYSTEMUPDATE, URHO3D_HANDLER(CrowdManager, HandleSceneSubsystemUpdate));
+        SubscribeToEvent(scene, E_SCENEUPDATESCHEDULERENABLED, [this](StringHash, VariantMap&) { AddUpdateJob(); });
+        updateScheduler_ = scene->GetUpdateScheduler();
+        AddUpdateJob();
 
         // Attempt to auto discover a NavigationMesh component (or its derivative) under the scene node
         if (navigationMeshId_ == 0)
@@ -662,11 +666,34 @@ void CrowdManager::OnSceneSet(Scene* scene)
         UnsubscribeFromEvent(E_NAVIGATION_MESH_REBUILT);
         UnsubscribeFromEvent(E_COMPONENTADDED);
         UnsubscribeFromEvent(E_COMPONENTREMOVED);
+        UnsubscribeFromEvent(E_SCENEUPDATESCHEDULERENABLED);
+
+        if (updateScheduler_)
+            updateScheduler_->RemoveJobs(this);
+        updateScheduler_ = nullptr;
 
         navigationMesh_ = nullptr;
     }
 }
 
+void CrowdManager::AddUpdateJob()
+{
+    if (!updateScheduler_ || !updateScheduler_->IsEnabled())
+        return;
+
+    // Crowd agents move nodes and send events from the update callback, so the job is executed in main thread
+    SceneUpdateJobDesc job;
+    job.name_ = "CrowdManager";
+    job.read_ = SceneDataAccess::Transforms | SceneDataAccess::Navigation | SceneDataAccess::UserLogic;
+    job.write_ = SceneDataAccess::Transforms | SceneDataAccess::Navigation | SceneDataAccess::UserLogic;
+    job.callback_ = [this](float timeStep)
+    {
+        if (crowd_ && navigationMesh_ && IsEnabledEffective())
+            Update(timeStep);
+    };
+    updateScheduler_->AddJob(this, job);
+}
+
 void CrowdManager::Update(float delta)
 {
     assert(crowd_ && navigationMesh_);
@@ -687,7 +714,7 @@ const dtQueryFilter* CrowdManager::GetDetourQueryFilter(unsigned queryFilterType
 void CrowdManager::HandleSceneSubsystemUpdate(StringHash eventType, VariantMap& eventData)
 {
     // Perform update tick as long as the crowd is initialized and the associated navmesh has not been removed
-    if (crowd_ && navigationMesh_)
+    if (crowd_ && navigationMesh_ && !GetScene()->GetUpdateScheduler()->IsEnabled())
     {
         using namespace SceneSubsystemUpdate;
 
@@ -39,6 +39,7 @@ namespace Urho3D
 
 class CrowdAgent;
 class NavigationMesh;
+class SceneUpdateScheduler;
 
 /// Parameter structure for obstacle avoidance params (copied from DetourObstacleAvoidance.h in order to hide Detour header from Urho3D library users).
 /// @pod
@@ -197,11 +198,15 @@ private:
     void HandleNavMeshChanged(StringHash eventType, VariantMap& eventData);
     /// Handle component added in the scene to check for late addition of the navmesh.
     void HandleComponentAdded(StringHash eventType, VariantMap& eventData);
+    /// Add crowd update to the scene update scheduler if it is enabled.
+    void AddUpdateJob();
 
     /// Internal Detour crowd object.
     dtCrowd* crowd_{};
     /// Velocity shader.
     CrowdAgentVelocityShader velocityShader_;
+    /// Scene update scheduler of the scene.
+    WeakPtr<SceneUpdateScheduler> updateScheduler_;
     /// NavigationMesh for which the crowd was created.
     WeakPtr<NavigationMesh> navigationMesh_;
     /// The NavigationMesh component Id for pending crowd creation.
@@ -29,6 +29,7 @@
 #include "../Resource/ResourceEvents.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
+#include "../Scene/SceneUpdateScheduler.h"
 #include "ParticleGraphLayer.h"
 #include "ParticleGraphLayerInstance.h"
 
@@ -154,12 +155,48 @@ void ParticleGraphEmitter::OnSceneSet(Scene* scene)
     else if (!scene)
         UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
 
+    if (scene)
+    {
+        SubscribeToEvent(scene, E_SCENEUPDATESCHEDULERENABLED, [this](StringHash, VariantMap&) { AddUpdateJob(); });
+        updateScheduler_ = scene->GetUpdateScheduler();
+        AddUpdateJob();
+    }
+    else
+    {
+        UnsubscribeFromEvent(E_SCENEUPDATESCHEDULERENABLED);
+        if (updateScheduler_)
+            updateScheduler_->RemoveJobs(this);
+        updateScheduler_ = nullptr;
+    }
+
     for (unsigned i = 0; i < layers_.size(); ++i)
     {
             layers_[i].OnSceneSet(scene);
     }
 }
 
+void ParticleGraphEmitter::AddUpdateJob()
+{
+    if (!updateScheduler_ || !updateScheduler_->IsEnabled())
+        return;
+
+    // Emitters don't share any state, so they are updated in parallel
+    SceneUpdateJobDesc job;
+    job.name_ = "ParticleGraphEmitter";
+    job.read_ = SceneDataAccess::Transforms | SceneDataAccess::Particles;
+    job.write_ = SceneDataAccess::Particles;
+    job.threadSafe_ = true;
+    job.callback_ = [this](float timeStep)
+    {
+        if (IsEnabledEffective())
+        {
+            lastTimeStep_ = timeStep;
+            Tick(timeStep);
+        }
+    };
+    updateScheduler_->AddJob(this, job);
+}
+
 bool ParticleGraphEmitter::EmitNewParticle(unsigned layer)
 {
     if (layer >= layers_.size())
@@ -208,8 +245,11 @@ void ParticleGraphEmitter::HandleScenePostUpdate(StringHash eventType, VariantMa
     // Store scene's timestep and use it instead of global timestep, as time scale may be other than 1
     using namespace ScenePostUpdate;
 
-    lastTimeStep_ = eventData[P_TIMESTEP].GetFloat();
+    // Emitter is updated by the scheduler instead
+    if (GetScene()->GetUpdateScheduler()->IsEnabled())
+        return;
 
+    lastTimeStep_ = eventData[P_TIMESTEP].GetFloat();
 
     Tick(lastTimeStep_);
 
@@ -33,6 +33,7 @@ namespace Urho3D
 
 class ParticleGraphLayerInstance;
 class ParticleGraphNodeInstance;
+class SceneUpdateScheduler;
 
 /// %Particle graph emitter component.
 class URHO3D_API ParticleGraphEmitter : public Component
@@ -102,12 +103,17 @@ private:
     void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
     /// Handle live reload of the particle effect.
     void HandleEffectReloadFinished(StringHash eventType, VariantMap& eventData);
+    /// Add emitter update to the scene update scheduler if it is enabled.
+    void AddUpdateJob();
 
     /// Particle effect.
     SharedPtr<ParticleGraphEffect> effect_;
 
     ea::vector<ParticleGraphLayerInstance> layers_;
 
+    /// Scene update scheduler of the scene.
+    WeakPtr<SceneUpdateScheduler> updateScheduler_;
+
     /// Last scene timestep.
     float lastTimeStep_{};
 
@@ -41,6 +41,7 @@
 #include "../Physics/RigidBody.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
+#include "../Scene/SceneUpdateScheduler.h"
 
 #include <Bullet/BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
 #include <Bullet/BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
@@ -856,14 +857,40 @@ void PhysicsWorld::OnSceneSet(Scene* scene)
     {
         scene_ = GetScene();
         SubscribeToEvent(scene_, E_SCENESUBSYSTEMUPDATE, URHO3D_HANDLER(PhysicsWorld, HandleSceneSubsystemUpdate));
+        SubscribeToEvent(scene_, E_SCENEUPDATESCHEDULERENABLED, [this](StringHash, VariantMap&) { AddUpdateJob(); });
+        AddUpdateJob();
     }
     else
+    {
         UnsubscribeFromEvent(E_SCENESUBSYSTEMUPDATE);
+        UnsubscribeFromEvent(E_SCENEUPDATESCHEDULERENABLED);
+        if (scene_)
+            scene_->GetUpdateScheduler()->RemoveJobs(this);
+    }
+}
+
+void PhysicsWorld::AddUpdateJob()
+{
+    SceneUpdateScheduler* scheduler = scene_->GetUpdateScheduler();
+    if (!scheduler->IsEnabled())
+        return;
+
+    // Physics step events are handled by user logic, so the job is executed in main thread
+    SceneUpdateJobDesc job;
+    job.name_ = "PhysicsWorld";
+    job.read_ = SceneDataAccess::Transforms | SceneDataAccess::Physics | SceneDataAccess::UserLogic;
+    job.write_ = SceneDataAccess::Transforms | SceneDataAccess::Physics | SceneDataAccess::UserLogic;
+    job.callback_ = [this](float timeStep)
+    {
+        if (updateEnabled_)
+            Update(timeStep);
+    };
+    scheduler->AddJob(this, job);
 }
 
 void PhysicsWorld::HandleSceneSubsystemUpdate(StringHash eventType, VariantMap& eventData)
 {
-    if (!updateEnabled_)
+    if (!updateEnabled_ || scene_->GetUpdateScheduler()->IsEnabled())
         return;
 
     using namespace SceneSubsystemUpdate;
@@ -324,6 +324,8 @@ protected:
 private:
     /// Handle the scene subsystem update event, step simulation here.
     void HandleSceneSubsystemUpdate(StringHash eventType, VariantMap& eventData);
+    /// Add simulation step to the scene update scheduler if it is enabled.
+    void AddUpdateJob();
     /// Trigger before physics update, before any of simulation steps.
     void PreUpdate(float timeStep);
     /// Trigger after physics update, after all of simulation steps.
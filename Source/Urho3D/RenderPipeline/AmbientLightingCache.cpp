@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../RenderPipeline/AmbientLightingCache.h"
+
+#include "../Graphics/Drawable.h"
+#include "../Graphics/GlobalIllumination.h"
+#include "../Graphics/Zone.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+void AmbientLightingCache::BeginFrame(unsigned numDrawables, GlobalIllumination* gi)
+{
+    const unsigned giRevision = gi ? gi->GetRevision() : 0;
+    if (gi_ != gi || giRevision_ != giRevision)
+    {
+        gi_ = gi;
+        giRevision_ = giRevision;
+        ++revision_;
+    }
+
+    cachedLighting_.resize(numDrawables);
+    numEvaluations_.store(0, std::memory_order_relaxed);
+}
+
+SphericalHarmonicsDot9 AmbientLightingCache::GetAmbientLighting(Drawable* drawable, const Vector3& samplePosition)
+{
+    const bool useGlobalIllumination = gi_ && drawable->GetGlobalIlluminationType() >= GlobalIlluminationType::BlendLightProbes;
+    Zone* zone = drawable->GetMutableCachedZone().zone_;
+
+    const unsigned drawableIndex = drawable->GetDrawableIndex();
+    if (!enabled_ || drawableIndex >= cachedLighting_.size())
+        return EvaluateAmbientLighting(drawable, samplePosition, useGlobalIllumination, zone);
+
+    CachedAmbientLighting& cachedLighting = cachedLighting_[drawableIndex];
+    const unsigned zoneRevision = zone->GetLightingRevision();
+    const bool isValid = cachedLighting.revision_ == revision_
+        && cachedLighting.drawable_ == drawable
+        && cachedLighting.zone_ == zone
+        && cachedLighting.zoneRevision_ == zoneRevision
+        && cachedLighting.useGlobalIllumination_ == useGlobalIllumination
+        && cachedLighting.samplePosition_ == samplePosition;
+
+    if (!isValid)
+    {
+        cachedLighting.drawable_ = drawable;
+        cachedLighting.zone_ = zone;
+        cachedLighting.zoneRevision_ = zoneRevision;
+        cachedLighting.revision_ = revision_;
+        cachedLighting.useGlobalIllumination_ = useGlobalIllumination;
+        cachedLighting.samplePosition_ = samplePosition;
+        cachedLighting.ambient_ = EvaluateAmbientLighting(drawable, samplePosition, useGlobalIllumination, zone);
+    }
+    return cachedLighting.ambient_;
+}
+
+SphericalHarmonicsDot9 AmbientLightingCache::EvaluateAmbientLighting(Drawable* drawable, const Vector3& samplePosition,
+    bool useGlobalIllumination, Zone* zone)
+{
+    numEvaluations_.fetch_add(1, std::memory_order_relaxed);
+
+    // Sample GI if possible/needed, reset to zero otherwise
+    SphericalHarmonicsDot9 result;
+    if (useGlobalIllumination)
+        result = gi_->SampleAmbientSH(samplePosition, drawable->GetMutableLightProbeTetrahedronHint());
+
+    // Apply ambient from Zone
+    if (!zone->IsBackgroundStatic())
+        result += zone->GetAmbientAndBackgroundLighting();
+    else
+        result += zone->GetAmbientLighting();
+    return result;
+}
+
+}
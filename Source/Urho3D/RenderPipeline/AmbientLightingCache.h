@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Core/NonCopyable.h"
+#include "../Math/SphericalHarmonics.h"
+#include "../Math/Vector3.h"
+
+#include <EASTL/vector.h>
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+class Drawable;
+class GlobalIllumination;
+class Zone;
+
+/// Ambient lighting of drawables preserved between frames.
+/// Cached lighting is reused while the drawable doesn't move and neither its zone nor global illumination is changed.
+class URHO3D_API AmbientLightingCache : public NonCopyable
+{
+public:
+    /// Set whether the cache is enabled. Ambient lighting is evaluated on every call if disabled.
+    void SetEnabled(bool enabled) { enabled_ = enabled; }
+    /// Return whether the cache is enabled.
+    bool IsEnabled() const { return enabled_; }
+
+    /// Prepare cache for new frame. Should be called from main thread.
+    void BeginFrame(unsigned numDrawables, GlobalIllumination* gi);
+    /// Return ambient lighting of drawable. Zone of drawable should be up to date.
+    /// Safe to call from worker threads for different drawables.
+    SphericalHarmonicsDot9 GetAmbientLighting(Drawable* drawable, const Vector3& samplePosition);
+
+    /// Return number of ambient lighting evaluations since the beginning of the frame.
+    unsigned GetNumEvaluations() const { return numEvaluations_.load(std::memory_order_relaxed); }
+
+private:
+    /// Evaluate ambient lighting from global illumination and zone.
+    SphericalHarmonicsDot9 EvaluateAmbientLighting(Drawable* drawable, const Vector3& samplePosition,
+        bool useGlobalIllumination, Zone* zone);
+
+    /// Cached ambient lighting of drawable.
+    struct CachedAmbientLighting
+    {
+        Drawable* drawable_{};
+        Zone* zone_{};
+        unsigned zoneRevision_{};
+        unsigned revision_{};
+        bool useGlobalIllumination_{};
+        Vector3 samplePosition_;
+        SphericalHarmonicsDot9 ambient_;
+    };
+
+    /// Whether the cache is enabled.
+    bool enabled_{true};
+    /// Global illumination used in current frame.
+    GlobalIllumination* gi_{};
+    /// Revision of global illumination used in current frame.
+    unsigned giRevision_{};
+    /// Revision of the cache. All cached lighting is discarded when changed.
+    unsigned revision_{1};
+    /// Cached lighting indexed by drawable index.
+    ea::vector<CachedAmbientLighting> cachedLighting_;
+    /// Number of ambient lighting evaluations.
+    std::atomic<unsigned> numEvaluations_{};
+};
+
+}
@@ -234,6 +234,7 @@ void BatchCompositor::ComposeShadowBatches()
     URHO3D_PROFILE("PrepareShadowBatches");
 
     // Collect shadow caster batches in worker threads
+    shadowSplitTasks_.clear();
     const auto& lightProcessors = drawableProcessor_->GetLightProcessors();
     for (unsigned lightIndex = 0; lightIndex < lightProcessors.size(); ++lightIndex)
     {
@@ -241,13 +242,13 @@ void BatchCompositor::ComposeShadowBatches()
         const unsigned numSplits = lightProcessor->GetNumSplits();
         for (unsigned splitIndex = 0; splitIndex < numSplits; ++splitIndex)
         {
-            workQueue_->AddWorkItem([=](unsigned threadIndex)
+            shadowSplitTasks_.push_back(workQueue_->ScheduleTask([=](unsigned threadIndex)
             {
                 BeginShadowBatchesComposition(lightIndex, lightProcessor->GetMutableSplit(splitIndex));
-            }, M_MAX_UNSIGNED);
+            }));
         }
     }
-    workQueue_->Complete(M_MAX_UNSIGNED);
+    workQueue_->WaitTasks(shadowSplitTasks_);
 
     // Finalize shadow batches
     FinalizeShadowBatchesComposition();
@@ -397,6 +398,7 @@ void BatchCompositor::FinalizeShadowBatchesComposition()
     }
 
     // Finalize shadow batches
+    shadowSplitTasks_.clear();
     const auto& lightProcessors = drawableProcessor_->GetLightProcessors();
     for (unsigned lightIndex = 0; lightIndex < lightProcessors.size(); ++lightIndex)
     {
@@ -404,13 +406,13 @@ void BatchCompositor::FinalizeShadowBatchesComposition()
         const unsigned numSplits = lightProcessor->GetNumSplits();
         for (unsigned splitIndex = 0; splitIndex < numSplits; ++splitIndex)
         {
-            workQueue_->AddWorkItem([=](unsigned threadIndex)
+            shadowSplitTasks_.push_back(workQueue_->ScheduleTask([=](unsigned threadIndex)
             {
                 lightProcessor->GetMutableSplit(splitIndex)->FinalizeShadowBatches();
-            }, M_MAX_UNSIGNED);
+            }));
         }
     }
-    workQueue_->Complete(M_MAX_UNSIGNED);
+    workQueue_->WaitTasks(shadowSplitTasks_);
 }
 
 }
@@ -295,6 +295,7 @@ private:
     /// @}
 
     WorkQueueVector<ea::pair<ShadowSplitProcessor*, PipelineBatchDesc>> delayedShadowBatches_;
+    ea::vector<TaskHandle> shadowSplitTasks_;
     ea::vector<PipelineBatch> lightVolumeBatches_;
     ea::vector<PipelineBatchByState> sortedLightVolumeBatches_;
 };
@@ -38,6 +38,7 @@
 #include "../RenderPipeline/RenderPipelineDefs.h"
 #include "../Scene/Scene.h"
 
+#include <EASTL/algorithm.h>
 #include <EASTL/sort.h>
 
 #include "../DebugNew.h"
@@ -48,6 +49,9 @@ namespace Urho3D
 namespace
 {
 
+/// Min number of point and spot lights without shadows to use light binning instead of octree queries.
+const unsigned MinLightsForBinning = 4;
+
 /// Calculate light penalty for drawable for given absolute light penalty and light settings
 /// Order of penalties, from lower to higher:
 /// -2:      Important directional lights;
@@ -178,6 +182,7 @@ void DrawableProcessor::SetSettings(const DrawableProcessorSettings& settings)
 {
     settings_ = settings;
     lightProcessorCache_->SetSettings(settings_.lightProcessorCache_);
+    ambientLightingCache_.SetEnabled(settings_.cacheAmbientLighting_);
 }
 
 void DrawableProcessor::OnUpdateBegin(const FrameInfo& frameInfo)
@@ -220,11 +225,13 @@ void DrawableProcessor::OnUpdateBegin(const FrameInfo& frameInfo)
     nonThreadedGeometryUpdates_.Clear();
 
     lightsTemp_.Clear();
+    isLightBinningValid_ = false;
 
     queuedDrawableUpdates_.Clear();
 
     // Update caches
     lightProcessorCache_->Update(frameInfo.timeStep_);
+    ambientLightingCache_.BeginFrame(numDrawables_, gi_);
 }
 
 void DrawableProcessor::OnCollectStatistics(RenderPipelineStats& stats)
@@ -508,25 +515,12 @@ void DrawableProcessor::ProcessVisibleDrawable(Drawable* drawable)
         // Process lighting
         if (needAmbient)
         {
-            const GlobalIlluminationType giType = drawable->GetGlobalIlluminationType();
             const ReflectionMode reflectionMode = drawable->GetReflectionMode();
 
-            // Reset SH from GI if possible/needed, reset to zero otherwise
-            if (gi_ && giType >= GlobalIlluminationType::BlendLightProbes)
-            {
-                unsigned& hint = drawable->GetMutableLightProbeTetrahedronHint();
-                const Vector3& samplePosition = boundingBox.Center();
-                lightAccumulator.sphericalHarmonics_ = gi_->SampleAmbientSH(samplePosition, hint);
-            }
-            else
-                lightAccumulator.sphericalHarmonics_ = {};
+            // Apply ambient from GI and Zone, reuse previous frame if nothing changed
+            lightAccumulator.sphericalHarmonics_ = ambientLightingCache_.GetAmbientLighting(drawable, boundingBox.Center());
 
-            // Apply ambient from Zone
             const CachedDrawableZone& cachedZone = drawable->GetMutableCachedZone();
-            if (!cachedZone.zone_->IsBackgroundStatic())
-                lightAccumulator.sphericalHarmonics_ += cachedZone.zone_->GetAmbientAndBackgroundLighting();
-            else
-                lightAccumulator.sphericalHarmonics_ += cachedZone.zone_->GetAmbientLighting();
 
             lightAccumulator.reflectionProbes_[0] = cachedZone.zone_->GetReflectionProbe();
             lightAccumulator.reflectionProbes_[1] = lightAccumulator.reflectionProbes_[0];
@@ -593,6 +587,8 @@ void DrawableProcessor::ProcessLights(LightProcessorCallback* callback)
     for (LightProcessor* lightProcessor : lightProcessors_)
         lightProcessor->BeginUpdate(this, callback);
 
+    UpdateLightBinning();
+
     ForEachParallel(workQueue_, lightProcessors_,
         [&](unsigned /*index*/, LightProcessor* lightProcessor)
     {
@@ -614,6 +610,36 @@ void DrawableProcessor::ProcessLights(LightProcessorCallback* callback)
     ProcessShadowCasters();
 }
 
+void DrawableProcessor::UpdateLightBinning()
+{
+    isLightBinningValid_ = false;
+    if (!settings_.clusteredLightBinning_)
+        return;
+
+    // Shadowed lights need octree query anyway to find shadow casters
+    const auto isBinned = [](const LightProcessor* lightProcessor)
+    {
+        return lightProcessor->GetLight()->GetLightType() != LIGHT_DIRECTIONAL && !lightProcessor->IsShadowRequested();
+    };
+    const unsigned numBinnedLights = ea::count_if(lightProcessors_.begin(), lightProcessors_.end(), isBinned);
+    if (numBinnedLights < MinLightsForBinning)
+        return;
+
+    URHO3D_PROFILE("UpdateLightBinning");
+
+    const unsigned viewMask = frameInfo_.camera_->GetViewMask();
+    litGeometriesTemp_.clear();
+    for (Drawable* geometry : geometries_)
+    {
+        const unsigned char flags = geometryFlags_[geometry->GetDrawableIndex()];
+        if ((flags & GeometryRenderFlag::Lit) && (geometry->GetViewMask() & viewMask))
+            litGeometriesTemp_.push_back(geometry);
+    }
+
+    lightBinning_.Build(litGeometriesTemp_);
+    isLightBinningValid_ = true;
+}
+
 void DrawableProcessor::ProcessForwardLightingForLight(
     unsigned lightIndex, const ea::vector<Drawable*>& litGeometries)
 {
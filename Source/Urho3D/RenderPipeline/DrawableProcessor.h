@@ -26,6 +26,8 @@
 #include "../Core/WorkQueue.h"
 #include "../Graphics/GraphicsDefs.h"
 #include "../Math/NumericRange.h"
+#include "../RenderPipeline/AmbientLightingCache.h"
+#include "../RenderPipeline/LightBinning.h"
 #include "../RenderPipeline/RenderPipelineDefs.h"
 #include "../RenderPipeline/LightAccumulator.h"
 
@@ -207,6 +209,9 @@ public:
     const auto& GetLightProcessorsByShadowMap() const { return lightProcessorsByShadowMapTexture_; }
     /// @}
 
+    /// Return light binning of lit geometries, if available. Valid during threaded update of lights.
+    const LightBinning* GetLightBinning() const { return isLightBinningValid_ ? &lightBinning_ : nullptr; }
+
     /// Return information from global drawable index. May be invalid for invisible drawables.
     /// @{
     unsigned char GetGeometryRenderFlags(unsigned drawableIndex) const { return geometryFlags_[drawableIndex]; }
@@ -243,6 +248,7 @@ protected:
 
     FloatRange CalculateBoundingBoxZRange(const BoundingBox& boundingBox) const;
 
+    void UpdateLightBinning();
     void SortLightProcessorsByShadowMapSize();
     void SortLightProcessorsByShadowMapTexture();
 
@@ -268,6 +274,7 @@ private:
     ea::vector<DrawableProcessorPass*> passes_;
     DrawableProcessorSettings settings_;
     ea::unique_ptr<LightProcessorCache> lightProcessorCache_;
+    AmbientLightingCache ambientLightingCache_;
     /// @}
 
     /// Constant within frame, changes between frames
@@ -308,6 +315,10 @@ private:
     ea::vector<LightProcessor*> lightProcessorsByShadowMapTexture_;
     unsigned numShadowedLights_{};
 
+    LightBinning lightBinning_;
+    bool isLightBinningValid_{};
+    ea::vector<Drawable*> litGeometriesTemp_;
+
     WorkQueueVector<Drawable*> queuedDrawableUpdates_;
 };
 
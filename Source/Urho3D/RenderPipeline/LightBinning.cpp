@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../RenderPipeline/LightBinning.h"
+
+#include "../Graphics/Drawable.h"
+
+#include <cmath>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Desired number of geometries in one cell.
+const unsigned GEOMETRIES_PER_CELL = 32;
+/// Max number of cells along each axis.
+const unsigned MAX_CELLS_PER_AXIS = 16;
+
+/// Return bounding box of culling shape.
+BoundingBox GetShapeBoundingBox(const OctreeCullingShape& shape)
+{
+    switch (shape.type_)
+    {
+    case OctreeCullingShape::Type::Frustum:
+        return BoundingBox(shape.frustum_);
+    case OctreeCullingShape::Type::Sphere:
+        return BoundingBox(shape.sphere_);
+    case OctreeCullingShape::Type::Box:
+        return shape.box_;
+    default:
+        return BoundingBox(-M_LARGE_VALUE, M_LARGE_VALUE);
+    }
+}
+
+}
+
+void LightBinning::Build(const ea::vector<Drawable*>& geometries)
+{
+    geometries_.clear();
+    cullingData_.Clear();
+    cells_.clear();
+    largeGeometriesIndex_ = 0;
+    numCellsPerAxis_ = 0;
+
+    const unsigned numGeometries = geometries.size();
+    if (numGeometries == 0)
+        return;
+
+    // Initialize grid to cover centers of all geometries
+    BoundingBox centersBox;
+    for (Drawable* geometry : geometries)
+        centersBox.Merge(geometry->GetWorldBoundingBox().Center());
+
+    const float desiredNumCells = std::cbrt(static_cast<float>(numGeometries) / GEOMETRIES_PER_CELL);
+    numCellsPerAxis_ = Clamp(static_cast<unsigned>(desiredNumCells), 1u, MAX_CELLS_PER_AXIS);
+    gridOrigin_ = centersBox.min_;
+    cellSize_ = VectorMax(centersBox.Size() / static_cast<float>(numCellsPerAxis_), Vector3::ONE * M_EPSILON);
+
+    // Find cell of each geometry, large geometries are stored after all cells
+    const unsigned numCells = numCellsPerAxis_ * numCellsPerAxis_ * numCellsPerAxis_;
+    const Vector3 maxCellHalfSize = cellSize_ * 0.5f;
+    cells_.resize(numCells + 1);
+    cellIndices_.resize(numGeometries);
+    maxHalfSize_ = Vector3::ZERO;
+    for (unsigned i = 0; i < numGeometries; ++i)
+    {
+        const BoundingBox& boundingBox = geometries[i]->GetWorldBoundingBox();
+        const Vector3 halfSize = boundingBox.HalfSize();
+        unsigned cellIndex = numCells;
+        if (halfSize.x_ <= maxCellHalfSize.x_ && halfSize.y_ <= maxCellHalfSize.y_ && halfSize.z_ <= maxCellHalfSize.z_)
+        {
+            const IntVector3 coords = GetCellCoordinates(boundingBox.Center());
+            cellIndex = (coords.z_ * numCellsPerAxis_ + coords.y_) * numCellsPerAxis_ + coords.x_;
+            maxHalfSize_ = VectorMax(maxHalfSize_, halfSize);
+        }
+
+        cellIndices_[i] = cellIndex;
+        cells_[cellIndex].boundingBox_.Merge(boundingBox);
+        ++cells_[cellIndex].endIndex_;
+    }
+
+    // Sort geometries by cells
+    unsigned offset = 0;
+    for (Cell& cell : cells_)
+    {
+        const unsigned count = cell.endIndex_;
+        cell.beginIndex_ = offset;
+        cell.endIndex_ = offset;
+        offset += count;
+    }
+
+    geometries_.resize(numGeometries);
+    for (unsigned i = 0; i < numGeometries; ++i)
+        geometries_[cells_[cellIndices_[i]].endIndex_++] = geometries[i];
+
+    for (Drawable* geometry : geometries_)
+        cullingData_.Add(geometry->GetWorldBoundingBox(), DRAWABLE_GEOMETRY, geometry->GetLightMaskInZone());
+
+    largeGeometriesIndex_ = cells_.back().beginIndex_;
+    cells_.pop_back();
+}
+
+void LightBinning::GetGeometries(const OctreeCullingShape& shape, unsigned lightMask, ea::vector<Drawable*>& result) const
+{
+    if (geometries_.empty())
+        return;
+
+    const BoundingBox shapeBox = GetShapeBoundingBox(shape);
+
+    // Large geometries are tested against every shape
+    cullingData_.CullRange(shape, false, DRAWABLE_GEOMETRY, lightMask, geometries_.data(),
+        largeGeometriesIndex_, geometries_.size(), result);
+
+    // Geometry in the cell may exceed cell bounds by max half size
+    const IntVector3 minCoords = GetCellCoordinates(shapeBox.min_ - maxHalfSize_);
+    const IntVector3 maxCoords = GetCellCoordinates(shapeBox.max_ + maxHalfSize_);
+    for (int z = minCoords.z_; z <= maxCoords.z_; ++z)
+    {
+        for (int y = minCoords.y_; y <= maxCoords.y_; ++y)
+        {
+            for (int x = minCoords.x_; x <= maxCoords.x_; ++x)
+            {
+                const Cell& cell = cells_[(z * numCellsPerAxis_ + y) * numCellsPerAxis_ + x];
+                if (cell.beginIndex_ == cell.endIndex_ || shapeBox.IsInsideFast(cell.boundingBox_) == OUTSIDE)
+                    continue;
+
+                cullingData_.CullRange(shape, false, DRAWABLE_GEOMETRY, lightMask, geometries_.data(),
+                    cell.beginIndex_, cell.endIndex_, result);
+            }
+        }
+    }
+}
+
+IntVector3 LightBinning::GetCellCoordinates(const Vector3& position) const
+{
+    // Clamp before conversion to avoid overflow for huge shapes
+    const float maxCoord = static_cast<float>(numCellsPerAxis_ - 1);
+    const Vector3 coords = VectorMin(VectorMax((position - gridOrigin_) / cellSize_, Vector3::ZERO), Vector3::ONE * maxCoord);
+    return VectorFloorToInt(coords);
+}
+
+}
@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Core/NonCopyable.h"
+#include "../Graphics/OctreeCulling.h"
+#include "../Math/BoundingBox.h"
+#include "../Math/Vector3.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Drawable;
+
+/// Clustered index of lit geometries used to find geometries affected by point and spot lights without octree queries.
+/// Geometries are grouped into cells of uniform grid by the center of bounding box.
+/// Geometries larger than the cell are stored separately and tested against every light.
+class URHO3D_API LightBinning : public NonCopyable
+{
+public:
+    /// Build clusters from geometries. Light mask in zone of each geometry is used for filtering.
+    void Build(const ea::vector<Drawable*>& geometries);
+    /// Append geometries intersecting the shape and matching the light mask. Thread-safe.
+    void GetGeometries(const OctreeCullingShape& shape, unsigned lightMask, ea::vector<Drawable*>& result) const;
+
+    /// Return number of geometries.
+    unsigned GetNumGeometries() const { return geometries_.size(); }
+    /// Return number of cells along each axis.
+    unsigned GetNumCellsPerAxis() const { return numCellsPerAxis_; }
+
+private:
+    /// Cell of the grid.
+    struct Cell
+    {
+        /// Bounding box of geometries in the cell.
+        BoundingBox boundingBox_;
+        /// Index of first geometry.
+        unsigned beginIndex_{};
+        /// Index after last geometry.
+        unsigned endIndex_{};
+    };
+
+    /// Return cell coordinates for the position.
+    IntVector3 GetCellCoordinates(const Vector3& position) const;
+
+    /// Geometries sorted by cells, followed by large geometries.
+    ea::vector<Drawable*> geometries_;
+    /// Culling data in the same order as geometries.
+    DrawableCullingData cullingData_;
+    /// Cells of the grid.
+    ea::vector<Cell> cells_;
+    /// Index of the first large geometry.
+    unsigned largeGeometriesIndex_{};
+
+    /// Number of cells along each axis.
+    unsigned numCellsPerAxis_{};
+    /// Origin of the grid.
+    Vector3 gridOrigin_;
+    /// Size of the cell.
+    Vector3 cellSize_;
+    /// Max half size of geometry stored in cell.
+    Vector3 maxHalfSize_;
+    /// Temporary cell indices of geometries.
+    ea::vector<unsigned> cellIndices_;
+};
+
+}
@@ -187,6 +187,28 @@ void LightProcessor::BeginUpdate(DrawableProcessor* drawableProcessor, LightProc
     }
 }
 
+bool LightProcessor::QueryLitGeometriesFromBinning(DrawableProcessor* drawableProcessor)
+{
+    // Shadowed lights need octree query anyway to find shadow casters
+    const LightBinning* lightBinning = drawableProcessor->GetLightBinning();
+    if (!lightBinning || isShadowRequested_)
+        return false;
+
+    const OctreeCullingShape shape = light_->GetLightType() == LIGHT_SPOT
+        ? OctreeCullingShape::FromFrustum(light_->GetFrustum())
+        : OctreeCullingShape::FromSphere(Sphere(light_->GetNode()->GetWorldPosition(), light_->GetRange()));
+    lightBinning->GetGeometries(shape, light_->GetLightMaskEffective(), litGeometries_);
+    hasLitGeometries_ = !litGeometries_.empty();
+
+    ea::erase_if(litGeometries_, [&](Drawable* drawable)
+    {
+        const unsigned char flags = drawableProcessor->GetGeometryRenderFlags(drawable->GetDrawableIndex());
+        return !(flags & GeometryRenderFlag::ForwardLit);
+    });
+    hasForwardLitGeometries_ = !litGeometries_.empty();
+    return true;
+}
+
 void LightProcessor::Update(DrawableProcessor* drawableProcessor, const LightProcessorCallback* callback)
 {
     const FrameInfo& frameInfo = drawableProcessor->GetFrameInfo();
@@ -202,6 +224,9 @@ void LightProcessor::Update(DrawableProcessor* drawableProcessor, const LightPro
     {
     case LIGHT_SPOT:
     {
+        if (QueryLitGeometriesFromBinning(drawableProcessor))
+            break;
+
         SpotLightGeometryQuery query(litGeometries_, hasLitGeometries_,
             isShadowRequested_ ? &shadowCasterCandidates_ : nullptr,
             drawableProcessor, light_, cullCamera->GetViewMask());
@@ -211,6 +236,9 @@ void LightProcessor::Update(DrawableProcessor* drawableProcessor, const LightPro
     }
     case LIGHT_POINT:
     {
+        if (QueryLitGeometriesFromBinning(drawableProcessor))
+            break;
+
         PointLightGeometryQuery query(litGeometries_, hasLitGeometries_,
             isShadowRequested_ ? &shadowCasterCandidates_ : nullptr,
             drawableProcessor, light_, cullCamera->GetViewMask());
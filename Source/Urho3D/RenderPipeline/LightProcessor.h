@@ -114,6 +114,11 @@ public:
     Light* GetLight() const { return light_; }
     /// @}
 
+    /// Return values are valid after BeginUpdate
+    /// @{
+    bool IsShadowRequested() const { return isShadowRequested_; }
+    /// @}
+
     /// Return values are valid after threaded update
     /// @{
     const ea::vector<Drawable*>& GetLitGeometries() const { return litGeometries_; }
@@ -138,6 +143,8 @@ public:
     /// @}
 
 private:
+    /// Find lit geometries via light binning if possible. Return false if octree query is required.
+    bool QueryLitGeometriesFromBinning(DrawableProcessor* drawableProcessor);
     void InitializeShadowSplits(DrawableProcessor* drawableProcessor);
     void UpdateHashes();
     void CookShaderParameters(Camera* cullCamera, const DrawableProcessorSettings& settings);
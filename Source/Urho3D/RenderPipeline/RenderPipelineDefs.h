@@ -317,6 +317,10 @@ struct DrawableProcessorSettings
     unsigned maxVertexLights_{ 4 };
     unsigned maxPixelLights_{ 4 };
     unsigned pcfKernelSize_{ 1 };
+    /// Whether to reuse ambient lighting of drawables between frames.
+    bool cacheAmbientLighting_{ true };
+    /// Whether to find geometries lit by unshadowed point and spot lights via clustered light binning.
+    bool clusteredLightBinning_{ true };
     LightProcessorCacheSettings lightProcessorCache_;
 
     /// Utility operators
@@ -346,6 +350,8 @@ struct DrawableProcessorSettings
             && maxVertexLights_ == rhs.maxVertexLights_
             && maxPixelLights_ == rhs.maxPixelLights_
             && pcfKernelSize_ == rhs.pcfKernelSize_
+            && cacheAmbientLighting_ == rhs.cacheAmbientLighting_
+            && clusteredLightBinning_ == rhs.clusteredLightBinning_
             && lightProcessorCache_ == rhs.lightProcessorCache_;
     }
 
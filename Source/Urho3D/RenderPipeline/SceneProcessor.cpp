@@ -307,9 +307,8 @@ void SceneProcessor::Update()
     else
     {
         URHO3D_PROFILE("QueryVisibleDrawables");
-        FrustumOctreeQuery drawableQuery(drawables_, frustum,
+        frameInfo_.octree_->GetDrawablesInFrustum(drawables_, frustum,
             DRAWABLE_GEOMETRY | DRAWABLE_LIGHT, frameInfo_.camera_->GetViewMask());
-        frameInfo_.octree_->GetDrawables(drawableQuery);
     }
 
     // Process drawables
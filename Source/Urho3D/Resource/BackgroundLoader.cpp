@@ -26,100 +26,108 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/Timer.h"
 #include "../IO/Log.h"
 #include "../Resource/BackgroundLoader.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
 
+#include <EASTL/sort.h>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+namespace
+{
+
+bool IsHigherPriority(ResourceLoadPriority lhs, ResourceLoadPriority rhs)
+{
+    return lhs < rhs;
+}
+
+}
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+    owner_(owner),
+    workQueue_(owner->GetSubsystem<WorkQueue>())
 {
 }
 
 BackgroundLoader::~BackgroundLoader()
 {
-    MutexLock lock(backgroundLoadMutex_);
+    ea::vector<TaskHandle> tasks;
 
+    backgroundLoadMutex_.Acquire();
+    shutDown_ = true;
+    for (ea::deque<ItemKey>& pendingItems : pendingItems_)
+        pendingItems.clear();
+    for (const auto& [key, item] : backgroundLoadQueue_)
+    {
+        if (item.task_.IsValid())
+            tasks.push_back(item.task_);
+    }
+    backgroundLoadMutex_.Release();
+
+    // Tasks reference the loader, so they should be completed before it's destroyed
+    if (WorkQueue* workQueue = workQueue_)
+        workQueue->WaitTasks(tasks);
+
+    MutexLock lock(backgroundLoadMutex_);
     backgroundLoadQueue_.clear();
 }
 
-void BackgroundLoader::ThreadFunction()
+bool BackgroundLoader::QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller,
+    ResourceLoadPriority priority)
 {
-    URHO3D_PROFILE_THREAD("BackgroundLoader Thread");
+    StringHash nameHash(name);
+    ItemKey key = ea::make_pair(type, nameHash);
 
-    while (shouldRun_)
-    {
-        backgroundLoadMutex_.Acquire();
+    MutexLock lock(backgroundLoadMutex_);
 
-        // Search for a queued resource that has not been loaded yet
-        auto i = backgroundLoadQueue_.begin();
-        while (i != backgroundLoadQueue_.end())
-        {
-            if (i->second.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
-        }
+    // If this is a resource calling for the background load of more resources, mark the dependency as necessary.
+    // The dependency is loaded with at least the same priority as the caller.
+    const auto linkCaller = [&](BackgroundLoadItem& item)
+    {
+        if (!caller)
+            return;
 
-        if (i == backgroundLoadQueue_.end())
+        ItemKey callerKey = ea::make_pair(caller->GetType(), caller->GetNameHash());
+        auto j = backgroundLoadQueue_.find(callerKey);
+        if (j != backgroundLoadQueue_.end())
         {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
+            BackgroundLoadItem& callerItem = j->second;
+            item.dependents_.insert(callerKey);
+            callerItem.dependencies_.insert(key);
+            if (IsHigherPriority(callerItem.priority_, priority))
+                priority = callerItem.priority_;
         }
         else
-        {
-            BackgroundLoadItem& item = i->second;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
+            URHO3D_LOGWARNING("Resource " + caller->GetName() +
+                       " requested for a background loaded resource but was not in the background load queue");
+    };
 
-            bool success = false;
-            AbstractFilePtr file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
-
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            ea::pair<StringHash, StringHash> key = ea::make_pair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.size())
-            {
-                for (auto i = item.dependents_.begin(); i != item.dependents_.end(); ++i)
-                {
-                    auto j = backgroundLoadQueue_.find(*i);
-                    if (j != backgroundLoadQueue_.end())
-                        j->second.dependencies_.erase(key);
-                }
-
-                item.dependents_.clear();
-            }
-
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
-        }
-    }
-}
+    // Check if already exists in the queue
+    auto i = backgroundLoadQueue_.find(key);
+    if (i != backgroundLoadQueue_.end())
+    {
+        BackgroundLoadItem& item = i->second;
 
-bool BackgroundLoader::QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller)
-{
-    StringHash nameHash(name);
-    ea::pair<StringHash, StringHash> key = ea::make_pair(type, nameHash);
+        // Dependents are notified when loading is done, so link the caller only if the resource is not loaded yet
+        const AsyncLoadState state = item.resource_->GetAsyncLoadState();
+        if (state == ASYNC_QUEUED || state == ASYNC_LOADING)
+            linkCaller(item);
 
-    MutexLock lock(backgroundLoadMutex_);
+        // Re-queue cancelled resource
+        const bool wasCancelled = item.cancelled_;
+        item.cancelled_ = false;
 
-    // Check if already exists in the queue
-    if (backgroundLoadQueue_.find(key) != backgroundLoadQueue_.end())
-        return false;
+        RaisePriority(key, priority);
+        DispatchItems();
+        return wasCancelled;
+    }
 
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
@@ -148,111 +156,150 @@ bool BackgroundLoader::QueueResource(StringHash type, const ea::string& name, bo
     item.resource_->SetName(name);
     item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
 
-    // If this is a resource calling for the background load of more resources, mark the dependency as necessary
-    if (caller)
-    {
-        ea::pair<StringHash, StringHash> callerKey = ea::make_pair(caller->GetType(), caller->GetNameHash());
-        auto j = backgroundLoadQueue_.find(
-            callerKey);
-        if (j != backgroundLoadQueue_.end())
-        {
-            BackgroundLoadItem& callerItem = j->second;
-            item.dependents_.insert(callerKey);
-            callerItem.dependencies_.insert(key);
-        }
-        else
-            URHO3D_LOGWARNING("Resource " + caller->GetName() +
-                       " requested for a background loaded resource but was not in the background load queue");
-    }
+    linkCaller(item);
+    item.priority_ = priority;
+    pendingItems_[static_cast<unsigned>(priority)].push_back(key);
 
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    DispatchItems();
+    return true;
+}
+
+bool BackgroundLoader::CancelResource(StringHash type, StringHash nameHash)
+{
+    ItemKey key = ea::make_pair(type, nameHash);
+
+    MutexLock lock(backgroundLoadMutex_);
 
+    auto i = backgroundLoadQueue_.find(key);
+    if (i == backgroundLoadQueue_.end())
+        return false;
+
+    // Resource that is being loaded cannot be interrupted, it will be discarded when loaded
+    if (i->second.dispatched_)
+        i->second.cancelled_ = true;
+    else
+        RemoveItem(key);
     return true;
 }
 
 void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 {
+    ItemKey key = ea::make_pair(type, nameHash);
+
     backgroundLoadMutex_.Acquire();
 
     // Check if the resource in question is being background loaded
-    ea::pair<StringHash, StringHash> key = ea::make_pair(type, nameHash);
     auto i = backgroundLoadQueue_.find(key);
-    if (i != backgroundLoadQueue_.end())
+    if (i == backgroundLoadQueue_.end())
     {
         backgroundLoadMutex_.Release();
+        return;
+    }
+
+    // Resource is needed right now, so load it and everything it depends on with the highest priority
+    i->second.cancelled_ = false;
+    RaisePriority(key, ResourceLoadPriority::Immediate);
+    DispatchItems();
 
+    // Queue may change while items are dispatched
+    i = backgroundLoadQueue_.find(key);
+    if (i == backgroundLoadQueue_.end())
+    {
+        backgroundLoadMutex_.Release();
+        return;
+    }
+
+    Resource* resource = i->second.resource_;
+    HiresTimer waitTimer;
+    bool didWait = false;
+    ea::vector<TaskHandle> tasks;
+
+    while (!IsItemReady(i->second))
+    {
+        didWait = true;
+
+        // Help to execute tasks of the resource and its dependencies instead of sleeping
+        tasks.clear();
+        tasks.push_back(i->second.task_);
+        for (const ItemKey& dependency : i->second.dependencies_)
         {
-            Resource* resource = i->second.resource_;
-            HiresTimer waitTimer;
-            bool didWait = false;
-
-            for (;;)
-            {
-                unsigned numDeps = i->second.dependencies_.size();
-                AsyncLoadState state = resource->GetAsyncLoadState();
-                if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
-                {
-                    didWait = true;
-                    Time::Sleep(1);
-                }
-                else
-                    break;
-            }
-
-            if (didWait)
-                URHO3D_LOGDEBUG("Waited " + ea::to_string(waitTimer.GetUSec(false) / 1000) + " ms for background loaded resource " +
-                         resource->GetName());
+            auto j = backgroundLoadQueue_.find(dependency);
+            if (j != backgroundLoadQueue_.end() && j->second.task_.IsValid())
+                tasks.push_back(j->second.task_);
         }
 
-        // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this
-        FinishBackgroundLoading(i->second);
-
-        backgroundLoadMutex_.Acquire();
-        // Erasing by key since queue may change since iterator been acquired.
-        backgroundLoadQueue_.erase(key);
         backgroundLoadMutex_.Release();
+        if (WorkQueue* workQueue = workQueue_)
+            workQueue->WaitTasks(tasks);
+        else
+            Time::Sleep(1);
+        backgroundLoadMutex_.Acquire();
+
+        // Queue may change while the mutex is released
+        i = backgroundLoadQueue_.find(key);
+        if (i == backgroundLoadQueue_.end())
+        {
+            backgroundLoadMutex_.Release();
+            return;
+        }
     }
-    else
-        backgroundLoadMutex_.Release();
+
+    if (didWait)
+        URHO3D_LOGDEBUG("Waited " + ea::to_string(waitTimer.GetUSec(false) / 1000) + " ms for background loaded resource " +
+                 resource->GetName());
+
+    // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this
+    backgroundLoadMutex_.Release();
+    FinishBackgroundLoading(i->second);
+    backgroundLoadMutex_.Acquire();
+
+    // Erasing by key since queue may change since iterator been acquired.
+    RemoveItem(key);
+    backgroundLoadMutex_.Release();
 }
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    HiresTimer timer;
+
+    backgroundLoadMutex_.Acquire();
+
+    // Finish resources with higher priority first
+    readyItems_.clear();
+    for (const auto& [key, item] : backgroundLoadQueue_)
     {
-        HiresTimer timer;
+        // Cancelled resources are discarded as soon as they are loaded
+        if (IsItemReady(item, !item.cancelled_))
+            readyItems_.emplace_back(item.priority_, key);
+    }
+    ea::sort(readyItems_.begin(), readyItems_.end(),
+        [](const auto& lhs, const auto& rhs) { return IsHigherPriority(lhs.first, rhs.first); });
 
-        backgroundLoadMutex_.Acquire();
+    for (const auto& [priority, key] : readyItems_)
+    {
+        // Resource may be already finished by WaitForResource
+        auto i = backgroundLoadQueue_.find(key);
+        if (i == backgroundLoadQueue_.end())
+            continue;
 
-        for (auto i = backgroundLoadQueue_.begin(); i != backgroundLoadQueue_.end();
-             i = backgroundLoadQueue_.begin())
+        if (!i->second.cancelled_)
         {
-            const auto key = i->first;
-            Resource* resource = i->second.resource_;
-            unsigned numDeps = i->second.dependencies_.size();
-            AsyncLoadState state = resource->GetAsyncLoadState();
-            if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
-                ++i;
-            else
-            {
-                // Finishing a resource may need it to wait for other resources to load, in which case we can not
-                // hold on to the mutex
-                backgroundLoadMutex_.Release();
-                FinishBackgroundLoading(i->second);
-                backgroundLoadMutex_.Acquire();
-                // Erasing by key because the queue may change since last time
-                backgroundLoadQueue_.erase(key);
-            }
-
-            // Break when the time limit passed so that we keep sufficient FPS
-            if (timer.GetUSec(false) >= maxMs * 1000LL)
-                break;
+            // Finishing a resource may need it to wait for other resources to load, in which case we can not
+            // hold on to the mutex
+            backgroundLoadMutex_.Release();
+            FinishBackgroundLoading(i->second);
+            backgroundLoadMutex_.Acquire();
         }
 
-        backgroundLoadMutex_.Release();
+        // Erasing by key because the queue may change since last time
+        RemoveItem(key);
+
+        // Break when the time limit passed so that we keep sufficient FPS
+        if (timer.GetUSec(false) >= maxMs * 1000LL)
+            break;
     }
+
+    backgroundLoadMutex_.Release();
 }
 
 unsigned BackgroundLoader::GetNumQueuedResources() const
@@ -261,6 +308,185 @@ unsigned BackgroundLoader::GetNumQueuedResources() const
     return backgroundLoadQueue_.size();
 }
 
+void BackgroundLoader::DispatchItems()
+{
+    if (shutDown_)
+        return;
+
+    const unsigned maxLoads = maxConcurrentLoads_ ? maxConcurrentLoads_ : MAX_IO_QUEUE_DEPTH;
+
+    for (unsigned priorityIndex = 0; priorityIndex < pendingItems_.size(); ++priorityIndex)
+    {
+        const auto priority = static_cast<ResourceLoadPriority>(priorityIndex);
+        ea::deque<ItemKey>& pendingItems = pendingItems_[priorityIndex];
+        while (!pendingItems.empty())
+        {
+            // Mutex may be released during dispatch, so the loader may be shut down in the meantime
+            if (shutDown_)
+                return;
+
+            if (priority != ResourceLoadPriority::Immediate && numActiveLoads_ >= maxLoads)
+                return;
+
+            const ItemKey key = pendingItems.front();
+            pendingItems.pop_front();
+
+            // Skip stale keys of removed, already dispatched or re-prioritized items
+            auto i = backgroundLoadQueue_.find(key);
+            if (i == backgroundLoadQueue_.end() || i->second.dispatched_ || i->second.priority_ != priority)
+                continue;
+
+            DispatchItem(key, i->second);
+        }
+    }
+}
+
+void BackgroundLoader::DispatchItem(const ItemKey& key, BackgroundLoadItem& item)
+{
+    item.dispatched_ = true;
+    ++numActiveLoads_;
+
+    // We can be sure that the item is not removed from the queue as long as it is being loaded
+    BackgroundLoadItem* itemPtr = &item;
+
+    // Decoding is submitted when the file is read, worker threads don't wait for I/O.
+    // WorkQueue executes the task immediately if its pool is exhausted. The file is not read at this point,
+    // so decoding is skipped until the task is stored in the item, and the item is loaded below instead.
+    WorkQueue* workQueue = workQueue_;
+    const auto decode = [this, key, itemPtr](unsigned)
+    {
+        if (itemPtr->task_.IsValid())
+            DecodeItem(key, *itemPtr);
+    };
+    const TaskHandle decodeTask = workQueue ? workQueue->CreateTask(decode) : TaskHandle{};
+    if (!decodeTask.IsValid())
+    {
+        // This may take a long time and may queue other resources, so it is important we do not hold the mutex during this
+        backgroundLoadMutex_.Release();
+        SetItemFile(item, owner_->GetFile(item.resource_->GetName(), item.sendEventOnFailure_));
+        DecodeItem(key, item);
+        backgroundLoadMutex_.Acquire();
+        return;
+    }
+
+    // Reading is executed immediately if the pool is exhausted, it only starts asynchronous read
+    item.task_ = decodeTask;
+    workQueue->ScheduleTask([this, itemPtr, decodeTask](unsigned) { ReadItem(*itemPtr, decodeTask); });
+}
+
+void BackgroundLoader::RaisePriority(const ItemKey& key, ResourceLoadPriority priority)
+{
+    auto i = backgroundLoadQueue_.find(key);
+    if (i == backgroundLoadQueue_.end())
+        return;
+
+    BackgroundLoadItem& item = i->second;
+    if (!IsHigherPriority(priority, item.priority_))
+        return;
+
+    item.priority_ = priority;
+    if (!item.dispatched_)
+        pendingItems_[static_cast<unsigned>(priority)].push_back(key);
+
+    for (const ItemKey& dependency : item.dependencies_)
+        RaisePriority(dependency, priority);
+}
+
+void BackgroundLoader::ReadItem(BackgroundLoadItem& item, TaskHandle decodeTask)
+{
+    URHO3D_PROFILE("ReadBackgroundLoadedResource");
+
+    // Work queue may be destroyed on shutdown while the file is being read
+    WeakPtr<WorkQueue> workQueue = workQueue_;
+    const auto submitDecode = [workQueue, decodeTask]()
+    {
+        if (WorkQueue* queue = workQueue)
+            queue->SubmitTask(decodeTask);
+    };
+    const auto onRead = [this, &item, submitDecode](AbstractFilePtr file)
+    {
+        SetItemFile(item, file);
+        submitDecode();
+    };
+
+    if (!owner_->ReadFileAsync(item.resource_->GetName(), onRead, item.sendEventOnFailure_))
+        submitDecode();
+}
+
+void BackgroundLoader::SetItemFile(BackgroundLoadItem& item, AbstractFilePtr file)
+{
+    if (!file)
+        return;
+
+    Resource* resource = item.resource_;
+    resource->SetAsyncLoadState(ASYNC_LOADING);
+    resource->SetAbsoluteFileName(file->GetAbsoluteName());
+    item.file_ = file;
+}
+
+void BackgroundLoader::DecodeItem(const ItemKey& key, BackgroundLoadItem& item)
+{
+    Resource* resource = item.resource_;
+
+    bool success = false;
+    if (item.file_)
+    {
+        URHO3D_PROFILE("DecodeBackgroundLoadedResource");
+        success = resource->BeginLoadCached(*item.file_);
+    }
+
+    item.file_ = nullptr;
+
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    MutexLock lock(backgroundLoadMutex_);
+    for (const ItemKey& dependent : item.dependents_)
+    {
+        auto j = backgroundLoadQueue_.find(dependent);
+        if (j != backgroundLoadQueue_.end())
+            j->second.dependencies_.erase(key);
+    }
+    item.dependents_.clear();
+
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+
+    --numActiveLoads_;
+    DispatchItems();
+}
+
+bool BackgroundLoader::IsItemReady(const BackgroundLoadItem& item, bool checkDependencies) const
+{
+    if (checkDependencies && !item.dependencies_.empty())
+        return false;
+
+    const AsyncLoadState state = item.resource_->GetAsyncLoadState();
+    return state == ASYNC_SUCCESS || state == ASYNC_FAIL;
+}
+
+void BackgroundLoader::RemoveItem(const ItemKey& key)
+{
+    auto i = backgroundLoadQueue_.find(key);
+    if (i == backgroundLoadQueue_.end())
+        return;
+
+    // Unlink the item so other resources don't wait for it
+    BackgroundLoadItem& item = i->second;
+    for (const ItemKey& dependent : item.dependents_)
+    {
+        auto j = backgroundLoadQueue_.find(dependent);
+        if (j != backgroundLoadQueue_.end())
+            j->second.dependencies_.erase(key);
+    }
+    for (const ItemKey& dependency : item.dependencies_)
+    {
+        auto j = backgroundLoadQueue_.find(dependency);
+        if (j != backgroundLoadQueue_.end())
+            j->second.dependents_.erase(key);
+    }
+
+    backgroundLoadQueue_.erase(i);
+}
+
 void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
 {
     Resource* resource = item.resource_;
@@ -22,18 +22,21 @@
 
 #pragma once
 
+#include <EASTL/array.h>
+#include <EASTL/deque.h>
 #include <EASTL/hash_set.h>
 #include <EASTL/unordered_map.h>
 
 #include "../Core/Mutex.h"
 #include "../Container/Ptr.h"
-#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
+#include "../IO/AbstractFile.h"
 #include "../Math/StringHash.h"
+#include "../Resource/Resource.h"
 
 namespace Urho3D
 {
 
-class Resource;
 class ResourceCache;
 
 /// Queue item for background loading of a resource.
@@ -47,11 +50,23 @@ struct URHO3D_API BackgroundLoadItem
     ea::hash_set<ea::pair<StringHash, StringHash> > dependents_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
+    /// Loading priority.
+    ResourceLoadPriority priority_{ResourceLoadPriority::Normal};
+    /// Whether the loading was dispatched to the work queue.
+    bool dispatched_{};
+    /// Whether the loading was cancelled. Cancelled resources are discarded once loaded.
+    bool cancelled_{};
+    /// File read by I/O stage.
+    AbstractFilePtr file_;
+    /// Last loading stage task.
+    TaskHandle task_;
 };
 
 /// Background loader of resources. Owned by the ResourceCache.
+/// Resources are loaded in two stages: asynchronous file read and decoding (Resource::BeginLoad) by WorkQueue task.
+/// Resources are dispatched in order of priority, priority is inherited by the resources requested during loading.
 /// @nobind
-class URHO3D_API BackgroundLoader : public RefCounted, public Thread
+class URHO3D_API BackgroundLoader : public RefCounted
 {
 public:
     /// Construct.
@@ -60,29 +75,69 @@ public:
     /// Destruct. Forcibly clear the load queue.
     ~BackgroundLoader() override;
 
-    /// Resource background loading loop.
-    void ThreadFunction() override;
-
     /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller);
+    /// If the resource is already queued, its priority is raised if needed.
+    bool QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller,
+        ResourceLoadPriority priority = ResourceLoadPriority::Normal);
+    /// Cancel loading of a resource. Return true if the resource was queued.
+    bool CancelResource(StringHash type, StringHash nameHash);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
 
+    /// Set maximum number of resources loaded simultaneously. Zero means MAX_IO_QUEUE_DEPTH.
+    /// Resources with Immediate priority are dispatched regardless of this limit.
+    void SetMaxConcurrentLoads(unsigned maxLoads) { maxConcurrentLoads_ = maxLoads; }
+    /// Return maximum number of resources loaded simultaneously.
+    unsigned GetMaxConcurrentLoads() const { return maxConcurrentLoads_; }
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
 
 private:
+    using ItemKey = ea::pair<StringHash, StringHash>;
+
+    /// Dispatch pending items to the work queue in order of priority. Should be called with locked mutex.
+    /// Mutex may be temporarily released, so iterators of the queue are invalidated.
+    void DispatchItems();
+    /// Dispatch one item to the work queue. Should be called with locked mutex.
+    /// If the item cannot be dispatched, it is loaded immediately with the mutex temporarily released.
+    void DispatchItem(const ItemKey& key, BackgroundLoadItem& item);
+    /// Raise priority of the item and all its dependencies. Should be called with locked mutex.
+    void RaisePriority(const ItemKey& key, ResourceLoadPriority priority);
+    /// Start asynchronous read of the item file and submit decoding task when done. Executed in the work queue.
+    void ReadItem(BackgroundLoadItem& item, TaskHandle decodeTask);
+    /// Store file read for the item.
+    void SetItemFile(BackgroundLoadItem& item, AbstractFilePtr file);
+    /// Decode file of the item. Executed in the work queue.
+    void DecodeItem(const ItemKey& key, BackgroundLoadItem& item);
+    /// Return whether the resource of the item is loaded and is ready to be finished.
+    /// If dependencies are checked, the item is not ready until all resources it depends on are loaded.
+    /// Should be called with locked mutex.
+    bool IsItemReady(const BackgroundLoadItem& item, bool checkDependencies = true) const;
+    /// Remove item from the queue and unlink it from other items. Should be called with locked mutex.
+    void RemoveItem(const ItemKey& key);
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
 
     /// Resource cache.
     ResourceCache* owner_;
+    /// Work queue.
+    WeakPtr<WorkQueue> workQueue_;
     /// Mutex for thread-safe access to the background load queue.
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
     ea::unordered_map<ea::pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Resources that are not dispatched yet, by priority. May contain stale keys.
+    ea::array<ea::deque<ItemKey>, static_cast<unsigned>(ResourceLoadPriority::Count)> pendingItems_;
+    /// Number of resources being loaded by the work queue.
+    unsigned numActiveLoads_{};
+    /// Maximum number of resources loaded simultaneously.
+    unsigned maxConcurrentLoads_{};
+    /// Whether the loader is being destroyed and should not dispatch new items.
+    bool shutDown_{};
+    /// Temporary storage for ready items.
+    ea::vector<ea::pair<ResourceLoadPriority, ItemKey>> readyItems_;
 };
 
 }
@@ -0,0 +1,282 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Resource/CookedResourceCache.h"
+
+#include "../Container/Hash.h"
+#include "../Core/Profiler.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../IO/VectorBuffer.h"
+#include "../LibraryInfo.h"
+#include "../Resource/Resource.h"
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    #define URHO3D_COOKED_CACHE_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Contents of cached file, memory-mapped if possible.
+class CachedFileData
+{
+public:
+    explicit CachedFileData(Context* context, const ea::string& fileName)
+    {
+#ifdef URHO3D_COOKED_CACHE_MMAP
+        const int fd = open(GetNativePath(fileName).c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                mappedData_ = static_cast<const unsigned char*>(data);
+                size_ = static_cast<unsigned>(fileStat.st_size);
+            }
+        }
+        close(fd);
+#else
+        File file(context);
+        if (!file.Open(fileName) || !file.GetSize())
+            return;
+
+        buffer_.resize(file.GetSize());
+        if (file.Read(buffer_.data(), buffer_.size()) == buffer_.size())
+            size_ = buffer_.size();
+#endif
+    }
+
+    ~CachedFileData()
+    {
+#ifdef URHO3D_COOKED_CACHE_MMAP
+        if (mappedData_)
+            munmap(const_cast<unsigned char*>(mappedData_), size_);
+#endif
+    }
+
+    /// Return data.
+    const unsigned char* GetData() const { return mappedData_ ? mappedData_ : buffer_.data(); }
+    /// Return size.
+    unsigned GetSize() const { return size_; }
+
+private:
+    const unsigned char* mappedData_{};
+    ByteVector buffer_;
+    unsigned size_{};
+};
+
+unsigned CalculateChecksum(Deserializer& source)
+{
+    if (const unsigned checksum = source.GetChecksum())
+        return checksum;
+
+    // Memory buffers don't calculate checksum, but the data is available in place
+    const unsigned oldPosition = source.GetPosition();
+    source.Seek(0);
+    const auto data = static_cast<const unsigned char*>(source.ReadInPlace(source.GetSize()));
+    source.Seek(oldPosition);
+
+    unsigned checksum = 0;
+    if (data)
+    {
+        for (unsigned i = 0; i < source.GetSize(); ++i)
+            checksum = SDBMHash(checksum, data[i]);
+    }
+    return checksum;
+}
+
+}
+
+unsigned CookedResourceKey::ToHash() const
+{
+    unsigned hash = type_.Value();
+    CombineHash(hash, StringHash::Calculate(name_.c_str()));
+    CombineHash(hash, sourceChecksum_);
+    CombineHash(hash, sourceSize_);
+    CombineHash(hash, flags_);
+    return hash;
+}
+
+CookedResourceCache::CookedResourceCache(Context* context)
+    : Object(context)
+    , engineRevision_(GetRevision())
+{
+}
+
+CookedResourceCache::~CookedResourceCache() = default;
+
+void CookedResourceCache::SetCacheDir(const ea::string& cacheDir)
+{
+    cacheDir_ = cacheDir.empty() ? EMPTY_STRING : AddTrailingSlash(cacheDir);
+    if (!cacheDir_.empty() && !GetSubsystem<FileSystem>()->CreateDirsRecursive(cacheDir_))
+    {
+        URHO3D_LOGERROR("Cannot create cooked resource cache directory {}", cacheDir_);
+        cacheDir_.clear();
+    }
+}
+
+void CookedResourceCache::Clear()
+{
+    if (cacheDir_.empty())
+        return;
+
+    auto fileSystem = GetSubsystem<FileSystem>();
+    ea::vector<ea::string> fileNames;
+    fileSystem->ScanDir(fileNames, cacheDir_, "*.cooked", SCAN_FILES, false);
+    for (const ea::string& fileName : fileNames)
+        fileSystem->Delete(cacheDir_ + fileName);
+}
+
+void CookedResourceCache::ResetStats()
+{
+    numHits_ = 0;
+    numMisses_ = 0;
+    numStores_ = 0;
+}
+
+bool CookedResourceCache::BeginLoad(Resource* resource, Deserializer& source)
+{
+    CookedResourceKey key;
+    if (!CreateKey(resource, source, key))
+        return resource->BeginLoad(source);
+
+    if (LoadCooked(key, resource))
+    {
+        ++numHits_;
+        return true;
+    }
+
+    ++numMisses_;
+    if (!resource->BeginLoad(source))
+        return false;
+
+    if (SaveCooked(key, resource))
+        ++numStores_;
+    return true;
+}
+
+ea::string CookedResourceCache::GetCachedFileName(const CookedResourceKey& key) const
+{
+    return Format("{}{:08x}.cooked", cacheDir_, key.ToHash());
+}
+
+bool CookedResourceCache::CreateKey(Resource* resource, Deserializer& source, CookedResourceKey& key) const
+{
+    key.type_ = resource->GetType();
+    key.name_ = !resource->GetName().empty() ? resource->GetName() : source.GetName();
+    key.sourceChecksum_ = CalculateChecksum(source);
+    key.sourceSize_ = source.GetSize();
+    key.flags_ = resource->GetCookedFlags();
+    return !key.name_.empty() && key.sourceChecksum_ != 0;
+}
+
+bool CookedResourceCache::LoadCooked(const CookedResourceKey& key, Resource* resource) const
+{
+    URHO3D_PROFILE("LoadCookedResource");
+
+    const CachedFileData fileData(context_, GetCachedFileName(key));
+    if (!fileData.GetSize())
+        return false;
+
+    // Cached file may be stale or belong to another key with the same hash
+    MemoryBuffer buffer(fileData.GetData(), fileData.GetSize());
+    if (buffer.ReadFileID() != "CKRS" || buffer.ReadUInt() != COOKED_RESOURCE_VERSION
+        || buffer.ReadString() != engineRevision_ || buffer.ReadStringHash() != key.type_
+        || buffer.ReadString() != key.name_ || buffer.ReadUInt() != key.sourceChecksum_
+        || buffer.ReadUInt() != key.sourceSize_ || buffer.ReadUInt() != key.flags_)
+        return false;
+
+    const unsigned dataSize = buffer.ReadUInt();
+    if (dataSize > buffer.GetSize() - buffer.GetPosition())
+        return false;
+
+    MemoryBuffer cookedData(fileData.GetData() + buffer.GetPosition(), dataSize);
+    cookedData.SetName(key.name_);
+    return resource->LoadCooked(cookedData);
+}
+
+bool CookedResourceCache::SaveCooked(const CookedResourceKey& key, const Resource* resource) const
+{
+    URHO3D_PROFILE("SaveCookedResource");
+
+    VectorBuffer cookedData;
+    if (!resource->SaveCooked(cookedData))
+        return false;
+
+    // Write to temporary file first, so other threads and processes never read partially written file
+    const ea::string fileName = GetCachedFileName(key);
+    const ea::string tempFileName = Format("{}.{}.tmp", fileName, static_cast<const void*>(resource));
+    {
+        File file(context_);
+        if (!file.Open(tempFileName, FILE_WRITE))
+            return false;
+
+        file.WriteFileID("CKRS");
+        file.WriteUInt(COOKED_RESOURCE_VERSION);
+        file.WriteString(engineRevision_);
+        file.WriteStringHash(key.type_);
+        file.WriteString(key.name_);
+        file.WriteUInt(key.sourceChecksum_);
+        file.WriteUInt(key.sourceSize_);
+        file.WriteUInt(key.flags_);
+        file.WriteUInt(cookedData.GetSize());
+        if (file.Write(cookedData.GetData(), cookedData.GetSize()) != cookedData.GetSize())
+        {
+            file.Close();
+            GetSubsystem<FileSystem>()->Delete(tempFileName);
+            return false;
+        }
+    }
+
+    // Rename doesn't replace existing file on some platforms
+    auto fileSystem = GetSubsystem<FileSystem>();
+    if (!fileSystem->Rename(tempFileName, fileName))
+    {
+        fileSystem->Delete(fileName);
+        if (!fileSystem->Rename(tempFileName, fileName))
+        {
+            fileSystem->Delete(tempFileName);
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Core/Object.h"
+#include "../Math/StringHash.h"
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+class Deserializer;
+class Resource;
+
+/// Version of cooked resource file format.
+static const unsigned COOKED_RESOURCE_VERSION = 1;
+
+/// Key of cooked resource. Cached cooked form is used only if all the fields match.
+struct URHO3D_API CookedResourceKey
+{
+    /// Return hash of the key used as file name.
+    unsigned ToHash() const;
+
+    /// Resource type.
+    StringHash type_;
+    /// Resource name.
+    ea::string name_;
+    /// Checksum of the source file.
+    unsigned sourceChecksum_{};
+    /// Size of the source file.
+    unsigned sourceSize_{};
+    /// Resource loading options.
+    unsigned flags_{};
+};
+
+/// Persistent cache of cooked resources. Cooked form is the state of the resource after Resource::BeginLoad
+/// that can be restored faster than the source file is decoded, e.g. decompressed image pixels.
+/// Cached files are discarded when the source file, the engine revision or the loading options change.
+/// Cached files are memory-mapped when the platform supports it.
+class URHO3D_API CookedResourceCache : public Object
+{
+    URHO3D_OBJECT(CookedResourceCache, Object);
+
+public:
+    /// Construct.
+    explicit CookedResourceCache(Context* context);
+    /// Destruct.
+    ~CookedResourceCache() override;
+
+    /// Set directory to store cooked resources in. The cache is disabled if empty.
+    void SetCacheDir(const ea::string& cacheDir);
+    /// Remove all cached files.
+    void Clear();
+    /// Reset hit and miss counters.
+    void ResetStats();
+
+    /// Begin loading the resource. Cooked form is restored if cached, otherwise the resource is loaded from source and cooked form is stored.
+    /// May be called from a worker thread.
+    bool BeginLoad(Resource* resource, Deserializer& source);
+
+    /// Return directory to store cooked resources in.
+    const ea::string& GetCacheDir() const { return cacheDir_; }
+    /// Return whether the cache is enabled.
+    bool IsEnabled() const { return !cacheDir_.empty(); }
+    /// Return number of resources restored from cooked form.
+    unsigned GetNumHits() const { return numHits_; }
+    /// Return number of resources loaded from source.
+    unsigned GetNumMisses() const { return numMisses_; }
+    /// Return number of cooked resources stored.
+    unsigned GetNumStores() const { return numStores_; }
+    /// Return name of the cached file for the key.
+    ea::string GetCachedFileName(const CookedResourceKey& key) const;
+
+private:
+    /// Create key for the resource loaded from source. Return false if the source checksum is unknown.
+    bool CreateKey(Resource* resource, Deserializer& source, CookedResourceKey& key) const;
+    /// Restore the resource from cached file. Return false if not cached or the file is stale.
+    bool LoadCooked(const CookedResourceKey& key, Resource* resource) const;
+    /// Save cooked form of the resource to file.
+    bool SaveCooked(const CookedResourceKey& key, const Resource* resource) const;
+
+    /// Cache directory.
+    ea::string cacheDir_;
+    /// Engine revision. Cached files of other revisions are ignored.
+    ea::string engineRevision_;
+    /// Number of cache hits.
+    std::atomic<unsigned> numHits_{};
+    /// Number of cache misses.
+    std::atomic<unsigned> numMisses_{};
+    /// Number of stored files.
+    std::atomic<unsigned> numStores_{};
+};
+
+}
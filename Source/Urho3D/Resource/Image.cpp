@@ -839,17 +839,22 @@ bool Image::BeginLoad(Deserializer& source)
             return false;
         }
 
-        // Read the file to buffer.
+        // Read the file to buffer, unless it's already in memory.
         size_t dataSize(source.GetSize());
-        ea::shared_array<uint8_t> data(new uint8_t[dataSize]);
-
-        memset(data.get(), 0, sizeof(uint8_t) * dataSize);
         source.Seek(0);
-        source.Read(data.get(), dataSize);
+        ea::shared_array<uint8_t> dataBuffer;
+        auto data = static_cast<const uint8_t*>(source.ReadInPlace(dataSize));
+        if (!data)
+        {
+            dataBuffer = ea::shared_array<uint8_t>(new uint8_t[dataSize]);
+            memset(dataBuffer.get(), 0, sizeof(uint8_t) * dataSize);
+            source.Read(dataBuffer.get(), dataSize);
+            data = dataBuffer.get();
+        }
 
         WebPBitstreamFeatures features;
 
-        if (WebPGetFeatures(data.get(), dataSize, &features) != VP8_STATUS_OK)
+        if (WebPGetFeatures(data, dataSize, &features) != VP8_STATUS_OK)
         {
             URHO3D_LOGERROR("Error reading WebP image: " + source.GetName());
             return false;
@@ -861,11 +866,11 @@ bool Image::BeginLoad(Deserializer& source)
         bool decodeError(false);
         if (features.has_alpha)
         {
-            decodeError = WebPDecodeRGBAInto(data.get(), dataSize, pixelData.get(), imgSize, 4 * features.width) == nullptr;
+            decodeError = WebPDecodeRGBAInto(data, dataSize, pixelData.get(), imgSize, 4 * features.width) == nullptr;
         }
         else
         {
-            decodeError = WebPDecodeRGBInto(data.get(), dataSize, pixelData.get(), imgSize, 3 * features.width) == nullptr;
+            decodeError = WebPDecodeRGBInto(data, dataSize, pixelData.get(), imgSize, 3 * features.width) == nullptr;
         }
         if (decodeError)
         {
@@ -920,6 +925,32 @@ bool Image::Save(Serializer& dest) const
     return success;
 }
 
+bool Image::SaveCooked(Serializer& dest) const
+{
+    if (IsCompressed() || nextLevel_ || nextSibling_ || !data_)
+        return false;
+
+    const unsigned dataSize = width_ * height_ * depth_ * components_;
+    dest.WriteInt(width_);
+    dest.WriteInt(height_);
+    dest.WriteInt(depth_);
+    dest.WriteUInt(components_);
+    return dest.Write(data_.get(), dataSize) == dataSize;
+}
+
+bool Image::LoadCooked(Deserializer& source)
+{
+    const int width = source.ReadInt();
+    const int height = source.ReadInt();
+    const int depth = source.ReadInt();
+    const unsigned components = source.ReadUInt();
+    if (!SetSize(width, height, depth, components))
+        return false;
+
+    const unsigned dataSize = width_ * height_ * depth_ * components_;
+    return source.Read(data_.get(), dataSize) == dataSize;
+}
+
 bool Image::SaveFile(const ea::string& fileName) const
 {
     auto fs = GetSubsystem<FileSystem>();
@@ -2412,6 +2443,10 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
 
+    // Decode directly from memory if possible
+    if (const void* data = source.ReadInPlace(dataSize))
+        return stbi_load_from_memory(static_cast<const unsigned char*>(data), dataSize, &width, &height, (int*)&components, 0);
+
     ea::shared_array<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.get(), dataSize);
     return stbi_load_from_memory(buffer.get(), dataSize, &width, &height, (int*)&components, 0);
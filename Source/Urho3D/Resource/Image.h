@@ -96,6 +96,12 @@ public:
     bool BeginLoad(Deserializer& source) override;
     /// Save the image to a stream. Regardless of original format, the image is saved as png. Compressed image data is not supported. Return true if successful.
     bool Save(Serializer& dest) const override;
+    /// Return whether the resource supports CookedResourceCache.
+    bool IsCookable() const override { return true; }
+    /// Save decoded pixels of uncompressed image. Compressed images are not decoded and so are not cooked.
+    bool SaveCooked(Serializer& dest) const override;
+    /// Restore decoded pixels of uncompressed image.
+    bool LoadCooked(Deserializer& source) override;
     /// Save the image to a file. Format of the image is determined by file extension. JPG is saved with maximum quality.
     bool SaveFile(const ea::string& fileName) const override;
 
@@ -30,6 +30,7 @@
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../Resource/CookedResourceCache.h"
 #include "../Resource/Resource.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/XMLElement.h"
@@ -125,7 +126,8 @@ bool Resource::Load(Deserializer& source)
     // If we are loading synchronously in a non-main thread, behave as if async loading (for example use
     // GetTempResource() instead of GetResource() to load resource dependencies)
     SetAsyncLoadState(Thread::IsMainThread() ? ASYNC_DONE : ASYNC_LOADING);
-    bool success = BeginLoad(source);
+    softUnloaded_ = false;
+    bool success = BeginLoadCached(source);
     if (success)
         success &= EndLoad();
     SetAsyncLoadState(ASYNC_DONE);
@@ -139,6 +141,14 @@ bool Resource::BeginLoad(Deserializer& source)
     return false;
 }
 
+bool Resource::BeginLoadCached(Deserializer& source)
+{
+    auto cookedCache = GetSubsystem<CookedResourceCache>();
+    if (cookedCache && cookedCache->IsEnabled() && IsCookable())
+        return cookedCache->BeginLoad(this, source);
+    return BeginLoad(source);
+}
+
 bool Resource::EndLoad()
 {
     // If no GPU upload step is necessary, no override is necessary
@@ -188,6 +198,16 @@ void Resource::SetAsyncLoadState(AsyncLoadState newState)
     asyncLoadState_ = newState;
 }
 
+bool Resource::SoftUnload()
+{
+    if (softUnloaded_)
+        return false;
+
+    // Don't try again even if nothing was released, until the resource is reloaded
+    softUnloaded_ = true;
+    return OnSoftUnload();
+}
+
 unsigned Resource::GetUseTimer()
 {
     // If more references than the resource cache, return always 0 & reset the timer
@@ -78,12 +78,27 @@ enum AsyncLoadState
     ASYNC_FAIL = 4
 };
 
+/// Priority of asynchronous resource loading. Resources with higher priority are loaded first.
+enum class ResourceLoadPriority
+{
+    /// Resource is needed immediately, e.g. it is visible now.
+    Immediate,
+    /// Default priority.
+    Normal,
+    /// Resource is prefetched and may be needed later.
+    Prefetch,
+    /// Number of priorities.
+    Count
+};
+
 /// Base class for resources.
 /// @templateversion
 class URHO3D_API Resource : public Object
 {
     URHO3D_OBJECT(Resource, Object);
 
+    friend class ResourceCache;
+
 public:
     /// Construct.
     explicit Resource(Context* context);
@@ -100,6 +115,17 @@ public:
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
 
+    /// Call BeginLoad or restore cooked form from CookedResourceCache if it's enabled. May be called from a worker thread.
+    bool BeginLoadCached(Deserializer& source);
+    /// Return whether the resource supports CookedResourceCache.
+    virtual bool IsCookable() const { return false; }
+    /// Return loading options that affect cooked form. Cached cooked form is discarded when they change.
+    virtual unsigned GetCookedFlags() const { return 0; }
+    /// Save cooked form, i.e. the state after BeginLoad that is expensive to recompute. Return true if successful.
+    virtual bool SaveCooked(Serializer& dest) const { return false; }
+    /// Restore the state after BeginLoad from cooked form. Return true if successful.
+    virtual bool LoadCooked(Deserializer& source) { return false; }
+
     /// Load resource from file.
     /// @alias{Load}
     bool LoadFile(const ea::string& fileName);
@@ -118,6 +144,9 @@ public:
     void SetAsyncLoadState(AsyncLoadState newState);
     /// Set absolute file name.
     void SetAbsoluteFileName(const ea::string& fileName) { absoluteFileName_ = fileName; }
+    /// Release CPU-side data that is not required for the resource to stay usable, e.g. shadow copies of GPU data.
+    /// Called by ResourceCache when over memory budget. Return true if any memory was released.
+    bool SoftUnload();
 
     /// Return name.
     /// @property
@@ -139,6 +168,12 @@ public:
 
     /// Return absolute file name.
     const ea::string& GetAbsoluteFileName() const { return absoluteFileName_; }
+    /// Return whether the resource was soft-unloaded. Reset when the resource is loaded again.
+    bool IsSoftUnloaded() const { return softUnloaded_; }
+
+protected:
+    /// Handle soft unload. Should release optional CPU-side data and update memory use. Return true if any memory was released.
+    virtual bool OnSoftUnload() { return false; }
 
 private:
     /// Name.
@@ -153,6 +188,16 @@ private:
     unsigned memoryUse_;
     /// Asynchronous loading state.
     AsyncLoadState asyncLoadState_;
+    /// Whether the resource was soft-unloaded.
+    bool softUnloaded_{};
+    /// Previous resource in the LRU list of the resource cache.
+    Resource* lruPrev_{};
+    /// Next resource in the LRU list of the resource cache.
+    Resource* lruNext_{};
+    /// Stamp of the last use in the resource cache.
+    unsigned long long lruStamp_{};
+    /// Memory use accounted in the resource group of the resource cache.
+    unsigned cachedMemoryUse_{};
 };
 
 /// Base class for simple resource that uses Archive serialization.
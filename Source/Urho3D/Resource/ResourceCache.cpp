@@ -30,6 +30,7 @@
 #include "../IO/FileWatcher.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
+#include "../IO/VirtualFileSystem.h"
 #include "../Resource/BackgroundLoader.h"
 #include "../Resource/BinaryFile.h"
 #include "../Resource/Image.h"
@@ -45,6 +46,7 @@
 #include "../DebugNew.h"
 
 #include <cstdio>
+#include <EASTL/sort.h>
 
 namespace Urho3D
 {
@@ -80,8 +82,6 @@ static const char* checkDirs[] =
     nullptr
 };
 
-static const SharedPtr<Resource> noResource;
-
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
     autoReloadResources_(false),
@@ -170,6 +170,10 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
     else
         packages_.push_back(SharedPtr<PackageFile>(package));
 
+    // Layer patch packages over their base packages
+    for (PackageFile* otherPackage : packages_)
+        package->LinkPatchPackage(otherPackage);
+
     URHO3D_LOGINFO("Added resource package " + package->GetName());
     return true;
 }
@@ -196,7 +200,7 @@ bool ResourceCache::AddManualResource(Resource* resource)
     }
 
     resource->ResetUseTimer();
-    resourceGroups_[resource->GetType()].resources_[resource->GetNameHash()] = resource;
+    StoreResource(resource->GetType(), resource->GetNameHash(), resource);
     UpdateResourceGroup(resource->GetType());
     return true;
 }
@@ -273,15 +277,18 @@ void ResourceCache::RemovePackageFile(const ea::string& fileName, bool releaseRe
 
 void ResourceCache::ReleaseResource(StringHash type, const ea::string& name, bool force)
 {
-    StringHash nameHash(name);
-    const SharedPtr<Resource>& existingRes = FindResource(type, nameHash);
-    if (!existingRes)
+    auto i = resourceGroups_.find(type);
+    if (i == resourceGroups_.end())
+        return;
+
+    auto j = i->second.resources_.find(StringHash(name));
+    if (j == i->second.resources_.end())
         return;
 
     // If other references exist, do not release, unless forced
-    if ((existingRes.Refs() == 1 && existingRes.WeakRefs() == 0) || force)
+    if ((j->second.Refs() == 1 && j->second.WeakRefs() == 0) || force)
     {
-        resourceGroups_[type].resources_.erase(nameHash);
+        EraseResource(type, i->second, j);
         UpdateResourceGroup(type);
     }
 }
@@ -290,30 +297,33 @@ void ResourceCache::ReleaseResource(const ea::string& resourceName, bool force)
 {
     // Some resources refer to others, like materials to textures. Repeat the release logic as many times as necessary to ensure
     // these get released. This is not necessary if forcing release
+    const StringHash nameHash(resourceName);
+    ea::vector<Resource*> resources;
     bool released;
     do
     {
         released = false;
 
-        for (auto i = resourceGroups_.begin(); i != resourceGroups_.end(); ++i)
+        // Only the groups that contain the resource are visited
+        resourceIndex_.FindAll(nameHash, resources);
+        for (Resource* resource : resources)
         {
-            for (auto j = i->second.resources_.begin(); j != i->second.resources_.end();)
+            const StringHash type = resource->GetType();
+            auto i = resourceGroups_.find(type);
+            if (i == resourceGroups_.end())
+                continue;
+
+            auto j = i->second.resources_.find(nameHash);
+            if (j == i->second.resources_.end())
+                continue;
+
+            // If other references exist, do not release, unless forced
+            if ((j->second.Refs() == 1 && j->second.WeakRefs() == 0) || force)
             {
-                auto current = i->second.resources_.find(resourceName);
-                if (current != i->second.resources_.end())
-                {
-                    // If other references exist, do not release, unless forced
-                    if ((current->second.Refs() == 1 && current->second.WeakRefs() == 0) || force)
-                    {
-                        j = i->second.resources_.erase(current);
-                        released = true;
-                        continue;
-                    }
-                }
-                ++j;
+                EraseResource(type, i->second, j);
+                UpdateResourceGroup(type);
+                released = true;
             }
-            if (released)
-                UpdateResourceGroup(i->first);
         }
 
     } while (released && !force);
@@ -333,7 +343,7 @@ void ResourceCache::ReleaseResources(StringHash type, bool force)
             // If other references exist, do not release, unless forced
             if ((current->second.Refs() == 1 && current->second.WeakRefs() == 0) || force)
             {
-                i->second.resources_.erase(current);
+                EraseResource(i->first, i->second, current);
                 released = true;
             }
         }
@@ -359,7 +369,7 @@ void ResourceCache::ReleaseResources(StringHash type, const ea::string& partialN
                 // If other references exist, do not release, unless forced
                 if ((current->second.Refs() == 1 && current->second.WeakRefs() == 0) || force)
                 {
-                    i->second.resources_.erase(current);
+                    EraseResource(i->first, i->second, current);
                     released = true;
                 }
             }
@@ -391,7 +401,7 @@ void ResourceCache::ReleaseResources(const ea::string& partialName, bool force)
                     // If other references exist, do not release, unless forced
                     if ((current->second.Refs() == 1 && current->second.WeakRefs() == 0) || force)
                     {
-                        i->second.resources_.erase(current);
+                        EraseResource(i->first, i->second, current);
                         released = true;
                     }
                 }
@@ -420,7 +430,7 @@ void ResourceCache::ReleaseAllResources(bool force)
                 // If other references exist, do not release, unless forced
                 if ((current->second.Refs() == 1 && current->second.WeakRefs() == 0) || force)
                 {
-                    i->second.resources_.erase(current);
+                    EraseResource(i->first, i->second, current);
                     released = true;
                 }
             }
@@ -450,6 +460,11 @@ bool ResourceCache::ReloadResource(Resource* resource)
     if (file)
         success = resource->Load(*(file.Get()));
 
+    // Memory use may be changed even if reloading failed
+    auto group = resourceGroups_.find(resource->GetType());
+    if (group != resourceGroups_.end() && group->second.resources_.find(resource->GetNameHash()) != group->second.resources_.end())
+        UpdateMemoryUse(group->second, resource);
+
     if (success)
     {
         resource->ResetUseTimer();
@@ -468,11 +483,11 @@ void ResourceCache::ReloadResourceWithDependencies(const ea::string& fileName)
 {
     StringHash fileNameHash(fileName);
     // If the filename is a resource we keep track of, reload it
-    const SharedPtr<Resource>& resource = FindResource(fileNameHash);
+    SharedPtr<Resource> resource = FindResource(fileNameHash);
     if (resource)
     {
         URHO3D_LOGDEBUG("Reloading changed resource " + fileName);
-        ReloadResource(resource.Get());
+        ReloadResource(resource);
     }
     // Always perform dependency resource check for resource loaded from XML file as it could be used in inheritance
     if (NeedToReloadDependencies(resource))
@@ -489,9 +504,8 @@ void ResourceCache::ReloadResourceWithDependencies(const ea::string& fileName)
 
             for (auto k = j->second.begin(); k != j->second.end(); ++k)
             {
-                const SharedPtr<Resource>& dependent = FindResource(*k);
-                if (dependent)
-                    dependents.push_back(dependent);
+                if (SharedPtr<Resource> dependent = FindResource(*k))
+                    dependents.push_back(ea::move(dependent));
             }
 
             for (unsigned k = 0; k < dependents.size(); ++k)
@@ -603,30 +617,57 @@ AbstractFilePtr ResourceCache::GetFile(const ea::string& name, bool sendEventOnF
     return SharedPtr<File>();
 }
 
-Resource* ResourceCache::GetExistingResource(StringHash type, const ea::string& name)
+bool ResourceCache::ReadFileAsync(const ea::string& name, AsyncReadCallback callback, bool sendEventOnFailure)
 {
-    ea::string sanitatedName = SanitateResourceName(name);
-
-    if (!Thread::IsMainThread())
+    auto vfs = GetSubsystem<VirtualFileSystem>();
+    if (vfs)
     {
-        URHO3D_LOGERROR("Attempted to get resource " + sanitatedName + " from outside the main thread");
-        return nullptr;
+        AsyncReadRequest request;
+        {
+            MutexLock lock(resourceMutex_);
+
+            ea::string sanitatedName = SanitateResourceName(name);
+            RouteResourceName(sanitatedName, RESOURCE_GETFILE);
+            if (sanitatedName.empty() || !CreateReadRequest(sanitatedName, request))
+                request.name_.clear();
+        }
+
+        if (!request.name_.empty())
+        {
+            request.callback_ = ea::move(callback);
+            vfs->GetAsyncFileReader()->Read(ea::move(request));
+            return true;
+        }
     }
 
+    // Read synchronously without reader, report errors the same way
+    AbstractFilePtr file = GetFile(name, sendEventOnFailure);
+    if (!file)
+        return false;
+
+    callback(file);
+    return true;
+}
+
+SharedPtr<Resource> ResourceCache::GetExistingResource(StringHash type, const ea::string& name)
+{
+    ea::string sanitatedName = SanitateResourceName(name);
+
     // If empty name, return null pointer immediately
     if (sanitatedName.empty())
         return nullptr;
 
-    StringHash nameHash(sanitatedName);
-
-    const SharedPtr<Resource>& existing = type == StringHash::Empty ? FindResource(type, nameHash) : FindResource(nameHash);
-    return existing;
+    SharedPtr<Resource> resource = FindResource(type, StringHash(sanitatedName));
+    if (resource && Thread::IsMainThread())
+        TouchResource(resource->GetType(), resource);
+    return resource;
 }
 
 Resource* ResourceCache::GetResource(StringHash type, const ea::string& name, bool sendEventOnFailure)
 {
     ea::string sanitatedName = SanitateResourceName(name);
 
+    // Raw pointer cannot keep the resource alive in other threads, they should use GetExistingResource instead
     if (!Thread::IsMainThread())
     {
         URHO3D_LOGERROR("Attempted to get resource " + sanitatedName + " from outside the main thread");
@@ -644,9 +685,11 @@ Resource* ResourceCache::GetResource(StringHash type, const ea::string& name, bo
     backgroundLoader_->WaitForResource(type, nameHash);
 #endif
 
-    const SharedPtr<Resource>& existing = FindResource(type, nameHash);
-    if (existing)
+    if (Resource* existing = FindResource(type, nameHash))
+    {
+        TouchResource(type, existing);
         return existing;
+    }
 
     SharedPtr<Resource> resource;
     // Make sure the pointer is non-null and is a Resource subclass
@@ -694,13 +737,14 @@ Resource* ResourceCache::GetResource(StringHash type, const ea::string& name, bo
 
     // Store to cache
     resource->ResetUseTimer();
-    resourceGroups_[type].resources_[nameHash] = resource;
+    StoreResource(type, nameHash, resource);
     UpdateResourceGroup(type);
 
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller)
+bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller,
+    ResourceLoadPriority priority)
 {
 #ifdef URHO3D_THREADING
     // If empty name, fail immediately
@@ -710,16 +754,45 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& na
 
     // First check if already exists as a loaded resource
     StringHash nameHash(sanitatedName);
-    if (FindResource(type, nameHash) != noResource)
+    if (FindResource(type, nameHash))
         return false;
 
-    return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller);
+    return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller, priority);
 #else
     // When threading not supported, fall back to synchronous loading
     return GetResource(type, name, sendEventOnFailure);
 #endif
 }
 
+bool ResourceCache::CancelBackgroundLoadResource(StringHash type, const ea::string& name)
+{
+#ifdef URHO3D_THREADING
+    ea::string sanitatedName = SanitateResourceName(name);
+    if (sanitatedName.empty())
+        return false;
+
+    return backgroundLoader_->CancelResource(type, StringHash(sanitatedName));
+#else
+    return false;
+#endif
+}
+
+void ResourceCache::SetMaxConcurrentBackgroundLoads(unsigned maxLoads)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetMaxConcurrentLoads(maxLoads);
+#endif
+}
+
+unsigned ResourceCache::GetMaxConcurrentBackgroundLoads() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetMaxConcurrentLoads();
+#else
+    return 0;
+#endif
+}
+
 SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const ea::string& name, bool sendEventOnFailure)
 {
     ea::string sanitatedName = SanitateResourceName(name);
@@ -981,13 +1054,15 @@ void ResourceCache::ResetDependencies(Resource* resource)
 
 ea::string ResourceCache::PrintMemoryUsage() const
 {
-    ea::string output = "Resource Type                 Cnt       Avg       Max    Budget     Total\n\n";
+    ea::string output = "Resource Type                 Cnt       Avg       Max    Budget     Total   Evicted  SoftUnld\n\n";
     char outputLine[256];
 
     unsigned totalResourceCt = 0;
     unsigned long long totalLargest = 0;
     unsigned long long totalAverage = 0;
     unsigned long long totalUse = GetTotalMemoryUse();
+    unsigned totalEvicted = 0;
+    unsigned totalSoftUnloaded = 0;
 
     for (auto cit = resourceGroups_.begin(); cit !=
         resourceGroups_.end(); ++cit)
@@ -1008,17 +1083,22 @@ ea::string ResourceCache::PrintMemoryUsage() const
         }
 
         totalResourceCt += resourceCt;
+        totalEvicted += cit->second.numEvicted_;
+        totalSoftUnloaded += cit->second.numSoftUnloaded_;
 
         const ea::string countString = ea::to_string(cit->second.resources_.size());
         const ea::string memUseString = GetFileSizeString(average);
         const ea::string memMaxString = GetFileSizeString(largest);
         const ea::string memBudgetString = GetFileSizeString(cit->second.memoryBudget_);
         const ea::string memTotalString = GetFileSizeString(cit->second.memoryUse_);
+        const ea::string evictedString = ea::to_string(cit->second.numEvicted_);
+        const ea::string softUnloadedString = ea::to_string(cit->second.numSoftUnloaded_);
         const ea::string resTypeName = context_->GetTypeName(cit->first);
 
         memset(outputLine, ' ', 256);
         outputLine[255] = 0;
-        sprintf(outputLine, "%-28s %4s %9s %9s %9s %9s\n", resTypeName.c_str(), countString.c_str(), memUseString.c_str(), memMaxString.c_str(), memBudgetString.c_str(), memTotalString.c_str());
+        sprintf(outputLine, "%-28s %4s %9s %9s %9s %9s %9s %9s\n", resTypeName.c_str(), countString.c_str(), memUseString.c_str(),
+            memMaxString.c_str(), memBudgetString.c_str(), memTotalString.c_str(), evictedString.c_str(), softUnloadedString.c_str());
 
         output += ((const char*)outputLine);
     }
@@ -1029,68 +1109,203 @@ ea::string ResourceCache::PrintMemoryUsage() const
     const ea::string countString = ea::to_string(totalResourceCt);
     const ea::string memUseString = GetFileSizeString(totalAverage);
     const ea::string memMaxString = GetFileSizeString(totalLargest);
+    const ea::string memBudgetString = totalMemoryBudget_ ? GetFileSizeString(totalMemoryBudget_) : "-";
     const ea::string memTotalString = GetFileSizeString(totalUse);
+    const ea::string evictedString = ea::to_string(totalEvicted);
+    const ea::string softUnloadedString = ea::to_string(totalSoftUnloaded);
 
     memset(outputLine, ' ', 256);
     outputLine[255] = 0;
-    sprintf(outputLine, "%-28s %4s %9s %9s %9s %9s\n", "All", countString.c_str(), memUseString.c_str(), memMaxString.c_str(), "-", memTotalString.c_str());
+    sprintf(outputLine, "%-28s %4s %9s %9s %9s %9s %9s %9s\n", "All", countString.c_str(), memUseString.c_str(),
+        memMaxString.c_str(), memBudgetString.c_str(), memTotalString.c_str(), evictedString.c_str(), softUnloadedString.c_str());
     output += ((const char*)outputLine);
 
     return output;
 }
 
-const SharedPtr<Resource>& ResourceCache::FindResource(StringHash type, StringHash nameHash)
+SharedPtr<Resource> ResourceCache::FindResource(StringHash type, StringHash nameHash) const
 {
-    MutexLock lock(resourceMutex_);
+    return resourceIndex_.Find(type, nameHash);
+}
 
-    auto i = resourceGroups_.find(type);
-    if (i == resourceGroups_.end())
-        return noResource;
-    auto j = i->second.resources_.find(nameHash);
-    if (j == i->second.resources_.end())
-        return noResource;
+SharedPtr<Resource> ResourceCache::FindResource(StringHash nameHash) const
+{
+    return resourceIndex_.Find(StringHash::Empty, nameHash);
+}
 
-    return j->second;
+void ResourceCache::StoreResource(StringHash type, StringHash nameHash, Resource* resource)
+{
+    ResourceGroup& group = resourceGroups_[type];
+    SharedPtr<Resource>& storedResource = group.resources_[nameHash];
+    if (storedResource && storedResource.Get() != resource)
+    {
+        UnlinkResource(group, storedResource);
+        group.memoryUse_ -= ea::min<unsigned long long>(group.memoryUse_, storedResource->cachedMemoryUse_);
+        storedResource->cachedMemoryUse_ = 0;
+    }
+
+    // Update index first so other threads never find the replaced resource after it is released
+    resourceIndex_.Add(type, nameHash, resource);
+    storedResource = resource;
+    TouchResource(group, resource);
+    UpdateMemoryUse(group, resource);
 }
 
-const SharedPtr<Resource>& ResourceCache::FindResource(StringHash nameHash)
+ea::unordered_map<StringHash, SharedPtr<Resource> >::iterator ResourceCache::EraseResource(
+    StringHash type, ResourceGroup& group, ea::unordered_map<StringHash, SharedPtr<Resource> >::iterator iter)
 {
-    MutexLock lock(resourceMutex_);
+    // Remove from index first so the resource is never visible to other threads after it is released
+    resourceIndex_.Remove(type, iter->first);
+
+    Resource* resource = iter->second;
+    UnlinkResource(group, resource);
+    group.memoryUse_ -= ea::min<unsigned long long>(group.memoryUse_, resource->cachedMemoryUse_);
+    resource->cachedMemoryUse_ = 0;
+    return group.resources_.erase(iter);
+}
 
-    for (auto i = resourceGroups_.begin(); i !=
-        resourceGroups_.end(); ++i)
+void ResourceCache::UpdateMemoryUse(ResourceGroup& group, Resource* resource)
+{
+    const unsigned memoryUse = resource->GetMemoryUse();
+    group.memoryUse_ -= ea::min<unsigned long long>(group.memoryUse_, resource->cachedMemoryUse_);
+    group.memoryUse_ += memoryUse;
+    resource->cachedMemoryUse_ = memoryUse;
+}
+
+void ResourceCache::TouchResource(ResourceGroup& group, Resource* resource)
+{
+    resource->ResetUseTimer();
+    resource->lruStamp_ = ++lruStamp_;
+    if (group.lruTail_ == resource)
+        return;
+
+    UnlinkResource(group, resource);
+    resource->lruPrev_ = group.lruTail_;
+    (group.lruTail_ ? group.lruTail_->lruNext_ : group.lruHead_) = resource;
+    group.lruTail_ = resource;
+}
+
+void ResourceCache::TouchResource(StringHash type, Resource* resource)
+{
+    auto i = resourceGroups_.find(type ? type : resource->GetType());
+    if (i != resourceGroups_.end())
+        TouchResource(i->second, resource);
+}
+
+void ResourceCache::UnlinkResource(ResourceGroup& group, Resource* resource)
+{
+    const bool isLinked = resource->lruPrev_ || group.lruHead_ == resource;
+    if (!isLinked)
+        return;
+
+    (resource->lruPrev_ ? resource->lruPrev_->lruNext_ : group.lruHead_) = resource->lruNext_;
+    (resource->lruNext_ ? resource->lruNext_->lruPrev_ : group.lruTail_) = resource->lruPrev_;
+    resource->lruPrev_ = nullptr;
+    resource->lruNext_ = nullptr;
+}
+
+bool ResourceCache::EvictResources(StringHash type, ResourceGroup& group, unsigned long long memoryBudget)
+{
+    // Resources in use are skipped without touching, so they keep their position in the LRU list.
+    // They are remembered during the same walk in case they need to be soft-unloaded.
+    bool memoryReleased = false;
+    tempResourcesInUse_.clear();
+    Resource* resource = group.lruHead_;
+    while (resource && group.memoryUse_ > memoryBudget)
     {
-        auto j = i->second.resources_.find(nameHash);
-        if (j != i->second.resources_.end())
-            return j->second;
+        Resource* nextResource = resource->lruNext_;
+        auto iter = resource->Refs() == 1 ? group.resources_.find(resource->GetNameHash()) : group.resources_.end();
+        if (iter != group.resources_.end() && iter->second.Get() == resource)
+        {
+            URHO3D_LOGDEBUG("Resource group " + resource->GetTypeName() + " over memory budget, releasing resource " +
+                resource->GetName());
+            ++group.numEvicted_;
+            EraseResource(type, group, iter);
+            memoryReleased = true;
+        }
+        else if (softUnloadEnabled_ && !resource->IsSoftUnloaded())
+            tempResourcesInUse_.push_back(resource);
+        resource = nextResource;
     }
 
-    return noResource;
+    // Remaining resources are in use, release optional data starting from the least recently used one
+    for (Resource* resourceInUse : tempResourcesInUse_)
+    {
+        if (group.memoryUse_ <= memoryBudget)
+            break;
+
+        if (resourceInUse->SoftUnload())
+        {
+            URHO3D_LOGDEBUG("Resource group " + resourceInUse->GetTypeName() + " over memory budget, soft-unloading resource " +
+                resourceInUse->GetName());
+            ++group.numSoftUnloaded_;
+            UpdateMemoryUse(group, resourceInUse);
+            memoryReleased = true;
+        }
+    }
+    tempResourcesInUse_.clear();
+
+    return memoryReleased;
+}
+
+void ResourceCache::EnforceTotalMemoryBudget()
+{
+    unsigned long long totalMemoryUse = GetTotalMemoryUse();
+    if (totalMemoryUse <= totalMemoryBudget_)
+        return;
+
+    // Evict from the group that holds the least recently used resource first.
+    // Eviction doesn't make other groups older, so the groups are sorted only once.
+    tempGroupsByAge_.clear();
+    for (const auto& [type, group] : resourceGroups_)
+    {
+        if (group.lruHead_)
+            tempGroupsByAge_.emplace_back(group.lruHead_->lruStamp_, type);
+    }
+    ea::sort(tempGroupsByAge_.begin(), tempGroupsByAge_.end());
+
+    for (const auto& [stamp, type] : tempGroupsByAge_)
+    {
+        ResourceGroup& group = resourceGroups_[type];
+        const unsigned long long excessMemory = totalMemoryUse - totalMemoryBudget_;
+        const unsigned long long oldMemoryUse = group.memoryUse_;
+        EvictResources(type, group, oldMemoryUse - ea::min(oldMemoryUse, excessMemory));
+
+        totalMemoryUse -= oldMemoryUse - ea::min(oldMemoryUse, group.memoryUse_);
+        if (totalMemoryUse <= totalMemoryBudget_)
+            break;
+    }
+    tempGroupsByAge_.clear();
 }
 
 void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 {
     ea::hash_set<StringHash> affectedGroups;
+    ea::vector<Resource*> resources;
 
     const ea::unordered_map<ea::string, PackageEntry>& entries = package->GetEntries();
     for (auto i = entries.begin(); i != entries.end(); ++i)
     {
         StringHash nameHash(i->first);
 
-        // We do not know the actual resource type, so search all type containers
-        for (auto j = resourceGroups_.begin(); j !=
-            resourceGroups_.end(); ++j)
+        // We do not know the actual resource type, so look up the name index
+        resourceIndex_.FindAll(nameHash, resources);
+        for (Resource* resource : resources)
         {
+            const StringHash type = resource->GetType();
+            auto j = resourceGroups_.find(type);
+            if (j == resourceGroups_.end())
+                continue;
+
             auto k = j->second.resources_.find(nameHash);
-            if (k != j->second.resources_.end())
+            if (k == j->second.resources_.end())
+                continue;
+
+            // If other references exist, do not release, unless forced
+            if ((k->second.Refs() == 1 && k->second.WeakRefs() == 0) || force)
             {
-                // If other references exist, do not release, unless forced
-                if ((k->second.Refs() == 1 && k->second.WeakRefs() == 0) || force)
-                {
-                    j->second.resources_.erase(k);
-                    affectedGroups.insert(j->first);
-                }
-                break;
+                EraseResource(type, j->second, k);
+                affectedGroups.insert(type);
             }
         }
     }
@@ -1105,38 +1320,16 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     if (i == resourceGroups_.end())
         return;
 
-    for (;;)
-    {
-        unsigned totalSize = 0;
-        unsigned oldestTimer = 0;
-        auto oldestResource = i->second.resources_.end();
+    // Memory use is kept up to date when resources are stored, released and reloaded
+    ResourceGroup& group = i->second;
 
-        for (auto j = i->second.resources_.begin();
-             j != i->second.resources_.end(); ++j)
-        {
-            totalSize += j->second->GetMemoryUse();
-            unsigned useTimer = j->second->GetUseTimer();
-            if (useTimer > oldestTimer)
-            {
-                oldestTimer = useTimer;
-                oldestResource = j;
-            }
-        }
-
-        i->second.memoryUse_ = totalSize;
+    // If memory budget defined and is exceeded, evict least recently used resources
+    // (resources in use can not be evicted, but may be soft-unloaded)
+    if (group.memoryBudget_ && group.memoryUse_ > group.memoryBudget_)
+        EvictResources(type, group, group.memoryBudget_);
 
-        // If memory budget defined and is exceeded, remove the oldest resource and loop again
-        // (resources in use always return a zero timer and can not be removed)
-        if (i->second.memoryBudget_ && i->second.memoryUse_ > i->second.memoryBudget_ &&
-            oldestResource != i->second.resources_.end())
-        {
-            URHO3D_LOGDEBUG("Resource group " + oldestResource->second->GetTypeName() + " over memory budget, releasing resource " +
-                     oldestResource->second->GetName());
-            i->second.resources_.erase(oldestResource);
-        }
-        else
-            break;
-    }
+    if (totalMemoryBudget_)
+        EnforceTotalMemoryBudget();
 }
 
 void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
@@ -1196,12 +1389,62 @@ AbstractFilePtr ResourceCache::SearchResourceDirs(const ea::string& name)
     return nullptr;
 }
 
+bool ResourceCache::CreateReadRequest(const ea::string& name, AsyncReadRequest& request)
+{
+    const auto searchResourceDirs = [&]()
+    {
+        auto* fileSystem = GetSubsystem<FileSystem>();
+        for (const ea::string& resourceDir : resourceDirs_)
+        {
+            if (fileSystem->FileExists(resourceDir + name))
+            {
+                request.region_.fileName_ = resourceDir + name;
+                return true;
+            }
+        }
+
+        // Fallback using absolute path
+        if (fileSystem->FileExists(name))
+        {
+            request.region_.fileName_ = name;
+            return true;
+        }
+        return false;
+    };
+
+    const auto searchPackages = [&]()
+    {
+        for (PackageFile* package : packages_)
+        {
+            if (!package->Exists(name))
+                continue;
+
+            // Compressed and memory-mapped files are opened by I/O thread
+            const FileIdentifier fileName{EMPTY_STRING, name};
+            request.region_ = package->GetNativeFileRegion(fileName);
+            if (request.region_.IsEmpty())
+            {
+                request.openFile_ = [package = SharedPtr<PackageFile>(package), fileName]
+                { return package->OpenFile(fileName, FILE_READ); };
+            }
+            return true;
+        }
+        return false;
+    };
+
+    request.name_ = name;
+    if (searchPackagesFirst_)
+        return searchPackages() || searchResourceDirs();
+    else
+        return searchResourceDirs() || searchPackages();
+}
+
 AbstractFilePtr ResourceCache::SearchPackages(const ea::string& name)
 {
     for (unsigned i = 0; i < packages_.size(); ++i)
     {
         if (packages_[i]->Exists(name))
-            return AbstractFilePtr(MakeShared<File>(context_, packages_[i], name));
+            return packages_[i]->OpenFile(FileIdentifier{EMPTY_STRING, name}, FILE_READ);
     }
 
     return nullptr;
@@ -1403,10 +1646,11 @@ bool ResourceCache::RenameResource(const ea::string& source, const ea::string& d
                 ignoreResourceAutoReload_.emplace_back(resource->GetName());
             }
 
+            resourceIndex_.Remove(groupPair.first, resource->GetNameHash());
             groupPair.second.resources_.erase(resource->GetNameHash());
             resource->SetName(newName);
             resource->SetAbsoluteFileName(newNativeFileName);
-            groupPair.second.resources_[resource->GetNameHash()] = resource;
+            StoreResource(groupPair.first, resource->GetNameHash(), resource);
             movedAny = true;
 
             using namespace ResourceRenamed;
@@ -1453,6 +1697,17 @@ void ResourceCache::RouteResourceName(ea::string& name, ResourceRequest requestT
 
 void ResourceCache::Clear()
 {
+    // Resources may outlive the cache, don't leave dangling links
+    for (auto& [type, group] : resourceGroups_)
+    {
+        for (auto& [nameHash, resource] : group.resources_)
+        {
+            resource->lruPrev_ = nullptr;
+            resource->lruNext_ = nullptr;
+        }
+    }
+
+    resourceIndex_.Clear();
     resourceGroups_.clear();
     dependentResources_.clear();
 }
@@ -29,8 +29,10 @@
 
 #include "../Container/Ptr.h"
 #include "../Core/Mutex.h"
+#include "../IO/AsyncFileReader.h"
 #include "../IO/File.h"
 #include "../Resource/Resource.h"
+#include "../Resource/ResourceIndex.h"
 
 namespace Urho3D
 {
@@ -48,7 +50,11 @@ struct ResourceGroup
     /// Construct with defaults.
     ResourceGroup() :
         memoryBudget_(0),
-        memoryUse_(0)
+        memoryUse_(0),
+        lruHead_(nullptr),
+        lruTail_(nullptr),
+        numEvicted_(0),
+        numSoftUnloaded_(0)
     {
     }
 
@@ -58,6 +64,14 @@ struct ResourceGroup
     unsigned long long memoryUse_;
     /// Resources.
     ea::unordered_map<StringHash, SharedPtr<Resource> > resources_;
+    /// Least recently used resource. Resources are evicted starting from it.
+    Resource* lruHead_;
+    /// Most recently used resource.
+    Resource* lruTail_;
+    /// Number of resources evicted because of memory budget.
+    unsigned numEvicted_;
+    /// Number of resources soft-unloaded because of memory budget.
+    unsigned numSoftUnloaded_;
 };
 
 /// Resource request types.
@@ -144,6 +158,12 @@ public:
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     /// @property
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set maximum number of resources background loaded simultaneously. Zero means MAX_IO_QUEUE_DEPTH.
+    void SetMaxConcurrentBackgroundLoads(unsigned maxLoads);
+    /// Set memory budget for all resource types together. Zero means unlimited.
+    void SetTotalMemoryBudget(unsigned long long budget) { totalMemoryBudget_ = budget; }
+    /// Set whether resources in use may be soft-unloaded when memory budget is exceeded and nothing can be evicted.
+    void SetSoftUnloadEnabled(bool enable) { softUnloadEnabled_ = enable; }
 
     /// Add a resource router object. By default there is none, so the routing process is skipped.
     void AddResourceRouter(ResourceRouter* router, bool addAsFirst = false);
@@ -152,19 +172,26 @@ public:
 
     /// Open and return a file from the resource load paths or from inside a package file. If not found, use a fallback search with absolute path. Return null if fails. Can be called from outside the main thread.
     AbstractFilePtr GetFile(const ea::string& name, bool sendEventOnFailure = true);
-    /// Return a resource by type and name. Load if not loaded yet. Return null if not found or if fails, unless SetReturnFailedResources(true) has been called. Can be called only from the main thread.
+    /// Read a file from the resource load paths or from inside a package file asynchronously. Callback is called from I/O thread.
+    /// Return false if not found, the callback is not called in this case. Can be called from outside the main thread.
+    bool ReadFileAsync(const ea::string& name, AsyncReadCallback callback, bool sendEventOnFailure = true);
+    /// Return a resource by type and name. Load if not loaded yet. Return null if not found or if fails, unless SetReturnFailedResources(true) has been called. Can be called only from the main thread, use GetExistingResource in other threads.
     Resource* GetResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data).
     SharedPtr<Resource> GetTempResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true);
     /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
-    bool BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr);
+    /// If the resource is already queued, its loading priority is raised if needed.
+    bool BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr,
+        ResourceLoadPriority priority = ResourceLoadPriority::Normal);
+    /// Cancel background loading of a resource. Return true if the resource was queued. Can be called from outside the main thread.
+    bool CancelBackgroundLoadResource(StringHash type, const ea::string& name);
     /// Return number of pending background-loaded resources.
     /// @property
     unsigned GetNumBackgroundLoadResources() const;
     /// Return all loaded resources of a specific type.
     void GetResources(ea::vector<Resource*>& result, StringHash type) const;
-    /// Return an already loaded resource of specific type & name, or null if not found. Will not load if does not exist. Specifying zero type will search all types.
-    Resource* GetExistingResource(StringHash type, const ea::string& name);
+    /// Return an already loaded resource of specific type & name, or null if not found. Will not load if does not exist. Specifying zero type will search all types. Can be called from outside the main thread.
+    SharedPtr<Resource> GetExistingResource(StringHash type, const ea::string& name);
 
     /// Return all loaded resources.
     const ea::unordered_map<StringHash, ResourceGroup>& GetAllResources() const { return resourceGroups_; }
@@ -180,13 +207,16 @@ public:
     /// Template version of returning a resource by name.
     template <class T> T* GetResource(const ea::string& name, bool sendEventOnFailure = true);
     /// Template version of returning an existing resource by name.
-    template <class T> T* GetExistingResource(const ea::string& name);
+    template <class T> SharedPtr<T> GetExistingResource(const ea::string& name);
     /// Template version of loading a resource without storing it to the cache.
     template <class T> SharedPtr<T> GetTempResource(const ea::string& name, bool sendEventOnFailure = true);
     /// Template version of releasing a resource by name.
     template <class T> void ReleaseResource(const ea::string& resourceName, bool force = false);
     /// Template version of queueing a resource background load.
-    template <class T> bool BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr);
+    template <class T> bool BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr,
+        ResourceLoadPriority priority = ResourceLoadPriority::Normal);
+    /// Template version of cancelling a resource background load.
+    template <class T> bool CancelBackgroundLoadResource(const ea::string& name);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(ea::vector<T*>& result) const;
     /// Return whether a file exists in the resource directories or package files. Does not check manually added in-memory resources.
@@ -218,6 +248,12 @@ public:
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     /// @property
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
+    /// Return maximum number of resources background loaded simultaneously.
+    unsigned GetMaxConcurrentBackgroundLoads() const;
+    /// Return memory budget for all resource types together.
+    unsigned long long GetTotalMemoryBudget() const { return totalMemoryBudget_; }
+    /// Return whether resources in use may be soft-unloaded.
+    bool IsSoftUnloadEnabled() const { return softUnloadEnabled_; }
 
     /// Return a resource router by index.
     ResourceRouter* GetResourceRouter(unsigned index) const;
@@ -257,25 +293,47 @@ public:
     void Clear();
 
 private:
-    /// Find a resource.
-    const SharedPtr<Resource>& FindResource(StringHash type, StringHash nameHash);
-    /// Find a resource by name only. Searches all type groups.
-    const SharedPtr<Resource>& FindResource(StringHash nameHash);
+    /// Find a resource. If type is empty, find resource of any type. Safe to call from any thread.
+    SharedPtr<Resource> FindResource(StringHash type, StringHash nameHash) const;
+    /// Find a resource by name only.
+    SharedPtr<Resource> FindResource(StringHash nameHash) const;
+    /// Store resource in the cache.
+    void StoreResource(StringHash type, StringHash nameHash, Resource* resource);
+    /// Erase resource from the group. Return iterator to the next resource.
+    ea::unordered_map<StringHash, SharedPtr<Resource> >::iterator EraseResource(
+        StringHash type, ResourceGroup& group, ea::unordered_map<StringHash, SharedPtr<Resource> >::iterator iter);
     /// Release resources loaded from a package file.
     void ReleasePackageResources(PackageFile* package, bool force = false);
-    /// Update a resource group. Recalculate memory use and release resources if over memory budget.
+    /// Update a resource group. Release resources if over memory budget.
     void UpdateResourceGroup(StringHash type);
+    /// Update memory use of the group after memory use of the resource is changed.
+    void UpdateMemoryUse(ResourceGroup& group, Resource* resource);
+    /// Mark resource as most recently used.
+    void TouchResource(ResourceGroup& group, Resource* resource);
+    /// Mark resource as most recently used if it's stored in the cache.
+    void TouchResource(StringHash type, Resource* resource);
+    /// Remove resource from LRU list of the group.
+    void UnlinkResource(ResourceGroup& group, Resource* resource);
+    /// Evict least recently used resources that are not in use until the group fits into the memory budget. If not enough, soft-unload resources in use if enabled.
+    /// Return false if no memory can be released.
+    bool EvictResources(StringHash type, ResourceGroup& group, unsigned long long memoryBudget);
+    /// Evict resources until total memory use fits into total memory budget.
+    void EnforceTotalMemoryBudget();
     /// Handle begin frame event. Automatic resource reloads and the finalization of background loaded resources are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Search FileSystem for file.
     AbstractFilePtr SearchResourceDirs(const ea::string& name);
     /// Search resource packages for file.
     AbstractFilePtr SearchPackages(const ea::string& name);
+    /// Create asynchronous read request for the file. Return false if not found. Should be called with locked mutex.
+    bool CreateReadRequest(const ea::string& name, AsyncReadRequest& request);
 
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
-    /// Resources by type.
+    /// Resources by type. Modified only from the main thread.
     ea::unordered_map<StringHash, ResourceGroup> resourceGroups_;
+    /// Resources by name, mirrors resource groups. Used for lookups from any thread.
+    ResourceIndex resourceIndex_;
     /// Resource load directories.
     ea::vector<ea::string> resourceDirs_;
     /// File watchers for resource directories, if automatic reloading enabled.
@@ -298,16 +356,26 @@ private:
     mutable bool isRouting_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// Memory budget for all resource types together.
+    unsigned long long totalMemoryBudget_{};
+    /// Whether to soft-unload resources in use.
+    bool softUnloadEnabled_{};
+    /// Last stamp of resource use.
+    unsigned long long lruStamp_{};
+    /// Temporary storage for resources in use that are evicted.
+    ea::vector<Resource*> tempResourcesInUse_;
+    /// Temporary storage for resource groups evicted by total memory budget.
+    ea::vector<ea::pair<unsigned long long, StringHash>> tempGroupsByAge_;
     /// List of resources that will not be auto-reloaded if reloading event triggers.
     ea::vector<ea::string> ignoreResourceAutoReload_;
     /// Sanitized path to executable
     ea::string exePath_;
 };
 
-template <class T> T* ResourceCache::GetExistingResource(const ea::string& name)
+template <class T> SharedPtr<T> ResourceCache::GetExistingResource(const ea::string& name)
 {
     StringHash type = T::GetTypeStatic();
-    return static_cast<T*>(GetExistingResource(type, name));
+    return StaticCast<T>(GetExistingResource(type, name));
 }
 
 template <class T> T* ResourceCache::GetResource(const ea::string& name, bool sendEventOnFailure)
@@ -328,10 +396,17 @@ template <class T> SharedPtr<T> ResourceCache::GetTempResource(const ea::string&
     return StaticCast<T>(GetTempResource(type, name, sendEventOnFailure));
 }
 
-template <class T> bool ResourceCache::BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure, Resource* caller)
+template <class T> bool ResourceCache::BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure, Resource* caller,
+    ResourceLoadPriority priority)
 {
     StringHash type = T::GetTypeStatic();
-    return BackgroundLoadResource(type, name, sendEventOnFailure, caller);
+    return BackgroundLoadResource(type, name, sendEventOnFailure, caller, priority);
+}
+
+template <class T> bool ResourceCache::CancelBackgroundLoadResource(const ea::string& name)
+{
+    StringHash type = T::GetTypeStatic();
+    return CancelBackgroundLoadResource(type, name);
 }
 
 template <class T> void ResourceCache::GetResources(ea::vector<T*>& result) const
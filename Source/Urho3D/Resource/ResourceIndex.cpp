@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Resource/ResourceIndex.h"
+
+#include "../Resource/Resource.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+void ResourceIndex::Add(StringHash type, StringHash nameHash, Resource* resource)
+{
+    Shard& shard = GetShard(nameHash);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+
+    EntryVector& entries = shard.resources_[nameHash];
+    for (Entry& entry : entries)
+    {
+        if (entry.type_ == type)
+        {
+            entry.resource_ = resource;
+            return;
+        }
+    }
+    entries.push_back(Entry{type, resource});
+}
+
+void ResourceIndex::Remove(StringHash type, StringHash nameHash)
+{
+    Shard& shard = GetShard(nameHash);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+
+    const auto iter = shard.resources_.find(nameHash);
+    if (iter == shard.resources_.end())
+        return;
+
+    EntryVector& entries = iter->second;
+    ea::erase_if(entries, [&](const Entry& entry) { return entry.type_ == type; });
+    if (entries.empty())
+        shard.resources_.erase(iter);
+}
+
+void ResourceIndex::Clear()
+{
+    for (Shard& shard : shards_)
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        shard.resources_.clear();
+    }
+}
+
+SharedPtr<Resource> ResourceIndex::Find(StringHash type, StringHash nameHash) const
+{
+    const Shard& shard = GetShard(nameHash);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+
+    const auto iter = shard.resources_.find(nameHash);
+    if (iter == shard.resources_.end())
+        return nullptr;
+
+    for (const Entry& entry : iter->second)
+    {
+        if (type == StringHash::Empty || entry.type_ == type)
+            return SharedPtr<Resource>(entry.resource_);
+    }
+    return nullptr;
+}
+
+void ResourceIndex::FindAll(StringHash nameHash, ea::vector<Resource*>& result) const
+{
+    result.clear();
+
+    const Shard& shard = GetShard(nameHash);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+
+    const auto iter = shard.resources_.find(nameHash);
+    if (iter == shard.resources_.end())
+        return;
+
+    for (const Entry& entry : iter->second)
+        result.push_back(entry.resource_);
+}
+
+}
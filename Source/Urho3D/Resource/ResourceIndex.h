@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/Ptr.h"
+#include "../Math/StringHash.h"
+
+#include <EASTL/array.h>
+#include <EASTL/fixed_vector.h>
+#include <EASTL/unordered_map.h>
+#include <EASTL/vector.h>
+
+#include <shared_mutex>
+
+namespace Urho3D
+{
+
+class Resource;
+
+/// Thread-safe index of cached resources by name hash, shared by all resource types.
+/// The index is split into shards protected by reader-writer locks, so concurrent lookups don't block each other.
+/// The index doesn't own resources, the owner is responsible for removing resources before they are destroyed.
+class URHO3D_API ResourceIndex
+{
+public:
+    /// Number of shards. Should be power of two.
+    static constexpr unsigned NumShards = 32;
+
+    /// Add resource or replace existing resource with the same type and name.
+    void Add(StringHash type, StringHash nameHash, Resource* resource);
+    /// Remove resource with given type and name.
+    void Remove(StringHash type, StringHash nameHash);
+    /// Remove all resources.
+    void Clear();
+
+    /// Find resource by type and name. If type is empty, return resource of any type. Safe to call from any thread.
+    /// The reference is taken under the lock, so the resource stays alive even if it is released from the cache.
+    SharedPtr<Resource> Find(StringHash type, StringHash nameHash) const;
+    /// Find all resources with given name regardless of type. Returned pointers are not referenced, should be called from main thread.
+    void FindAll(StringHash nameHash, ea::vector<Resource*>& result) const;
+
+private:
+    /// Resource of specific type.
+    struct Entry
+    {
+        StringHash type_;
+        Resource* resource_{};
+    };
+    /// Resources with the same name. Usually there's only one.
+    using EntryVector = ea::fixed_vector<Entry, 1>;
+
+    /// Shard of the index. Aligned to avoid false sharing between shards.
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mutex_;
+        ea::unordered_map<StringHash, EntryVector> resources_;
+    };
+
+    /// Return shard for the name.
+    Shard& GetShard(StringHash nameHash) { return shards_[nameHash.Value() & (NumShards - 1)]; }
+    const Shard& GetShard(StringHash nameHash) const { return shards_[nameHash.Value() & (NumShards - 1)]; }
+
+    /// Shards.
+    ea::array<Shard, NumShards> shards_;
+};
+
+}
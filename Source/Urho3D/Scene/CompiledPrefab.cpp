@@ -0,0 +1,280 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Scene/CompiledPrefab.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../IO/Log.h"
+#include "../Scene/Component.h"
+#include "../Scene/Node.h"
+#include "../Scene/SceneObjectPool.h"
+#include "../Scene/SceneResolver.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Return pool size class of the object.
+unsigned GetPoolSizeClass(unsigned objectSize)
+{
+    const unsigned granularity = SceneObjectPool::SizeGranularity;
+    return (objectSize + granularity - 1) / granularity * granularity;
+}
+
+}
+
+bool CompiledPrefab::Compile(Node* node)
+{
+    Clear();
+
+    if (!node)
+    {
+        URHO3D_LOGERROR("Null node given for CompiledPrefab");
+        return false;
+    }
+
+    URHO3D_PROFILE("CompilePrefab");
+
+    DefaultComponentCache defaultComponents;
+    CompileNode(node, M_MAX_UNSIGNED, defaultComponents);
+
+    // Count objects allocated per instance so memory for all instances can be reserved at once
+    ea::unordered_map<unsigned, unsigned> numObjectsBySize;
+    numObjectsBySize[GetPoolSizeClass(sizeof(Node))] += nodes_.size();
+    numObjectsBySize[GetPoolSizeClass(sizeof(NodeImpl))] += nodes_.size();
+    for (const CompiledComponent& component : components_)
+    {
+        const ObjectReflection* reflection = node->GetContext()->GetReflection(component.type_);
+        if (reflection && reflection->GetObjectSize() != 0)
+            ++numObjectsBySize[GetPoolSizeClass(reflection->GetObjectSize())];
+    }
+    objectSizes_.assign(numObjectsBySize.begin(), numObjectsBySize.end());
+
+    return true;
+}
+
+void CompiledPrefab::Clear()
+{
+    nodes_.clear();
+    components_.clear();
+    attributes_.clear();
+    objectSizes_.clear();
+    hasIdAttributes_ = false;
+}
+
+void CompiledPrefab::CompileNode(Node* node, unsigned parentIndex, DefaultComponentCache& defaultComponents)
+{
+    const unsigned nodeIndex = nodes_.size();
+    CompiledNode& nodeData = nodes_.emplace_back();
+    nodeData.parentIndex_ = parentIndex;
+    nodeData.id_ = node->GetID();
+    nodeData.name_ = node->GetName();
+    nodeData.tags_ = node->GetTags();
+    nodeData.position_ = node->GetPosition();
+    nodeData.rotation_ = node->GetRotation();
+    nodeData.scale_ = node->GetScale();
+    nodeData.enabled_ = node->IsEnabled();
+    nodeData.vars_ = node->GetVars();
+    nodeData.firstComponent_ = components_.size();
+
+    for (Component* component : node->GetComponents())
+    {
+        if (component->IsTemporary())
+            continue;
+
+        ObjectReflection* reflection = component->GetReflection();
+        if (!reflection || !reflection->HasObjectFactory())
+        {
+            URHO3D_LOGWARNING("Component '{}' cannot be created from reflection and is skipped in compiled prefab",
+                component->GetTypeName());
+            continue;
+        }
+
+        CompiledComponent& componentData = components_.emplace_back();
+        componentData.type_ = component->GetType();
+        componentData.id_ = component->GetID();
+        componentData.firstAttribute_ = attributes_.size();
+
+        // Store only values that differ from the values of default-constructed component
+        SharedPtr<Serializable>& defaultComponent = defaultComponents[componentData.type_];
+        if (!defaultComponent)
+            defaultComponent = DynamicCast<Serializable>(reflection->CreateObject());
+
+        const ea::vector<AttributeInfo>& attributes = reflection->GetAttributes();
+        for (unsigned attributeIndex = 0; attributeIndex < attributes.size(); ++attributeIndex)
+        {
+            const AttributeInfo& attr = attributes[attributeIndex];
+            if (!attr.ShouldSave() || !attr.ShouldLoad())
+                continue;
+
+            Variant value;
+            component->OnGetAttribute(attr, value);
+
+            if (defaultComponent && !component->SaveDefaultAttributes(attr))
+            {
+                Variant defaultValue;
+                defaultComponent->OnGetAttribute(attr, defaultValue);
+                if (value == defaultValue)
+                    continue;
+            }
+
+            if (attr.mode_ & (AM_NODEID | AM_COMPONENTID | AM_NODEIDVECTOR))
+                hasIdAttributes_ = true;
+
+            attributes_.push_back(CompiledAttribute{attr.nameHash_, attributeIndex, ea::move(value)});
+        }
+
+        componentData.numAttributes_ = attributes_.size() - componentData.firstAttribute_;
+    }
+
+    // Reference may be invalidated by compilation of children
+    nodes_[nodeIndex].numComponents_ = components_.size() - nodes_[nodeIndex].firstComponent_;
+
+    for (Node* child : node->GetChildren())
+    {
+        if (!child->IsTemporary())
+            CompileNode(child, nodeIndex, defaultComponents);
+    }
+}
+
+Node* CompiledPrefab::Instantiate(Node* parent) const
+{
+    const ea::vector<Node*> instances = Instantiate(parent, 1);
+    return !instances.empty() ? instances[0] : nullptr;
+}
+
+ea::vector<Node*> CompiledPrefab::Instantiate(Node* parent, unsigned count) const
+{
+    if (!parent)
+    {
+        URHO3D_LOGERROR("Null parent node given for CompiledPrefab");
+        return {};
+    }
+
+    if (nodes_.empty() || count == 0)
+        return {};
+
+    URHO3D_PROFILE("InstantiateCompiledPrefab");
+
+    // Resolve reflections once for all instances. Reflection could be re-registered since compilation,
+    // so attributes are matched by name using compiled index as a hint
+    Context* context = parent->GetContext();
+    ea::vector<ObjectReflection*> reflections(components_.size());
+    ea::vector<unsigned> attributeIndices(attributes_.size(), M_MAX_UNSIGNED);
+    for (unsigned componentIndex = 0; componentIndex < components_.size(); ++componentIndex)
+    {
+        const CompiledComponent& componentData = components_[componentIndex];
+        ObjectReflection* reflection = context->GetReflection(componentData.type_);
+        if (!reflection || !reflection->HasObjectFactory())
+        {
+            URHO3D_LOGERROR("Could not create component of type {} because it is no longer registered",
+                componentData.type_.ToDebugString());
+            continue;
+        }
+
+        reflections[componentIndex] = reflection;
+        for (unsigned i = 0; i < componentData.numAttributes_; ++i)
+        {
+            const unsigned attributeIndex = componentData.firstAttribute_ + i;
+            const CompiledAttribute& attribute = attributes_[attributeIndex];
+            attributeIndices[attributeIndex] = reflection->GetAttributeIndex(attribute.nameHash_, attribute.index_);
+        }
+    }
+
+    for (const auto& [objectSize, numObjects] : objectSizes_)
+        SceneObjectPool::Reserve(objectSize, numObjects * count);
+
+    ea::vector<Node*> instances;
+    instances.reserve(count);
+    for (unsigned i = 0; i < count; ++i)
+        instances.push_back(CreateInstance(parent, reflections, attributeIndices));
+    return instances;
+}
+
+Node* CompiledPrefab::CreateInstance(Node* parent, const ea::vector<ObjectReflection*>& reflections,
+    const ea::vector<unsigned>& attributeIndices) const
+{
+    SceneResolver resolver;
+
+    ea::vector<Node*> createdNodes(nodes_.size());
+    for (unsigned nodeIndex = 0; nodeIndex < nodes_.size(); ++nodeIndex)
+    {
+        const CompiledNode& nodeData = nodes_[nodeIndex];
+        Node* nodeParent = nodeIndex == 0 ? parent : createdNodes[nodeData.parentIndex_];
+
+        Node* node = nodeParent->CreateChild(nodeData.name_);
+        createdNodes[nodeIndex] = node;
+
+        if (!nodeData.enabled_)
+            node->SetEnabled(false);
+        if (!nodeData.tags_.empty())
+            node->SetTags(nodeData.tags_);
+        node->SetTransform(nodeData.position_, nodeData.rotation_, nodeData.scale_);
+        for (const auto& [key, value] : nodeData.vars_)
+            node->SetVar(key, value);
+
+        if (hasIdAttributes_)
+            resolver.AddNode(nodeData.id_, node);
+
+        for (unsigned i = 0; i < nodeData.numComponents_; ++i)
+        {
+            const unsigned componentIndex = nodeData.firstComponent_ + i;
+            const CompiledComponent& componentData = components_[componentIndex];
+            ObjectReflection* reflection = reflections[componentIndex];
+            if (!reflection)
+                continue;
+
+            const SharedPtr<Component> component = DynamicCast<Component>(reflection->CreateObject());
+            if (!component)
+                continue;
+
+            node->AddComponent(component, 0);
+
+            const ea::vector<AttributeInfo>& attributes = reflection->GetAttributes();
+            for (unsigned j = 0; j < componentData.numAttributes_; ++j)
+            {
+                const unsigned attributeIndex = componentData.firstAttribute_ + j;
+                if (attributeIndices[attributeIndex] != M_MAX_UNSIGNED)
+                    component->OnSetAttribute(attributes[attributeIndices[attributeIndex]], attributes_[attributeIndex].value_);
+            }
+
+            if (hasIdAttributes_)
+                resolver.AddComponent(componentData.id_, component);
+        }
+    }
+
+    Node* rootNode = createdNodes[0];
+    if (hasIdAttributes_)
+        resolver.Resolve();
+    rootNode->ApplyAttributes();
+    return rootNode;
+}
+
+}
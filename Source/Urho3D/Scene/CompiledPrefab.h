@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/Ptr.h"
+#include "../Core/Variant.h"
+
+#include <EASTL/unordered_map.h>
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Node;
+class ObjectReflection;
+class Serializable;
+
+/// Prefab compiled into flat tables for fast instantiation.
+/// Node hierarchy is stored as a table in depth-first order, components store non-default attribute values
+/// with attribute indices resolved in advance. Instantiation doesn't involve archives, attribute lookup by name
+/// or creation of default values, and memory for all objects is reserved in SceneObjectPool at once.
+/// Temporary nodes and components are skipped, like in serialization.
+class URHO3D_API CompiledPrefab
+{
+public:
+    /// Construct empty.
+    CompiledPrefab() = default;
+    /// Compile from node hierarchy.
+    explicit CompiledPrefab(Node* node) { Compile(node); }
+
+    /// Compile from node hierarchy. Return false if the node is null.
+    bool Compile(Node* node);
+    /// Remove all contents.
+    void Clear();
+
+    /// Create instance of prefab as a child of the parent node. Return root node of the instance.
+    Node* Instantiate(Node* parent) const;
+    /// Create multiple instances of prefab as children of the parent node. Return root nodes of the instances.
+    ea::vector<Node*> Instantiate(Node* parent, unsigned count) const;
+
+    /// Return whether the prefab is empty.
+    bool IsEmpty() const { return nodes_.empty(); }
+    /// Return number of nodes in the prefab.
+    unsigned GetNumNodes() const { return nodes_.size(); }
+    /// Return number of components in the prefab.
+    unsigned GetNumComponents() const { return components_.size(); }
+
+private:
+    /// Attribute value with resolved attribute index.
+    struct CompiledAttribute
+    {
+        /// Attribute name hash.
+        StringHash nameHash_;
+        /// Index of attribute in reflection at the time of compilation, used as a hint.
+        unsigned index_{};
+        /// Value of attribute.
+        Variant value_;
+    };
+
+    /// Compiled component.
+    struct CompiledComponent
+    {
+        /// Component type. Reflection is looked up on instantiation because the type may be re-registered.
+        StringHash type_;
+        /// ID of original component.
+        unsigned id_{};
+        /// Range of attribute values in attributes_.
+        unsigned firstAttribute_{};
+        unsigned numAttributes_{};
+    };
+
+    /// Compiled node.
+    struct CompiledNode
+    {
+        /// Index of parent node in nodes_, M_MAX_UNSIGNED for root node.
+        unsigned parentIndex_{};
+        /// ID of original node.
+        unsigned id_{};
+        /// Node properties.
+        /// @{
+        ea::string name_;
+        StringVector tags_;
+        Vector3 position_;
+        Quaternion rotation_;
+        Vector3 scale_;
+        bool enabled_{};
+        StringVariantMap vars_;
+        /// @}
+        /// Range of components in components_.
+        unsigned firstComponent_{};
+        unsigned numComponents_{};
+    };
+
+    /// Default-constructed components used to skip default attribute values.
+    using DefaultComponentCache = ea::unordered_map<StringHash, SharedPtr<Serializable>>;
+
+    /// Compile node and its children recursively.
+    void CompileNode(Node* node, unsigned parentIndex, DefaultComponentCache& defaultComponents);
+    /// Create single instance. Memory should be already reserved.
+    /// Reflections are resolved per component, attribute indices are resolved per attribute value.
+    Node* CreateInstance(Node* parent, const ea::vector<ObjectReflection*>& reflections,
+        const ea::vector<unsigned>& attributeIndices) const;
+
+    /// Nodes in depth-first order.
+    ea::vector<CompiledNode> nodes_;
+    /// Components of all nodes.
+    ea::vector<CompiledComponent> components_;
+    /// Attribute values of all components.
+    ea::vector<CompiledAttribute> attributes_;
+    /// Number of pooled objects per object size required for one instance.
+    ea::vector<ea::pair<unsigned, unsigned>> objectSizes_;
+    /// Whether the attributes reference nodes or components by ID and should be resolved after instantiation.
+    bool hasIdAttributes_{};
+};
+
+}
@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include "../Scene/SceneObjectPool.h"
 #include "../Scene/Serializable.h"
 
 namespace Urho3D
@@ -49,8 +50,11 @@ class URHO3D_API Component : public Serializable
 
     friend class Node;
     friend class Scene;
+    friend class SceneComponentIndex;
 
 public:
+    URHO3D_SCENE_OBJECT_POOL();
+
     /// Construct.
     explicit Component(Context* context);
     /// Destruct.
@@ -131,6 +135,10 @@ protected:
     bool networkUpdate_;
     /// Enabled flag.
     bool enabled_;
+
+private:
+    /// Position in the scene component index of this type.
+    unsigned indexPosition_{M_MAX_UNSIGNED};
 };
 
 template <class T> T* Component::GetComponent() const { return static_cast<T*>(GetComponent(T::GetTypeStatic())); }
@@ -22,6 +22,9 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/Log.h"
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_PHYSICS2D)
 #include "../Physics/PhysicsEvents.h"
@@ -33,8 +36,309 @@
 namespace Urho3D
 {
 
+LogicComponentManager::LogicComponentManager(Context* context)
+    : TrackedComponentRegistryBase(context, LogicComponent::GetTypeStatic())
+    , workQueue_(GetSubsystem<WorkQueue>())
+{
+}
+
+LogicComponentManager::~LogicComponentManager() = default;
+
+void LogicComponentManager::RegisterObject(Context* context)
+{
+    context->AddFactoryReflection<LogicComponentManager>(Category_Scene);
+}
+
+void LogicComponentManager::Update(float timeStep)
+{
+    URHO3D_PROFILE("UpdateLogicComponents");
+
+    FlushChanges();
+    SubscribeToFixedUpdate();
+
+    ++updateDepth_;
+    // Batches are not reallocated during update because additions are delayed until next flush
+    for (ComponentBatch& batch : batches_)
+    {
+        const unsigned numComponents = batch.components_.size();
+        if (batch.threadSafe_)
+        {
+            // Delayed start may modify scene and should be called from main thread
+            for (unsigned i = 0; i < numComponents; ++i)
+                DelayedStartIfNeeded(batch, i);
+            UpdateParallel(batch.components_, timeStep);
+            continue;
+        }
+
+        for (unsigned i = 0; i < numComponents; ++i)
+        {
+            if (!DelayedStartIfNeeded(batch, i))
+                continue;
+
+            LogicComponent* component = batch.components_[i];
+            if (component->updateEventMask_ & USE_UPDATE)
+                component->Update(timeStep);
+        }
+    }
+    --updateDepth_;
+}
+
+void LogicComponentManager::PostUpdate(float timeStep)
+{
+    URHO3D_PROFILE("PostUpdateLogicComponents");
+
+    FlushChanges();
+
+    ++updateDepth_;
+    for (ComponentBatch& batch : batches_)
+    {
+        const unsigned numComponents = batch.components_.size();
+        for (unsigned i = 0; i < numComponents; ++i)
+        {
+            LogicComponent* component = batch.components_[i];
+            if (component && (component->updateEventMask_ & USE_POSTUPDATE))
+                component->PostUpdate(timeStep);
+        }
+    }
+    --updateDepth_;
+}
+
+void LogicComponentManager::FixedUpdate(float timeStep)
+{
+    URHO3D_PROFILE("FixedUpdateLogicComponents");
+
+    FlushChanges();
+
+    ++updateDepth_;
+    for (ComponentBatch& batch : batches_)
+    {
+        const unsigned numComponents = batch.components_.size();
+        for (unsigned i = 0; i < numComponents; ++i)
+        {
+            LogicComponent* component = batch.components_[i];
+            if (!component || !(component->updateEventMask_ & USE_FIXEDUPDATE))
+                continue;
+
+            // Execute user-defined delayed start function before first fixed update if not called yet
+            if (!DelayedStartIfNeeded(batch, i))
+                continue;
+
+            batch.components_[i]->FixedUpdate(timeStep);
+        }
+    }
+    --updateDepth_;
+}
+
+void LogicComponentManager::FixedPostUpdate(float timeStep)
+{
+    URHO3D_PROFILE("FixedPostUpdateLogicComponents");
+
+    FlushChanges();
+
+    ++updateDepth_;
+    for (ComponentBatch& batch : batches_)
+    {
+        const unsigned numComponents = batch.components_.size();
+        for (unsigned i = 0; i < numComponents; ++i)
+        {
+            LogicComponent* component = batch.components_[i];
+            if (component && (component->updateEventMask_ & USE_FIXEDPOSTUPDATE))
+                component->FixedPostUpdate(timeStep);
+        }
+    }
+    --updateDepth_;
+}
+
+void LogicComponentManager::UpdateParallel(ea::span<LogicComponent* const> components, float timeStep)
+{
+    Scene* scene = GetScene();
+    if (scene)
+        scene->BeginThreadedUpdate();
+
+    ForEachParallel(workQueue_, ParallelUpdateBucket, components,
+        [timeStep](unsigned /*index*/, LogicComponent* component)
+    {
+        if (component && (component->updateEventMask_ & USE_UPDATE))
+            component->Update(timeStep);
+    });
+
+    if (scene)
+        scene->EndThreadedUpdate();
+}
+
+void LogicComponentManager::OnSceneSet(Scene* scene)
+{
+    TrackedComponentRegistryBase::OnSceneSet(scene);
+
+    if (scene)
+    {
+        SubscribeToEvent<Ev::SceneUpdate>(scene, [this](const Ev::SceneUpdate& event) { Update(event.timeStep_); });
+        SubscribeToEvent<Ev::ScenePostUpdate>(scene, [this](const Ev::ScenePostUpdate& event) { PostUpdate(event.timeStep_); });
+        SubscribeToFixedUpdate();
+    }
+    else
+    {
+        UnsubscribeFromAllEvents();
+        fixedUpdateSource_ = nullptr;
+        batches_.clear();
+        addedComponents_.clear();
+        dirty_ = false;
+    }
+}
+
+void LogicComponentManager::OnComponentAdded(TrackedComponentBase* baseComponent)
+{
+    auto component = static_cast<LogicComponent*>(baseComponent);
+
+    // Component is added to batch on next flush so batches are not modified during update
+    component->batchIndex_ = M_MAX_UNSIGNED;
+    component->indexInBatch_ = addedComponents_.size();
+    addedComponents_.push_back(component);
+    dirty_ = true;
+
+    component->UpdateEventSubscription();
+}
+
+void LogicComponentManager::OnComponentRemoved(TrackedComponentBase* baseComponent)
+{
+    auto component = static_cast<LogicComponent*>(baseComponent);
+    if (!component->IsBatchedUpdate())
+        return;
+
+    // Leave gap so the indices of other components are not changed during update
+    if (component->batchIndex_ != M_MAX_UNSIGNED)
+    {
+        ComponentBatch& batch = batches_[component->batchIndex_];
+        batch.components_[component->indexInBatch_] = nullptr;
+        ++batch.numRemoved_;
+    }
+    else
+        addedComponents_[component->indexInBatch_] = nullptr;
+
+    component->batchIndex_ = M_MAX_UNSIGNED;
+    component->indexInBatch_ = M_MAX_UNSIGNED;
+    dirty_ = true;
+
+    component->UpdateEventSubscription();
+}
+
+void LogicComponentManager::FlushChanges()
+{
+    if (!dirty_ || updateDepth_ > 0)
+        return;
+
+    URHO3D_PROFILE("FlushLogicComponentChanges");
+
+    dirty_ = false;
+
+    bool batchesChanged = false;
+    for (ComponentBatch& batch : batches_)
+    {
+        if (batch.numRemoved_ == 0)
+            continue;
+
+        ea::erase(batch.components_, nullptr);
+        batch.numRemoved_ = 0;
+        batchesChanged = true;
+    }
+
+    const unsigned numBatches = batches_.size();
+    ea::erase_if(batches_, [](const ComponentBatch& batch) { return batch.components_.empty(); });
+    if (numBatches != batches_.size())
+        batchesChanged = true;
+
+    for (LogicComponent* component : addedComponents_)
+    {
+        if (component && AddToBatch(component))
+            batchesChanged = true;
+    }
+    addedComponents_.clear();
+
+    if (batchesChanged)
+    {
+        for (unsigned batchIndex = 0; batchIndex < batches_.size(); ++batchIndex)
+        {
+            const ea::vector<LogicComponent*>& components = batches_[batchIndex].components_;
+            for (unsigned i = 0; i < components.size(); ++i)
+            {
+                components[i]->batchIndex_ = batchIndex;
+                components[i]->indexInBatch_ = i;
+            }
+        }
+    }
+}
+
+bool LogicComponentManager::AddToBatch(LogicComponent* component)
+{
+    const StringHash type = component->GetType();
+    const auto isLess = [](const ComponentBatch& batch, StringHash type) { return batch.type_ < type; };
+    auto iter = ea::lower_bound(batches_.begin(), batches_.end(), type, isLess);
+
+    bool batchAdded = false;
+    if (iter == batches_.end() || iter->type_ != type)
+    {
+        ComponentBatch batch;
+        batch.type_ = type;
+        batch.threadSafe_ = component->IsThreadSafeUpdate();
+        iter = batches_.insert(iter, ea::move(batch));
+        batchAdded = true;
+    }
+
+    component->batchIndex_ = static_cast<unsigned>(iter - batches_.begin());
+    component->indexInBatch_ = iter->components_.size();
+    iter->components_.push_back(component);
+    return batchAdded;
+}
+
+void LogicComponentManager::SubscribeToFixedUpdate()
+{
+#if defined(URHO3D_PHYSICS) || defined(URHO3D_PHYSICS2D)
+    if (fixedUpdateSource_)
+        return;
+
+    fixedUpdateSource_ = GetFixedUpdateSource();
+    if (fixedUpdateSource_)
+    {
+        SubscribeToEvent(fixedUpdateSource_, E_PHYSICSPRESTEP, URHO3D_HANDLER(LogicComponentManager, HandlePhysicsPreStep));
+        SubscribeToEvent(fixedUpdateSource_, E_PHYSICSPOSTSTEP, URHO3D_HANDLER(LogicComponentManager, HandlePhysicsPostStep));
+    }
+#endif
+}
+
+bool LogicComponentManager::DelayedStartIfNeeded(ComponentBatch& batch, unsigned index)
+{
+    LogicComponent* component = batch.components_[index];
+    if (!component)
+        return false;
+
+    if (!component->delayedStartCalled_)
+    {
+        component->DelayedStart();
+        component->delayedStartCalled_ = true;
+    }
+
+    // Component may be removed by DelayedStart()
+    return batch.components_[index] != nullptr;
+}
+
+#if defined(URHO3D_PHYSICS) || defined(URHO3D_PHYSICS2D)
+
+void LogicComponentManager::HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData)
+{
+    using namespace PhysicsPreStep;
+    FixedUpdate(eventData[P_TIMESTEP].GetFloat());
+}
+
+void LogicComponentManager::HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData)
+{
+    using namespace PhysicsPostStep;
+    FixedPostUpdate(eventData[P_TIMESTEP].GetFloat());
+}
+
+#endif
+
 LogicComponent::LogicComponent(Context* context) :
-    Component(context),
+    TrackedComponentBase(context),
     updateEventMask_(USE_UPDATE | USE_POSTUPDATE | USE_FIXEDUPDATE | USE_FIXEDPOSTUPDATE),
     currentEventMask_(0),
     delayedStartCalled_(false)
@@ -45,6 +349,17 @@ LogicComponent::~LogicComponent() = default;
 
 void LogicComponent::OnSetEnabled()
 {
+    // Manager may be already removed from the scene
+    if (manager_ && manager_->GetScene() == GetScene())
+    {
+        const bool wasTracked = IsTrackedInRegistry();
+        const bool isTracked = ShouldBeTrackedInRegistry();
+        if (wasTracked && !isTracked)
+            manager_->RemoveTrackedComponent(this);
+        else if (!wasTracked && isTracked)
+            manager_->AddTrackedComponent(this);
+    }
+
     UpdateEventSubscription();
 }
 
@@ -69,6 +384,18 @@ StringHash LogicComponent::GetPostUpdateEvent() const
     return E_SCENEPOSTUPDATE;
 }
 
+bool LogicComponent::ShouldBeTrackedInRegistry() const
+{
+    // Components with custom post-update event are always updated via event subscriptions
+    return IsEnabledEffective() && GetPostUpdateEvent() == E_SCENEPOSTUPDATE;
+}
+
+void LogicComponent::ReconnectToRegistry()
+{
+    Scene* scene = GetScene();
+    manager_ = scene ? scene->GetDerivedComponent<LogicComponentManager>() : nullptr;
+}
+
 void LogicComponent::SetUpdateEventMask(UpdateEventFlags mask)
 {
     if (updateEventMask_ != mask)
@@ -94,6 +421,18 @@ void LogicComponent::OnNodeSet(Node* previousNode, Node* currentNode)
 
 void LogicComponent::OnSceneSet(Scene* scene)
 {
+    LogicComponentManager* newManager = scene ? scene->GetDerivedComponent<LogicComponentManager>() : nullptr;
+    if (newManager != manager_)
+    {
+        if (manager_ && IsTrackedInRegistry())
+            manager_->RemoveTrackedComponent(this);
+
+        manager_ = newManager;
+
+        if (manager_ && ShouldBeTrackedInRegistry())
+            manager_->AddTrackedComponent(this);
+    }
+
     if (scene)
         UpdateEventSubscription();
     else
@@ -114,7 +453,8 @@ void LogicComponent::UpdateEventSubscription()
     if (!scene)
         return;
 
-    bool enabled = IsEnabledEffective();
+    // Batched components are updated by the manager
+    bool enabled = IsEnabledEffective() && !IsBatchedUpdate();
 
     bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
     if (needUpdate && !(currentEventMask_ & USE_UPDATE))
@@ -25,7 +25,9 @@
 #pragma once
 
 #include "../Container/FlagSet.h"
-#include "../Scene/Component.h"
+#include "../Scene/TrackedComponent.h"
+
+#include <EASTL/span.h>
 
 namespace Urho3D
 {
@@ -45,10 +47,94 @@ enum UpdateEvent : unsigned
 };
 URHO3D_FLAGSET(UpdateEvent, UpdateEventFlags);
 
+class LogicComponent;
+class WorkQueue;
+
+/// Scene component that updates all logic components of the scene in batches instead of individual event subscriptions.
+/// Components of the same type are stored contiguously and updated together, batches are sorted by type.
+/// Logic components use individual event subscriptions if the scene doesn't have this component.
+class URHO3D_API LogicComponentManager : public TrackedComponentRegistryBase
+{
+    URHO3D_OBJECT(LogicComponentManager, TrackedComponentRegistryBase);
+
+public:
+    static constexpr bool IsOnlyEnabledTracked = true;
+    /// Number of components updated by one task in parallel update.
+    static constexpr unsigned ParallelUpdateBucket = 64;
+
+    /// Construct.
+    explicit LogicComponentManager(Context* context);
+    /// Destruct.
+    ~LogicComponentManager() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Call Update() of all components. Called automatically on scene update.
+    void Update(float timeStep);
+    /// Call PostUpdate() of all components. Called automatically on scene post-update.
+    void PostUpdate(float timeStep);
+    /// Call FixedUpdate() of all components. Called automatically on physics pre-step.
+    void FixedUpdate(float timeStep);
+    /// Call FixedPostUpdate() of all components. Called automatically on physics post-step.
+    void FixedPostUpdate(float timeStep);
+    /// Call Update() of thread-safe components from worker threads. Null components are skipped.
+    void UpdateParallel(ea::span<LogicComponent* const> components, float timeStep);
+
+    /// Return number of batches, i.e. distinct types of updated components.
+    unsigned GetNumBatches() const { return batches_.size(); }
+    /// Return components in the batch. May contain null pointers in place of recently removed components.
+    ea::span<LogicComponent* const> GetBatchComponents(unsigned batchIndex) const { return batches_[batchIndex].components_; }
+
+protected:
+    void OnSceneSet(Scene* scene) override;
+    void OnComponentAdded(TrackedComponentBase* baseComponent) override;
+    void OnComponentRemoved(TrackedComponentBase* baseComponent) override;
+
+private:
+    /// Components of the same type.
+    struct ComponentBatch
+    {
+        StringHash type_;
+        bool threadSafe_{};
+        ea::vector<LogicComponent*> components_;
+        unsigned numRemoved_{};
+    };
+
+    /// Apply pending additions and removals. Ignored if called during update.
+    void FlushChanges();
+    /// Add component to the batch of its type.
+    bool AddToBatch(LogicComponent* component);
+    /// Subscribe to fixed update events of the physics world, if present.
+    void SubscribeToFixedUpdate();
+    /// Call DelayedStart() of the component if not called yet. Return false if the component was removed.
+    bool DelayedStartIfNeeded(ComponentBatch& batch, unsigned index);
+
+#if defined(URHO3D_PHYSICS) || defined(URHO3D_PHYSICS2D)
+    /// Handle physics pre-step event.
+    void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
+    /// Handle physics post-step event.
+    void HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData);
+#endif
+
+    /// Work queue.
+    WorkQueue* workQueue_{};
+    /// Batches sorted by type.
+    ea::vector<ComponentBatch> batches_;
+    /// Components added since last flush.
+    ea::vector<LogicComponent*> addedComponents_;
+    /// Source of fixed update events.
+    WeakPtr<Component> fixedUpdateSource_;
+    /// Whether there are pending changes.
+    bool dirty_{};
+    /// Depth of nested updates.
+    unsigned updateDepth_{};
+};
+
 /// Helper base class for user-defined game logic components that hooks up to update events and forwards them to virtual functions similar to ScriptInstance class.
-class URHO3D_API LogicComponent : public Component
+class URHO3D_API LogicComponent : public TrackedComponentBase
 {
-    URHO3D_OBJECT(LogicComponent, Component);
+    URHO3D_OBJECT(LogicComponent, TrackedComponentBase);
+    friend class LogicComponentManager;
 
     /// Construct.
     explicit LogicComponent(Context* context);
@@ -78,6 +164,16 @@ class URHO3D_API LogicComponent : public Component
 
     /// Return post update event type. Should stay the same for any given instance of the component.
     virtual StringHash GetPostUpdateEvent() const;
+    /// Return whether Update() may be called from worker threads in parallel for all components of this type.
+    /// Used only by LogicComponentManager. Thread-safe components should not send events or modify scene hierarchy.
+    /// Should stay the same for any given instance of the component.
+    virtual bool IsThreadSafeUpdate() const { return false; }
+
+    /// Implement TrackedComponentBase.
+    /// @{
+    bool ShouldBeTrackedInRegistry() const override;
+    void ReconnectToRegistry() override;
+    /// @}
 
     /// Set what update events should be subscribed to. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
     void SetUpdateEventMask(UpdateEventFlags mask);
@@ -87,6 +183,10 @@ class URHO3D_API LogicComponent : public Component
 
     /// Return whether the DelayedStart() function has been called.
     bool IsDelayedStartCalled() const { return delayedStartCalled_; }
+    /// Return manager of the scene, if any.
+    LogicComponentManager* GetManager() const { return manager_; }
+    /// Return whether the component is updated by LogicComponentManager instead of individual event subscriptions.
+    bool IsBatchedUpdate() const { return indexInBatch_ != M_MAX_UNSIGNED; }
 
 protected:
     /// Handle scene node being assigned at creation.
@@ -113,6 +213,12 @@ private:
     UpdateEventFlags currentEventMask_;
     /// Flag for delayed start.
     bool delayedStartCalled_;
+    /// Manager of the scene.
+    WeakPtr<LogicComponentManager> manager_;
+    /// Index of the batch in the manager. M_MAX_UNSIGNED if the component is pending.
+    unsigned batchIndex_{M_MAX_UNSIGNED};
+    /// Index in the batch or in the pending components of the manager.
+    unsigned indexInBatch_{M_MAX_UNSIGNED};
 };
 
 }
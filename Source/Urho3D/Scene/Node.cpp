@@ -389,6 +389,12 @@ void Node::ApplyAttributes()
         children_[i]->ApplyAttributes();
 }
 
+void Node::OnSetAttribute(const AttributeInfo& attr, const Variant& src)
+{
+    Serializable::OnSetAttribute(attr, src);
+    ++attributesRevision_;
+}
+
 bool Node::SaveXML(Serializer& dest, const ea::string& indentation) const
 {
     SharedPtr<XMLFile> xml(MakeShared<XMLFile>(context_));
@@ -416,6 +422,7 @@ void Node::SetName(const ea::string& name)
     {
         impl_->name_ = name;
         impl_->nameHash_ = name;
+        ++attributesRevision_;
 
         // Send change event
         if (scene_)
@@ -445,6 +452,7 @@ void Node::AddTag(const ea::string& tag)
 
     // Add tag
     impl_->tags_.push_back(tag);
+    ++attributesRevision_;
 
     // Cache
     if (scene_)
@@ -482,6 +490,7 @@ bool Node::RemoveTag(const ea::string& tag)
         return false;
 
     impl_->tags_.erase(it);
+    ++attributesRevision_;
 
     // Scene cache update
     if (scene_)
@@ -519,17 +528,20 @@ void Node::RemoveAllTags()
     }
 
     impl_->tags_.clear();
+    ++attributesRevision_;
 }
 
 void Node::SetPosition(const Vector3& position)
 {
     position_ = position;
+    ++attributesRevision_;
     MarkDirty();
 }
 
 void Node::SetRotation(const Quaternion& rotation)
 {
     rotation_ = rotation;
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -555,6 +567,7 @@ void Node::SetScale(const Vector3& scale)
     if (scale_.z_ == 0.0f)
         scale_.z_ = M_EPSILON;
 
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -562,6 +575,7 @@ void Node::SetTransform(const Vector3& position, const Quaternion& rotation)
 {
     position_ = position;
     rotation_ = rotation;
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -575,6 +589,7 @@ void Node::SetTransform(const Vector3& position, const Quaternion& rotation, con
     position_ = position;
     rotation_ = rotation;
     scale_ = scale;
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -657,6 +672,7 @@ void Node::Translate(const Vector3& delta, TransformSpace space)
         break;
     }
 
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -683,6 +699,7 @@ void Node::Rotate(const Quaternion& delta, TransformSpace space)
         break;
     }
 
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -721,6 +738,7 @@ void Node::RotateAround(const Vector3& point, const Quaternion& delta, Transform
     Vector3 oldRelativePos = oldRotation.Inverse() * (position_ - parentSpacePoint);
     position_ = rotation_ * oldRelativePos + parentSpacePoint;
 
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -779,6 +797,7 @@ void Node::Scale(float scale)
 void Node::Scale(const Vector3& scale)
 {
     scale_ *= scale;
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -807,6 +826,7 @@ void Node::ScaleAround(const Vector3& point, const Vector3& scale, TransformSpac
     const Vector3 oldRelativePos = (Vector3::ONE / oldScale) * (position_ - parentSpacePoint);
     position_ = scale_ * oldRelativePos + parentSpacePoint;
 
+    ++attributesRevision_;
     MarkDirty();
 }
 
@@ -849,23 +869,12 @@ void Node::MarkDirty()
             return;
         cur->dirty_ = true;
 
-        // Notify listener components first, then mark child nodes
-        for (auto i = cur->listeners_.begin(); i !=
-            cur->listeners_.end();)
-        {
-            Component *c = i->Get();
-            if (c)
-            {
-                c->OnMarkedDirty(cur);
-                ++i;
-            }
-            // If listener has expired, erase from list (swap with the last element to avoid O(n^2) behavior)
-            else
-            {
-                *i = cur->listeners_.back();
-                cur->listeners_.pop_back();
-            }
-        }
+        // Notify listener components first, then mark child nodes.
+        // If the node is tracked by scene transform store, notification may be deferred
+        const bool notificationDeferred = cur->transformIndex_ != M_MAX_UNSIGNED
+            && cur->scene_->GetTransformStore()->MarkNodeDirty(cur->transformIndex_);
+        if (!notificationDeferred)
+            cur->NotifyListeners();
 
         // Tail call optimization: Don't recurse to mark the first child dirty, but
         // instead process it in the context of the current function. If there are more
@@ -883,6 +892,25 @@ void Node::MarkDirty()
     }
 }
 
+void Node::NotifyListeners()
+{
+    for (auto i = listeners_.begin(); i != listeners_.end();)
+    {
+        Component *c = i->Get();
+        if (c)
+        {
+            c->OnMarkedDirty(this);
+            ++i;
+        }
+        // If listener has expired, erase from list (swap with the last element to avoid O(n^2) behavior)
+        else
+        {
+            *i = listeners_.back();
+            listeners_.pop_back();
+        }
+    }
+}
+
 Node* Node::CreateChild(const ea::string& name, unsigned id, bool temporary)
 {
     Node* newNode = CreateChild(id, temporary);
@@ -937,6 +965,8 @@ void Node::AddChild(Node* node, unsigned index)
         scene_->NodeAdded(node);
 
     node->parent_ = this;
+    if (scene_)
+        scene_->GetTransformStore()->MarkHierarchyDirty();
     node->MarkDirty();
 
     // Send change event
@@ -1182,13 +1212,17 @@ void Node::SetParent(Node* parent)
 void Node::SetVar(const ea::string& key, const Variant& value)
 {
     vars_[key] = value;
+    ++attributesRevision_;
 }
 
 void Node::SetVarByHash(StringHash hash, const Variant& value)
 {
     const auto iter = vars_.find_by_hash(hash.Value());
     if (iter != vars_.end())
+    {
         iter->second = value;
+        ++attributesRevision_;
+    }
 }
 
 void Node::AddListener(Component* component)
@@ -1845,6 +1879,7 @@ void Node::SetTransformSilent(const Vector3& position, const Quaternion& rotatio
     position_ = position;
     rotation_ = rotation;
     scale_ = scale;
+    ++attributesRevision_;
 }
 
 void Node::SetTransformSilent(const Matrix3x4& matrix)
@@ -1867,6 +1902,7 @@ void Node::SetEnabled(bool enable, bool recursive, bool storeSelf)
     if (enable != enabled_)
     {
         enabled_ = enable;
+        ++attributesRevision_;
 
         // Notify listener components of the state change
         for (auto i = listeners_.begin(); i != listeners_.end();)
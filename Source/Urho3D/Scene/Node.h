@@ -53,6 +53,8 @@ enum TransformSpace
 /// Internal implementation structure for less performance-critical Node variables.
 struct URHO3D_API NodeImpl
 {
+    URHO3D_SCENE_OBJECT_POOL();
+
     /// Nodes this node depends on for network updates.
     ea::vector<Node*> dependencyNodes_;
     /// Name.
@@ -71,8 +73,12 @@ class URHO3D_API Node : public Serializable
     URHO3D_OBJECT(Node, Serializable);
 
     friend class Connection;
+    friend class SceneTransformStore;
+    friend class ThreadedSceneLoader;
 
 public:
+    URHO3D_SCENE_OBJECT_POOL();
+
     /// Construct.
     explicit Node(Context* context);
     /// Destruct. Any child nodes are detached.
@@ -106,6 +112,8 @@ public:
     bool SaveJSON(JSONValue& dest) const override;
     /// Apply attribute changes that can not be applied immediately recursively to child nodes and components.
     void ApplyAttributes() override;
+    /// Handle attribute write access.
+    void OnSetAttribute(const AttributeInfo& attr, const Variant& src) override;
 
     /// Return whether should save default-valued attributes into XML. Always save node transforms for readability, even if identity.
     bool SaveDefaultAttributes(const AttributeInfo& attr) const override { return true; }
@@ -567,6 +575,8 @@ public:
 
     /// Return whether transform has changed and world transform needs recalculation.
     bool IsDirty() const { return dirty_; }
+    /// Return revision of node attributes. Incremented whenever name, tags, enabled state, local transform or variables are changed.
+    unsigned GetAttributesRevision() const { return attributesRevision_; }
 
     /// Return number of child scene nodes.
     unsigned GetNumChildren(bool recursive = false) const;
@@ -681,13 +691,13 @@ public:
     unsigned GetNumPersistentComponents() const;
 
     /// Set position in parent space silently without marking the node & child nodes dirty. Used by animation code.
-    void SetPositionSilent(const Vector3& position) { position_ = position; }
+    void SetPositionSilent(const Vector3& position) { position_ = position; ++attributesRevision_; }
 
     /// Set position in parent space silently without marking the node & child nodes dirty. Used by animation code.
-    void SetRotationSilent(const Quaternion& rotation) { rotation_ = rotation; }
+    void SetRotationSilent(const Quaternion& rotation) { rotation_ = rotation; ++attributesRevision_; }
 
     /// Set scale in parent space silently without marking the node & child nodes dirty. Used by animation code.
-    void SetScaleSilent(const Vector3& scale) { scale_ = scale; }
+    void SetScaleSilent(const Vector3& scale) { scale_ = scale; ++attributesRevision_; }
 
     /// Set local transform silently without marking the node & child nodes dirty. Used by animation code.
     void SetTransformSilent(const Vector3& position, const Quaternion& rotation, const Vector3& scale);
@@ -702,6 +712,8 @@ private:
     Component* SafeCreateComponent(const ea::string& typeName, StringHash type, unsigned id);
     /// Recalculate the world transform.
     void UpdateWorldTransform() const;
+    /// Notify listener components that the node was marked dirty. Expired listeners are removed.
+    void NotifyListeners();
     /// Remove child node by iterator.
     void RemoveChild(ea::vector<SharedPtr<Node> >::iterator i);
     /// Return child nodes recursively.
@@ -746,6 +758,10 @@ private:
     Vector3 scale_;
     /// World-space rotation.
     mutable Quaternion worldRotation_;
+    /// Index in scene transform store, if enabled.
+    unsigned transformIndex_{M_MAX_UNSIGNED};
+    /// Revision of node attributes.
+    unsigned attributesRevision_{};
     /// Components.
     ea::vector<SharedPtr<Component> > components_;
     /// Child scene nodes.
@@ -35,14 +35,21 @@
 #include "../Resource/ResourceEvents.h"
 #include "../Resource/XMLFile.h"
 #include "../Resource/JSONFile.h"
+#include "../Scene/CompiledPrefab.h"
 #include "../Scene/Component.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
+#include "../Scene/SceneUpdateScheduler.h"
 #include "../Scene/SplinePath.h"
+#include "../Scene/ThreadedSceneLoader.h"
 #include "../Scene/UnknownComponent.h"
 #include "../Scene/ValueAnimation.h"
 #include "../Scene/PrefabReference.h"
+#include "../Utility/PackedSceneData.h"
+
+#include <EASTL/sort.h>
 
 #include "../DebugNew.h"
 
@@ -59,6 +66,7 @@ Scene::Scene(Context* context) :
     elapsedTime_(0),
     updateEnabled_(true),
     asyncLoading_(false),
+    asyncLoadingThreaded_(false),
     threadedUpdate_(false),
     lightmaps_(Texture2D::GetTypeStatic())
 {
@@ -66,6 +74,9 @@ Scene::Scene(Context* context) :
     SetID(GetFreeNodeID());
     NodeAdded(this);
 
+    updateScheduler_ = MakeShared<SceneUpdateScheduler>(context_, this);
+    transformStore_ = MakeShared<SceneTransformStore>(context_, this);
+
     SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(Scene, HandleUpdate));
     SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, URHO3D_HANDLER(Scene, HandleResourceBackgroundLoaded));
 }
@@ -98,14 +109,19 @@ void Scene::RegisterObject(Context* context)
 
 bool Scene::CreateComponentIndex(StringHash componentType)
 {
+    if (indexedComponentTypes_.contains(componentType))
+        return true;
+
+    indexedComponentTypes_.push_back(componentType);
+    SceneComponentIndex& index = componentIndexes_.emplace_back();
+
     if (!IsEmpty())
     {
-        URHO3D_LOGERROR("Component Index may be created only for empty Scene");
-        return false;
+        ea::vector<Component*> components;
+        GetComponents(components, componentType, true);
+        for (Component* component : components)
+            index.Insert(component);
     }
-
-    indexedComponentTypes_.push_back(componentType);
-    componentIndexes_.emplace_back();
     return true;
 }
 
@@ -117,6 +133,66 @@ const SceneComponentIndex& Scene::GetComponentIndex(StringHash componentType)
     return emptyIndex;
 }
 
+const ea::vector<Node*>& Scene::QueryNodesWithComponents(const ea::vector<StringHash>& componentTypes)
+{
+    static const ea::vector<Node*> emptyResult;
+    if (componentTypes.empty())
+        return emptyResult;
+
+    ea::vector<StringHash> key = componentTypes;
+    ea::sort(key.begin(), key.end());
+    key.erase(ea::unique(key.begin(), key.end()), key.end());
+
+    ComponentQuery& query = componentQueries_[key];
+    if (query.indexes_.empty())
+    {
+        for (StringHash componentType : key)
+        {
+            CreateComponentIndex(componentType);
+            query.indexes_.push_back(indexedComponentTypes_.index_of(componentType));
+        }
+        query.versions_.resize(key.size(), M_MAX_UNSIGNED);
+    }
+
+    bool dirty = false;
+    unsigned smallestIndex = query.indexes_[0];
+    for (unsigned i = 0; i < query.indexes_.size(); ++i)
+    {
+        const SceneComponentIndex& index = componentIndexes_[query.indexes_[i]];
+        if (index.GetVersion() != query.versions_[i])
+        {
+            query.versions_[i] = index.GetVersion();
+            dirty = true;
+        }
+        if (index.GetSize() < componentIndexes_[smallestIndex].GetSize())
+            smallestIndex = query.indexes_[i];
+    }
+
+    if (!dirty)
+        return query.nodes_;
+
+    URHO3D_PROFILE("UpdateComponentQuery");
+
+    // Iterate the smallest index and check other components on the node
+    query.nodes_.clear();
+    const StringHash smallestIndexType = indexedComponentTypes_[smallestIndex];
+    for (Component* component : componentIndexes_[smallestIndex])
+    {
+        Node* node = component->GetNode();
+
+        // Node may have several components of this type, visit it only once
+        if (node->GetComponent(smallestIndexType) != component)
+            continue;
+
+        const bool hasAllComponents = ea::all_of(key.begin(), key.end(),
+            [&](StringHash componentType) { return componentType == smallestIndexType || node->HasComponent(componentType); });
+        if (hasAllComponents)
+            query.nodes_.push_back(node);
+    }
+
+    return query.nodes_;
+}
+
 void Scene::SerializeInBlock(Archive& archive)
 {
     Node::SerializeInBlock(archive);
@@ -366,8 +442,9 @@ bool Scene::LoadAsync(AbstractFilePtr file, LoadMode mode)
 
     if (mode > LOAD_RESOURCES_ONLY)
     {
-        // Preload resources if appropriate, then return to the original position for loading the scene content
-        if (mode != LOAD_SCENE)
+        // Preload resources if appropriate, then return to the original position for loading the scene content.
+        // Threaded loading preloads resources when decoding nodes
+        if (mode != LOAD_SCENE && !asyncLoadingThreaded_)
         {
             URHO3D_PROFILE("FindResourcesToPreload");
 
@@ -389,6 +466,15 @@ bool Scene::LoadAsync(AbstractFilePtr file, LoadMode mode)
 
         // Then prepare to load child nodes in the async updates
         asyncProgress_.totalNodes_ = file->ReadVLE();
+
+        if (asyncLoadingThreaded_)
+        {
+            ByteVector data(file->GetSize() - file->GetPosition());
+            data.resize(file->Read(data.data(), data.size()));
+
+            threadedLoader_ = ea::make_unique<ThreadedSceneLoader>(this);
+            threadedLoader_->StartBinary(ea::move(data), asyncProgress_.totalNodes_);
+        }
     }
     else
     {
@@ -432,8 +518,8 @@ bool Scene::LoadAsyncXML(AbstractFilePtr file, LoadMode mode)
     {
         XMLElement rootElement = xml->GetRoot();
 
-        // Preload resources if appropriate
-        if (mode != LOAD_SCENE)
+        // Preload resources if appropriate. Threaded loading preloads resources when decoding nodes
+        if (mode != LOAD_SCENE && !asyncLoadingThreaded_)
         {
             URHO3D_PROFILE("FindResourcesToPreload");
 
@@ -448,6 +534,14 @@ bool Scene::LoadAsyncXML(AbstractFilePtr file, LoadMode mode)
         if (!Node::LoadXML(rootElement, resolver_, false))
             return false;
 
+        if (asyncLoadingThreaded_)
+        {
+            threadedLoader_ = ea::make_unique<ThreadedSceneLoader>(this);
+            threadedLoader_->StartXML(rootElement);
+            asyncProgress_.totalNodes_ = threadedLoader_->GetNumNodes();
+            return true;
+        }
+
         // Then prepare for loading all root level child nodes in the async update
         XMLElement childNodeElement = rootElement.GetChild("node");
         asyncProgress_.xmlElement_ = childNodeElement;
@@ -501,8 +595,8 @@ bool Scene::LoadAsyncJSON(AbstractFilePtr file, LoadMode mode)
     {
         JSONValue rootVal = json->GetRoot();
 
-        // Preload resources if appropriate
-        if (mode != LOAD_SCENE)
+        // Preload resources if appropriate. Threaded loading preloads resources when decoding nodes
+        if (mode != LOAD_SCENE && !asyncLoadingThreaded_)
         {
             URHO3D_PROFILE("FindResourcesToPreload");
 
@@ -517,6 +611,15 @@ bool Scene::LoadAsyncJSON(AbstractFilePtr file, LoadMode mode)
         if (!Node::LoadJSON(rootVal, resolver_, false))
             return false;
 
+        if (asyncLoadingThreaded_)
+        {
+            // Decode from the value owned by the file, local copy is destroyed on return
+            threadedLoader_ = ea::make_unique<ThreadedSceneLoader>(this);
+            threadedLoader_->StartJSON(json->GetRoot());
+            asyncProgress_.totalNodes_ = threadedLoader_->GetNumNodes();
+            return true;
+        }
+
         // Then prepare for loading all root level child nodes in the async update
         JSONArray childrenArray = rootVal.Get("children").GetArray();
         asyncProgress_.jsonIndex_ = 0;
@@ -537,6 +640,8 @@ bool Scene::LoadAsyncJSON(AbstractFilePtr file, LoadMode mode)
 
 void Scene::StopAsyncLoading()
 {
+    // Wait for decoding tasks before the source is released
+    threadedLoader_.reset();
     asyncLoading_ = false;
     asyncProgress_.file_.Reset();
     asyncProgress_.xmlFile_.Reset();
@@ -634,6 +739,37 @@ Node* Scene::InstantiateJSON(Deserializer& source, const Vector3& position, cons
     return InstantiateJSON(json->GetRoot(), position, rotation);
 }
 
+ea::vector<Node*> Scene::InstantiateMany(const PackedNodeData& nodeData, unsigned count, Node* parent)
+{
+    if (!parent)
+        parent = this;
+    else if (parent->GetScene() != this)
+    {
+        URHO3D_LOGERROR("Parent node does not belong to the scene");
+        return {};
+    }
+
+    if (count == 0)
+        return {};
+
+    URHO3D_PROFILE("InstantiateMany");
+
+    // Packed data is decoded only once, other copies are instantiated from the prefab compiled from the first one
+    Node* prototype = nodeData.SpawnCopy(parent);
+    if (!prototype)
+        return {};
+
+    ea::vector<Node*> nodes{prototype};
+    if (count == 1)
+        return nodes;
+
+    const CompiledPrefab prefab{prototype};
+    const ea::vector<Node*> copies = prefab.Instantiate(parent, count - 1);
+    nodes.insert(nodes.end(), copies.begin(), copies.end());
+
+    return nodes;
+}
+
 void Scene::Clear()
 {
     StopAsyncLoading();
@@ -761,21 +897,30 @@ void Scene::Update(float timeStep)
 
     using namespace SceneUpdate;
 
+    // Update variable timestep logic
+    SendEvent<Ev::SceneUpdate>({this, timeStep});
+
     VariantMap& eventData = GetEventDataMap();
     eventData[P_SCENE] = this;
     eventData[P_TIMESTEP] = timeStep;
 
-    // Update variable timestep logic
-    SendEvent(E_SCENEUPDATE, eventData);
-
     // Update scene attribute animation.
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
 
+    // Propagate transforms changed by logic to scene subsystems, if enabled
+    transformStore_->Update();
+
     // Update scene subsystems. If a physics world is present, it will be updated, triggering fixed timestep logic updates
     SendEvent(E_SCENESUBSYSTEMUPDATE, eventData);
 
+    // Update scene subsystems registered in the scheduler, if enabled
+    if (updateScheduler_->IsEnabled())
+        updateScheduler_->Update(timeStep);
+
     // Post-update variable timestep logic
-    SendEvent(E_SCENEPOSTUPDATE, eventData);
+    SendEvent<Ev::ScenePostUpdate>({this, timeStep});
+
+    transformStore_->Update();
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -908,6 +1053,7 @@ void Scene::NodeRemoved(Node* node)
 
     unsigned id = node->GetID();
     replicatedNodes_.erase(id);
+    transformStore_->OnNodeRemoved(node);
 
     node->ResetScene();
 
@@ -954,7 +1100,7 @@ void Scene::ComponentAdded(Component* component)
     component->OnSceneSet(this);
 
     if (auto index = GetMutableComponentIndex(component->GetType()))
-        index->insert(component);
+        index->Insert(component);
 }
 
 void Scene::ComponentRemoved(Component* component)
@@ -963,7 +1109,7 @@ void Scene::ComponentRemoved(Component* component)
         return;
 
     if (auto index = GetMutableComponentIndex(component->GetType()))
-        index->erase(component);
+        index->Remove(component);
 
     unsigned id = component->GetID();
     replicatedComponents_.erase(id);
@@ -1024,55 +1170,86 @@ void Scene::UpdateAsyncLoading()
 {
     URHO3D_PROFILE("UpdateAsyncLoading");
 
+    if (threadedLoader_)
+    {
+        threadedLoader_->Update();
+
+        // All resources should be queued before nodes are created
+        if (asyncProgress_.mode_ != LOAD_SCENE)
+        {
+            threadedLoader_->ProcessDecodedResources(
+                [this](StringHash type, const ea::string& name) { PreloadResource(type, name); });
+            if (!threadedLoader_->IsDecoded() && !threadedLoader_->IsFailed())
+                return;
+        }
+    }
+
     // If resources left to load, do not load nodes yet
     if (asyncProgress_.loadedResources_ < asyncProgress_.totalResources_)
         return;
 
     HiresTimer asyncLoadTimer;
 
-    for (;;)
+    if (threadedLoader_)
     {
-        if (asyncProgress_.loadedNodes_ >= asyncProgress_.totalNodes_)
+        asyncProgress_.loadedNodes_ += threadedLoader_->CommitNodes(resolver_, asyncLoadingMs_ * 1000LL);
+        if (threadedLoader_->IsFinished())
         {
+            if (threadedLoader_->IsFailed())
+            {
+                URHO3D_LOGERROR("Failed to decode scene, loaded {} of {} root-level nodes",
+                    asyncProgress_.loadedNodes_, asyncProgress_.totalNodes_);
+            }
             FinishAsyncLoading();
             return;
         }
+    }
+    else
+    {
+        for (;;)
+        {
+            if (asyncProgress_.loadedNodes_ >= asyncProgress_.totalNodes_)
+            {
+                FinishAsyncLoading();
+                return;
+            }
 
 
-        // Read one child node with its full sub-hierarchy either from binary, JSON, or XML
-        /// \todo Works poorly in scenes where one root-level child node contains all content
-        if (asyncProgress_.xmlFile_)
-        {
-            unsigned nodeID = asyncProgress_.xmlElement_.GetUInt("id");
-            Node* newNode = CreateChild(nodeID);
-            resolver_.AddNode(nodeID, newNode);
-            newNode->LoadXML(asyncProgress_.xmlElement_, resolver_);
-            asyncProgress_.xmlElement_ = asyncProgress_.xmlElement_.GetNext("node");
-        }
-        else if (asyncProgress_.jsonFile_) // Load from JSON
-        {
-            const JSONValue& childValue = asyncProgress_.jsonFile_->GetRoot().Get("children").GetArray().at(
-                asyncProgress_.jsonIndex_);
-
-            unsigned nodeID =childValue.Get("id").GetUInt();
-            Node* newNode = CreateChild(nodeID);
-            resolver_.AddNode(nodeID, newNode);
-            newNode->LoadJSON(childValue, resolver_);
-            ++asyncProgress_.jsonIndex_;
-        }
-        else // Load from binary
-        {
-            unsigned nodeID = asyncProgress_.file_->ReadUInt();
-            Node* newNode = CreateChild(nodeID);
-            resolver_.AddNode(nodeID, newNode);
-            newNode->Load(*asyncProgress_.file_, resolver_);
-        }
+            // Read one child node with its full sub-hierarchy either from binary, JSON, or XML
+            /// \todo Works poorly in scenes where one root-level child node contains all content
+            if (asyncProgress_.xmlFile_)
+            {
+                unsigned nodeID = asyncProgress_.xmlElement_.GetUInt("id");
+                Node* newNode = CreateChild(nodeID);
+                resolver_.AddNode(nodeID, newNode);
+                newNode->LoadXML(asyncProgress_.xmlElement_, resolver_);
+                asyncProgress_.xmlElement_ = asyncProgress_.xmlElement_.GetNext("node");
+            }
+            else if (asyncProgress_.jsonFile_) // Load from JSON
+            {
+                const JSONValue& childValue = asyncProgress_.jsonFile_->GetRoot().Get("children").GetArray().at(
+                    asyncProgress_.jsonIndex_);
+
+                unsigned nodeID =childValue.Get("id").GetUInt();
+                Node* newNode = CreateChild(nodeID);
+                resolver_.AddNode(nodeID, newNode);
+                newNode->LoadJSON(childValue, resolver_);
+                ++asyncProgress_.jsonIndex_;
+            }
+            else // Load from binary
+            {
+                unsigned nodeID = asyncProgress_.file_->ReadUInt();
+                Node* newNode = CreateChild(nodeID);
+                resolver_.AddNode(nodeID, newNode);
+                newNode->Load(*asyncProgress_.file_, resolver_);
+            }
 
-        ++asyncProgress_.loadedNodes_;
+            ++asyncProgress_.loadedNodes_;
 
-        // Break if time limit exceeded, so that we keep sufficient FPS
-        if (asyncLoadTimer.GetUSec(false) >= asyncLoadingMs_ * 1000LL)
-            break;
+            // Break if time limit exceeded, so that we keep sufficient FPS
+            if (asyncLoadTimer.GetUSec(false) >= asyncLoadingMs_ * 1000LL)
+                break;
+        }
     }
 
     using namespace AsyncLoadProgress;
@@ -1202,6 +1379,22 @@ void Scene::PreloadResources(AbstractFilePtr file, bool isSceneFile)
 #endif
 }
 
+void Scene::PreloadResource(StringHash type, const ea::string& name)
+{
+    // If not threaded, can not background load resources, so rather load synchronously later when needed
+#ifdef URHO3D_THREADING
+    auto* cache = GetSubsystem<ResourceCache>();
+
+    // Sanitate resource name beforehand so that when we get the background load event, the name matches exactly
+    const ea::string sanitatedName = cache->SanitateResourceName(name);
+    if (cache->BackgroundLoadResource(type, sanitatedName))
+    {
+        ++asyncProgress_.totalResources_;
+        asyncProgress_.resources_.insert(StringHash(sanitatedName));
+    }
+#endif
+}
+
 void Scene::PreloadResourcesXML(const XMLElement& element)
 {
     // If not threaded, can not background load resources, so rather load synchronously later when needed
@@ -1384,7 +1577,32 @@ void RegisterSceneLibrary(Context* context)
     Scene::RegisterObject(context);
     UnknownComponent::RegisterObject(context);
     SplinePath::RegisterObject(context);
+    LogicComponentManager::RegisterObject(context);
     PrefabReference::RegisterObject(context);
 }
 
+void Ev::SceneUpdate::ToVariantMap(VariantMap& eventData) const
+{
+    eventData[Urho3D::SceneUpdate::P_SCENE] = scene_;
+    eventData[Urho3D::SceneUpdate::P_TIMESTEP] = timeStep_;
+}
+
+void Ev::SceneUpdate::FromVariantMap(const VariantMap& eventData)
+{
+    scene_ = static_cast<Scene*>(GetEventParameter(eventData, Urho3D::SceneUpdate::P_SCENE).GetPtr());
+    timeStep_ = GetEventParameter(eventData, Urho3D::SceneUpdate::P_TIMESTEP).GetFloat();
+}
+
+void Ev::ScenePostUpdate::ToVariantMap(VariantMap& eventData) const
+{
+    eventData[Urho3D::ScenePostUpdate::P_SCENE] = scene_;
+    eventData[Urho3D::ScenePostUpdate::P_TIMESTEP] = timeStep_;
+}
+
+void Ev::ScenePostUpdate::FromVariantMap(const VariantMap& eventData)
+{
+    scene_ = static_cast<Scene*>(GetEventParameter(eventData, Urho3D::ScenePostUpdate::P_SCENE).GetPtr());
+    timeStep_ = GetEventParameter(eventData, Urho3D::ScenePostUpdate::P_TIMESTEP).GetFloat();
+}
+
 }
@@ -24,11 +24,14 @@
 
 #pragma once
 
+#include "../Container/Hash.h"
 #include "../Core/Mutex.h"
 #include "../Resource/JSONFile.h"
 #include "../Resource/XMLElement.h"
 #include "../Scene/Node.h"
+#include "../Scene/SceneComponentIndex.h"
 #include "../Scene/SceneResolver.h"
+#include "../Scene/SceneTransformStore.h"
 
 #include <EASTL/span.h>
 #include <EASTL/unique_ptr.h>
@@ -39,7 +42,10 @@ namespace Urho3D
 
 class File;
 class PackageFile;
+class PackedNodeData;
+class SceneUpdateScheduler;
 class Texture2D;
+class ThreadedSceneLoader;
 
 /// TODO: Get rid of "replicated" word in the code. It is not used in the networking code anymore.
 static const unsigned FIRST_REPLICATED_ID = 0x1;
@@ -86,9 +92,6 @@ struct AsyncProgress
     unsigned totalNodes_;
 };
 
-/// Index of components in the Scene.
-using SceneComponentIndex = ea::hash_set<Component*>;
-
 /// Root scene node, represents the whole scene.
 class URHO3D_API Scene : public Node
 {
@@ -110,14 +113,19 @@ public:
     /// @nobind
     static void RegisterObject(Context* context);
 
-    /// Create component index. Scene must be empty.
+    /// Create component index. Existing components of this type are added to the index.
     bool CreateComponentIndex(StringHash componentType);
-    /// Create component index for template type. Scene must be empty.
+    /// Create component index for template type. Existing components of this type are added to the index.
     template <class T> void CreateComponentIndex() { CreateComponentIndex(T::GetTypeStatic()); }
-    /// Return component index. Iterable. Invalidated when indexed component is added or removed!
+    /// Return component index. Iterable. Iterators are invalidated when indexed component is added or removed!
     const SceneComponentIndex& GetComponentIndex(StringHash componentType);
-    /// Return component index for template type. Invalidated when indexed component is added or removed!
+    /// Return component index for template type. Iterators are invalidated when indexed component is added or removed!
     template <class T> const SceneComponentIndex& GetComponentIndex() { return GetComponentIndex(T::GetTypeStatic()); }
+    /// Return nodes that have components of all given types. Component indexes are created for types that are not indexed yet.
+    /// Result is cached until a component of any of these types is added or removed.
+    const ea::vector<Node*>& QueryNodesWithComponents(const ea::vector<StringHash>& componentTypes);
+    /// Return nodes that have components of all given template types.
+    template <class... T> const ea::vector<Node*>& QueryNodesWithComponents() { return QueryNodesWithComponents({T::GetTypeStatic()...}); }
 
     /// Serialize object. May throw ArchiveException.
     void SerializeInBlock(Archive& archive) override;
@@ -168,6 +176,9 @@ public:
         (const JSONValue& source, const Vector3& position, const Quaternion& rotation);
     /// Instantiate scene content from JSON data. Return root node if successful.
     Node* InstantiateJSON(Deserializer& source, const Vector3& position, const Quaternion& rotation);
+    /// Instantiate many copies of packed node as children of parent node, or of the scene if parent is not specified.
+    /// Packed data is deserialized once, other copies are created from CompiledPrefab with memory reserved in the scene object pool.
+    ea::vector<Node*> InstantiateMany(const PackedNodeData& nodeData, unsigned count, Node* parent = nullptr);
 
     /// Clear scene completely.
     void Clear();
@@ -183,6 +194,9 @@ public:
     /// Set maximum milliseconds per frame to spend on async scene loading.
     /// @property
     void SetAsyncLoadingMs(int ms);
+    /// Set whether asynchronous loading decodes child nodes of the scene file in worker threads.
+    /// Resources are preloaded as soon as the nodes referencing them are decoded.
+    void SetAsyncLoadingThreaded(bool enable) { asyncLoadingThreaded_ = enable; }
     /// Add a required package file for networking. To be called on the server.
     void AddRequiredPackageFile(PackageFile* package);
     /// Clear required package files.
@@ -241,6 +255,8 @@ public:
     /// Return maximum milliseconds per frame to spend on async loading.
     /// @property
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
+    /// Return whether asynchronous loading decodes child nodes of the scene file in worker threads.
+    bool IsAsyncLoadingThreaded() const { return asyncLoadingThreaded_; }
 
     /// Return required package files.
     /// @property
@@ -260,6 +276,10 @@ public:
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
+    /// Return scheduler of scene subsystem updates. It is disabled by default.
+    SceneUpdateScheduler* GetUpdateScheduler() const { return updateScheduler_; }
+    /// Return structure-of-arrays storage of node transforms. It is disabled by default.
+    SceneTransformStore* GetTransformStore() const { return transformStore_; }
 
     /// Get free node ID.
     unsigned GetFreeNodeID();
@@ -299,6 +319,8 @@ private:
     void FinishSaving(Serializer* dest) const;
     /// Preload resources from a binary scene or object prefab file.
     void PreloadResources(AbstractFilePtr file, bool isSceneFile);
+    /// Preload single resource.
+    void PreloadResource(StringHash type, const ea::string& name);
     /// Preload resources from an XML scene or object prefab file.
     void PreloadResourcesXML(const XMLElement& element);
     /// Preload resources from a JSON scene or object prefab file.
@@ -312,6 +334,18 @@ private:
     ea::vector<StringHash> indexedComponentTypes_;
     /// Indexes of components.
     ea::vector<SceneComponentIndex> componentIndexes_;
+    /// Cached result of component query.
+    struct ComponentQuery
+    {
+        /// Indexes of queried component types in componentIndexes_.
+        ea::vector<unsigned> indexes_;
+        /// Versions of component indexes when the result was collected.
+        ea::vector<unsigned> versions_;
+        /// Nodes that have all queried components.
+        ea::vector<Node*> nodes_;
+    };
+    /// Cached component queries by sorted component types.
+    ea::unordered_map<ea::vector<StringHash>, ComponentQuery> componentQueries_;
 
     /// Replicated scene nodes by ID.
     ea::unordered_map<unsigned, Node*> replicatedNodes_;
@@ -323,12 +357,18 @@ private:
     AsyncProgress asyncProgress_;
     /// Node and component ID resolver for asynchronous loading.
     SceneResolver resolver_;
+    /// Loader of child nodes for threaded asynchronous loading.
+    ea::unique_ptr<ThreadedSceneLoader> threadedLoader_;
     /// Source file name.
     mutable ea::string fileName_;
     /// Required package files for networking.
     ea::vector<SharedPtr<PackageFile> > requiredPackageFiles_;
     /// Registered node user variable reverse mappings.
     ea::unordered_map<StringHash, ea::string> varNames_;
+    /// Scheduler of scene subsystem updates.
+    SharedPtr<SceneUpdateScheduler> updateScheduler_;
+    /// Structure-of-arrays storage of node transforms.
+    SharedPtr<SceneTransformStore> transformStore_;
     /// Delayed dirty notification queue for components.
     ea::vector<Component*> delayedDirtyComponents_;
     /// Mutex for the delayed dirty notification queue.
@@ -349,6 +389,8 @@ private:
     bool updateEnabled_;
     /// Asynchronous loading flag.
     bool asyncLoading_;
+    /// Threaded asynchronous loading flag.
+    bool asyncLoadingThreaded_;
     /// Threaded update flag.
     bool threadedUpdate_;
 
@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Scene/SceneComponentIndex.h"
+
+#include "../Scene/Component.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+void SceneComponentIndex::Insert(Component* component)
+{
+    if (Contains(component))
+        return;
+
+    component->indexPosition_ = components_.size();
+    components_.push_back(component);
+    ++version_;
+}
+
+void SceneComponentIndex::Remove(Component* component)
+{
+    if (!Contains(component))
+        return;
+
+    // Leave a hole instead of shifting the tail, so iteration order is stable and removal is cheap
+    components_[component->indexPosition_] = nullptr;
+    component->indexPosition_ = M_MAX_UNSIGNED;
+    ++numHoles_;
+    ++version_;
+
+    if (numHoles_ == components_.size())
+    {
+        components_.clear();
+        numHoles_ = 0;
+    }
+}
+
+void SceneComponentIndex::Clear()
+{
+    for (Component* component : components_)
+    {
+        if (component)
+            component->indexPosition_ = M_MAX_UNSIGNED;
+    }
+    components_.clear();
+    numHoles_ = 0;
+    ++version_;
+}
+
+bool SceneComponentIndex::Contains(const Component* component) const
+{
+    const unsigned position = component->indexPosition_;
+    return position < components_.size() && components_[position] == component;
+}
+
+void SceneComponentIndex::Compact() const
+{
+    unsigned numComponents = 0;
+    for (Component* component : components_)
+    {
+        if (!component)
+            continue;
+
+        component->indexPosition_ = numComponents;
+        components_[numComponents++] = component;
+    }
+    components_.resize(numComponents);
+    numHoles_ = 0;
+}
+
+}
@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Urho3D.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Component;
+
+/// Dense index of scene components of the same type.
+/// Components are stored contiguously in order of insertion, removal keeps the order of remaining components.
+/// The order is deterministic and doesn't depend on memory addresses.
+/// Removed components leave holes that are compacted in one pass before the components are accessed again.
+/// Components removed during iteration are seen as null until the next iteration.
+class URHO3D_API SceneComponentIndex
+{
+public:
+    using ConstIterator = ea::vector<Component*>::const_iterator;
+
+    /// Add component. Does nothing if already added.
+    void Insert(Component* component);
+    /// Remove component. Does nothing if not added.
+    void Remove(Component* component);
+    /// Remove all components.
+    void Clear();
+
+    /// Return whether the component is indexed.
+    bool Contains(const Component* component) const;
+    /// Return all components.
+    const ea::vector<Component*>& GetComponents() const { CompactIfNeeded(); return components_; }
+    /// Return component by position in the index.
+    Component* GetComponent(unsigned index) const { CompactIfNeeded(); return components_[index]; }
+    /// Return component by position in the index, cast to specified type.
+    template <class T> T* GetComponent(unsigned index) const { return static_cast<T*>(GetComponent(index)); }
+    /// Return number of components.
+    unsigned GetSize() const { return components_.size() - numHoles_; }
+    /// Return whether the index is empty.
+    bool IsEmpty() const { return GetSize() == 0; }
+    /// Return version of the index. Incremented when a component is added or removed.
+    unsigned GetVersion() const { return version_; }
+
+    /// Return number of components. Used by range-based algorithms.
+    unsigned size() const { return GetSize(); }
+    /// Return whether the index is empty. Used by range-based algorithms.
+    bool empty() const { return IsEmpty(); }
+    /// Return iterator to the beginning.
+    ConstIterator begin() const { CompactIfNeeded(); return components_.begin(); }
+    /// Return iterator to the end.
+    ConstIterator end() const { CompactIfNeeded(); return components_.end(); }
+
+private:
+    /// Remove holes left by removed components if there are any.
+    void CompactIfNeeded() const
+    {
+        if (numHoles_ != 0)
+            Compact();
+    }
+    /// Remove holes left by removed components and update positions of the remaining ones.
+    void Compact() const;
+
+    /// Components. Removed components are null until compacted.
+    mutable ea::vector<Component*> components_;
+    /// Number of removed components that are not compacted yet.
+    mutable unsigned numHoles_{};
+    /// Version.
+    unsigned version_{};
+};
+
+}
@@ -23,10 +23,13 @@
 #pragma once
 
 #include "../Core/Object.h"
+#include "../Core/TypedEvent.h"
 
 namespace Urho3D
 {
 
+class Scene;
+
 /// Variable timestep scene update.
 URHO3D_EVENT(E_SCENEUPDATE, SceneUpdate)
 {
@@ -207,6 +210,12 @@ URHO3D_EVENT(E_INTERCEPTNETWORKUPDATE, InterceptNetworkUpdate)
     URHO3D_PARAM(P_VALUE, Value);                  // Variant
 }
 
+/// Scene update scheduler is enabled. Components should register their update jobs again.
+URHO3D_EVENT(E_SCENEUPDATESCHEDULERENABLED, SceneUpdateSchedulerEnabled)
+{
+    URHO3D_PARAM(P_SCENE, Scene);                  // Scene pointer
+}
+
 /// Scene manager has activated a new scene.
 URHO3D_EVENT(E_SCENEACTIVATED, SceneActivated)
 {
@@ -214,4 +223,34 @@ URHO3D_EVENT(E_SCENEACTIVATED, SceneActivated)
     URHO3D_PARAM(P_NEWSCENE, NewScene);            // Scene pointer
 }
 
+/// Typed scene events with statically typed payload. Use with Object::SendEvent<T> and Object::SubscribeToEvent<T>.
+namespace Ev
+{
+
+/// Typed payload of E_SCENEUPDATE.
+struct URHO3D_API SceneUpdate
+{
+    URHO3D_TYPED_EVENT(E_SCENEUPDATE);
+
+    Scene* scene_{};
+    float timeStep_{};
+
+    void ToVariantMap(VariantMap& eventData) const;
+    void FromVariantMap(const VariantMap& eventData);
+};
+
+/// Typed payload of E_SCENEPOSTUPDATE.
+struct URHO3D_API ScenePostUpdate
+{
+    URHO3D_TYPED_EVENT(E_SCENEPOSTUPDATE);
+
+    Scene* scene_{};
+    float timeStep_{};
+
+    void ToVariantMap(VariantMap& eventData) const;
+    void FromVariantMap(const VariantMap& eventData);
+};
+
+}
+
 }
@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Scene/SceneObjectPool.h"
+
+#include "../Container/Allocator.h"
+
+#include <EASTL/array.h>
+
+#include <mutex>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Fixed-size allocator for one size class.
+struct SizeClassPool
+{
+    /// Allocator blocks.
+    AllocatorBlock* allocator_{};
+    /// Number of allocated objects.
+    unsigned numAllocated_{};
+    /// Mutex.
+    std::mutex mutex_;
+
+    /// Return total capacity of the allocator.
+    unsigned GetCapacity() const { return allocator_ ? allocator_->capacity_ : 0; }
+};
+
+/// Pooled objects should be aligned as the default new. Allocator layout guarantees it on 64-bit platforms.
+constexpr bool isPoolingSupported = (sizeof(AllocatorBlock) + sizeof(AllocatorNode)) % alignof(std::max_align_t) == 0;
+
+const unsigned numSizeClasses = SceneObjectPool::MaxPooledSize / SceneObjectPool::SizeGranularity;
+
+/// Initial number of objects in size class.
+const unsigned initialCapacity = 64;
+
+unsigned GetSizeClass(size_t size)
+{
+    return static_cast<unsigned>((size - 1) / SceneObjectPool::SizeGranularity);
+}
+
+/// Return node size for the size class. Allocator nodes have pointer-sized header,
+/// node size is adjusted so that every object is aligned as the default new.
+unsigned GetNodeSize(unsigned sizeClass)
+{
+    const unsigned objectSize = (sizeClass + 1) * SceneObjectPool::SizeGranularity;
+    const unsigned alignment = alignof(std::max_align_t);
+    const unsigned stride = (objectSize + sizeof(AllocatorNode) + alignment - 1) / alignment * alignment;
+    return stride - sizeof(AllocatorNode);
+}
+
+ea::array<SizeClassPool, numSizeClasses>& GetPools()
+{
+    // Never destroyed because objects may be released during static deinitialization
+    static auto pools = new ea::array<SizeClassPool, numSizeClasses>();
+    return *pools;
+}
+
+}
+
+bool SceneObjectPool::IsPooled(size_t size)
+{
+    return isPoolingSupported && size != 0 && size <= MaxPooledSize;
+}
+
+void* SceneObjectPool::Allocate(size_t size)
+{
+    if (!IsPooled(size))
+        return ::operator new(size);
+
+    const unsigned sizeClass = GetSizeClass(size);
+    SizeClassPool& pool = GetPools()[sizeClass];
+
+    std::lock_guard<std::mutex> lock(pool.mutex_);
+    if (!pool.allocator_)
+        pool.allocator_ = AllocatorInitialize(GetNodeSize(sizeClass), initialCapacity);
+
+    ++pool.numAllocated_;
+    return AllocatorReserve(pool.allocator_);
+}
+
+void SceneObjectPool::Free(void* ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    if (!IsPooled(size))
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    SizeClassPool& pool = GetPools()[GetSizeClass(size)];
+
+    std::lock_guard<std::mutex> lock(pool.mutex_);
+    --pool.numAllocated_;
+    AllocatorFree(pool.allocator_, ptr);
+}
+
+void SceneObjectPool::Reserve(size_t size, unsigned count)
+{
+    if (!IsPooled(size) || count == 0)
+        return;
+
+    const unsigned sizeClass = GetSizeClass(size);
+    SizeClassPool& pool = GetPools()[sizeClass];
+
+    std::lock_guard<std::mutex> lock(pool.mutex_);
+    const unsigned numFree = pool.GetCapacity() - pool.numAllocated_;
+    if (numFree >= count)
+        return;
+
+    // Reserve one contiguous block for all missing objects
+    const unsigned missingCount = count - numFree;
+    if (!pool.allocator_)
+        pool.allocator_ = AllocatorInitialize(GetNodeSize(sizeClass), missingCount);
+    else
+    {
+        AllocatorReserveBlock(pool.allocator_, pool.allocator_->nodeSize_, missingCount);
+        pool.allocator_->capacity_ += missingCount;
+    }
+}
+
+unsigned SceneObjectPool::GetNumAllocated(size_t size)
+{
+    if (!IsPooled(size))
+        return 0;
+
+    SizeClassPool& pool = GetPools()[GetSizeClass(size)];
+    std::lock_guard<std::mutex> lock(pool.mutex_);
+    return pool.numAllocated_;
+}
+
+unsigned SceneObjectPool::GetNumFree(size_t size)
+{
+    if (!IsPooled(size))
+        return 0;
+
+    SizeClassPool& pool = GetPools()[GetSizeClass(size)];
+    std::lock_guard<std::mutex> lock(pool.mutex_);
+    return pool.GetCapacity() - pool.numAllocated_;
+}
+
+}
@@ -0,0 +1,79 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include <Urho3D/Urho3D.h>
+
+#include <cstddef>
+#include <new>
+
+namespace Urho3D
+{
+
+/// Pool of memory for scene nodes and components. Thread-safe.
+/// Objects of similar size share one fixed-size allocator, so objects spawned together are stored close in memory
+/// and spawning or despawning doesn't fragment the heap. Large objects are allocated from the heap.
+class URHO3D_API SceneObjectPool
+{
+public:
+    /// Size difference between pooled size classes.
+    static constexpr unsigned SizeGranularity = 16;
+    /// Maximum size of pooled object.
+    static constexpr unsigned MaxPooledSize = 1024;
+
+    /// Allocate memory for object of given size.
+    static void* Allocate(size_t size);
+    /// Free memory of object of given size.
+    static void Free(void* ptr, size_t size);
+    /// Reserve memory for given number of objects of given size.
+    static void Reserve(size_t size, unsigned count);
+
+    /// Return whether objects of given size are pooled.
+    static bool IsPooled(size_t size);
+    /// Return number of allocated objects of the same size class as given size.
+    static unsigned GetNumAllocated(size_t size);
+    /// Return number of objects of the same size class as given size that can be allocated without heap allocation.
+    static unsigned GetNumFree(size_t size);
+};
+
+}
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+/// Debug allocation function used by DebugNew.h.
+#define URHO3D_SCENE_OBJECT_POOL_DEBUG_NEW() \
+    static void* operator new(size_t size, int /*blockUse*/, const char* /*fileName*/, int /*line*/) { return Urho3D::SceneObjectPool::Allocate(size); }
+#else
+#define URHO3D_SCENE_OBJECT_POOL_DEBUG_NEW()
+#endif
+
+/// Declare class-specific allocation functions that use SceneObjectPool. Inherited by derived classes.
+#define URHO3D_SCENE_OBJECT_POOL() \
+    static void* operator new(size_t size) { return Urho3D::SceneObjectPool::Allocate(size); } \
+    static void* operator new(size_t size, std::align_val_t alignment) { return ::operator new(size, alignment); } \
+    static void* operator new(size_t /*size*/, void* ptr) noexcept { return ptr; } \
+    static void operator delete(void* ptr, size_t size) { Urho3D::SceneObjectPool::Free(ptr, size); } \
+    static void operator delete(void* ptr, size_t /*size*/, std::align_val_t alignment) { ::operator delete(ptr, alignment); } \
+    static void operator delete(void* /*ptr*/, void* /*place*/) noexcept {} \
+    URHO3D_SCENE_OBJECT_POOL_DEBUG_NEW()
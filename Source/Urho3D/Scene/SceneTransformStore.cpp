@@ -0,0 +1,261 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Scene/SceneTransformStore.h"
+
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
+#include "../Scene/Scene.h"
+
+#include <EASTL/algorithm.h>
+#include <EASTL/span.h>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+const unsigned long long one = 1;
+
+}
+
+SceneTransformStore::SceneTransformStore(Context* context, Scene* scene)
+    : Object(context)
+    , workQueue_(GetSubsystem<WorkQueue>())
+    , scene_(scene)
+{
+}
+
+SceneTransformStore::~SceneTransformStore() = default;
+
+void SceneTransformStore::SetEnabled(bool enabled)
+{
+    if (enabled_ == enabled)
+        return;
+
+    if (enabled_)
+    {
+        Update();
+        ResetIndices();
+
+        nodes_.clear();
+        parentIndices_.clear();
+        levelOffsets_.clear();
+        localTransforms_.clear();
+        worldTransforms_.clear();
+        worldRotations_.clear();
+        dirtyMask_ = nullptr;
+        dirtyMaskSize_ = 0;
+    }
+
+    enabled_ = enabled;
+    hierarchyDirty_ = true;
+}
+
+bool SceneTransformStore::MarkNodeDirty(unsigned index)
+{
+    dirtyMask_[index / 64].fetch_or(one << (index % 64), std::memory_order_relaxed);
+    // Components are responsible for handling notifications from worker threads
+    return !scene_->IsThreadedUpdate();
+}
+
+void SceneTransformStore::OnNodeRemoved(Node* node)
+{
+    node->transformIndex_ = M_MAX_UNSIGNED;
+    hierarchyDirty_ = true;
+}
+
+void SceneTransformStore::Update()
+{
+    if (!enabled_)
+        return;
+
+    URHO3D_PROFILE("UpdateSceneTransforms");
+
+    if (hierarchyDirty_)
+        RebuildHierarchy();
+
+    CollectDirtyNodes();
+    numUpdatedNodes_ = dirtyNodes_.size();
+    if (dirtyNodes_.empty())
+        return;
+
+    // Nodes are sorted by hierarchy level, so parents are always updated before children
+    const unsigned numLevels = GetNumLevels();
+    const auto beginIter = dirtyNodes_.begin();
+    auto levelBegin = beginIter;
+    for (unsigned level = 0; level < numLevels && levelBegin != dirtyNodes_.end(); ++level)
+    {
+        const auto levelEnd = ea::lower_bound(levelBegin, dirtyNodes_.end(), levelOffsets_[level + 1]);
+        const unsigned levelSize = static_cast<unsigned>(levelEnd - levelBegin);
+
+        if (levelSize >= ParallelUpdateThreshold && workQueue_->GetNumThreads() > 0)
+        {
+            const ea::span<const unsigned> levelNodes(&*levelBegin, levelSize);
+            ForEachParallel(workQueue_, ParallelUpdateBucket, levelNodes,
+                [this](unsigned /*index*/, unsigned nodeIndex) { UpdateNode(nodeIndex); });
+        }
+        else
+        {
+            for (auto iter = levelBegin; iter != levelEnd; ++iter)
+                UpdateNode(*iter);
+        }
+
+        levelBegin = levelEnd;
+    }
+
+    // Listeners may mark nodes dirty again, they will be processed on next update
+    URHO3D_PROFILE("NotifyTransformListeners");
+    for (unsigned nodeIndex : dirtyNodes_)
+    {
+        Node* node = nodes_[nodeIndex];
+        if (!node->listeners_.empty())
+            node->NotifyListeners();
+    }
+}
+
+void SceneTransformStore::UpdateNode(unsigned index)
+{
+    Node* node = nodes_[index];
+    const unsigned parentIndex = parentIndices_[index];
+
+    Matrix3x4& localTransform = localTransforms_[index];
+    Matrix3x4& worldTransform = worldTransforms_[index];
+    Quaternion& worldRotation = worldRotations_[index];
+
+    localTransform = node->GetTransform();
+    if (parentIndex == M_MAX_UNSIGNED)
+    {
+        worldTransform = localTransform;
+        worldRotation = node->rotation_;
+    }
+    else
+    {
+        worldTransform = worldTransforms_[parentIndex] * localTransform;
+        worldRotation = worldRotations_[parentIndex] * node->rotation_;
+    }
+
+    node->worldTransform_ = worldTransform;
+    node->worldRotation_ = worldRotation;
+    node->dirty_ = false;
+}
+
+void SceneTransformStore::RebuildHierarchy()
+{
+    URHO3D_PROFILE("RebuildTransformHierarchy");
+
+    hierarchyDirty_ = false;
+
+    nodes_.clear();
+    parentIndices_.clear();
+    levelOffsets_.clear();
+
+    // Collect nodes in breadth-first order
+    nodes_.push_back(scene_);
+    parentIndices_.push_back(M_MAX_UNSIGNED);
+    levelOffsets_.push_back(0);
+
+    unsigned levelBegin = 0;
+    while (levelBegin != nodes_.size())
+    {
+        const unsigned levelEnd = nodes_.size();
+        levelOffsets_.push_back(levelEnd);
+
+        for (unsigned index = levelBegin; index < levelEnd; ++index)
+        {
+            for (Node* child : nodes_[index]->children_)
+            {
+                nodes_.push_back(child);
+                parentIndices_.push_back(child->IsTransformHierarchyRoot() ? M_MAX_UNSIGNED : index);
+            }
+        }
+
+        levelBegin = levelEnd;
+    }
+
+    // Preserve dirty state of existing nodes, new nodes are always dirty
+    const unsigned numNodes = nodes_.size();
+    const unsigned newDirtyMaskSize = (numNodes + 63) / 64;
+    ea::unique_ptr<std::atomic<unsigned long long>[]> newDirtyMask(new std::atomic<unsigned long long>[newDirtyMaskSize]);
+    for (unsigned i = 0; i < newDirtyMaskSize; ++i)
+        newDirtyMask[i].store(0, std::memory_order_relaxed);
+
+    for (unsigned index = 0; index < numNodes; ++index)
+    {
+        Node* node = nodes_[index];
+        const unsigned oldIndex = node->transformIndex_;
+        const bool wasDirty = oldIndex == M_MAX_UNSIGNED
+            || (dirtyMask_[oldIndex / 64].load(std::memory_order_relaxed) & (one << (oldIndex % 64))) != 0;
+        if (wasDirty || node->IsDirty())
+            newDirtyMask[index / 64].fetch_or(one << (index % 64), std::memory_order_relaxed);
+        node->transformIndex_ = index;
+    }
+
+    localTransforms_.resize(numNodes);
+    worldTransforms_.resize(numNodes);
+    worldRotations_.resize(numNodes);
+
+    // Transforms of clean nodes are up to date and are not recalculated, copy them
+    for (unsigned index = 0; index < numNodes; ++index)
+    {
+        if (newDirtyMask[index / 64].load(std::memory_order_relaxed) & (one << (index % 64)))
+            continue;
+
+        Node* node = nodes_[index];
+        localTransforms_[index] = node->GetTransform();
+        worldTransforms_[index] = node->worldTransform_;
+        worldRotations_[index] = node->worldRotation_;
+    }
+
+    dirtyMask_ = ea::move(newDirtyMask);
+    dirtyMaskSize_ = newDirtyMaskSize;
+}
+
+void SceneTransformStore::ResetIndices()
+{
+    ea::vector<Node*> children;
+    scene_->GetChildren(children, true);
+    for (Node* node : children)
+        node->transformIndex_ = M_MAX_UNSIGNED;
+    scene_->transformIndex_ = M_MAX_UNSIGNED;
+}
+
+void SceneTransformStore::CollectDirtyNodes()
+{
+    dirtyNodes_.clear();
+    for (unsigned wordIndex = 0; wordIndex < dirtyMaskSize_; ++wordIndex)
+    {
+        unsigned long long word = dirtyMask_[wordIndex].exchange(0, std::memory_order_relaxed);
+        for (unsigned index = wordIndex * 64; word != 0; ++index, word >>= 1)
+        {
+            if (word & 1)
+                dirtyNodes_.push_back(index);
+        }
+    }
+}
+
+}
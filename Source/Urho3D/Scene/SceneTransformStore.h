@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Core/Object.h"
+#include "../Math/Matrix3x4.h"
+
+#include <EASTL/unique_ptr.h>
+#include <EASTL/vector.h>
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+class Node;
+class Scene;
+class WorkQueue;
+
+/// Opt-in structure-of-arrays storage of scene node transforms.
+/// When enabled, world transforms of dirty nodes are recalculated in one breadth-first pass over flat arrays,
+/// and nodes of one hierarchy level are processed in parallel.
+/// Notification of node listeners (Component::OnMarkedDirty) is batched and performed after the pass.
+/// The pass is executed by the scene before E_SCENESUBSYSTEMUPDATE, after E_SCENEPOSTUPDATE and before octree update.
+class URHO3D_API SceneTransformStore : public Object
+{
+    URHO3D_OBJECT(SceneTransformStore, Object);
+
+public:
+    /// Minimum number of dirty nodes in one hierarchy level to process them in parallel.
+    static constexpr unsigned ParallelUpdateThreshold = 1024;
+    /// Number of nodes processed by one parallel task.
+    static constexpr unsigned ParallelUpdateBucket = 256;
+
+    /// Construct.
+    SceneTransformStore(Context* context, Scene* scene);
+    /// Destruct.
+    ~SceneTransformStore() override;
+
+    /// Set whether the store is enabled. Pending notifications are delivered when the store is disabled.
+    void SetEnabled(bool enabled);
+    /// Return whether the store is enabled.
+    bool IsEnabled() const { return enabled_; }
+
+    /// Recalculate world transforms of dirty nodes and notify their listeners. Should be called from main thread.
+    void Update();
+
+    /// Return number of nodes in the store.
+    unsigned GetNumNodes() const { return nodes_.size(); }
+    /// Return number of hierarchy levels in the store.
+    unsigned GetNumLevels() const { return levelOffsets_.empty() ? 0 : levelOffsets_.size() - 1; }
+    /// Return number of nodes updated during last Update.
+    unsigned GetNumUpdatedNodes() const { return numUpdatedNodes_; }
+    /// Return world transform of the node at given index. Valid after Update.
+    const Matrix3x4& GetWorldTransform(unsigned index) const { return worldTransforms_[index]; }
+
+    /// Mark hierarchy as changed. Called by Node and Scene.
+    void MarkHierarchyDirty() { hierarchyDirty_ = true; }
+    /// Mark node at given index as dirty. Return true if listener notification is deferred. Thread-safe.
+    bool MarkNodeDirty(unsigned index);
+    /// Forget removed node. Called by Scene.
+    void OnNodeRemoved(Node* node);
+
+private:
+    /// Rebuild flat arrays from scene hierarchy, preserving dirty state of nodes.
+    void RebuildHierarchy();
+    /// Reset indices of all nodes in the scene.
+    void ResetIndices();
+    /// Collect indices of dirty nodes and clear dirty mask.
+    void CollectDirtyNodes();
+    /// Recalculate world transform of the node at given index.
+    void UpdateNode(unsigned index);
+
+    /// Work queue.
+    WorkQueue* workQueue_{};
+    /// Owner scene.
+    Scene* scene_{};
+    /// Whether enabled.
+    bool enabled_{};
+    /// Whether hierarchy has changed since last rebuild.
+    bool hierarchyDirty_{};
+
+    /// Nodes in breadth-first order.
+    ea::vector<Node*> nodes_;
+    /// Index of parent for each node. M_MAX_UNSIGNED for hierarchy roots.
+    ea::vector<unsigned> parentIndices_;
+    /// Offsets of hierarchy levels in node arrays. Last element is equal to number of nodes.
+    ea::vector<unsigned> levelOffsets_;
+    /// Local transforms of nodes.
+    ea::vector<Matrix3x4> localTransforms_;
+    /// World transforms of nodes.
+    ea::vector<Matrix3x4> worldTransforms_;
+    /// World rotations of nodes.
+    ea::vector<Quaternion> worldRotations_;
+    /// Bit mask of dirty nodes.
+    ea::unique_ptr<std::atomic<unsigned long long>[]> dirtyMask_;
+    /// Number of words in dirty mask.
+    unsigned dirtyMaskSize_{};
+
+    /// Indices of dirty nodes in breadth-first order.
+    ea::vector<unsigned> dirtyNodes_;
+    /// Number of nodes updated during last Update.
+    unsigned numUpdatedNodes_{};
+};
+
+}
@@ -0,0 +1,276 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Scene/SceneUpdateScheduler.h"
+
+#include "../Core/Profiler.h"
+#include "../Scene/Component.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+SceneUpdateScheduler::SceneUpdateScheduler(Context* context, Scene* scene)
+    : Object(context)
+    , workQueue_(GetSubsystem<WorkQueue>())
+    , scene_(scene)
+{
+}
+
+SceneUpdateScheduler::~SceneUpdateScheduler() = default;
+
+void SceneUpdateScheduler::SetEnabled(bool enabled)
+{
+    if (enabled_ == enabled)
+        return;
+
+    enabled_ = enabled;
+    if (enabled_)
+    {
+        using namespace SceneUpdateSchedulerEnabled;
+
+        Scene* scene = scene_;
+        if (!scene)
+            return;
+
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_SCENE] = scene;
+        scene->SendEvent(E_SCENEUPDATESCHEDULERENABLED, eventData);
+    }
+    else if (!updating_)
+        RemoveAllJobs();
+}
+
+void SceneUpdateScheduler::AddJob(Component* owner, const SceneUpdateJobDesc& desc)
+{
+    if (!enabled_ || !owner)
+        return;
+
+    if (updating_)
+    {
+        // Groups cannot be modified while tasks are running, delay until next update
+        pendingJobs_.emplace_back(WeakPtr<Component>(owner), desc);
+        return;
+    }
+
+    auto groupIter = ea::find_if(groups_.begin(), groups_.end(),
+        [&](const JobGroup& group) { return group.desc_.name_ == desc.name_; });
+    if (groupIter == groups_.end())
+    {
+        JobGroup& group = groups_.emplace_back();
+        group.desc_ = desc;
+        group.desc_.callback_ = nullptr;
+        groupIter = ea::prev(groups_.end());
+        dependenciesDirty_ = true;
+    }
+
+    // Owner of existing instance may be expired and have the same address, so the owner is reassigned too
+    ea::vector<JobInstance>& instances = groupIter->instances_;
+    const auto [indexIter, isNew] = groupIter->instanceIndices_.emplace(owner, instances.size());
+    if (isNew)
+        instances.push_back(JobInstance{WeakPtr<Component>(owner), desc.callback_});
+    else
+        instances[indexIter->second] = JobInstance{WeakPtr<Component>(owner), desc.callback_};
+}
+
+void SceneUpdateScheduler::RemoveJobs(Component* owner)
+{
+    for (JobGroup& group : groups_)
+    {
+        const auto indexIter = group.instanceIndices_.find(owner);
+        if (indexIter == group.instanceIndices_.end())
+            continue;
+
+        // Instances are actually removed on next update
+        group.instances_[indexIter->second].owner_ = nullptr;
+        group.instanceIndices_.erase(indexIter);
+    }
+
+    ea::erase_if(pendingJobs_, [&](const ea::pair<WeakPtr<Component>, SceneUpdateJobDesc>& job) { return job.first == owner; });
+}
+
+bool SceneUpdateScheduler::IsConflicting(const SceneUpdateJobDesc& lhs, const SceneUpdateJobDesc& rhs)
+{
+    return (lhs.write_ & (rhs.read_ | rhs.write_)) || (rhs.write_ & lhs.read_);
+}
+
+void SceneUpdateScheduler::Update(float timeStep)
+{
+    URHO3D_PROFILE("UpdateSceneJobs");
+
+    for (const auto& [owner, desc] : pendingJobs_)
+    {
+        if (owner)
+            AddJob(owner, desc);
+    }
+    pendingJobs_.clear();
+
+    RemoveExpiredInstances();
+    if (dependenciesDirty_)
+        UpdateDependencies();
+
+    if (groups_.empty())
+        return;
+
+    updating_ = true;
+
+    // Create all tasks first so dependencies can be added before any task is submitted.
+    // Main thread jobs are represented by empty tasks that are submitted after the job is executed.
+    for (JobGroup& group : groups_)
+    {
+        if (group.desc_.threadSafe_)
+            group.task_ = workQueue_->CreateTask([this, &group, timeStep](unsigned) { ExecuteGroup(group, timeStep); });
+        else
+            group.task_ = workQueue_->CreateTask(nullptr);
+    }
+
+    for (JobGroup& group : groups_)
+    {
+        if (group.desc_.threadSafe_)
+        {
+            for (unsigned dependencyIndex : group.dependencies_)
+                workQueue_->AddTaskDependency(group.task_, groups_[dependencyIndex].task_);
+        }
+    }
+
+    scene_->BeginThreadedUpdate();
+
+    for (JobGroup& group : groups_)
+    {
+        if (group.desc_.threadSafe_)
+            workQueue_->SubmitTask(group.task_);
+    }
+
+    // Execute main thread jobs in order of registration, waiting for dependencies to complete
+    for (JobGroup& group : groups_)
+    {
+        if (group.desc_.threadSafe_)
+            continue;
+
+        tempTasks_.clear();
+        for (unsigned dependencyIndex : group.dependencies_)
+            tempTasks_.push_back(groups_[dependencyIndex].task_);
+        workQueue_->WaitTasks(tempTasks_);
+
+        ExecuteGroup(group, timeStep);
+        workQueue_->SubmitTask(group.task_);
+    }
+
+    tempTasks_.clear();
+    for (const JobGroup& group : groups_)
+        tempTasks_.push_back(group.task_);
+    workQueue_->WaitTasks(tempTasks_);
+
+    scene_->EndThreadedUpdate();
+
+    updating_ = false;
+
+    // Scheduler may be disabled by one of the jobs
+    if (!enabled_)
+        RemoveAllJobs();
+}
+
+unsigned SceneUpdateScheduler::GetNumJobInstances() const
+{
+    unsigned numInstances = 0;
+    for (const JobGroup& group : groups_)
+        numInstances += group.instances_.size();
+    return numInstances;
+}
+
+void SceneUpdateScheduler::RemoveAllJobs()
+{
+    groups_.clear();
+    pendingJobs_.clear();
+    dependenciesDirty_ = false;
+}
+
+void SceneUpdateScheduler::RemoveExpiredInstances()
+{
+    Scene* scene = scene_;
+    for (JobGroup& group : groups_)
+    {
+        const unsigned numInstances = group.instances_.size();
+        ea::erase_if(group.instances_, [&](const JobInstance& instance)
+        {
+            return !instance.owner_ || instance.owner_->GetScene() != scene;
+        });
+
+        if (numInstances == group.instances_.size())
+            continue;
+
+        group.instanceIndices_.clear();
+        for (unsigned i = 0; i < group.instances_.size(); ++i)
+            group.instanceIndices_.emplace(group.instances_[i].owner_.Get(), i);
+    }
+
+    const unsigned numGroups = groups_.size();
+    ea::erase_if(groups_, [](const JobGroup& group) { return group.instances_.empty(); });
+    if (numGroups != groups_.size())
+        dependenciesDirty_ = true;
+}
+
+void SceneUpdateScheduler::UpdateDependencies()
+{
+    dependenciesDirty_ = false;
+
+    const unsigned numGroups = groups_.size();
+    for (unsigned i = 0; i < numGroups; ++i)
+    {
+        JobGroup& group = groups_[i];
+        group.dependencies_.clear();
+        for (unsigned j = 0; j < i; ++j)
+        {
+            if (IsConflicting(group.desc_, groups_[j].desc_))
+                group.dependencies_.push_back(j);
+        }
+    }
+}
+
+void SceneUpdateScheduler::ExecuteGroup(JobGroup& group, float timeStep)
+{
+    if (group.desc_.threadSafe_ && group.instances_.size() > 1)
+    {
+        ForEachParallel(workQueue_, group.instances_, [timeStep](unsigned /*index*/, const JobInstance& instance)
+        {
+            if (instance.owner_)
+                instance.callback_(timeStep);
+        });
+    }
+    else
+    {
+        // Main thread jobs may add or remove components, so iterate by index and re-check the owner
+        for (unsigned i = 0; i < group.instances_.size(); ++i)
+        {
+            const JobInstance& instance = group.instances_[i];
+            if (instance.owner_)
+                instance.callback_(timeStep);
+        }
+    }
+}
+
+}
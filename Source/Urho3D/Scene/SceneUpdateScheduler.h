@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/FlagSet.h"
+#include "../Core/Object.h"
+#include "../Core/WorkQueue.h"
+
+#include <EASTL/unordered_map.h>
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Component;
+class Scene;
+
+/// Kinds of scene data that can be accessed by scene update jobs.
+enum class SceneDataAccess : unsigned
+{
+    None = 0,
+    /// Node transforms and hierarchy.
+    Transforms = 1 << 0,
+    /// Physics world and rigid bodies.
+    Physics = 1 << 1,
+    /// Navigation meshes and crowds.
+    Navigation = 1 << 2,
+    /// Animation states and skeletons.
+    Animation = 1 << 3,
+    /// Particle systems.
+    Particles = 1 << 4,
+    /// Network replication state.
+    Network = 1 << 5,
+    /// Arbitrary user logic, e.g. event handlers.
+    UserLogic = 1 << 6,
+    /// Everything.
+    All = 0xffffffff,
+};
+URHO3D_FLAGSET(SceneDataAccess, SceneDataAccessFlags);
+
+/// Description of scene update job.
+struct SceneUpdateJobDesc
+{
+    /// Name of the job. All instances of the job with the same name are executed together.
+    ea::string name_;
+    /// Scene data read by the job.
+    SceneDataAccessFlags read_;
+    /// Scene data written by the job.
+    SceneDataAccessFlags write_;
+    /// Whether the instances of the job may be executed in worker threads in parallel with each other.
+    /// Thread-safe jobs should not send events or modify scene hierarchy.
+    bool threadSafe_{};
+    /// Update callback.
+    ea::function<void(float timeStep)> callback_;
+};
+
+/// Opt-in scheduler of scene subsystem updates.
+/// When enabled, registered jobs are executed after E_SCENESUBSYSTEMUPDATE event as a task graph.
+/// Jobs are registered only while the scheduler is enabled. All jobs are dropped when the scheduler is disabled,
+/// and E_SCENEUPDATESCHEDULERENABLED is sent when it is enabled again so the components can register their jobs.
+/// Jobs that don't conflict on accessed scene data are executed in parallel.
+/// Conflicting jobs are executed in order of registration, so the result is deterministic.
+class URHO3D_API SceneUpdateScheduler : public Object
+{
+    URHO3D_OBJECT(SceneUpdateScheduler, Object);
+
+public:
+    /// Construct.
+    SceneUpdateScheduler(Context* context, Scene* scene);
+    /// Destruct.
+    ~SceneUpdateScheduler() override;
+
+    /// Set whether the scheduler is enabled.
+    void SetEnabled(bool enabled);
+    /// Return whether the scheduler is enabled.
+    bool IsEnabled() const { return enabled_; }
+
+    /// Add job instance owned by the component. Job is removed when the component is destroyed or removed from the scene.
+    /// If the component already owns the job with the same name, it is replaced. Ignored if the scheduler is disabled.
+    void AddJob(Component* owner, const SceneUpdateJobDesc& desc);
+    /// Remove all jobs owned by the component.
+    void RemoveJobs(Component* owner);
+
+    /// Execute all jobs. Should be called from main thread.
+    void Update(float timeStep);
+
+    /// Return number of job groups.
+    unsigned GetNumJobGroups() const { return groups_.size(); }
+    /// Return number of job instances, including the ones that are not removed yet.
+    unsigned GetNumJobInstances() const;
+    /// Return whether two accesses conflict and should not be executed simultaneously.
+    static bool IsConflicting(const SceneUpdateJobDesc& lhs, const SceneUpdateJobDesc& rhs);
+
+private:
+    /// Instance of the job.
+    struct JobInstance
+    {
+        WeakPtr<Component> owner_;
+        ea::function<void(float timeStep)> callback_;
+    };
+
+    /// Group of job instances with the same name.
+    struct JobGroup
+    {
+        SceneUpdateJobDesc desc_;
+        ea::vector<JobInstance> instances_;
+        ea::unordered_map<Component*, unsigned> instanceIndices_;
+        ea::vector<unsigned> dependencies_;
+        TaskHandle task_;
+    };
+
+    /// Remove all jobs.
+    void RemoveAllJobs();
+    /// Remove instances whose owners are expired or removed from the scene.
+    void RemoveExpiredInstances();
+    /// Rebuild dependencies between groups.
+    void UpdateDependencies();
+    /// Execute all instances of the group.
+    void ExecuteGroup(JobGroup& group, float timeStep);
+
+    /// Work queue.
+    WorkQueue* workQueue_{};
+    /// Owner scene.
+    WeakPtr<Scene> scene_;
+    /// Whether enabled.
+    bool enabled_{};
+    /// Whether dependencies are dirty.
+    bool dependenciesDirty_{};
+    /// Whether the jobs are being executed.
+    bool updating_{};
+    /// Job groups in order of registration.
+    ea::vector<JobGroup> groups_;
+    /// Jobs added during update.
+    ea::vector<ea::pair<WeakPtr<Component>, SceneUpdateJobDesc>> pendingJobs_;
+    /// Temporary storage for task handles.
+    ea::vector<TaskHandle> tempTasks_;
+};
+
+}
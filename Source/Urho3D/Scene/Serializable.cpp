@@ -46,6 +46,49 @@ namespace Urho3D
 
 static const unsigned MAX_STACK_ATTRIBUTE_COUNT = 128;
 
+namespace
+{
+
+template <class T>
+void SerializeMemberAsType(Archive& archive, const char* name, const void* member)
+{
+    SerializeValue(archive, name, *static_cast<T*>(const_cast<void*>(member)));
+}
+
+/// Write attribute value from member variable without Variant. Output format is the same as for Variant.
+void SerializeMemberAttribute(Archive& archive, const AttributeInfo& attr, const void* member)
+{
+    VariantType variantType = attr.type_;
+    SerializeValue(archive, "type", variantType);
+
+    // Unsigned integers are stored as signed ones with the same bits, the same way Variant does
+    switch (variantType)
+    {
+    case VAR_INT: SerializeMemberAsType<int>(archive, "value", member); break;
+    case VAR_INT64: SerializeMemberAsType<long long>(archive, "value", member); break;
+    case VAR_BOOL: SerializeMemberAsType<bool>(archive, "value", member); break;
+    case VAR_FLOAT: SerializeMemberAsType<float>(archive, "value", member); break;
+    case VAR_DOUBLE: SerializeMemberAsType<double>(archive, "value", member); break;
+    case VAR_VECTOR2: SerializeMemberAsType<Vector2>(archive, "value", member); break;
+    case VAR_VECTOR3: SerializeMemberAsType<Vector3>(archive, "value", member); break;
+    case VAR_VECTOR4: SerializeMemberAsType<Vector4>(archive, "value", member); break;
+    case VAR_QUATERNION: SerializeMemberAsType<Quaternion>(archive, "value", member); break;
+    case VAR_COLOR: SerializeMemberAsType<Color>(archive, "value", member); break;
+    case VAR_INTRECT: SerializeMemberAsType<IntRect>(archive, "value", member); break;
+    case VAR_INTVECTOR2: SerializeMemberAsType<IntVector2>(archive, "value", member); break;
+    case VAR_INTVECTOR3: SerializeMemberAsType<IntVector3>(archive, "value", member); break;
+    case VAR_RECT: SerializeMemberAsType<Rect>(archive, "value", member); break;
+    case VAR_MATRIX3: SerializeMemberAsType<Matrix3>(archive, "value", member); break;
+    case VAR_MATRIX3X4: SerializeMemberAsType<Matrix3x4>(archive, "value", member); break;
+    case VAR_MATRIX4: SerializeMemberAsType<Matrix4>(archive, "value", member); break;
+    default:
+        URHO3D_ASSERT(false, "Unsupported type of direct member attribute");
+        break;
+    }
+}
+
+}
+
 static unsigned RemapAttributeIndex(const ea::vector<AttributeInfo>* attributes, const AttributeInfo& netAttr, unsigned netAttrIndex)
 {
     if (!attributes)
@@ -420,6 +463,11 @@ void Serializable::SerializeInBlock(Archive& archive)
 
             auto& [index, value] = serializedAttributes.emplace_back();
             index = attributeIndex;
+
+            // Plain members are written directly from memory later, OnGetAttribute is not called for them
+            if (saveDefaults && attr.accessor_->IsDirectMember())
+                continue;
+
             OnGetAttribute(attr, value);
 
             // Skip defaults if allowed
@@ -468,6 +516,12 @@ void Serializable::SerializeInBlock(Archive& archive)
                 const AttributeInfo& attr = attributes[value.first];
                 StringHash nameHash = attr.nameHash_;
                 SerializeStringHash(archive, "name", nameHash, attr.name_);
+
+                if (value.second.IsEmpty() && attr.accessor_->IsDirectMember())
+                {
+                    SerializeMemberAttribute(archive, attr, attr.accessor_->GetMemberPointer(this));
+                    return;
+                }
             }
 
             SerializeVariantInBlock(archive, value.second);
@@ -26,6 +26,7 @@
 #include "../Core/Object.h"
 
 #include <cstddef>
+#include <type_traits>
 
 namespace Urho3D
 {
@@ -177,14 +178,91 @@ SharedPtr<AttributeAccessor> MakeVariantAttributeAccessor(TGetFunction getFuncti
     return SharedPtr<AttributeAccessor>(new VariantAttributeAccessorImpl<TClassType, TGetFunction, TSetFunction>(getFunction, setFunction));
 }
 
+/// Whether the attribute of given type can be serialized directly from memory.
+/// Type should be trivially copyable and have the same layout as the storage of corresponding Variant type.
+template <class T>
+static constexpr bool IsDirectAttributeType = std::is_trivially_copyable_v<T>
+    && (std::is_same_v<T, int> || std::is_same_v<T, unsigned> || std::is_same_v<T, long long>
+        || std::is_same_v<T, unsigned long long> || std::is_same_v<T, bool> || std::is_same_v<T, float>
+        || std::is_same_v<T, double> || std::is_same_v<T, Vector2> || std::is_same_v<T, Vector3>
+        || std::is_same_v<T, Vector4> || std::is_same_v<T, Quaternion> || std::is_same_v<T, Color>
+        || std::is_same_v<T, IntRect> || std::is_same_v<T, IntVector2> || std::is_same_v<T, IntVector3>
+        || std::is_same_v<T, Rect> || std::is_same_v<T, Matrix3> || std::is_same_v<T, Matrix3x4>
+        || std::is_same_v<T, Matrix4>);
+
+/// Template implementation of the member variable attribute accessor.
+/// If the member has exactly the type of the attribute and the type is supported, it's exposed for direct serialization.
+template <class TClassType, class TAttributeType, class TMemberFunction, class TSetFunction>
+class MemberAttributeAccessorImpl : public AttributeAccessor
+{
+public:
+    /// Type returned by member function.
+    using MemberReference = std::invoke_result_t<TMemberFunction, const TClassType&>;
+    /// Whether the member may be accessed directly.
+    static constexpr bool IsDirect = std::is_lvalue_reference_v<MemberReference>
+        && std::is_same_v<std::decay_t<MemberReference>, TAttributeType> && IsDirectAttributeType<TAttributeType>;
+
+    /// Construct.
+    MemberAttributeAccessorImpl(TMemberFunction memberFunction, TSetFunction setFunction)
+        : memberFunction_(memberFunction)
+        , setFunction_(setFunction)
+    {
+        directMember_ = IsDirect;
+    }
+
+    /// Read member variable.
+    void Get(const Serializable* ptr, Variant& value) const override
+    {
+        assert(ptr);
+        const auto classPtr = static_cast<const TClassType*>(ptr);
+        value = memberFunction_(*classPtr);
+    }
+
+    /// Invoke setter function.
+    void Set(Serializable* ptr, const Variant& value) override
+    {
+        assert(ptr);
+        auto classPtr = static_cast<TClassType*>(ptr);
+        setFunction_(*classPtr, value);
+    }
+
+    /// Return pointer to member variable.
+    const void* GetMemberPointer(const Serializable* ptr) const override
+    {
+        assert(ptr);
+        if constexpr (IsDirect)
+            return &memberFunction_(*static_cast<const TClassType*>(ptr));
+        else
+            return nullptr;
+    }
+
+private:
+    /// Member reference functor.
+    TMemberFunction memberFunction_;
+    /// Set functor.
+    TSetFunction setFunction_;
+};
+
+/// Make member attribute accessor implementation.
+/// \tparam TClassType Serializable class type.
+/// \tparam TAttributeType Type of attribute.
+/// \tparam TMemberFunction Functional object with call signature `const auto& memberFunction(const TClassType& self)`
+/// \tparam TSetFunction Functional object with call signature `void setFunction(TClassType& self, const Variant& value)`
+template <class TClassType, class TAttributeType, class TMemberFunction, class TSetFunction>
+SharedPtr<AttributeAccessor> MakeMemberAttributeAccessor(TMemberFunction memberFunction, TSetFunction setFunction)
+{
+    using AccessorType = MemberAttributeAccessorImpl<TClassType, TAttributeType, TMemberFunction, TSetFunction>;
+    return SharedPtr<AttributeAccessor>(new AccessorType(memberFunction, setFunction));
+}
+
 /// Make member attribute accessor.
-#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
-    [](const ClassName& self, Urho3D::Variant& value) { value = self.variable; }, \
+#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeMemberAttributeAccessor<ClassName, typeName>( \
+    [](const ClassName& self) -> decltype(auto) { return (self.variable); }, \
     [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); })
 
 /// Make member attribute accessor with custom post-set callback.
-#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR_EX(typeName, variable, postSetCallback) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
-    [](const ClassName& self, Urho3D::Variant& value) { value = self.variable; }, \
+#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR_EX(typeName, variable, postSetCallback) Urho3D::MakeMemberAttributeAccessor<ClassName, typeName>( \
+    [](const ClassName& self) -> decltype(auto) { return (self.variable); }, \
     [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); self.postSetCallback(); })
 
 /// Make custom member attribute accessor.
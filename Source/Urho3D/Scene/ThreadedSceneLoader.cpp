@@ -0,0 +1,622 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Scene/ThreadedSceneLoader.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/Timer.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../Scene/Component.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneResolver.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Number of root-level XML or JSON nodes decoded by one task.
+const unsigned NodesPerTask = 16;
+/// Maximum time of one binary decoding task, in microseconds.
+const long long BinaryTaskTimeUs = 2000;
+
+/// Return whether the XML element of Animatable component contains object or attribute animation.
+bool HasAnimationXML(const XMLElement& element)
+{
+    return element.HasChild("objectanimation") || element.HasChild("attributeanimation");
+}
+
+/// Return whether the JSON value of Animatable component contains object or attribute animation.
+bool HasAnimationJSON(const JSONValue& value)
+{
+    return !value.Get("objectanimation").IsNull() || !value.Get("attributeanimation").IsNull();
+}
+
+}
+
+ThreadedSceneLoader::ThreadedSceneLoader(Scene* scene)
+    : context_(scene->GetContext())
+    , scene_(scene)
+    , workQueue_(scene->GetSubsystem<WorkQueue>())
+    , nodeAttributes_(context_->GetAttributes(Node::GetTypeStatic()))
+{
+}
+
+ThreadedSceneLoader::~ThreadedSceneLoader()
+{
+    cancelled_.store(true, std::memory_order_relaxed);
+
+    // Binary decoding task may schedule another one, wait until the list is stable
+    ea::vector<TaskHandle> tasks;
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex_);
+            if (tasks.size() == tasks_.size())
+                break;
+            tasks = tasks_;
+        }
+        workQueue_->WaitTasks(tasks);
+    }
+}
+
+void ThreadedSceneLoader::CreateChunks(unsigned numChunks)
+{
+    chunks_.resize(numChunks);
+    for (auto& chunk : chunks_)
+        chunk = ea::make_unique<DecodedChunk>();
+}
+
+void ThreadedSceneLoader::AddTask(WorkFunction function)
+{
+    if (!workQueue_)
+    {
+        function(0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(tasksMutex_);
+    tasks_.push_back(workQueue_->ScheduleTask(ea::move(function)));
+}
+
+void ThreadedSceneLoader::StartBinary(ByteVector data, unsigned numNodes)
+{
+    binaryData_ = ea::move(data);
+    CreateChunks(numNodes);
+
+    if (numNodes > 0)
+        AddTask([this](unsigned) { DecodeBinaryChunks(0, 0); });
+}
+
+void ThreadedSceneLoader::StartXML(const XMLElement& sceneElement)
+{
+    unsigned numNodes = 0;
+    for (XMLElement childElement = sceneElement.GetChild("node"); childElement; childElement = childElement.GetNext("node"))
+        ++numNodes;
+
+    CreateChunks(numNodes);
+
+    unsigned index = 0;
+    for (XMLElement childElement = sceneElement.GetChild("node"); childElement; childElement = childElement.GetNext("node"))
+        chunks_[index++]->xmlSource_ = childElement;
+
+    for (unsigned beginIndex = 0; beginIndex < numNodes; beginIndex += NodesPerTask)
+    {
+        const unsigned endIndex = ea::min(beginIndex + NodesPerTask, numNodes);
+        AddTask([this, beginIndex, endIndex](unsigned) { DecodeChunks(beginIndex, endIndex); });
+    }
+}
+
+void ThreadedSceneLoader::StartJSON(const JSONValue& sceneValue)
+{
+    const JSONArray& childrenArray = sceneValue.Get("children").GetArray();
+    const unsigned numNodes = childrenArray.size();
+
+    CreateChunks(numNodes);
+    for (unsigned i = 0; i < numNodes; ++i)
+        chunks_[i]->jsonSource_ = &childrenArray[i];
+
+    for (unsigned beginIndex = 0; beginIndex < numNodes; beginIndex += NodesPerTask)
+    {
+        const unsigned endIndex = ea::min(beginIndex + NodesPerTask, numNodes);
+        AddTask([this, beginIndex, endIndex](unsigned) { DecodeChunks(beginIndex, endIndex); });
+    }
+}
+
+void ThreadedSceneLoader::Update()
+{
+    if (!workQueue_ || workQueue_->GetNumThreads() > 0 || IsDecoded())
+        return;
+
+    // Execute one pending task per update so loading is still time-sliced
+    TaskHandle pendingTask;
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex_);
+        for (const TaskHandle& task : tasks_)
+        {
+            if (!workQueue_->IsTaskCompleted(task))
+            {
+                pendingTask = task;
+                break;
+            }
+        }
+    }
+
+    if (pendingTask.IsValid())
+        workQueue_->WaitTask(pendingTask);
+}
+
+void ThreadedSceneLoader::ProcessDecodedResources(const ResourceCallback& callback)
+{
+    numProcessedChunks_ = ea::max(numProcessedChunks_, numCommittedChunks_);
+    while (numProcessedChunks_ < chunks_.size())
+    {
+        DecodedChunk& chunk = *chunks_[numProcessedChunks_];
+        if (!chunk.decoded_.load(std::memory_order_acquire))
+            break;
+
+        for (const auto& [type, name] : chunk.resources_)
+            callback(type, name);
+        chunk.resources_.clear();
+
+        ++numProcessedChunks_;
+    }
+}
+
+unsigned ThreadedSceneLoader::CommitNodes(SceneResolver& resolver, long long maxTimeUs)
+{
+    URHO3D_PROFILE("CommitDecodedNodes");
+
+    HiresTimer timer;
+    unsigned numCommittedNodes = 0;
+    while (numCommittedChunks_ < chunks_.size())
+    {
+        ea::unique_ptr<DecodedChunk>& chunk = chunks_[numCommittedChunks_];
+        if (!chunk->decoded_.load(std::memory_order_acquire))
+            break;
+
+        CommitChunk(*chunk, resolver);
+
+        // Decoded data is not needed anymore
+        chunk.reset();
+        ++numCommittedChunks_;
+        ++numCommittedNodes;
+
+        if (timer.GetUSec(false) >= maxTimeUs)
+            break;
+    }
+    return numCommittedNodes;
+}
+
+bool ThreadedSceneLoader::IsFinished() const
+{
+    if (numCommittedChunks_ == chunks_.size())
+        return true;
+
+    // Check failure first so the number of decoded chunks is final
+    return IsFailed() && numCommittedChunks_ == numDecodedChunks_.load(std::memory_order_acquire);
+}
+
+void ThreadedSceneLoader::MarkFailed()
+{
+    failed_.store(true, std::memory_order_release);
+    cancelled_.store(true, std::memory_order_relaxed);
+}
+
+void ThreadedSceneLoader::DecodeChunks(unsigned beginIndex, unsigned endIndex)
+{
+    URHO3D_PROFILE("DecodeSceneNodes");
+
+    for (unsigned index = beginIndex; index < endIndex; ++index)
+    {
+        if (cancelled_.load(std::memory_order_relaxed))
+            return;
+
+        DecodedChunk& chunk = *chunks_[index];
+        if (chunk.xmlSource_)
+            DecodeNodeXML(chunk, chunk.xmlSource_, M_MAX_UNSIGNED);
+        else if (chunk.jsonSource_)
+            DecodeNodeJSON(chunk, *chunk.jsonSource_, M_MAX_UNSIGNED);
+
+        chunk.decoded_.store(true, std::memory_order_release);
+        numDecodedChunks_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void ThreadedSceneLoader::DecodeBinaryChunks(unsigned chunkIndex, unsigned position)
+{
+    URHO3D_PROFILE("DecodeSceneNodes");
+
+    HiresTimer timer;
+    MemoryBuffer source(binaryData_.data(), binaryData_.size());
+    source.Seek(position);
+
+    while (chunkIndex < chunks_.size())
+    {
+        if (cancelled_.load(std::memory_order_relaxed))
+            return;
+
+        DecodedChunk& chunk = *chunks_[chunkIndex];
+        const unsigned nodeId = source.ReadUInt();
+        if (source.IsEof() || !DecodeNodeBinary(chunk, source, nodeId, M_MAX_UNSIGNED))
+        {
+            URHO3D_LOGERROR("Could not decode root-level node {} of binary scene", chunkIndex);
+            MarkFailed();
+            return;
+        }
+
+        chunk.decoded_.store(true, std::memory_order_release);
+        numDecodedChunks_.fetch_add(1, std::memory_order_release);
+        ++chunkIndex;
+
+        // Continue in another task so the worker thread is not occupied for too long
+        if (chunkIndex < chunks_.size() && timer.GetUSec(false) >= BinaryTaskTimeUs)
+        {
+            const unsigned nextPosition = source.GetPosition();
+            AddTask([this, chunkIndex, nextPosition](unsigned) { DecodeBinaryChunks(chunkIndex, nextPosition); });
+            return;
+        }
+    }
+}
+
+void ThreadedSceneLoader::DecodeNodeXML(DecodedChunk& chunk, const XMLElement& element, unsigned parentIndex)
+{
+    const unsigned nodeIndex = chunk.nodes_.size();
+    {
+        DecodedNode& node = chunk.nodes_.emplace_back();
+        node.parentIndex_ = parentIndex;
+        node.id_ = element.GetUInt("id");
+        node.firstAttribute_ = chunk.attributes_.size();
+    }
+
+    DecodeAttributesXML(chunk, element, *nodeAttributes_);
+    chunk.nodes_[nodeIndex].numAttributes_ = chunk.attributes_.size() - chunk.nodes_[nodeIndex].firstAttribute_;
+    chunk.nodes_[nodeIndex].firstComponent_ = chunk.components_.size();
+
+    for (XMLElement componentElement = element.GetChild("component"); componentElement;
+        componentElement = componentElement.GetNext("component"))
+    {
+        DecodedComponent& component = chunk.components_.emplace_back();
+        component.typeName_ = componentElement.GetAttribute("type");
+        component.type_ = StringHash(component.typeName_);
+        component.id_ = componentElement.GetUInt("id");
+        component.firstAttribute_ = chunk.attributes_.size();
+
+        // Animations create objects when loaded, so animated components are loaded on commit
+        const ea::vector<AttributeInfo>* attributes = GetDecodableAttributes(component.type_);
+        if (attributes && !HasAnimationXML(componentElement))
+            DecodeAttributesXML(chunk, componentElement, *attributes);
+        else
+        {
+            component.deferred_ = true;
+            component.xmlSource_ = componentElement;
+        }
+
+        component.numAttributes_ = chunk.attributes_.size() - component.firstAttribute_;
+    }
+
+    chunk.nodes_[nodeIndex].numComponents_ = chunk.components_.size() - chunk.nodes_[nodeIndex].firstComponent_;
+
+    for (XMLElement childElement = element.GetChild("node"); childElement; childElement = childElement.GetNext("node"))
+        DecodeNodeXML(chunk, childElement, nodeIndex);
+}
+
+void ThreadedSceneLoader::DecodeNodeJSON(DecodedChunk& chunk, const JSONValue& value, unsigned parentIndex)
+{
+    const unsigned nodeIndex = chunk.nodes_.size();
+    {
+        DecodedNode& node = chunk.nodes_.emplace_back();
+        node.parentIndex_ = parentIndex;
+        node.id_ = value.Get("id").GetUInt();
+        node.firstAttribute_ = chunk.attributes_.size();
+    }
+
+    DecodeAttributesJSON(chunk, value, *nodeAttributes_);
+    chunk.nodes_[nodeIndex].numAttributes_ = chunk.attributes_.size() - chunk.nodes_[nodeIndex].firstAttribute_;
+    chunk.nodes_[nodeIndex].firstComponent_ = chunk.components_.size();
+
+    for (const JSONValue& componentValue : value.Get("components").GetArray())
+    {
+        DecodedComponent& component = chunk.components_.emplace_back();
+        component.typeName_ = componentValue.Get("type").GetString();
+        component.type_ = StringHash(component.typeName_);
+        component.id_ = componentValue.Get("id").GetUInt();
+        component.firstAttribute_ = chunk.attributes_.size();
+
+        // Animations create objects when loaded, so animated components are loaded on commit
+        const ea::vector<AttributeInfo>* attributes = GetDecodableAttributes(component.type_);
+        if (attributes && !HasAnimationJSON(componentValue))
+            DecodeAttributesJSON(chunk, componentValue, *attributes);
+        else
+        {
+            component.deferred_ = true;
+            component.jsonSource_ = &componentValue;
+        }
+
+        component.numAttributes_ = chunk.attributes_.size() - component.firstAttribute_;
+    }
+
+    chunk.nodes_[nodeIndex].numComponents_ = chunk.components_.size() - chunk.nodes_[nodeIndex].firstComponent_;
+
+    for (const JSONValue& childValue : value.Get("children").GetArray())
+        DecodeNodeJSON(chunk, childValue, nodeIndex);
+}
+
+bool ThreadedSceneLoader::DecodeNodeBinary(DecodedChunk& chunk, MemoryBuffer& source, unsigned nodeId, unsigned parentIndex)
+{
+    const unsigned nodeIndex = chunk.nodes_.size();
+    {
+        DecodedNode& node = chunk.nodes_.emplace_back();
+        node.parentIndex_ = parentIndex;
+        node.id_ = nodeId;
+        node.firstAttribute_ = chunk.attributes_.size();
+    }
+
+    if (!DecodeAttributesBinary(chunk, source, *nodeAttributes_))
+        return false;
+
+    chunk.nodes_[nodeIndex].numAttributes_ = chunk.attributes_.size() - chunk.nodes_[nodeIndex].firstAttribute_;
+    chunk.nodes_[nodeIndex].firstComponent_ = chunk.components_.size();
+
+    const unsigned numComponents = source.ReadVLE();
+    for (unsigned i = 0; i < numComponents; ++i)
+    {
+        const unsigned componentSize = source.ReadVLE();
+        if (componentSize > source.GetSize() - source.GetPosition())
+            return false;
+
+        const unsigned char* componentData = source.GetData() + source.GetPosition();
+        source.Seek(source.GetPosition() + componentSize);
+
+        MemoryBuffer componentSource(componentData, componentSize);
+        DecodedComponent& component = chunk.components_.emplace_back();
+        component.type_ = componentSource.ReadStringHash();
+        component.id_ = componentSource.ReadUInt();
+        component.firstAttribute_ = chunk.attributes_.size();
+
+        const unsigned attributesPosition = componentSource.GetPosition();
+        const ea::vector<AttributeInfo>* attributes = GetDecodableAttributes(component.type_);
+        if (!attributes || !DecodeAttributesBinary(chunk, componentSource, *attributes))
+        {
+            // Malformed component data is not fatal, like in Node::Load
+            chunk.attributes_.resize(component.firstAttribute_);
+            component.deferred_ = true;
+            component.binarySource_.assign(componentData + attributesPosition, componentData + componentSize);
+        }
+
+        component.numAttributes_ = chunk.attributes_.size() - component.firstAttribute_;
+    }
+
+    chunk.nodes_[nodeIndex].numComponents_ = chunk.components_.size() - chunk.nodes_[nodeIndex].firstComponent_;
+
+    const unsigned numChildren = source.ReadVLE();
+    for (unsigned i = 0; i < numChildren; ++i)
+    {
+        const unsigned childId = source.ReadUInt();
+        if (source.IsEof() || !DecodeNodeBinary(chunk, source, childId, nodeIndex))
+            return false;
+    }
+
+    return true;
+}
+
+void ThreadedSceneLoader::DecodeAttributesXML(
+    DecodedChunk& chunk, const XMLElement& element, const ea::vector<AttributeInfo>& attributes) const
+{
+    // Same lookup as in Serializable::LoadXML
+    const unsigned numAttributes = attributes.size();
+    unsigned startIndex = 0;
+    for (XMLElement attributeElement = element.GetChild("attribute"); attributeElement;
+        attributeElement = attributeElement.GetNext("attribute"))
+    {
+        const ea::string& name = attributeElement.GetAttribute("name");
+        unsigned index = startIndex;
+        unsigned attempts = numAttributes;
+        while (attempts)
+        {
+            const AttributeInfo& attr = attributes[index];
+            if (attr.ShouldLoad() && !attr.name_.compare(name))
+            {
+                Variant value;
+                if (!attr.enumNames_.empty() && attr.type_ == VAR_INT)
+                {
+                    const ea::string& enumName = attributeElement.GetAttribute("value");
+                    const unsigned enumValue = attr.ConvertEnumToUInt(enumName);
+                    if (enumValue != M_MAX_UNSIGNED)
+                        value = enumValue;
+                    else
+                        URHO3D_LOGWARNING("Unknown enum value " + enumName + " in attribute " + attr.name_);
+                }
+                else
+                    value = attributeElement.GetVariantValue(attr.type_);
+
+                if (!value.IsEmpty())
+                    AddAttribute(chunk, index, attr, ea::move(value));
+
+                startIndex = (index + 1) % numAttributes;
+                break;
+            }
+
+            index = (index + 1) % numAttributes;
+            --attempts;
+        }
+
+        if (!attempts)
+            URHO3D_LOGWARNING("Unknown attribute " + name + " in XML data");
+    }
+}
+
+void ThreadedSceneLoader::DecodeAttributesJSON(
+    DecodedChunk& chunk, const JSONValue& value, const ea::vector<AttributeInfo>& attributes) const
+{
+    // Same lookup as in Serializable::LoadJSON
+    const JSONValue& attributesValue = value.Get("attributes");
+    if (!attributesValue.IsObject())
+        return;
+
+    for (unsigned index = 0; index < attributes.size(); ++index)
+    {
+        const AttributeInfo& attr = attributes[index];
+        if (!attr.ShouldLoad())
+            continue;
+
+        const JSONValue& attributeValue = attributesValue.Get(attr.name_);
+        if (attributeValue.GetValueType() == JSON_NULL)
+            continue;
+
+        Variant decodedValue;
+        if (!attr.enumNames_.empty() && attr.type_ == VAR_INT)
+        {
+            const ea::string& enumName = attributeValue.GetString();
+            const unsigned enumValue = attr.ConvertEnumToUInt(enumName);
+            if (enumValue != M_MAX_UNSIGNED)
+                decodedValue = enumValue;
+            else
+                URHO3D_LOGWARNING("Unknown enum value " + enumName + " in attribute " + attr.name_);
+        }
+        else
+            decodedValue = attributeValue.GetVariantValue(attr.type_);
+
+        if (!decodedValue.IsEmpty())
+            AddAttribute(chunk, index, attr, ea::move(decodedValue));
+    }
+}
+
+bool ThreadedSceneLoader::DecodeAttributesBinary(
+    DecodedChunk& chunk, Deserializer& source, const ea::vector<AttributeInfo>& attributes) const
+{
+    // Same layout as in Serializable::Load
+    for (unsigned index = 0; index < attributes.size(); ++index)
+    {
+        const AttributeInfo& attr = attributes[index];
+        if (!attr.ShouldLoad())
+            continue;
+
+        if (source.IsEof())
+            return false;
+
+        AddAttribute(chunk, index, attr, source.ReadVariant(attr.type_));
+    }
+    return true;
+}
+
+void ThreadedSceneLoader::AddAttribute(DecodedChunk& chunk, unsigned index, const AttributeInfo& attr, Variant value) const
+{
+    if (attr.type_ == VAR_RESOURCEREF)
+    {
+        const ResourceRef& ref = value.GetResourceRef();
+        if (!ref.name_.empty())
+            chunk.resources_.emplace_back(ref.type_, ref.name_);
+    }
+    else if (attr.type_ == VAR_RESOURCEREFLIST)
+    {
+        const ResourceRefList& refList = value.GetResourceRefList();
+        for (const ea::string& name : refList.names_)
+        {
+            if (!name.empty())
+                chunk.resources_.emplace_back(refList.type_, name);
+        }
+    }
+
+    chunk.attributes_.push_back(DecodedAttribute{index, ea::move(value)});
+}
+
+const ea::vector<AttributeInfo>* ThreadedSceneLoader::GetDecodableAttributes(StringHash componentType) const
+{
+    // Reflections are not modified during loading, so they can be read from any thread
+    const ObjectReflection* reflection = context_->GetReflection(componentType);
+    if (!reflection || !reflection->HasObjectFactory())
+        return nullptr;
+
+    // Custom attributes create objects when decoded, which is not allowed in worker threads
+    const ea::vector<AttributeInfo>& attributes = reflection->GetAttributes();
+    for (const AttributeInfo& attr : attributes)
+    {
+        if (attr.ShouldLoad() && attr.type_ == VAR_CUSTOM)
+            return nullptr;
+    }
+    return &attributes;
+}
+
+void ThreadedSceneLoader::CommitChunk(DecodedChunk& chunk, SceneResolver& resolver)
+{
+    Scene* scene = scene_;
+
+    createdNodes_.resize(chunk.nodes_.size());
+    for (unsigned nodeIndex = 0; nodeIndex < chunk.nodes_.size(); ++nodeIndex)
+    {
+        const DecodedNode& nodeData = chunk.nodes_[nodeIndex];
+        Node* parent = nodeData.parentIndex_ == M_MAX_UNSIGNED ? scene : createdNodes_[nodeData.parentIndex_];
+
+        Node* node = parent->CreateChild(nodeData.id_);
+        createdNodes_[nodeIndex] = node;
+        resolver.AddNode(nodeData.id_, node);
+
+        for (unsigned i = 0; i < nodeData.numAttributes_; ++i)
+        {
+            const DecodedAttribute& attribute = chunk.attributes_[nodeData.firstAttribute_ + i];
+            node->OnSetAttribute((*nodeAttributes_)[attribute.index_], attribute.value_);
+        }
+
+        for (unsigned componentIndex = 0; componentIndex < nodeData.numComponents_; ++componentIndex)
+        {
+            const DecodedComponent& componentData = chunk.components_[nodeData.firstComponent_ + componentIndex];
+            Component* component = node->SafeCreateComponent(componentData.typeName_, componentData.type_, componentData.id_);
+            if (!component)
+                continue;
+
+            resolver.AddComponent(componentData.id_, component);
+
+            if (componentData.deferred_)
+            {
+                if (componentData.xmlSource_)
+                    component->LoadXML(componentData.xmlSource_);
+                else if (componentData.jsonSource_)
+                    component->LoadJSON(*componentData.jsonSource_);
+                else
+                {
+                    MemoryBuffer source(componentData.binarySource_);
+                    component->Load(source);
+                }
+                continue;
+            }
+
+            const ea::vector<AttributeInfo>& attributes = *component->GetAttributes();
+            for (unsigned i = 0; i < componentData.numAttributes_; ++i)
+            {
+                const DecodedAttribute& attribute = chunk.attributes_[componentData.firstAttribute_ + i];
+                component->OnSetAttribute(attributes[attribute.index_], attribute.value_);
+            }
+        }
+    }
+    createdNodes_.clear();
+}
+
+}
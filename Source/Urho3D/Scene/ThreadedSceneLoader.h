@@ -0,0 +1,226 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/ByteVector.h"
+#include "../Container/Ptr.h"
+#include "../Core/Variant.h"
+#include "../Core/WorkQueue.h"
+#include "../Resource/JSONValue.h"
+#include "../Resource/XMLElement.h"
+
+#include <EASTL/functional.h>
+#include <EASTL/unique_ptr.h>
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace Urho3D
+{
+
+class Context;
+class Deserializer;
+class MemoryBuffer;
+class Node;
+class Scene;
+class SceneResolver;
+struct AttributeInfo;
+
+/// Loader of root-level scene nodes that decodes scene file in worker threads.
+/// Each root-level node is decoded with its whole hierarchy into intermediate form with attribute values
+/// converted to Variants. Decoded nodes are committed to the scene from the main thread in document order,
+/// so the result doesn't depend on number of threads or timing.
+/// Components that cannot be decoded safely in worker threads, e.g. unknown components or components with
+/// custom attributes, are loaded from the original source on commit.
+class URHO3D_API ThreadedSceneLoader
+{
+public:
+    /// Callback used to report resources referenced by decoded components.
+    using ResourceCallback = ea::function<void(StringHash type, const ea::string& name)>;
+
+    /// Construct.
+    explicit ThreadedSceneLoader(Scene* scene);
+    /// Destruct. Wait for decoding tasks to finish.
+    ~ThreadedSceneLoader();
+
+    /// Start decoding of root-level child nodes from binary stream.
+    void StartBinary(ByteVector data, unsigned numNodes);
+    /// Start decoding of root-level child nodes from XML element of the scene. XML file should be kept alive.
+    void StartXML(const XMLElement& sceneElement);
+    /// Start decoding of root-level child nodes from JSON value of the scene. JSON file should be kept alive.
+    void StartJSON(const JSONValue& sceneValue);
+
+    /// Execute decoding tasks in main thread if there are no worker threads.
+    void Update();
+    /// Report resources referenced by nodes decoded since last call, in document order.
+    void ProcessDecodedResources(const ResourceCallback& callback);
+    /// Create decoded nodes in the scene until time limit is exceeded or until not yet decoded node is reached.
+    /// Return number of committed root-level nodes.
+    unsigned CommitNodes(SceneResolver& resolver, long long maxTimeUs);
+
+    /// Return total number of root-level nodes.
+    unsigned GetNumNodes() const { return chunks_.size(); }
+    /// Return number of committed root-level nodes.
+    unsigned GetNumCommittedNodes() const { return numCommittedChunks_; }
+    /// Return whether all nodes are decoded.
+    bool IsDecoded() const { return numDecodedChunks_.load(std::memory_order_acquire) == chunks_.size(); }
+    /// Return whether decoding has failed. Nodes decoded before the error can be still committed.
+    bool IsFailed() const { return failed_.load(std::memory_order_acquire); }
+    /// Return whether all nodes that can be loaded are committed.
+    bool IsFinished() const;
+
+private:
+    /// Attribute value with resolved attribute index.
+    struct DecodedAttribute
+    {
+        /// Index of attribute.
+        unsigned index_{};
+        /// Value of attribute.
+        Variant value_;
+    };
+
+    /// Component decoded from scene file.
+    struct DecodedComponent
+    {
+        /// Type name. May be empty for binary files.
+        ea::string typeName_;
+        /// Type hash.
+        StringHash type_;
+        /// ID in the scene file.
+        unsigned id_{};
+        /// Range of attribute values.
+        unsigned firstAttribute_{};
+        unsigned numAttributes_{};
+        /// Whether the component is loaded from the original source on commit.
+        bool deferred_{};
+        /// Original source of deferred component.
+        /// @{
+        XMLElement xmlSource_;
+        const JSONValue* jsonSource_{};
+        ByteVector binarySource_;
+        /// @}
+    };
+
+    /// Node decoded from scene file.
+    struct DecodedNode
+    {
+        /// Index of parent node in the chunk. M_MAX_UNSIGNED for root-level node.
+        unsigned parentIndex_{};
+        /// ID in the scene file.
+        unsigned id_{};
+        /// Range of attribute values.
+        unsigned firstAttribute_{};
+        unsigned numAttributes_{};
+        /// Range of components.
+        unsigned firstComponent_{};
+        unsigned numComponents_{};
+    };
+
+    /// Root-level node with its hierarchy.
+    struct DecodedChunk
+    {
+        /// Nodes in depth-first order.
+        ea::vector<DecodedNode> nodes_;
+        /// Components of all nodes.
+        ea::vector<DecodedComponent> components_;
+        /// Attribute values of all nodes and components.
+        ea::vector<DecodedAttribute> attributes_;
+        /// Resources referenced by decoded components.
+        ea::vector<ea::pair<StringHash, ea::string>> resources_;
+        /// Source XML element.
+        XMLElement xmlSource_;
+        /// Source JSON value.
+        const JSONValue* jsonSource_{};
+        /// Whether the chunk is decoded.
+        std::atomic<bool> decoded_{};
+    };
+
+    /// Create chunks and tasks that decode them.
+    void CreateChunks(unsigned numChunks);
+    /// Add decoding task.
+    void AddTask(WorkFunction function);
+    /// Decode range of chunks from XML or JSON.
+    void DecodeChunks(unsigned beginIndex, unsigned endIndex);
+    /// Decode chunks from binary stream, starting from given chunk and position, until time slice is exceeded.
+    void DecodeBinaryChunks(unsigned chunkIndex, unsigned position);
+    /// Mark decoding as failed and cancel the rest.
+    void MarkFailed();
+
+    /// Decode node with children from XML.
+    void DecodeNodeXML(DecodedChunk& chunk, const XMLElement& element, unsigned parentIndex);
+    /// Decode node with children from JSON.
+    void DecodeNodeJSON(DecodedChunk& chunk, const JSONValue& value, unsigned parentIndex);
+    /// Decode node with children from binary. Return false on error.
+    bool DecodeNodeBinary(DecodedChunk& chunk, MemoryBuffer& source, unsigned nodeId, unsigned parentIndex);
+
+    /// Decode attribute values from XML.
+    void DecodeAttributesXML(DecodedChunk& chunk, const XMLElement& element, const ea::vector<AttributeInfo>& attributes) const;
+    /// Decode attribute values from JSON.
+    void DecodeAttributesJSON(DecodedChunk& chunk, const JSONValue& value, const ea::vector<AttributeInfo>& attributes) const;
+    /// Decode attribute values from binary. Return false on error.
+    bool DecodeAttributesBinary(DecodedChunk& chunk, Deserializer& source, const ea::vector<AttributeInfo>& attributes) const;
+    /// Add decoded attribute value and remember referenced resources.
+    void AddAttribute(DecodedChunk& chunk, unsigned index, const AttributeInfo& attr, Variant value) const;
+    /// Return attributes of component type if it can be decoded in worker thread, null otherwise.
+    const ea::vector<AttributeInfo>* GetDecodableAttributes(StringHash componentType) const;
+
+    /// Create decoded nodes of the chunk in the scene.
+    void CommitChunk(DecodedChunk& chunk, SceneResolver& resolver);
+
+    /// Context.
+    Context* context_{};
+    /// Scene.
+    WeakPtr<Scene> scene_;
+    /// Work queue.
+    WorkQueue* workQueue_{};
+    /// Node attributes.
+    const ea::vector<AttributeInfo>* nodeAttributes_{};
+
+    /// Decoded chunks in document order.
+    ea::vector<ea::unique_ptr<DecodedChunk>> chunks_;
+    /// Binary stream.
+    ByteVector binaryData_;
+    /// Decoding tasks.
+    ea::vector<TaskHandle> tasks_;
+    /// Mutex for decoding tasks.
+    std::mutex tasksMutex_;
+    /// Number of decoded chunks.
+    std::atomic<unsigned> numDecodedChunks_{};
+    /// Whether decoding is cancelled.
+    std::atomic<bool> cancelled_{};
+    /// Whether decoding has failed.
+    std::atomic<bool> failed_{};
+
+    /// Number of chunks whose resources are reported.
+    unsigned numProcessedChunks_{};
+    /// Number of committed chunks.
+    unsigned numCommittedChunks_{};
+    /// Nodes created for the chunk being committed.
+    ea::vector<Node*> createdNodes_;
+};
+
+}
@@ -0,0 +1,459 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Profiler.h"
+#include "../IO/ArchiveSerializationVariant.h"
+#include "../IO/BinaryArchive.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../IO/VectorBuffer.h"
+#include "../Scene/Component.h"
+#include "../Scene/Scene.h"
+#include "../Utility/SceneDiff.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Calculate FNV-1a hash of the buffer.
+unsigned long long HashBytes(const ByteVector& data)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    for (unsigned char value : data)
+    {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/// Pack attributes of node without children and components.
+void PackNodeAttributes(Node* node, VectorBuffer& buffer, PackedSceneObject& result)
+{
+    buffer.Clear();
+    ConsumeArchiveException([&]
+    {
+        BinaryOutputArchive archive{node->GetContext(), buffer};
+        ArchiveBlock block = archive.OpenUnorderedBlock("Node");
+        node->Serializable::SerializeInBlock(archive);
+    });
+    result.data_ = buffer.GetBuffer();
+    result.hash_ = HashBytes(result.data_);
+}
+
+/// Unpack attributes of node without children and components.
+void UnpackNodeAttributes(Node* node, const PackedSceneObject& data)
+{
+    ConsumeArchiveException([&]
+    {
+        MemoryBuffer view{data.data_};
+        BinaryInputArchive archive{node->GetContext(), view};
+        ArchiveBlock block = archive.OpenUnorderedBlock("Node");
+        node->Serializable::SerializeInBlock(archive);
+    });
+}
+
+/// Return whether the scene attribute is stored in snapshot.
+/// Counters of node and component IDs are not editable and change whenever any node is created, even a temporary one.
+bool IsSceneAttributeTracked(const AttributeInfo& attr)
+{
+    return attr.ShouldSave() && !(attr.mode_ & AM_NOEDIT);
+}
+
+/// Pack attributes of scene without children and components.
+void PackSceneAttributes(Scene* scene, VectorBuffer& buffer, PackedSceneObject& result)
+{
+    buffer.Clear();
+    ConsumeArchiveException([&]
+    {
+        BinaryOutputArchive archive{scene->GetContext(), buffer};
+        ArchiveBlock block = archive.OpenUnorderedBlock("Scene");
+        const ea::vector<AttributeInfo>& attributes = *scene->GetAttributes();
+        for (unsigned index = 0; index < attributes.size(); ++index)
+        {
+            if (!IsSceneAttributeTracked(attributes[index]))
+                continue;
+
+            Variant value = scene->GetAttribute(index);
+            SerializeValue(archive, attributes[index].name_.c_str(), value);
+        }
+    });
+    result.data_ = buffer.GetBuffer();
+    result.hash_ = HashBytes(result.data_);
+}
+
+/// Unpack attributes of scene without children and components.
+void UnpackSceneAttributes(Scene* scene, const PackedSceneObject& data)
+{
+    ConsumeArchiveException([&]
+    {
+        MemoryBuffer view{data.data_};
+        BinaryInputArchive archive{scene->GetContext(), view};
+        ArchiveBlock block = archive.OpenUnorderedBlock("Scene");
+        const ea::vector<AttributeInfo>& attributes = *scene->GetAttributes();
+        for (unsigned index = 0; index < attributes.size(); ++index)
+        {
+            if (!IsSceneAttributeTracked(attributes[index]))
+                continue;
+
+            Variant value;
+            SerializeValue(archive, attributes[index].name_.c_str(), value);
+            scene->SetAttribute(index, value);
+        }
+    });
+    scene->ApplyAttributes();
+}
+
+/// Pack attributes of component.
+void PackComponentAttributes(Component* component, VectorBuffer& buffer, PackedSceneObject& result,
+    const PackedSceneObject* previous)
+{
+    buffer.Clear();
+    ConsumeArchiveException([&]
+    {
+        BinaryOutputArchive archive{component->GetContext(), buffer};
+        SerializeValue(archive, "Component", *component);
+    });
+    result.data_ = buffer.GetBuffer();
+    result.hash_ = previous && previous->data_ == result.data_ ? previous->hash_ : HashBytes(result.data_);
+}
+
+/// Return index to insert object at so that it has the specified index among persistent objects.
+template <class T>
+unsigned GetActualIndex(const ea::vector<SharedPtr<T>>& objects, const T* object, unsigned persistentIndex)
+{
+    // Index is calculated as if the object was removed, like ReorderChild and ReorderComponent do
+    unsigned index = 0;
+    unsigned numPersistent = 0;
+    for (const SharedPtr<T>& other : objects)
+    {
+        if (other == object)
+            continue;
+        if (!other->IsTemporary())
+        {
+            if (numPersistent == persistentIndex)
+                return index;
+            ++numPersistent;
+        }
+        ++index;
+    }
+    return index;
+}
+
+/// Unpack attributes of component.
+void UnpackComponentAttributes(Component* component, const PackedSceneObject& data)
+{
+    ConsumeArchiveException([&]
+    {
+        MemoryBuffer view{data.data_};
+        BinaryInputArchive archive{component->GetContext(), view};
+        SerializeValue(archive, "Component", *component);
+    });
+}
+
+}
+
+void PackedSceneObject::SerializeInBlock(Archive& archive)
+{
+    SerializeValue(archive, "id", id_);
+    SerializeValue(archive, "parentId", parentId_);
+    SerializeValue(archive, "index", index_);
+    SerializeValue(archive, "type", type_);
+    SerializeValue(archive, "hash", hash_);
+    SerializeVectorAsBytes(archive, "data", data_);
+}
+
+SceneSnapshot SceneSnapshot::FromScene(Scene* scene, const SceneSnapshot* previous)
+{
+    SceneSnapshot result;
+    VectorBuffer buffer;
+
+    result.scene_.id_ = scene->GetID();
+    PackSceneAttributes(scene, buffer, result.scene_);
+    result.checksum_ = result.scene_.hash_;
+
+    const auto packComponents = [&](Node* node)
+    {
+        unsigned index = 0;
+        for (Component* component : node->GetComponents())
+        {
+            if (component->IsTemporary())
+                continue;
+
+            PackedSceneObject& data = result.components_.emplace_back();
+            data.id_ = component->GetID();
+            data.parentId_ = node->GetID();
+            data.index_ = index++;
+            data.type_ = component->GetType();
+
+            // Component setters don't track changes, so components are always packed. Hash is reused if data is the same.
+            const PackedSceneObject* previousData = previous ? previous->GetComponent(data.id_) : nullptr;
+            PackComponentAttributes(component, buffer, data, previousData);
+
+            result.componentIndices_[data.id_] = result.components_.size() - 1;
+            CombineHash(result.checksum_, data.hash_);
+        }
+    };
+
+    packComponents(scene);
+
+    // Parents are packed before children so the nodes can be re-created in order.
+    // Index among persistent children is calculated when the children are pushed.
+    ea::vector<ea::pair<Node*, unsigned>> stack;
+    const auto pushChildren = [&](Node* parent)
+    {
+        const ea::vector<SharedPtr<Node>>& children = parent->GetChildren();
+        const unsigned numPersistent = ea::count_if(children.begin(), children.end(),
+            [](const SharedPtr<Node>& child) { return !child->IsTemporary(); });
+
+        unsigned index = numPersistent;
+        for (auto iter = children.rbegin(); iter != children.rend(); ++iter)
+        {
+            if (!(*iter)->IsTemporary())
+                stack.emplace_back(*iter, --index);
+        }
+    };
+
+    pushChildren(scene);
+
+    while (!stack.empty())
+    {
+        const auto [node, persistentIndex] = stack.back();
+        stack.pop_back();
+
+        PackedSceneObject& data = result.nodes_.emplace_back();
+        data.id_ = node->GetID();
+        data.parentId_ = node->GetParent()->GetID();
+        data.index_ = persistentIndex;
+
+        // Attributes of the node are packed again only if they were changed since previous snapshot
+        const PackedSceneObject* previousData = previous ? previous->GetNode(data.id_) : nullptr;
+        const unsigned previousIndex = previousData ? previousData - previous->nodes_.data() : M_MAX_UNSIGNED;
+        if (previousData && previous->nodeObjects_[previousIndex] == node
+            && previous->nodeRevisions_[previousIndex] == node->GetAttributesRevision())
+        {
+            data.data_ = previousData->data_;
+            data.hash_ = previousData->hash_;
+        }
+        else
+            PackNodeAttributes(node, buffer, data);
+
+        result.nodeIndices_[data.id_] = result.nodes_.size() - 1;
+        result.nodeObjects_.emplace_back(node);
+        result.nodeRevisions_.push_back(node->GetAttributesRevision());
+        CombineHash(result.checksum_, data.hash_);
+
+        packComponents(node);
+        pushChildren(node);
+    }
+
+    return result;
+}
+
+const PackedSceneObject* SceneSnapshot::GetNode(unsigned id) const
+{
+    const auto iter = nodeIndices_.find(id);
+    return iter != nodeIndices_.end() ? &nodes_[iter->second] : nullptr;
+}
+
+const PackedSceneObject* SceneSnapshot::GetComponent(unsigned id) const
+{
+    const auto iter = componentIndices_.find(id);
+    return iter != componentIndices_.end() ? &components_[iter->second] : nullptr;
+}
+
+SceneDiff SceneDiff::Compute(const SceneSnapshot& from, const SceneSnapshot& to)
+{
+    SceneDiff result;
+
+    if (!from.GetScene().IsSameAs(to.GetScene()) || from.GetScene().data_ != to.GetScene().data_)
+    {
+        result.sceneChanged_ = true;
+        result.scene_ = to.GetScene();
+    }
+
+    for (const PackedSceneObject& data : from.GetNodes())
+    {
+        if (!to.GetNode(data.id_))
+            result.removedNodes_.push_back(data.id_);
+    }
+
+    for (const PackedSceneObject& data : from.GetComponents())
+    {
+        const PackedSceneObject* newData = to.GetComponent(data.id_);
+        // Components cannot be moved between nodes, so they are re-created
+        if (!newData || newData->parentId_ != data.parentId_ || newData->type_ != data.type_)
+            result.removedComponents_.push_back(data.id_);
+    }
+
+    // Hashes are only used to skip the comparison of data, equal hashes are not trusted
+    const auto isChanged = [](const PackedSceneObject* oldData, const PackedSceneObject& newData)
+    {
+        return !oldData || !oldData->IsSameAs(newData) || oldData->data_ != newData.data_;
+    };
+
+    for (const PackedSceneObject& data : to.GetNodes())
+    {
+        if (isChanged(from.GetNode(data.id_), data))
+            result.nodes_.push_back(data);
+    }
+
+    for (const PackedSceneObject& data : to.GetComponents())
+    {
+        if (isChanged(from.GetComponent(data.id_), data))
+            result.components_.push_back(data);
+    }
+
+    return result;
+}
+
+void SceneDiff::Apply(Scene* scene) const
+{
+    URHO3D_PROFILE("ApplySceneDiff");
+
+    // Nodes are created and moved before removal, so the nodes moved out of removed nodes are kept
+    ea::vector<Node*> changedNodes;
+    for (const PackedSceneObject& data : nodes_)
+    {
+        Node* parent = scene->GetNode(data.parentId_);
+        if (!parent)
+        {
+            URHO3D_LOGERROR("Cannot find parent node {} of node {}", data.parentId_, data.id_);
+            changedNodes.push_back(nullptr);
+            continue;
+        }
+
+        Node* node = scene->GetNode(data.id_);
+        if (!node)
+        {
+            node = parent->CreateChild(data.id_, false);
+            if (node->GetID() != data.id_)
+            {
+                URHO3D_LOGERROR("Cannot create node {}", data.id_);
+                node->Remove();
+                changedNodes.push_back(nullptr);
+                continue;
+            }
+        }
+        else if (node->GetParent() != parent)
+            parent->AddChild(node);
+
+        UnpackNodeAttributes(node, data);
+        changedNodes.push_back(node);
+    }
+
+    for (unsigned id : removedComponents_)
+    {
+        if (Component* component = scene->GetComponent(id))
+            component->Remove();
+    }
+
+    for (unsigned id : removedNodes_)
+    {
+        if (Node* node = scene->GetNode(id))
+            node->Remove();
+    }
+
+    // Nodes are reordered when there are no removed siblings left, temporary siblings keep their places
+    for (unsigned i = 0; i < nodes_.size(); ++i)
+    {
+        if (Node* node = changedNodes[i])
+        {
+            Node* parent = node->GetParent();
+            parent->ReorderChild(node, GetActualIndex(parent->GetChildren(), node, nodes_[i].index_));
+        }
+    }
+
+    ea::vector<Component*> changedComponents;
+    for (const PackedSceneObject& data : components_)
+    {
+        Node* node = scene->GetNode(data.parentId_);
+        if (!node)
+        {
+            URHO3D_LOGERROR("Cannot find owner node {} of component {}", data.parentId_, data.id_);
+            changedComponents.push_back(nullptr);
+            continue;
+        }
+
+        Component* component = scene->GetComponent(data.id_);
+        if (!component)
+        {
+            component = node->CreateComponent(data.type_, data.id_);
+            if (!component || component->GetID() != data.id_)
+            {
+                URHO3D_LOGERROR("Cannot create component {}", data.id_);
+                if (component)
+                    component->Remove();
+                changedComponents.push_back(nullptr);
+                continue;
+            }
+        }
+
+        UnpackComponentAttributes(component, data);
+        changedComponents.push_back(component);
+    }
+
+    for (unsigned i = 0; i < components_.size(); ++i)
+    {
+        if (Component* component = changedComponents[i])
+        {
+            Node* node = component->GetNode();
+            node->ReorderComponent(component, GetActualIndex(node->GetComponents(), component, components_[i].index_));
+        }
+    }
+
+    // Apply attributes when all objects exist, so references by ID are resolved
+    for (Component* component : changedComponents)
+    {
+        if (component)
+            component->ApplyAttributes();
+    }
+
+    if (sceneChanged_)
+        UnpackSceneAttributes(scene, scene_);
+}
+
+void SceneDiff::SerializeInBlock(Archive& archive)
+{
+    SerializeValue(archive, "sceneChanged", sceneChanged_);
+    if (sceneChanged_)
+        SerializeValue(archive, "scene", scene_);
+    SerializeVectorAsObjects(archive, "nodes", nodes_, "node");
+    SerializeVectorAsObjects(archive, "components", components_, "component");
+    SerializeVectorAsBytes(archive, "removedNodes", removedNodes_);
+    SerializeVectorAsBytes(archive, "removedComponents", removedComponents_);
+}
+
+bool SceneDiff::IsEmpty() const
+{
+    return !sceneChanged_ && nodes_.empty() && components_.empty() && removedNodes_.empty()
+        && removedComponents_.empty();
+}
+
+}
@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2017-2022 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/ByteVector.h"
+#include "../Container/Ptr.h"
+#include "../Math/StringHash.h"
+
+#include <EASTL/unordered_map.h>
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Archive;
+class Node;
+class Scene;
+
+/// Attributes of scene, node or component packed without hierarchy.
+struct URHO3D_API PackedSceneObject
+{
+    /// Serialize content from/to archive. May throw ArchiveException.
+    void SerializeInBlock(Archive& archive);
+    /// Return whether the object has the same content and placement.
+    bool IsSameAs(const PackedSceneObject& rhs) const
+    {
+        return hash_ == rhs.hash_ && data_.size() == rhs.data_.size() && parentId_ == rhs.parentId_
+            && index_ == rhs.index_ && type_ == rhs.type_;
+    }
+
+    /// Object ID.
+    unsigned id_{};
+    /// ID of parent node for nodes, ID of owner node for components.
+    unsigned parentId_{};
+    /// Index among persistent children of parent node or among persistent components of owner node.
+    unsigned index_{};
+    /// Type of component. Empty for nodes.
+    StringHash type_;
+    /// Hash of attribute data.
+    unsigned long long hash_{};
+    /// Attributes serialized to binary archive.
+    ByteVector data_;
+};
+
+/// Snapshot of scene content packed per object.
+/// Objects are packed independently and hashed, so snapshots can be compared object by object.
+/// Temporary nodes and components are skipped, like in serialization.
+/// If previous snapshot of the same scene is provided, only the nodes with changed attributes revision
+/// are packed and hashed again. Component setters don't track changes, so components are always packed,
+/// and only the components with changed data are hashed again.
+class URHO3D_API SceneSnapshot
+{
+public:
+    /// Pack scene. Reuse packed data of unchanged nodes and hashes of unchanged components from previous snapshot if provided.
+    static SceneSnapshot FromScene(Scene* scene, const SceneSnapshot* previous = nullptr);
+
+    /// Return packed attributes of the scene itself.
+    const PackedSceneObject& GetScene() const { return scene_; }
+    /// Return packed nodes in depth-first order, parents go before children.
+    const ea::vector<PackedSceneObject>& GetNodes() const { return nodes_; }
+    /// Return packed components in order of nodes.
+    const ea::vector<PackedSceneObject>& GetComponents() const { return components_; }
+    /// Return packed node by ID.
+    const PackedSceneObject* GetNode(unsigned id) const;
+    /// Return packed component by ID.
+    const PackedSceneObject* GetComponent(unsigned id) const;
+    /// Return checksum of the whole snapshot.
+    unsigned long long GetChecksum() const { return checksum_; }
+
+private:
+    /// Scene attributes.
+    PackedSceneObject scene_;
+    /// Nodes.
+    ea::vector<PackedSceneObject> nodes_;
+    /// Components.
+    ea::vector<PackedSceneObject> components_;
+    /// Node index by ID.
+    ea::unordered_map<unsigned, unsigned> nodeIndices_;
+    /// Component index by ID.
+    ea::unordered_map<unsigned, unsigned> componentIndices_;
+    /// Packed nodes, used to reuse packed data in the next snapshot. Not serialized.
+    ea::vector<WeakPtr<Node>> nodeObjects_;
+    /// Attributes revisions of packed nodes. Not serialized.
+    ea::vector<unsigned> nodeRevisions_;
+    /// Checksum of the whole snapshot.
+    unsigned long long checksum_{};
+};
+
+/// Set of changes between two scene snapshots.
+/// Contains only added, changed and removed objects, so it can be stored and applied much faster than the whole scene.
+class URHO3D_API SceneDiff
+{
+public:
+    /// Compute changes needed to convert scene from the first state into the second one.
+    static SceneDiff Compute(const SceneSnapshot& from, const SceneSnapshot& to);
+
+    /// Apply changes to the scene. Scene is expected to be in the initial state of the diff.
+    void Apply(Scene* scene) const;
+    /// Serialize content from/to archive. May throw ArchiveException.
+    void SerializeInBlock(Archive& archive);
+
+    /// Return whether there are no changes.
+    bool IsEmpty() const;
+    /// Return number of added or changed nodes.
+    unsigned GetNumChangedNodes() const { return nodes_.size(); }
+    /// Return number of added or changed components.
+    unsigned GetNumChangedComponents() const { return components_.size(); }
+    /// Return number of removed nodes.
+    unsigned GetNumRemovedNodes() const { return removedNodes_.size(); }
+    /// Return number of removed components.
+    unsigned GetNumRemovedComponents() const { return removedComponents_.size(); }
+
+private:
+    /// Whether the attributes of the scene itself are changed.
+    bool sceneChanged_{};
+    /// New attributes of the scene itself.
+    PackedSceneObject scene_;
+    /// Added or changed nodes in depth-first order.
+    ea::vector<PackedSceneObject> nodes_;
+    /// Added or changed components.
+    ea::vector<PackedSceneObject> components_;
+    /// IDs of removed nodes.
+    ea::vector<unsigned> removedNodes_;
+    /// IDs of removed components.
+    ea::vector<unsigned> removedComponents_;
+};
+
+}